@@ -0,0 +1,219 @@
+/**
+ ********************************************************************
+ * @file    dji_camera_stream_encoder_benchmark.cpp
+ * @brief   Encoder latency and bit rate adherence of DJICameraStreamEncoder on synthetic frames.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* The benchmark has its own main, it is only compiled by the benchmark target of the platform CMakeLists. */
+#ifdef DJI_SAMPLE_BENCHMARK
+
+/* Includes ------------------------------------------------------------------*/
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <unistd.h>
+#include <vector>
+#include "liveview/dji_camera_stream_encoder.hpp"
+
+/* Private constants ---------------------------------------------------------*/
+#define ENCODER_BENCHMARK_WIDTH_DEFAULT         (1280)
+#define ENCODER_BENCHMARK_HEIGHT_DEFAULT        (720)
+#define ENCODER_BENCHMARK_FRAME_RATE_DEFAULT    (30)
+#define ENCODER_BENCHMARK_BIT_RATE_DEFAULT      (4 * 1000 * 1000)
+#define ENCODER_BENCHMARK_FRAME_COUNT_DEFAULT   (900)
+// Side of the noise block moving over the frame, keeps the encoder busy with content that does not predict well
+#define ENCODER_BENCHMARK_NOISE_BLOCK_SIZE      (128)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t byteCount;
+    uint32_t packetCount;
+} T_EncoderBenchmarkOutput;
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static double EncoderBenchmark_GetTimeMs(void);
+static void EncoderBenchmark_FillFrame(std::vector<uint8_t> &frame, uint32_t width, uint32_t height,
+                                       uint32_t index, uint32_t &seed);
+static void EncoderBenchmark_OutputCallback(const uint8_t *buf, int bufLen, void *userData);
+static double EncoderBenchmark_GetPercentile(std::vector<double> &values, double percent);
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_DjiCameraStreamEncoderConfig config = {};
+    T_DjiCameraStreamEncoderStatistics statistics;
+    T_EncoderBenchmarkOutput output = {};
+    DJICameraStreamEncoder encoder;
+    std::vector<uint8_t> frame;
+    std::vector<double> latencyMs;
+    uint32_t frameCount = ENCODER_BENCHMARK_FRAME_COUNT_DEFAULT;
+    uint32_t failedCount = 0;
+    uint32_t seed = 0x2545F491;
+    bool isPaced = false;
+    double startMs;
+    double elapsedMs;
+
+    if (argc > 1 && argc != 6 && argc != 7) {
+        printf("usage: %s [width height frameRate bitRate frameCount [paced]]\n", argv[0]);
+        printf("  paced: 1 hands frames over at the frame rate like a camera, 0 as fast as possible\n");
+        return -1;
+    }
+
+    config.width = ENCODER_BENCHMARK_WIDTH_DEFAULT;
+    config.height = ENCODER_BENCHMARK_HEIGHT_DEFAULT;
+    config.frameRate = ENCODER_BENCHMARK_FRAME_RATE_DEFAULT;
+    config.bitRate = ENCODER_BENCHMARK_BIT_RATE_DEFAULT;
+    config.useIntraRefresh = true;
+    if (argc > 1) {
+        config.width = (uint32_t) strtoul(argv[1], nullptr, 0) & ~1u;
+        config.height = (uint32_t) strtoul(argv[2], nullptr, 0) & ~1u;
+        config.frameRate = (uint32_t) strtoul(argv[3], nullptr, 0);
+        config.bitRate = (uint32_t) strtoul(argv[4], nullptr, 0);
+        frameCount = (uint32_t) strtoul(argv[5], nullptr, 0);
+        isPaced = argc == 7 && atoi(argv[6]) != 0;
+    }
+
+    if (!encoder.init(config)) {
+        printf("init encoder failed, %ux%u %u fps %u bps\n", config.width, config.height, config.frameRate,
+               config.bitRate);
+        return -1;
+    }
+    encoder.registerCallback(EncoderBenchmark_OutputCallback, &output);
+
+    frame.resize((size_t) config.width * config.height * 3 / 2);
+    latencyMs.reserve(frameCount);
+
+    startMs = EncoderBenchmark_GetTimeMs();
+    for (uint32_t i = 0; i < frameCount; i++) {
+        double frameStartMs;
+
+        /* Filling the frame is not part of the measured latency, the camera delivers it ready. */
+        EncoderBenchmark_FillFrame(frame, config.width, config.height, i, seed);
+
+        frameStartMs = EncoderBenchmark_GetTimeMs();
+        if (!encoder.encodeFrame(frame.data(), config.width, config.height, DJI_CAMERA_IMAGE_FORMAT_NV12)) {
+            failedCount++;
+        }
+        latencyMs.push_back(EncoderBenchmark_GetTimeMs() - frameStartMs);
+
+        if (isPaced) {
+            double nextFrameMs = startMs + (double) (i + 1) * 1000 / config.frameRate;
+            double waitMs = nextFrameMs - EncoderBenchmark_GetTimeMs();
+            if (waitMs > 0) {
+                usleep((useconds_t) (waitMs * 1000));
+            }
+        }
+    }
+    elapsedMs = EncoderBenchmark_GetTimeMs() - startMs;
+
+    encoder.getStatistics(statistics);
+    encoder.cleanup();
+
+    printf("frames: %u x %ux%u NV12, %u fps, target %u bps, %s\n", frameCount, config.width, config.height,
+           config.frameRate, config.bitRate, isPaced ? "paced" : "unpaced");
+    printf("throughput: %.1f fps over %.1f s, failed frames: %u\n",
+           elapsedMs > 0 ? frameCount * 1000.0 / elapsedMs : 0.0, elapsedMs / 1000, failedCount);
+    printf("latency ms: avg %.2f p50 %.2f p95 %.2f p99 %.2f max %.2f\n", statistics.averageLatencyMs,
+           EncoderBenchmark_GetPercentile(latencyMs, 50), EncoderBenchmark_GetPercentile(latencyMs, 95),
+           EncoderBenchmark_GetPercentile(latencyMs, 99), statistics.maxLatencyMs);
+    printf("bit rate: avg %.0f bps (%+.1f%% of target), peak 1 s window %.0f bps (%+.1f%% of target)\n",
+           statistics.averageBitRate, (statistics.averageBitRate / config.bitRate - 1) * 100,
+           statistics.peakBitRate, (statistics.peakBitRate / config.bitRate - 1) * 100);
+    printf("output: %llu bytes in %u packets, %llu key frames\n", (unsigned long long) output.byteCount,
+           output.packetCount, (unsigned long long) statistics.keyFrameCount);
+
+    return failedCount == 0 ? 0 : -1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static double EncoderBenchmark_GetTimeMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec * 1000 + (double) ts.tv_nsec / 1000000;
+}
+
+static void EncoderBenchmark_FillFrame(std::vector<uint8_t> &frame, uint32_t width, uint32_t height,
+                                       uint32_t index, uint32_t &seed)
+{
+    uint8_t *luma = frame.data();
+    uint8_t *chroma = luma + (size_t) width * height;
+    uint32_t blockSize = std::min<uint32_t>(ENCODER_BENCHMARK_NOISE_BLOCK_SIZE, std::min(width, height));
+    uint32_t blockX = (index * 8) % (width - blockSize + 1);
+    uint32_t blockY = (index * 4) % (height - blockSize + 1);
+
+    /* A gradient panning by two pixels per frame, which motion search predicts well. */
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            luma[(size_t) y * width + x] = (uint8_t) (x + y + index * 2);
+        }
+    }
+
+    /* A block of fresh noise per frame, which no prediction helps, like foliage or water. */
+    for (uint32_t y = blockY; y < blockY + blockSize; y++) {
+        for (uint32_t x = blockX; x < blockX + blockSize; x++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            luma[(size_t) y * width + x] = (uint8_t) seed;
+        }
+    }
+
+    for (uint32_t y = 0; y < height / 2; y++) {
+        for (uint32_t x = 0; x < width / 2; x++) {
+            chroma[(size_t) y * width + x * 2] = (uint8_t) (128 + x / 8 - index % 32);
+            chroma[(size_t) y * width + x * 2 + 1] = (uint8_t) (128 + y / 8);
+        }
+    }
+}
+
+static void EncoderBenchmark_OutputCallback(const uint8_t *buf, int bufLen, void *userData)
+{
+    T_EncoderBenchmarkOutput *output = (T_EncoderBenchmarkOutput *) userData;
+
+    (void) buf;
+
+    output->byteCount += bufLen;
+    output->packetCount++;
+}
+
+static double EncoderBenchmark_GetPercentile(std::vector<double> &values, double percent)
+{
+    size_t index;
+
+    if (values.empty()) {
+        return 0;
+    }
+
+    index = (size_t) ((values.size() - 1) * percent / 100);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+
+    return values[index];
+}
+
+#endif
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
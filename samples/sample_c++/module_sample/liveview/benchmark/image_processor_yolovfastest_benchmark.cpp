@@ -0,0 +1,164 @@
+/**
+ ********************************************************************
+ * @file    image_processor_yolovfastest_benchmark.cpp
+ * @brief   Per-stage timing of ImageProcessorYolovFastest over a directory of recorded frames.
+ *
+ * @copyright (c) 2023 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* The benchmark has its own main, it is only compiled by the benchmark target of the platform CMakeLists. */
+#if defined(DJI_SAMPLE_BENCHMARK) && defined(OPEN_CV_INSTALLED)
+
+/* Includes ------------------------------------------------------------------*/
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <string>
+#include <vector>
+#include "liveview/image_processor_yolovfastest.hpp"
+
+/* Private constants ---------------------------------------------------------*/
+// Frames processed before timing starts, the first forward pass allocates the layers of the network
+#define YOLO_BENCHMARK_WARM_UP_FRAME_COUNT  (5)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+static const char *s_stageNames[ImageProcessorYolovFastest::kStageCount] = {"preprocess", "forward", "postprocess"};
+static uint64_t s_detectionCount = 0;
+
+/* Private functions declaration ---------------------------------------------*/
+static bool YoloBenchmark_LoadFrames(const char *dirPath, std::vector<std::shared_ptr<cv::Mat>> &frames);
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    ImageProcessorYolovFastest::StageTiming warmUpTiming[ImageProcessorYolovFastest::kStageCount];
+    ImageProcessorYolovFastest::StageTiming timing[ImageProcessorYolovFastest::kStageCount];
+    std::vector<std::shared_ptr<cv::Mat>> frames;
+    std::vector<T_DjiLiveViewBoundingBox> boundingBoxes;
+    uint32_t repeatCount = 1;
+    double totalMs = 0;
+    int64_t startTick;
+    double elapsedMs;
+
+    if (argc < 2 || argc > 3) {
+        printf("usage: %s <frame directory> [repeat count]\n", argv[0]);
+        printf("  frames are the .jpg, .png and .bmp files of the directory, e.g. exported from a recorded flight\n");
+        return -1;
+    }
+    if (argc == 3) {
+        repeatCount = std::max(1, atoi(argv[2]));
+    }
+
+    if (!YoloBenchmark_LoadFrames(argv[1], frames)) {
+        printf("no frames found in %s\n", argv[1]);
+        return -1;
+    }
+
+    ImageProcessorYolovFastest processor("YOLOvFastest");
+    if (processor.Init() != 0) {
+        printf("load network failed, see the data directory next to image_processor_yolovfastest.cpp\n");
+        return -1;
+    }
+    processor.SetDetectionCallback([](const std::vector<ImageProcessorYolovFastest::Detection> &detections) {
+        s_detectionCount += detections.size();
+    });
+
+    /* The stage timing of the processor cannot be reset, the warm-up is subtracted from the averages below. */
+    for (uint32_t i = 0; i < YOLO_BENCHMARK_WARM_UP_FRAME_COUNT; i++) {
+        processor.Process(frames[i % frames.size()], boundingBoxes);
+    }
+    processor.GetStageTiming(warmUpTiming);
+    s_detectionCount = 0;
+
+    startTick = cv::getTickCount();
+    for (uint32_t i = 0; i < repeatCount; i++) {
+        for (size_t j = 0; j < frames.size(); j++) {
+            processor.Process(frames[j], boundingBoxes);
+        }
+    }
+    elapsedMs = (cv::getTickCount() - startTick) * 1000.0 / cv::getTickFrequency();
+
+    processor.GetStageTiming(timing);
+    printf("frames: %zu x %u, %s\n", frames.size(), repeatCount, argv[1]);
+    for (int i = 0; i < ImageProcessorYolovFastest::kStageCount; i++) {
+        uint64_t count = timing[i].count - warmUpTiming[i].count;
+        double sumMs = timing[i].average_ms * timing[i].count - warmUpTiming[i].average_ms * warmUpTiming[i].count;
+        double averageMs = count > 0 ? sumMs / count : 0;
+
+        totalMs += averageMs;
+        printf("%-12s avg %7.2f ms, max %7.2f ms (including warm-up)\n", s_stageNames[i], averageMs,
+               timing[i].max_ms);
+    }
+    for (int i = 0; i < ImageProcessorYolovFastest::kStageCount; i++) {
+        uint64_t count = timing[i].count - warmUpTiming[i].count;
+        double sumMs = timing[i].average_ms * timing[i].count - warmUpTiming[i].average_ms * warmUpTiming[i].count;
+
+        printf("%-12s share %5.1f%%\n", s_stageNames[i],
+               totalMs > 0 && count > 0 ? sumMs / count / totalMs * 100 : 0);
+    }
+    printf("throughput: %.1f fps, %.2f detections per frame\n",
+           elapsedMs > 0 ? frames.size() * repeatCount * 1000.0 / elapsedMs : 0.0,
+           (double) s_detectionCount / (frames.size() * repeatCount));
+
+    return 0;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static bool YoloBenchmark_LoadFrames(const char *dirPath, std::vector<std::shared_ptr<cv::Mat>> &frames)
+{
+    std::vector<std::string> fileNames;
+    struct dirent *entry;
+    DIR *dir;
+
+    dir = opendir(dirPath);
+    if (dir == nullptr) {
+        return false;
+    }
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+        size_t dot = name.rfind('.');
+        std::string extension = dot == std::string::npos ? "" : name.substr(dot + 1);
+
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == "jpg" || extension == "jpeg" || extension == "png" || extension == "bmp") {
+            fileNames.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    /* Recorded frames are numbered, keep their order so runs on the same directory are comparable. */
+    std::sort(fileNames.begin(), fileNames.end());
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        cv::Mat frame = cv::imread(std::string(dirPath) + "/" + fileNames[i], cv::IMREAD_COLOR);
+
+        if (!frame.empty()) {
+            frames.push_back(std::make_shared<cv::Mat>(frame));
+        }
+    }
+
+    return !frames.empty();
+}
+
+#endif
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
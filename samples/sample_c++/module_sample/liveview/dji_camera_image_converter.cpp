@@ -0,0 +1,408 @@
+/**
+ ********************************************************************
+ * @file    dji_camera_image_converter.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_camera_image_converter.hpp"
+#include <algorithm>
+#include "dji_liveview_trace.hpp"
+#include "dji_logger.h"
+
+extern "C" {
+#ifdef FFMPEG_INSTALLED
+#include <libavutil/pixfmt.h>
+#endif
+}
+
+/* Private constants ---------------------------------------------------------*/
+#define DJI_CAMERA_IMAGE_CONVERTER_RGB_PIXEL_SIZE    (3)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+DJICameraImageConverter::DJICameraImageConverter(uint32_t sliceCount, uint32_t poolCapacity)
+    : m_sliceCount(1),
+      m_width(0),
+      m_height(0),
+      m_pixelFormat(-1),
+      m_sliceHeight(0),
+      m_maxWidth(0),
+      m_maxHeight(0),
+      m_downscaleFactor(1),
+#ifdef FFMPEG_INSTALLED
+      m_scaleContext(nullptr),
+#endif
+      m_pool(poolCapacity),
+      m_droppedFrameCount(0),
+      m_workImage(nullptr),
+      m_workRgbData(nullptr),
+      m_workGeneration(0),
+      m_workSliceCount(0),
+      m_workNextSlice(0),
+      m_workPendingCount(0),
+      m_isStopping(false)
+{
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_mutex_init(&m_workMutex, nullptr);
+    pthread_cond_init(&m_workCond, nullptr);
+    pthread_cond_init(&m_doneCond, nullptr);
+    setSliceCount(sliceCount);
+}
+
+DJICameraImageConverter::~DJICameraImageConverter()
+{
+    pthread_mutex_lock(&m_workMutex);
+    m_isStopping = true;
+    pthread_cond_broadcast(&m_workCond);
+    pthread_mutex_unlock(&m_workMutex);
+    for (auto worker : m_workers) {
+        pthread_join(worker, nullptr);
+    }
+
+    freeContexts();
+#ifdef FFMPEG_INSTALLED
+    sws_freeContext(m_scaleContext);
+#endif
+    pthread_cond_destroy(&m_doneCond);
+    pthread_cond_destroy(&m_workCond);
+    pthread_mutex_destroy(&m_workMutex);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+void DJICameraImageConverter::setSliceCount(uint32_t sliceCount)
+{
+    if (sliceCount < 1) {
+        sliceCount = 1;
+    } else if (sliceCount > DJI_CAMERA_IMAGE_CONVERTER_SLICE_NUM_MAX) {
+        sliceCount = DJI_CAMERA_IMAGE_CONVERTER_SLICE_NUM_MAX;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    if (sliceCount != m_sliceCount) {
+        /* The contexts are sized for their slice, they are built again on the next frame. */
+        freeContexts();
+        m_sliceCount = sliceCount;
+    }
+    /* The calling thread converts a slice itself, the pool only grows and is joined by the destructor. */
+    startWorkers(m_sliceCount - 1);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void DJICameraImageConverter::setMaxResolution(uint32_t maxWidth, uint32_t maxHeight)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_maxWidth = maxWidth;
+    m_maxHeight = maxHeight;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void DJICameraImageConverter::setDownscaleFactor(uint32_t factor)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_downscaleFactor = factor > 0 ? factor : 1;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool DJICameraImageConverter::convertToRGB(const CameraRGBImage &image, CameraRGBImage &rgbImage)
+{
+#ifdef FFMPEG_INSTALLED
+    AVPixelFormat pixelFormat;
+    std::shared_ptr<DJICameraImageBuffer> rgbBuffer;
+    int outWidth;
+    int outHeight;
+    size_t rgbSize;
+    int64_t startTimeUs;
+
+    if (image.format == DJI_CAMERA_IMAGE_FORMAT_YUV420P) {
+        pixelFormat = image.isFullRange ? AV_PIX_FMT_YUVJ420P : AV_PIX_FMT_YUV420P;
+    } else if (image.format == DJI_CAMERA_IMAGE_FORMAT_NV12) {
+        pixelFormat = AV_PIX_FMT_NV12;
+    } else {
+        return false;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    getOutputSize(image.width, image.height, outWidth, outHeight);
+    pthread_mutex_unlock(&m_mutex);
+
+    rgbSize = (size_t) outWidth * outHeight * DJI_CAMERA_IMAGE_CONVERTER_RGB_PIXEL_SIZE;
+    rgbBuffer = m_pool.acquire(rgbSize);
+    if (rgbBuffer == nullptr) {
+        /* Every pooled buffer is still held downstream, drop this frame instead of growing. */
+        pthread_mutex_lock(&m_mutex);
+        m_droppedFrameCount++;
+        if (1 == m_droppedFrameCount || 0 == m_droppedFrameCount % 100) {
+            USER_LOG_WARN("Image pool exhausted, %u frames dropped.", m_droppedFrameCount);
+        }
+        pthread_mutex_unlock(&m_mutex);
+        return false;
+    }
+
+    startTimeUs = DjiLiveviewTrace_GetTimeUs();
+    pthread_mutex_lock(&m_mutex);
+    if (outWidth != image.width || outHeight != image.height) {
+        const uint8_t *srcData[DJI_CAMERA_IMAGE_PLANE_NUM_MAX + 1] = {nullptr};
+        int srcStride[DJI_CAMERA_IMAGE_PLANE_NUM_MAX + 1] = {0};
+        uint8_t *dstData[1] = {rgbBuffer->data.data()};
+        int dstStride[1] = {outWidth * DJI_CAMERA_IMAGE_CONVERTER_RGB_PIXEL_SIZE};
+
+        for (int i = 0; i < image.planeCount; i++) {
+            srcData[i] = image.planeData[i];
+            srcStride[i] = image.planeStride[i];
+        }
+
+        m_scaleContext = sws_getCachedContext(m_scaleContext, image.width, image.height, pixelFormat,
+                                              outWidth, outHeight, AV_PIX_FMT_RGB24,
+                                              SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+        if (m_scaleContext == nullptr) {
+            pthread_mutex_unlock(&m_mutex);
+            return false;
+        }
+        sws_scale(m_scaleContext, srcData, srcStride, 0, image.height, dstData, dstStride);
+    } else if (!prepareContexts(image.width, image.height, pixelFormat)) {
+        pthread_mutex_unlock(&m_mutex);
+        return false;
+    } else {
+        convertSlices(image, rgbBuffer->data.data());
+    }
+    pthread_mutex_unlock(&m_mutex);
+    DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_CONVERT, image.traceId, startTimeUs,
+                            DjiLiveviewTrace_GetTimeUs());
+
+    rgbImage = CameraRGBImage();
+    rgbImage.buffer = rgbBuffer;
+    rgbImage.rawData = rgbBuffer->data.data();
+    rgbImage.rawDataSize = rgbSize;
+    rgbImage.height = outHeight;
+    rgbImage.width = outWidth;
+    rgbImage.planeCount = 1;
+    rgbImage.planeData[0] = rgbImage.rawData;
+    rgbImage.planeStride[0] = outWidth * DJI_CAMERA_IMAGE_CONVERTER_RGB_PIXEL_SIZE;
+    rgbImage.traceId = image.traceId;
+
+    return true;
+#else
+    (void) image;
+    (void) rgbImage;
+    return false;
+#endif
+}
+
+uint32_t DJICameraImageConverter::getDroppedFrameCount()
+{
+    uint32_t count;
+
+    pthread_mutex_lock(&m_mutex);
+    count = m_droppedFrameCount;
+    pthread_mutex_unlock(&m_mutex);
+
+    return count;
+}
+
+/* Private functions definition-----------------------------------------------*/
+bool DJICameraImageConverter::prepareContexts(int width, int height, int pixelFormat)
+{
+#ifdef FFMPEG_INSTALLED
+    if (!m_contexts.empty() && width == m_width && height == m_height && pixelFormat == m_pixelFormat) {
+        return true;
+    }
+
+    freeContexts();
+
+    /* Slices start on even rows, so every slice owns whole rows of the subsampled chroma planes. */
+    m_sliceHeight = ((height + m_sliceCount - 1) / m_sliceCount + 1) & ~1;
+    for (int sliceY = 0; sliceY < height; sliceY += m_sliceHeight) {
+        int sliceHeight = std::min(m_sliceHeight, height - sliceY);
+        SwsContext *context = sws_getContext(width, sliceHeight, (AVPixelFormat) pixelFormat,
+                                             width, sliceHeight, AV_PIX_FMT_RGB24,
+                                             SWS_BICUBIC, nullptr, nullptr, nullptr);
+        if (context == nullptr) {
+            USER_LOG_ERROR("Create scaler context for %dx%d failed.", width, sliceHeight);
+            freeContexts();
+            return false;
+        }
+        m_contexts.push_back(context);
+    }
+
+    m_width = width;
+    m_height = height;
+    m_pixelFormat = pixelFormat;
+
+    return true;
+#else
+    (void) width;
+    (void) height;
+    (void) pixelFormat;
+    return false;
+#endif
+}
+
+void DJICameraImageConverter::getOutputSize(int width, int height, int &outWidth, int &outHeight)
+{
+    double scale = 1.0 / m_downscaleFactor;
+
+    if (m_maxWidth > 0 && width * scale > m_maxWidth) {
+        scale = (double) m_maxWidth / width;
+    }
+    if (m_maxHeight > 0 && height * scale > m_maxHeight) {
+        scale = (double) m_maxHeight / height;
+    }
+
+    if (scale >= 1.0) {
+        outWidth = width;
+        outHeight = height;
+        return;
+    }
+
+    /* Even sizes keep every scaler path available. */
+    outWidth = std::max(2, (int) (width * scale) & ~1);
+    outHeight = std::max(2, (int) (height * scale) & ~1);
+}
+
+void DJICameraImageConverter::freeContexts()
+{
+#ifdef FFMPEG_INSTALLED
+    for (auto context : m_contexts) {
+        sws_freeContext(context);
+    }
+    m_contexts.clear();
+#endif
+}
+
+void DJICameraImageConverter::convertSlice(uint32_t index, const CameraRGBImage &image, uint8_t *rgbData)
+{
+#ifdef FFMPEG_INSTALLED
+    int sliceY = index * m_sliceHeight;
+    int sliceHeight = std::min(m_sliceHeight, image.height - sliceY);
+    const uint8_t *srcData[DJI_CAMERA_IMAGE_PLANE_NUM_MAX + 1] = {nullptr};
+    int srcStride[DJI_CAMERA_IMAGE_PLANE_NUM_MAX + 1] = {0};
+    uint8_t *dstData[1];
+    int dstStride[1];
+
+    for (int i = 0; i < image.planeCount; i++) {
+        /* Chroma planes of both supported formats have half as many rows as the image. */
+        int planeY = (i == 0) ? sliceY : sliceY / 2;
+        srcData[i] = image.planeData[i] + (size_t) planeY * image.planeStride[i];
+        srcStride[i] = image.planeStride[i];
+    }
+    dstStride[0] = image.width * DJI_CAMERA_IMAGE_CONVERTER_RGB_PIXEL_SIZE;
+    dstData[0] = rgbData + (size_t) sliceY * dstStride[0];
+
+    sws_scale(m_contexts[index], srcData, srcStride, 0, sliceHeight, dstData, dstStride);
+#else
+    (void) index;
+    (void) image;
+    (void) rgbData;
+#endif
+}
+
+/* Called with m_mutex held, so the contexts and the slice height stay as they are until every slice is done. */
+void DJICameraImageConverter::convertSlices(const CameraRGBImage &image, uint8_t *rgbData)
+{
+#ifdef FFMPEG_INSTALLED
+    pthread_mutex_lock(&m_workMutex);
+    m_workImage = &image;
+    m_workRgbData = rgbData;
+    m_workSliceCount = m_contexts.size();
+    m_workNextSlice = 0;
+    m_workPendingCount = m_workSliceCount;
+    m_workGeneration++;
+    if (m_workSliceCount > 1) {
+        pthread_cond_broadcast(&m_workCond);
+    }
+
+    runPendingSlices();
+    while (m_workPendingCount > 0) {
+        pthread_cond_wait(&m_doneCond, &m_workMutex);
+    }
+    m_workImage = nullptr;
+    m_workRgbData = nullptr;
+    pthread_mutex_unlock(&m_workMutex);
+#else
+    (void) image;
+    (void) rgbData;
+#endif
+}
+
+/* Called with m_workMutex held, released while a slice is converted. */
+void DJICameraImageConverter::runPendingSlices()
+{
+    while (m_workNextSlice < m_workSliceCount) {
+        uint32_t index = m_workNextSlice++;
+
+        pthread_mutex_unlock(&m_workMutex);
+        convertSlice(index, *m_workImage, m_workRgbData);
+        pthread_mutex_lock(&m_workMutex);
+
+        if (--m_workPendingCount == 0) {
+            pthread_cond_signal(&m_doneCond);
+        }
+    }
+}
+
+void DJICameraImageConverter::startWorkers(uint32_t workerCount)
+{
+    pthread_t worker;
+
+    while (m_workers.size() < workerCount) {
+        if (pthread_create(&worker, nullptr, workerEntry, this) != 0) {
+            /* The calling thread picks up the slices no worker takes. */
+            USER_LOG_WARN("Create converter worker failed, %u workers running.", (uint32_t) m_workers.size());
+            return;
+        }
+        m_workers.push_back(worker);
+    }
+}
+
+void *DJICameraImageConverter::workerEntry(void *arg)
+{
+    static_cast<DJICameraImageConverter *>(arg)->workerFunc();
+
+    return nullptr;
+}
+
+void DJICameraImageConverter::workerFunc()
+{
+    uint64_t generation;
+
+    pthread_mutex_lock(&m_workMutex);
+    generation = m_workGeneration;
+    while (true) {
+        while (!m_isStopping && generation == m_workGeneration) {
+            pthread_cond_wait(&m_workCond, &m_workMutex);
+        }
+        if (m_isStopping) {
+            break;
+        }
+        generation = m_workGeneration;
+        runPendingSlices();
+    }
+    pthread_mutex_unlock(&m_workMutex);
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,121 @@
+/**
+ ********************************************************************
+ * @file    dji_camera_image_converter.hpp
+ * @brief   This is the header file for "dji_camera_image_converter.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_CAMERA_IMAGE_CONVERTER_H
+#define DJI_CAMERA_IMAGE_CONVERTER_H
+
+/* Includes ------------------------------------------------------------------*/
+extern "C" {
+#ifdef FFMPEG_INSTALLED
+#include <libswscale/swscale.h>
+#endif
+}
+
+#include "pthread.h"
+#include <vector>
+#include "dji_camera_image_handler.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_CAMERA_IMAGE_CONVERTER_SLICE_NUM_MAX    (8)
+
+/* Exported types ------------------------------------------------------------*/
+/*! @note
+ * Converts decoded YUV images to packed RGB24 into buffers of its own pool.
+ * The scaler contexts are created once per resolution and format and reused
+ * for every later frame. With more than one slice the image is cut into
+ * horizontal bands that are converted in parallel, each band by its own
+ * context. The bands are shared between the calling thread and a pool of
+ * worker threads that lives as long as the converter, so no thread is created
+ * per frame. Slicing only applies while the image keeps its size, an image
+ * that is reduced to fit a resolution cap is converted by one scaling context.
+ */
+class DJICameraImageConverter {
+public:
+    explicit DJICameraImageConverter(uint32_t sliceCount = 1,
+                                     uint32_t poolCapacity = DJI_CAMERA_IMAGE_POOL_DEFAULT_CAPACITY);
+    ~DJICameraImageConverter();
+
+    void setSliceCount(uint32_t sliceCount);
+    /*! @brief Limit the RGB output size, the image is reduced keeping its aspect ratio. 0 means no limit. */
+    void setMaxResolution(uint32_t maxWidth, uint32_t maxHeight);
+    /*! @brief Divide both dimensions of the RGB output, applied before the resolution limit. */
+    void setDownscaleFactor(uint32_t factor);
+    bool convertToRGB(const CameraRGBImage &image, CameraRGBImage &rgbImage);
+    uint32_t getDroppedFrameCount();
+
+private:
+    bool prepareContexts(int width, int height, int pixelFormat);
+    void freeContexts();
+    void convertSlice(uint32_t index, const CameraRGBImage &image, uint8_t *rgbData);
+    void convertSlices(const CameraRGBImage &image, uint8_t *rgbData);
+    void runPendingSlices();
+    void startWorkers(uint32_t workerCount);
+    static void *workerEntry(void *arg);
+    void workerFunc();
+    void getOutputSize(int width, int height, int &outWidth, int &outHeight);
+
+    pthread_mutex_t m_mutex;
+    uint32_t m_sliceCount;
+    int m_width;
+    int m_height;
+    int m_pixelFormat;
+    int m_sliceHeight;
+    uint32_t m_maxWidth;
+    uint32_t m_maxHeight;
+    uint32_t m_downscaleFactor;
+#ifdef FFMPEG_INSTALLED
+    std::vector<SwsContext *> m_contexts;
+    SwsContext *m_scaleContext;
+#endif
+    DJICameraImagePool m_pool;
+    uint32_t m_droppedFrameCount;
+
+    /* Slices of the frame being converted, handed out to whichever thread asks first. */
+    std::vector<pthread_t> m_workers;
+    pthread_mutex_t m_workMutex;
+    pthread_cond_t m_workCond;
+    pthread_cond_t m_doneCond;
+    const CameraRGBImage *m_workImage;
+    uint8_t *m_workRgbData;
+    uint64_t m_workGeneration;
+    uint32_t m_workSliceCount;
+    uint32_t m_workNextSlice;
+    uint32_t m_workPendingCount;
+    bool m_isStopping;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DJI_CAMERA_IMAGE_CONVERTER_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
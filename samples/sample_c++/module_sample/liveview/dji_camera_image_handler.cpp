@@ -24,6 +24,8 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "dji_camera_image_handler.hpp"
+#include "dji_camera_image_converter.hpp"
+#include "dji_liveview_trace.hpp"
 
 /* Private constants ---------------------------------------------------------*/
 
@@ -34,10 +36,55 @@
 /* Private functions declaration ---------------------------------------------*/
 
 /* Exported functions definition ---------------------------------------------*/
-DJICameraImageHandler::DJICameraImageHandler() : m_newImageFlag(false)
+CameraRGBImage::CameraRGBImage()
+    : rawData(nullptr),
+      rawDataSize(0),
+      height(0),
+      width(0),
+      format(DJI_CAMERA_IMAGE_FORMAT_RGB24),
+      isFullRange(false),
+      planeCount(0),
+      planeData(),
+      planeStride(),
+      traceId(0)
 {
+}
+
+bool CameraRGBImage::toRGB(CameraRGBImage &rgbImage) const
+{
+    if (format == DJI_CAMERA_IMAGE_FORMAT_RGB24) {
+        rgbImage = *this;
+        return true;
+    }
+
+    if (converter == nullptr) {
+        return false;
+    }
+
+    return converter->convertToRGB(*this, rgbImage);
+}
+
+void CameraRGBImage::release()
+{
+    buffer.reset();
+    frameRef.reset();
+    rawData = nullptr;
+    planeCount = 0;
+}
+
+DJICameraImageHandler::DJICameraImageHandler() : m_img(), m_newImageFlag(false), m_imageWriteTimeUs(0)
+{
+    pthread_condattr_t condAttr;
+
     pthread_mutex_init(&m_mutex, NULL);
-    pthread_cond_init(&m_condv, NULL);
+
+    /* Timed waits count on the monotonic clock, a wall clock step must not
+     * shorten or stretch them.
+     */
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&m_condv, &condAttr);
+    pthread_condattr_destroy(&condAttr);
 }
 
 DJICameraImageHandler::~DJICameraImageHandler()
@@ -46,9 +93,10 @@ DJICameraImageHandler::~DJICameraImageHandler()
     pthread_cond_destroy(&m_condv);
 }
 
-bool DJICameraImageHandler::getNewImageWithLock(CameraRGBImage &copyOfImage, int timeoutMilliSec)
+bool DJICameraImageHandler::getNewImageWithLock(CameraRGBImage &image, int timeoutMilliSec)
 {
     int result;
+    int64_t writeTimeUs = 0;
 
     /*! @note
      * Here result == 0 means successful.
@@ -56,40 +104,89 @@ bool DJICameraImageHandler::getNewImageWithLock(CameraRGBImage &copyOfImage, int
      */
     pthread_mutex_lock(&m_mutex);
     if (m_newImageFlag) {
-        /* At this point, a copy of m_img is made, so it is safe to
-         * do any modifications to copyOfImage in user code.
+        /* The pooled buffer is moved out rather than copied, the handler
+         * no longer references it once the reader has taken it.
          */
-        copyOfImage = m_img;
+        image = std::move(m_img);
+        m_img = CameraRGBImage();
         m_newImageFlag = false;
+        writeTimeUs = m_imageWriteTimeUs;
         result = 0;
     } else {
         struct timespec absTimeout;
-        clock_gettime(CLOCK_REALTIME, &absTimeout);
-        absTimeout.tv_nsec += timeoutMilliSec * 1e6;
+        clock_gettime(CLOCK_MONOTONIC, &absTimeout);
+        absTimeout.tv_sec += timeoutMilliSec / 1000;
+        absTimeout.tv_nsec += (long) (timeoutMilliSec % 1000) * 1000000;
+        if (absTimeout.tv_nsec >= 1000000000) {
+            absTimeout.tv_sec += 1;
+            absTimeout.tv_nsec -= 1000000000;
+        }
         result = pthread_cond_timedwait(&m_condv, &m_mutex, &absTimeout);
 
-        if (result == 0) {
-            copyOfImage = m_img;
+        if (result == 0 && m_newImageFlag) {
+            image = std::move(m_img);
+            m_img = CameraRGBImage();
             m_newImageFlag = false;
+            writeTimeUs = m_imageWriteTimeUs;
+        } else if (result == 0) {
+            result = -1;
         }
     }
     pthread_mutex_unlock(&m_mutex);
+
+    if (result == 0 && writeTimeUs != 0) {
+        DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_HANDOFF, image.traceId, writeTimeUs,
+                                DjiLiveviewTrace_GetTimeUs());
+    }
     return (result == 0) ? true : false;
 }
 
-void DJICameraImageHandler::writeNewImageWithLock(uint8_t *buf, int bufSize, int width, int height)
+void DJICameraImageHandler::writeNewImageWithLock(const std::shared_ptr<DJICameraImageBuffer> &buffer,
+                                                  int width, int height)
+{
+    CameraRGBImage image;
+
+    image.buffer = buffer;
+    image.rawData = buffer->data.data();
+    image.rawDataSize = buffer->size;
+    image.height = height;
+    image.width = width;
+    image.planeCount = 1;
+    image.planeData[0] = image.rawData;
+    image.planeStride[0] = width * 3;
+
+    writeNewImageWithLock(image);
+}
+
+void DJICameraImageHandler::writeNewImageWithLock(const CameraRGBImage &image)
 {
+    CameraRGBImage staleImage;
+
     pthread_mutex_lock(&m_mutex);
 
-    m_img.rawData.assign(buf, buf + bufSize);
-    m_img.height = height;
-    m_img.width = width;
+    /* An image that was never consumed is overwritten, its buffer goes back
+     * to the pool after the lock is released.
+     */
+    staleImage = std::move(m_img);
+    m_img = image;
     m_newImageFlag = true;
+    m_imageWriteTimeUs = DjiLiveviewTrace_IsEnabled() ? DjiLiveviewTrace_GetTimeUs() : 0;
 
     pthread_cond_signal(&m_condv);
     pthread_mutex_unlock(&m_mutex);
 }
 
+bool DJICameraImageHandler::hasNewImage()
+{
+    bool newImageFlag;
+
+    pthread_mutex_lock(&m_mutex);
+    newImageFlag = m_newImageFlag;
+    pthread_mutex_unlock(&m_mutex);
+
+    return newImageFlag;
+}
+
 /* Private functions definition-----------------------------------------------*/
 
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
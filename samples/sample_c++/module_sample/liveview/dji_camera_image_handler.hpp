@@ -30,22 +30,60 @@
 /* Includes ------------------------------------------------------------------*/
 #include "pthread.h"
 #include <cstdint>
-#include <vector>
+#include <memory>
+#include "dji_camera_image_pool.hpp"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* Exported constants --------------------------------------------------------*/
+#define DJI_CAMERA_IMAGE_PLANE_NUM_MAX    (3)
 
 /* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_CAMERA_IMAGE_FORMAT_RGB24 = 0,
+    DJI_CAMERA_IMAGE_FORMAT_YUV420P,    /*!< Y, U and V planes, chroma subsampled by two in both directions. */
+    DJI_CAMERA_IMAGE_FORMAT_NV12,       /*!< Y plane and one interleaved UV plane. */
+} E_DjiCameraImageFormat;
+
+class DJICameraImageConverter;
+
+/*! @note
+ * rawData points into a pooled buffer that is kept alive by the buffer member,
+ * so copying a CameraRGBImage only copies a reference, never the pixels.
+ * Images in a YUV format point at the planes of the decoded frame instead,
+ * which frameRef keeps alive, and rawData is the luma plane. Such an image is
+ * converted to RGB only when a consumer asks for it with toRGB.
+ */
 struct CameraRGBImage {
-    std::vector<uint8_t> rawData;
+    std::shared_ptr<DJICameraImageBuffer> buffer;
+    uint8_t *rawData;
+    size_t rawDataSize;
     int height;
     int width;
+
+    E_DjiCameraImageFormat format;
+    bool isFullRange;
+    int planeCount;
+    uint8_t *planeData[DJI_CAMERA_IMAGE_PLANE_NUM_MAX];
+    int planeStride[DJI_CAMERA_IMAGE_PLANE_NUM_MAX];
+    std::shared_ptr<void> frameRef;
+    std::shared_ptr<DJICameraImageConverter> converter;
+    int64_t traceId;    /*!< Arrival time of the stream data of the frame, 0 when unknown, see dji_liveview_trace.hpp. */
+
+    CameraRGBImage();
+
+    /*! @brief Get the image as packed RGB24, converting it with the cached converter of its decoder.
+     *  @return false when the conversion is not possible or no pooled buffer is free.
+     */
+    bool toRGB(CameraRGBImage &rgbImage) const;
+
+    /*! @brief Drop the references to the pixels, handing pooled buffers and decoded frames back. */
+    void release();
 };
 
-typedef void (*CameraImageCallback)(CameraRGBImage pImg, void *userData);
+typedef void (*CameraImageCallback)(const CameraRGBImage &img, void *userData);
 
 typedef void (*H264Callback)(const uint8_t *buf, int bufLen, void *userData);
 
@@ -54,14 +92,18 @@ public:
     DJICameraImageHandler();
     ~DJICameraImageHandler();
 
-    void writeNewImageWithLock(uint8_t *buf, int bufSize, int width, int height);
-    bool getNewImageWithLock(CameraRGBImage &copyOfImage, int timeoutMilliSec);
+    void writeNewImageWithLock(const std::shared_ptr<DJICameraImageBuffer> &buffer, int width, int height);
+    void writeNewImageWithLock(const CameraRGBImage &image);
+    bool getNewImageWithLock(CameraRGBImage &image, int timeoutMilliSec);
+    /*! @brief Whether an image is waiting that the reader has not taken yet. */
+    bool hasNewImage();
 
 private:
     pthread_mutex_t m_mutex;
     pthread_cond_t m_condv;
     CameraRGBImage m_img;
     bool m_newImageFlag;
+    int64_t m_imageWriteTimeUs;
 };
 
 /* Exported functions --------------------------------------------------------*/
@@ -0,0 +1,133 @@
+/**
+ ********************************************************************
+ * @file    dji_camera_image_pool.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_camera_image_pool.hpp"
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+DJICameraImagePool::PoolState::PoolState(uint32_t capacity)
+    : capacity(capacity),
+      allocatedCount(0),
+      exhaustedCount(0)
+{
+    pthread_mutex_init(&mutex, nullptr);
+    freeList.reserve(capacity);
+}
+
+DJICameraImagePool::PoolState::~PoolState()
+{
+    for (auto buffer : freeList) {
+        delete buffer;
+    }
+    freeList.clear();
+    pthread_mutex_destroy(&mutex);
+}
+
+void DJICameraImagePool::PoolState::release(DJICameraImageBuffer *buffer)
+{
+    pthread_mutex_lock(&mutex);
+    freeList.push_back(buffer);
+    pthread_mutex_unlock(&mutex);
+}
+
+DJICameraImagePool::DJICameraImagePool(uint32_t capacity)
+    : m_state(std::make_shared<PoolState>(capacity > 0 ? capacity : 1))
+{
+}
+
+DJICameraImagePool::~DJICameraImagePool()
+{
+}
+
+std::shared_ptr<DJICameraImageBuffer> DJICameraImagePool::acquire(size_t size)
+{
+    DJICameraImageBuffer *buffer = nullptr;
+    std::shared_ptr<PoolState> state = m_state;
+
+    pthread_mutex_lock(&state->mutex);
+    if (!state->freeList.empty()) {
+        buffer = state->freeList.back();
+        state->freeList.pop_back();
+    } else if (state->allocatedCount < state->capacity) {
+        buffer = new DJICameraImageBuffer();
+        buffer->size = 0;
+        state->allocatedCount++;
+    } else {
+        state->exhaustedCount++;
+    }
+    pthread_mutex_unlock(&state->mutex);
+
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+
+    /* Buffers only grow, so a stream at a fixed resolution allocates once per slot. */
+    if (buffer->data.size() < size) {
+        buffer->data.resize(size);
+    }
+    buffer->size = size;
+
+    return std::shared_ptr<DJICameraImageBuffer>(buffer, [state](DJICameraImageBuffer *p) {
+        state->release(p);
+    });
+}
+
+uint32_t DJICameraImagePool::getCapacity() const
+{
+    return m_state->capacity;
+}
+
+uint32_t DJICameraImagePool::getFreeCount()
+{
+    uint32_t count;
+
+    pthread_mutex_lock(&m_state->mutex);
+    count = m_state->freeList.size() + (m_state->capacity - m_state->allocatedCount);
+    pthread_mutex_unlock(&m_state->mutex);
+
+    return count;
+}
+
+uint32_t DJICameraImagePool::getExhaustedCount()
+{
+    uint32_t count;
+
+    pthread_mutex_lock(&m_state->mutex);
+    count = m_state->exhaustedCount;
+    pthread_mutex_unlock(&m_state->mutex);
+
+    return count;
+}
+
+/* Private functions definition-----------------------------------------------*/
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
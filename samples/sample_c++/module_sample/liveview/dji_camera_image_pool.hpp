@@ -0,0 +1,94 @@
+/**
+ ********************************************************************
+ * @file    dji_camera_image_pool.hpp
+ * @brief   This is the header file for "dji_camera_image_pool.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_CAMERA_IMAGE_POOL_H
+#define DJI_CAMERA_IMAGE_POOL_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "pthread.h"
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_CAMERA_IMAGE_POOL_DEFAULT_CAPACITY    (4)
+
+/* Exported types ------------------------------------------------------------*/
+struct DJICameraImageBuffer {
+    std::vector<uint8_t> data;
+    size_t size;
+};
+
+/*! @note
+ * Fixed-capacity pool of image buffers. Buffers are handed out as shared
+ * pointers and return to the pool automatically when the last reference is
+ * dropped, so a decoded frame can travel from the decoder to the user callback
+ * without being copied. The pool state is itself reference counted, so buffers
+ * held by the user remain valid after the pool has been destroyed.
+ */
+class DJICameraImagePool {
+public:
+    explicit DJICameraImagePool(uint32_t capacity = DJI_CAMERA_IMAGE_POOL_DEFAULT_CAPACITY);
+    ~DJICameraImagePool();
+
+    /*! @brief Take a free buffer able to hold size bytes.
+     *  @return nullptr when all buffers are in use, the caller must drop the frame.
+     */
+    std::shared_ptr<DJICameraImageBuffer> acquire(size_t size);
+
+    uint32_t getCapacity() const;
+    uint32_t getFreeCount();
+    uint32_t getExhaustedCount();
+
+private:
+    struct PoolState {
+        pthread_mutex_t mutex;
+        std::vector<DJICameraImageBuffer *> freeList;
+        uint32_t capacity;
+        uint32_t allocatedCount;
+        uint32_t exhaustedCount;
+
+        PoolState(uint32_t capacity);
+        ~PoolState();
+        void release(DJICameraImageBuffer *buffer);
+    };
+
+    std::shared_ptr<PoolState> m_state;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DJI_CAMERA_IMAGE_POOL_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -27,6 +27,7 @@
 #include "unistd.h"
 #include "pthread.h"
 #include "dji_logger.h"
+#include "dji_liveview_trace.hpp"
 
 /* Private constants ---------------------------------------------------------*/
 
@@ -43,29 +44,38 @@ DJICameraStreamDecoder::DJICameraStreamDecoder()
       cbThreadStatus(-1),
       cb(nullptr),
       cbUserParam(nullptr),
+      activeDecodeCount(0),
+      decodeMode(DJI_CAMERA_STREAM_DECODER_MODE_FRAME_THREADING),
+      frameSkipPolicy(DJI_CAMERA_STREAM_DECODER_FRAME_SKIP_NONE),
+      frameDiscard(DJI_CAMERA_STREAM_DECODER_DISCARD_NONE),
+      isLagging(false),
+      decodeLatency(),
 #ifdef FFMPEG_INSTALLED
       pCodecCtx(nullptr),
       pCodec(nullptr),
       pCodecParserCtx(nullptr),
-      pSwsCtx(nullptr),
       pFrameYUV(nullptr),
-      pFrameRGB(nullptr),
-      rgbBuf(nullptr),
 #endif
-      bufSize(0)
+      converter(std::make_shared<DJICameraImageConverter>()),
+      outputFormat(DJI_CAMERA_STREAM_DECODER_OUTPUT_RGB24),
+      unsupportedFormatCount(0)
 {
     pthread_mutex_init(&decodemutex, nullptr);
+    pthread_cond_init(&decodeIdleCond, nullptr);
+    pthread_mutex_init(&latencyMutex, nullptr);
 }
 
 DJICameraStreamDecoder::~DJICameraStreamDecoder()
 {
-    pthread_mutex_destroy(&decodemutex);
     if(cb)
     {
         registerCallback(nullptr, nullptr);
     }
 
     cleanup();
+    pthread_mutex_destroy(&latencyMutex);
+    pthread_cond_destroy(&decodeIdleCond);
+    pthread_mutex_destroy(&decodemutex);
 }
 
 bool DJICameraStreamDecoder::init()
@@ -74,6 +84,7 @@ bool DJICameraStreamDecoder::init()
 
     if (true == initSuccess) {
         USER_LOG_INFO("Decoder already initialized.\n");
+        pthread_mutex_unlock(&decodemutex);
         return true;
     }
 
@@ -81,34 +92,40 @@ bool DJICameraStreamDecoder::init()
     avcodec_register_all();
     pCodecCtx = avcodec_alloc_context3(nullptr);
     if (!pCodecCtx) {
+        pthread_mutex_unlock(&decodemutex);
         return false;
     }
 
-    pCodecCtx->thread_count = 4;
+    if (decodeMode == DJI_CAMERA_STREAM_DECODER_MODE_LOW_DELAY) {
+        /* Frame threads hold one frame per thread before the first output, slice threads add no delay. */
+        pCodecCtx->thread_count = 4;
+        pCodecCtx->thread_type = FF_THREAD_SLICE;
+        pCodecCtx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    } else {
+        pCodecCtx->thread_count = 4;
+    }
+    /* Decoded frames are reference counted, so a frame can be handed out in YUV mode without a copy. */
+    pCodecCtx->refcounted_frames = 1;
+    pCodecCtx->flags2 |= AV_CODEC_FLAG2_SHOW_ALL;
     pCodec = avcodec_find_decoder(AV_CODEC_ID_H264);
     if (!pCodec || avcodec_open2(pCodecCtx, pCodec, nullptr) < 0) {
+        pthread_mutex_unlock(&decodemutex);
         return false;
     }
 
     pCodecParserCtx = av_parser_init(AV_CODEC_ID_H264);
     if (!pCodecParserCtx) {
+        pthread_mutex_unlock(&decodemutex);
         return false;
     }
 
     pFrameYUV = av_frame_alloc();
     if (!pFrameYUV) {
+        pthread_mutex_unlock(&decodemutex);
         return false;
     }
-
-    pFrameRGB = av_frame_alloc();
-    if (!pFrameRGB) {
-        return false;
-    }
-
-    pSwsCtx = nullptr;
-
-    pCodecCtx->flags2 |= AV_CODEC_FLAG2_SHOW_ALL;
 #endif
+    isLagging = false;
     initSuccess = true;
     pthread_mutex_unlock(&decodemutex);
 
@@ -119,17 +136,15 @@ void DJICameraStreamDecoder::cleanup()
 {
     pthread_mutex_lock(&decodemutex);
 
+    /* decodeBuffer runs without the lock, wait until it has left the codec before freeing it. */
     initSuccess = false;
-
-#ifdef FFMPEG_INSTALLED
-    if (nullptr != pSwsCtx) {
-        sws_freeContext(pSwsCtx);
-        pSwsCtx = nullptr;
+    while (activeDecodeCount > 0) {
+        pthread_cond_wait(&decodeIdleCond, &decodemutex);
     }
 
+#ifdef FFMPEG_INSTALLED
     if (nullptr != pFrameYUV) {
-        av_free(pFrameYUV);
-        pFrameYUV = nullptr;
+        av_frame_free(&pFrameYUV);
     }
 
     if (nullptr != pCodecParserCtx) {
@@ -146,16 +161,6 @@ void DJICameraStreamDecoder::cleanup()
         av_free(pCodecCtx);
         pCodecCtx = nullptr;
     }
-
-    if (nullptr != rgbBuf) {
-        av_free(rgbBuf);
-        rgbBuf = nullptr;
-    }
-
-    if (nullptr != pFrameRGB) {
-        av_free(pFrameRGB);
-        pFrameRGB = nullptr;
-    }
 #endif
     pthread_mutex_unlock(&decodemutex);
 }
@@ -171,79 +176,108 @@ void *DJICameraStreamDecoder::callbackThreadEntry(void *p)
 void DJICameraStreamDecoder::callbackThreadFunc()
 {
     while (cbThreadIsRunning) {
-        CameraRGBImage copyOfImage;
-        if (!decodedImageHandler.getNewImageWithLock(copyOfImage, 1000)) {
+        CameraRGBImage image;
+        if (!decodedImageHandler.getNewImageWithLock(image, 1000)) {
             //DDEBUG_PRIVATE("Decoder Callback Thread: Get image time out\n");
             continue;
         }
 
         if (cb) {
-            (*cb)(copyOfImage, cbUserParam);
+            int64_t callbackStartUs = DjiLiveviewTrace_GetTimeUs();
+            (*cb)(image, cbUserParam);
+            if (image.traceId != 0) {
+                int64_t callbackEndUs = DjiLiveviewTrace_GetTimeUs();
+                DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_CALLBACK, image.traceId, callbackStartUs,
+                                        callbackEndUs);
+                DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_TOTAL, image.traceId, image.traceId, callbackEndUs);
+            }
         }
     }
 }
 
 void DJICameraStreamDecoder::decodeBuffer(const uint8_t *buf, int bufLen)
 {
+    decodeBuffer(buf, bufLen, DjiLiveviewTrace_GetTimeUs());
+}
+
+void DJICameraStreamDecoder::decodeBuffer(const uint8_t *buf, int bufLen, int64_t arrivalTimeUs)
+{
+#ifdef FFMPEG_INSTALLED
     const uint8_t *pData = buf;
     int remainingLen = bufLen;
     int processedLen = 0;
-
-#ifdef FFMPEG_INSTALLED
     AVPacket pkt;
+    AVDiscard discard;
+    int64_t stageStartUs;
+
+    /* The lock only guards against cleanup, the stream callback is the only caller decoding. */
+    if (!enterDecode()) {
+        return;
+    }
+
+    if (frameDiscard == DJI_CAMERA_STREAM_DECODER_DISCARD_NON_KEY) {
+        discard = AVDISCARD_NONKEY;
+    } else if (frameDiscard == DJI_CAMERA_STREAM_DECODER_DISCARD_NON_REFERENCE) {
+        discard = AVDISCARD_NONREF;
+    } else {
+        discard = AVDISCARD_DEFAULT;
+    }
+
     av_init_packet(&pkt);
-    pthread_mutex_lock(&decodemutex);
     while (remainingLen > 0) {
-        if (!pCodecParserCtx || !pCodecCtx) {
-            //DSTATUS("Invalid decoder ctx.");
-            break;
-        }
+        /* The arrival time travels through the parser and the codec as the pts of the frame. */
+        stageStartUs = DjiLiveviewTrace_GetTimeUs();
         processedLen = av_parser_parse2(pCodecParserCtx, pCodecCtx,
                                         &pkt.data, &pkt.size,
                                         pData, remainingLen,
-                                        AV_NOPTS_VALUE, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
+                                        arrivalTimeUs, AV_NOPTS_VALUE, AV_NOPTS_VALUE);
         remainingLen -= processedLen;
         pData += processedLen;
+        DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_PARSE, arrivalTimeUs, stageStartUs,
+                                DjiLiveviewTrace_GetTimeUs());
+
+        if (pkt.size <= 0) {
+            continue;
+        }
+        pkt.pts = pCodecParserCtx->pts;
+
+        isLagging = frameSkipPolicy == DJI_CAMERA_STREAM_DECODER_FRAME_SKIP_WHEN_LAGGING &&
+                    decodedImageHandler.hasNewImage();
+        pCodecCtx->skip_frame = (isLagging && discard < AVDISCARD_NONREF) ? AVDISCARD_NONREF : discard;
 
-        if (pkt.size > 0) {
+        /* The decode span of a packet ends when its frame comes out, the conversion is traced on its own. */
+        stageStartUs = DjiLiveviewTrace_GetTimeUs();
+        if (decodeMode == DJI_CAMERA_STREAM_DECODER_MODE_LOW_DELAY) {
+            int ret = avcodec_send_packet(pCodecCtx, &pkt);
+            if (ret < 0 && ret != AVERROR(EAGAIN)) {
+                continue;
+            }
+            while (avcodec_receive_frame(pCodecCtx, pFrameYUV) == 0) {
+                DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_DECODE, pFrameYUV->best_effort_timestamp,
+                                        stageStartUs, DjiLiveviewTrace_GetTimeUs());
+                handleDecodedFrame();
+                stageStartUs = DjiLiveviewTrace_GetTimeUs();
+            }
+        } else {
             int gotPicture = 0;
             avcodec_decode_video2(pCodecCtx, pFrameYUV, &gotPicture, &pkt);
+            DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_DECODE, pkt.pts, stageStartUs,
+                                    DjiLiveviewTrace_GetTimeUs());
 
             if (!gotPicture) {
                 ////DSTATUS_PRIVATE("Got Frame, but no picture\n");
                 continue;
-            } else {
-                int w = pFrameYUV->width;
-                int h = pFrameYUV->height;
-                ////DSTATUS_PRIVATE("Got picture! size=%dx%d\n", w, h);
-
-                if (nullptr == pSwsCtx) {
-                    pSwsCtx = sws_getContext(w, h, pCodecCtx->pix_fmt,
-                                             w, h, AV_PIX_FMT_RGB24,
-                                             4, nullptr, nullptr, nullptr);
-                }
-
-                if (nullptr == rgbBuf) {
-                    bufSize = avpicture_get_size(AV_PIX_FMT_RGB24, w, h);
-                    rgbBuf = (uint8_t *) av_malloc(bufSize);
-                    avpicture_fill((AVPicture *) pFrameRGB, rgbBuf, AV_PIX_FMT_RGB24, w, h);
-                }
-
-                if (nullptr != pSwsCtx && nullptr != rgbBuf) {
-                    sws_scale(pSwsCtx,
-                              (uint8_t const *const *) pFrameYUV->data, pFrameYUV->linesize, 0, pFrameYUV->height,
-                              pFrameRGB->data, pFrameRGB->linesize);
-
-                    pFrameRGB->height = h;
-                    pFrameRGB->width = w;
-
-                    decodedImageHandler.writeNewImageWithLock(pFrameRGB->data[0], bufSize, w, h);
-                }
             }
+            handleDecodedFrame();
         }
     }
-    pthread_mutex_unlock(&decodemutex);
     av_free_packet(&pkt);
+
+    leaveDecode();
+#else
+    (void) buf;
+    (void) bufLen;
+    (void) arrivalTimeUs;
 #endif
 }
 
@@ -279,6 +313,182 @@ bool DJICameraStreamDecoder::registerCallback(CameraImageCallback f, void *param
     }
 }
 
+uint32_t DJICameraStreamDecoder::getDroppedFrameCount()
+{
+    return converter->getDroppedFrameCount();
+}
+
+void DJICameraStreamDecoder::setOutputFormat(E_DjiCameraStreamDecoderOutputFormat format)
+{
+    pthread_mutex_lock(&decodemutex);
+    outputFormat = format;
+    pthread_mutex_unlock(&decodemutex);
+}
+
+void DJICameraStreamDecoder::setRGBConversionSliceCount(uint32_t sliceCount)
+{
+    converter->setSliceCount(sliceCount);
+}
+
+void DJICameraStreamDecoder::setDecodeMode(E_DjiCameraStreamDecoderMode mode)
+{
+    pthread_mutex_lock(&decodemutex);
+    decodeMode = mode;
+    pthread_mutex_unlock(&decodemutex);
+}
+
+void DJICameraStreamDecoder::setFrameSkipPolicy(E_DjiCameraStreamDecoderFrameSkipPolicy policy)
+{
+    pthread_mutex_lock(&decodemutex);
+    frameSkipPolicy = policy;
+    pthread_mutex_unlock(&decodemutex);
+}
+
+void DJICameraStreamDecoder::setFrameDiscard(E_DjiCameraStreamDecoderDiscard discard)
+{
+    pthread_mutex_lock(&decodemutex);
+    frameDiscard = discard;
+    pthread_mutex_unlock(&decodemutex);
+}
+
+void DJICameraStreamDecoder::setRGBMaxResolution(uint32_t maxWidth, uint32_t maxHeight)
+{
+    converter->setMaxResolution(maxWidth, maxHeight);
+}
+
+void DJICameraStreamDecoder::setRGBDownscaleFactor(uint32_t factor)
+{
+    converter->setDownscaleFactor(factor);
+}
+
+void DJICameraStreamDecoder::getDecodeLatency(T_DjiCameraStreamDecoderLatency &latency)
+{
+    pthread_mutex_lock(&latencyMutex);
+    latency = decodeLatency;
+    pthread_mutex_unlock(&latencyMutex);
+}
+
 /* Private functions definition-----------------------------------------------*/
+bool DJICameraStreamDecoder::enterDecode()
+{
+    bool isReady;
+
+    pthread_mutex_lock(&decodemutex);
+#ifdef FFMPEG_INSTALLED
+    isReady = initSuccess && pCodecParserCtx && pCodecCtx;
+#else
+    isReady = initSuccess;
+#endif
+    if (isReady) {
+        activeDecodeCount++;
+    }
+    pthread_mutex_unlock(&decodemutex);
+
+    return isReady;
+}
+
+void DJICameraStreamDecoder::leaveDecode()
+{
+    pthread_mutex_lock(&decodemutex);
+    activeDecodeCount--;
+    if (activeDecodeCount == 0) {
+        pthread_cond_broadcast(&decodeIdleCond);
+    }
+    pthread_mutex_unlock(&decodemutex);
+}
+
+void DJICameraStreamDecoder::handleDecodedFrame()
+{
+#ifdef FFMPEG_INSTALLED
+    CameraRGBImage image;
+
+    recordDecodeLatency();
+
+    if (isLagging) {
+        /* The consumer has not taken the previous frame yet, converting this one would be wasted. */
+        pthread_mutex_lock(&latencyMutex);
+        decodeLatency.skippedFrameCount++;
+        pthread_mutex_unlock(&latencyMutex);
+        av_frame_unref(pFrameYUV);
+        return;
+    }
+
+    image.width = pFrameYUV->width;
+    image.height = pFrameYUV->height;
+    image.traceId = pFrameYUV->best_effort_timestamp != AV_NOPTS_VALUE ? pFrameYUV->best_effort_timestamp : 0;
+    image.isFullRange = pFrameYUV->format == AV_PIX_FMT_YUVJ420P;
+    image.converter = converter;
+    if (pFrameYUV->format == AV_PIX_FMT_YUV420P || pFrameYUV->format == AV_PIX_FMT_YUVJ420P) {
+        image.format = DJI_CAMERA_IMAGE_FORMAT_YUV420P;
+        image.planeCount = 3;
+    } else if (pFrameYUV->format == AV_PIX_FMT_NV12) {
+        image.format = DJI_CAMERA_IMAGE_FORMAT_NV12;
+        image.planeCount = 2;
+    } else {
+        unsupportedFormatCount++;
+        if (1 == unsupportedFormatCount) {
+            USER_LOG_ERROR("Unsupported decoded pixel format %d.", pFrameYUV->format);
+        }
+        av_frame_unref(pFrameYUV);
+        return;
+    }
+    for (int i = 0; i < image.planeCount; i++) {
+        image.planeData[i] = pFrameYUV->data[i];
+        image.planeStride[i] = pFrameYUV->linesize[i];
+    }
+    image.rawData = image.planeData[0];
+    image.rawDataSize = (size_t) image.planeStride[0] * image.height;
+
+    if (outputFormat == DJI_CAMERA_STREAM_DECODER_OUTPUT_YUV) {
+        /* The planes travel with a reference to the decoded frame instead of being converted. */
+        AVFrame *frameRef = av_frame_alloc();
+        if (frameRef == nullptr) {
+            av_frame_unref(pFrameYUV);
+            return;
+        }
+        av_frame_move_ref(frameRef, pFrameYUV);
+        image.frameRef = std::shared_ptr<void>(frameRef, [](void *p) {
+            AVFrame *frame = static_cast<AVFrame *>(p);
+            av_frame_free(&frame);
+        });
+        decodedImageHandler.writeNewImageWithLock(image);
+    } else {
+        CameraRGBImage rgbImage;
+        if (converter->convertToRGB(image, rgbImage)) {
+            decodedImageHandler.writeNewImageWithLock(rgbImage);
+        }
+        av_frame_unref(pFrameYUV);
+    }
+#endif
+}
+
+void DJICameraStreamDecoder::recordDecodeLatency()
+{
+#ifdef FFMPEG_INSTALLED
+    struct timespec now;
+    int64_t arrivalTimeUs = pFrameYUV->best_effort_timestamp;
+    double latencyMs;
+    int bucket = 0;
+
+    if (arrivalTimeUs == AV_NOPTS_VALUE) {
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    latencyMs = ((int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000 - arrivalTimeUs) / 1000.0;
+    while (bucket < DJI_CAMERA_STREAM_DECODER_LATENCY_BUCKET_NUM - 1 && latencyMs >= (double) (1 << bucket)) {
+        bucket++;
+    }
+
+    pthread_mutex_lock(&latencyMutex);
+    decodeLatency.frameCount++;
+    decodeLatency.bucketCount[bucket]++;
+    decodeLatency.averageMs += (latencyMs - decodeLatency.averageMs) / decodeLatency.frameCount;
+    if (latencyMs > decodeLatency.maxMs) {
+        decodeLatency.maxMs = latencyMs;
+    }
+    pthread_mutex_unlock(&latencyMutex);
+#endif
+}
 
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -38,25 +38,73 @@ extern "C" {
 
 #include "pthread.h"
 #include "dji_camera_image_handler.hpp"
+#include "dji_camera_image_converter.hpp"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /* Exported constants --------------------------------------------------------*/
+// Buckets of the decode latency histogram, bucket i counts latencies below 2^i ms, the last one everything above
+#define DJI_CAMERA_STREAM_DECODER_LATENCY_BUCKET_NUM    (10)
 
 /* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_CAMERA_STREAM_DECODER_MODE_FRAME_THREADING = 0, /*!< avcodec_decode_video2 with frame threads, buffers frames. */
+    DJI_CAMERA_STREAM_DECODER_MODE_LOW_DELAY,           /*!< send_packet/receive_frame, low delay flag, slice threads. */
+} E_DjiCameraStreamDecoderMode;
+
+typedef enum {
+    DJI_CAMERA_STREAM_DECODER_FRAME_SKIP_NONE = 0,      /*!< Every frame is delivered, the newest replaces a pending one. */
+    DJI_CAMERA_STREAM_DECODER_FRAME_SKIP_WHEN_LAGGING,  /*!< While a frame is pending, skip non-reference frames and
+                                                             do not convert or deliver the decoded ones. */
+} E_DjiCameraStreamDecoderFrameSkipPolicy;
+
+typedef enum {
+    DJI_CAMERA_STREAM_DECODER_DISCARD_NONE = 0,
+    DJI_CAMERA_STREAM_DECODER_DISCARD_NON_REFERENCE,    /*!< Frames no other frame refers to are not decoded. */
+    DJI_CAMERA_STREAM_DECODER_DISCARD_NON_KEY,          /*!< Only key frames are decoded. */
+} E_DjiCameraStreamDecoderDiscard;
+
+typedef struct {
+    uint64_t frameCount;
+    uint64_t skippedFrameCount;
+    uint64_t bucketCount[DJI_CAMERA_STREAM_DECODER_LATENCY_BUCKET_NUM];
+    double averageMs;
+    double maxMs;
+} T_DjiCameraStreamDecoderLatency;
+
+typedef enum {
+    DJI_CAMERA_STREAM_DECODER_OUTPUT_RGB24 = 0,  /*!< Every frame is converted to packed RGB24 by the decoder. */
+    DJI_CAMERA_STREAM_DECODER_OUTPUT_YUV,        /*!< Frames keep the planes of the decoder, see CameraRGBImage::toRGB. */
+} E_DjiCameraStreamDecoderOutputFormat;
+
 class DJICameraStreamDecoder {
 public:
     DJICameraStreamDecoder();
     ~DJICameraStreamDecoder();
     bool init();
+    /*! @note The mode takes effect on the next init. */
+    void setDecodeMode(E_DjiCameraStreamDecoderMode mode);
+    void setFrameSkipPolicy(E_DjiCameraStreamDecoderFrameSkipPolicy policy);
+    void setFrameDiscard(E_DjiCameraStreamDecoderDiscard discard);
+    /*! @brief Latency from the arrival of the first byte of a frame to its decoded picture. */
+    void getDecodeLatency(T_DjiCameraStreamDecoderLatency &latency);
     void cleanup();
 
     void callbackThreadFunc();
     void decodeBuffer(const uint8_t *pBuf, int len);
+    /*! @brief Decode stream data that arrived earlier, e.g. after waiting in a queue.
+     *  @param arrivalTimeUs: arrival time on the trace clock, used for the latency and as the trace ID of the frame.
+     */
+    void decodeBuffer(const uint8_t *pBuf, int len, int64_t arrivalTimeUs);
     static void *callbackThreadEntry(void *p);
     bool registerCallback(CameraImageCallback f, void *param);
+    uint32_t getDroppedFrameCount();
+    void setOutputFormat(E_DjiCameraStreamDecoderOutputFormat format);
+    void setRGBConversionSliceCount(uint32_t sliceCount);
+    void setRGBMaxResolution(uint32_t maxWidth, uint32_t maxHeight);
+    void setRGBDownscaleFactor(uint32_t factor);
     DJICameraImageHandler decodedImageHandler;
 
 private:
@@ -68,18 +116,30 @@ private:
     void *cbUserParam;
 
     pthread_mutex_t decodemutex;
+    pthread_cond_t decodeIdleCond;
+    uint32_t activeDecodeCount;
+    E_DjiCameraStreamDecoderMode decodeMode;
+    E_DjiCameraStreamDecoderFrameSkipPolicy frameSkipPolicy;
+    E_DjiCameraStreamDecoderDiscard frameDiscard;
+    bool isLagging;
+    pthread_mutex_t latencyMutex;
+    T_DjiCameraStreamDecoderLatency decodeLatency;
+
+    bool enterDecode();
+    void leaveDecode();
+    void handleDecodedFrame();
+    void recordDecodeLatency();
 
 #ifdef FFMPEG_INSTALLED
     AVCodecContext *pCodecCtx;
     AVCodec *pCodec;
     AVCodecParserContext *pCodecParserCtx;
-    SwsContext *pSwsCtx;
 
     AVFrame *pFrameYUV;
-    AVFrame *pFrameRGB;
 #endif
-    uint8_t *rgbBuf;
-    size_t bufSize;
+    std::shared_ptr<DJICameraImageConverter> converter;
+    E_DjiCameraStreamDecoderOutputFormat outputFormat;
+    uint32_t unsupportedFormatCount;
 };
 
 /* Exported functions --------------------------------------------------------*/
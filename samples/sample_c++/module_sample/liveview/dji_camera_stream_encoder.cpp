@@ -0,0 +1,423 @@
+/**
+ ********************************************************************
+ * @file    dji_camera_stream_encoder.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_camera_stream_encoder.hpp"
+#include <ctime>
+#include <vector>
+#include "dji_logger.h"
+
+#ifdef FFMPEG_INSTALLED
+extern "C" {
+#include <libavutil/opt.h>
+}
+#endif
+
+/* Private constants ---------------------------------------------------------*/
+#define DJI_CAMERA_STREAM_ENCODER_THREAD_NUM    (4)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static double DjiCameraStreamEncoder_GetTimeMs(void);
+
+/* Exported functions definition ---------------------------------------------*/
+DJICameraStreamEncoder::DJICameraStreamEncoder()
+    : initSuccess(false),
+      isKeyFrameRequested(false),
+      cb(nullptr),
+      cbUserParam(nullptr),
+      encoderConfig(),
+      encoderStatistics(),
+      windowByteCount(0),
+      windowFrameCount(0)
+#ifdef FFMPEG_INSTALLED
+    , pCodecCtx(nullptr),
+      pFrameYUV(nullptr),
+      pPacket(nullptr),
+      pSwsCtx(nullptr),
+      nextPts(0)
+#endif
+{
+    pthread_mutex_init(&encodeMutex, nullptr);
+}
+
+DJICameraStreamEncoder::~DJICameraStreamEncoder()
+{
+    cleanup();
+    pthread_mutex_destroy(&encodeMutex);
+}
+
+bool DJICameraStreamEncoder::init(const T_DjiCameraStreamEncoderConfig &config)
+{
+    pthread_mutex_lock(&encodeMutex);
+
+    if (true == initSuccess) {
+        USER_LOG_INFO("Encoder already initialized.");
+        pthread_mutex_unlock(&encodeMutex);
+        return true;
+    }
+
+    if (config.width < 2 || config.height < 2 || config.frameRate == 0 || config.bitRate == 0) {
+        USER_LOG_ERROR("Invalid encoder config %ux%u, %u fps, %u bps.", config.width, config.height,
+                       config.frameRate, config.bitRate);
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+
+    encoderConfig = config;
+    if (encoderConfig.vbvBufferMs == 0) {
+        encoderConfig.vbvBufferMs = DJI_CAMERA_STREAM_ENCODER_VBV_BUFFER_MS_DEFAULT;
+    }
+    if (encoderConfig.refreshPeriod == 0) {
+        encoderConfig.refreshPeriod = DJI_CAMERA_STREAM_ENCODER_REFRESH_PERIOD_DEFAULT;
+    }
+    encoderStatistics = T_DjiCameraStreamEncoderStatistics();
+    encoderStatistics.targetBitRate = encoderConfig.bitRate;
+    windowByteCount = 0;
+    windowFrameCount = 0;
+    isKeyFrameRequested = false;
+
+#ifdef FFMPEG_INSTALLED
+    AVCodec *pCodec;
+
+    avcodec_register_all();
+    pCodec = avcodec_find_encoder_by_name("libx264");
+    if (!pCodec) {
+        pCodec = avcodec_find_encoder(AV_CODEC_ID_H264);
+    }
+    pCodecCtx = pCodec ? avcodec_alloc_context3(pCodec) : nullptr;
+    if (!pCodecCtx) {
+        USER_LOG_ERROR("No H264 encoder available.");
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+
+    pCodecCtx->width = encoderConfig.width & ~1;
+    pCodecCtx->height = encoderConfig.height & ~1;
+    pCodecCtx->pix_fmt = AV_PIX_FMT_YUV420P;
+    pCodecCtx->time_base = (AVRational) {1, (int) encoderConfig.frameRate};
+    pCodecCtx->framerate = (AVRational) {(int) encoderConfig.frameRate, 1};
+    pCodecCtx->gop_size = encoderConfig.refreshPeriod;
+    pCodecCtx->max_b_frames = 0;
+    /* Frame threads hold one frame per thread before the first packet, slice threads add no delay. */
+    pCodecCtx->thread_count = DJI_CAMERA_STREAM_ENCODER_THREAD_NUM;
+    pCodecCtx->thread_type = FF_THREAD_SLICE;
+    /* The maximum rate equal to the average rate with a buffer of a few frames makes the rate constant, without
+     * filler data, so no frame needs much longer than a frame interval on a link of that bandwidth.
+     */
+    pCodecCtx->bit_rate = encoderConfig.bitRate;
+    pCodecCtx->rc_max_rate = encoderConfig.bitRate;
+    pCodecCtx->rc_buffer_size = (int) ((uint64_t) encoderConfig.bitRate * encoderConfig.vbvBufferMs / 1000);
+
+    /* Options of libx264, other encoders ignore them. */
+    av_opt_set(pCodecCtx->priv_data, "preset", "superfast", 0);
+    av_opt_set(pCodecCtx->priv_data, "tune", "zerolatency", 0);
+    if (encoderConfig.useIntraRefresh) {
+        /* Without key frames every frame has about the same size, there is no burst every group of pictures. */
+        av_opt_set(pCodecCtx->priv_data, "intra-refresh", "1", 0);
+    }
+
+    if (avcodec_open2(pCodecCtx, pCodec, nullptr) < 0) {
+        USER_LOG_ERROR("Open encoder %s failed.", pCodec->name);
+        avcodec_free_context(&pCodecCtx);
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+
+    pFrameYUV = av_frame_alloc();
+    pPacket = av_packet_alloc();
+    if (!pFrameYUV || !pPacket) {
+        av_frame_free(&pFrameYUV);
+        av_packet_free(&pPacket);
+        avcodec_free_context(&pCodecCtx);
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+    pFrameYUV->format = pCodecCtx->pix_fmt;
+    pFrameYUV->width = pCodecCtx->width;
+    pFrameYUV->height = pCodecCtx->height;
+    if (av_frame_get_buffer(pFrameYUV, 32) < 0) {
+        av_frame_free(&pFrameYUV);
+        av_packet_free(&pPacket);
+        avcodec_free_context(&pCodecCtx);
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+    nextPts = 0;
+#endif
+    initSuccess = true;
+    pthread_mutex_unlock(&encodeMutex);
+
+    return true;
+}
+
+void DJICameraStreamEncoder::cleanup()
+{
+    pthread_mutex_lock(&encodeMutex);
+
+    initSuccess = false;
+#ifdef FFMPEG_INSTALLED
+    if (nullptr != pSwsCtx) {
+        sws_freeContext(pSwsCtx);
+        pSwsCtx = nullptr;
+    }
+    av_packet_free(&pPacket);
+    av_frame_free(&pFrameYUV);
+    avcodec_free_context(&pCodecCtx);
+#endif
+    pthread_mutex_unlock(&encodeMutex);
+}
+
+void DJICameraStreamEncoder::registerCallback(H264Callback f, void *param)
+{
+    pthread_mutex_lock(&encodeMutex);
+    cb = f;
+    cbUserParam = param;
+    pthread_mutex_unlock(&encodeMutex);
+}
+
+bool DJICameraStreamEncoder::encodeFrame(const uint8_t *buf, uint32_t width, uint32_t height,
+                                         E_DjiCameraImageFormat format)
+{
+    const uint8_t *planeData[DJI_CAMERA_IMAGE_PLANE_NUM_MAX] = {buf, nullptr, nullptr};
+    int planeStride[DJI_CAMERA_IMAGE_PLANE_NUM_MAX] = {0, 0, 0};
+    int chromaWidth = (int) (width + 1) / 2;
+    int chromaHeight = (int) (height + 1) / 2;
+
+    if (buf == nullptr) {
+        return false;
+    }
+
+    switch (format) {
+        case DJI_CAMERA_IMAGE_FORMAT_YUV420P:
+            planeStride[0] = width;
+            planeStride[1] = chromaWidth;
+            planeStride[2] = chromaWidth;
+            planeData[1] = buf + (size_t) width * height;
+            planeData[2] = planeData[1] + (size_t) chromaWidth * chromaHeight;
+            break;
+        case DJI_CAMERA_IMAGE_FORMAT_NV12:
+            planeStride[0] = width;
+            planeStride[1] = chromaWidth * 2;
+            planeData[1] = buf + (size_t) width * height;
+            break;
+        default:
+            planeStride[0] = width * 3;
+            break;
+    }
+
+    return encodePlanes(planeData, planeStride, width, height, format);
+}
+
+bool DJICameraStreamEncoder::encodeImage(const CameraRGBImage &image)
+{
+    const uint8_t *planeData[DJI_CAMERA_IMAGE_PLANE_NUM_MAX] = {image.rawData, nullptr, nullptr};
+    int planeStride[DJI_CAMERA_IMAGE_PLANE_NUM_MAX] = {image.width * 3, 0, 0};
+
+    if (image.format != DJI_CAMERA_IMAGE_FORMAT_RGB24) {
+        for (int i = 0; i < image.planeCount && i < DJI_CAMERA_IMAGE_PLANE_NUM_MAX; i++) {
+            planeData[i] = image.planeData[i];
+            planeStride[i] = image.planeStride[i];
+        }
+    }
+
+    if (planeData[0] == nullptr) {
+        return false;
+    }
+
+    return encodePlanes(planeData, planeStride, image.width, image.height, image.format);
+}
+
+void DJICameraStreamEncoder::requestKeyFrame()
+{
+    pthread_mutex_lock(&encodeMutex);
+    isKeyFrameRequested = true;
+    pthread_mutex_unlock(&encodeMutex);
+}
+
+void DJICameraStreamEncoder::setBitRate(uint32_t bitRate)
+{
+    if (bitRate == 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&encodeMutex);
+    encoderConfig.bitRate = bitRate;
+    encoderStatistics.targetBitRate = bitRate;
+#ifdef FFMPEG_INSTALLED
+    /* libx264 compares these with its settings before every frame and reconfigures itself, no reopen needed. */
+    if (nullptr != pCodecCtx) {
+        pCodecCtx->bit_rate = bitRate;
+        pCodecCtx->rc_max_rate = bitRate;
+        pCodecCtx->rc_buffer_size = (int) ((uint64_t) bitRate * encoderConfig.vbvBufferMs / 1000);
+    }
+#endif
+    pthread_mutex_unlock(&encodeMutex);
+}
+
+void DJICameraStreamEncoder::getStatistics(T_DjiCameraStreamEncoderStatistics &statistics)
+{
+    pthread_mutex_lock(&encodeMutex);
+    statistics = encoderStatistics;
+    pthread_mutex_unlock(&encodeMutex);
+}
+
+/* Private functions definition-----------------------------------------------*/
+bool DJICameraStreamEncoder::encodePlanes(const uint8_t *const planeData[], const int planeStride[], int width,
+                                          int height, E_DjiCameraImageFormat format)
+{
+#ifdef FFMPEG_INSTALLED
+    const uint8_t *srcData[4] = {planeData[0], planeData[1], planeData[2], nullptr};
+    int srcStride[4] = {planeStride[0], planeStride[1], planeStride[2], 0};
+    AVPixelFormat srcFormat;
+    double startTimeMs;
+    std::vector<uint8_t> packetData;
+    std::vector<int> packetSizes;
+    H264Callback callback;
+    void *callbackUserParam;
+    size_t offset = 0;
+    int ret;
+
+    switch (format) {
+        case DJI_CAMERA_IMAGE_FORMAT_YUV420P:
+            srcFormat = AV_PIX_FMT_YUV420P;
+            break;
+        case DJI_CAMERA_IMAGE_FORMAT_NV12:
+            srcFormat = AV_PIX_FMT_NV12;
+            break;
+        default:
+            srcFormat = AV_PIX_FMT_RGB24;
+            break;
+    }
+
+    pthread_mutex_lock(&encodeMutex);
+    if (!initSuccess) {
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+
+    startTimeMs = DjiCameraStreamEncoder_GetTimeMs();
+
+    /* The encoder copies the picture on submission when it keeps no lookahead, so this is normally a no-op. */
+    if (av_frame_make_writable(pFrameYUV) < 0) {
+        encoderStatistics.failedFrameCount++;
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+
+    pSwsCtx = sws_getCachedContext(pSwsCtx, width, height, srcFormat, pFrameYUV->width, pFrameYUV->height,
+                                   AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR, nullptr, nullptr, nullptr);
+    if (nullptr == pSwsCtx) {
+        encoderStatistics.failedFrameCount++;
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+    sws_scale(pSwsCtx, srcData, srcStride, 0, height, pFrameYUV->data, pFrameYUV->linesize);
+
+    pFrameYUV->pts = nextPts++;
+    pFrameYUV->pict_type = isKeyFrameRequested ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_NONE;
+    isKeyFrameRequested = false;
+
+    ret = avcodec_send_frame(pCodecCtx, pFrameYUV);
+    if (ret < 0) {
+        encoderStatistics.failedFrameCount++;
+        pthread_mutex_unlock(&encodeMutex);
+        return false;
+    }
+
+    /* With zero latency tuning every frame comes out before the next one goes in. The packets are copied out and
+     * passed on after the lock is released, so a slow callback does not hold up other producers and the callback
+     * may call back into the encoder.
+     */
+    while ((ret = avcodec_receive_packet(pCodecCtx, pPacket)) == 0) {
+        packetData.insert(packetData.end(), pPacket->data, pPacket->data + pPacket->size);
+        packetSizes.push_back(pPacket->size);
+        recordFrame(pPacket->size, (pPacket->flags & AV_PKT_FLAG_KEY) != 0,
+                    DjiCameraStreamEncoder_GetTimeMs() - startTimeMs);
+        av_packet_unref(pPacket);
+    }
+    callback = cb;
+    callbackUserParam = cbUserParam;
+    pthread_mutex_unlock(&encodeMutex);
+
+    if (callback) {
+        for (int size: packetSizes) {
+            (*callback)(packetData.data() + offset, size, callbackUserParam);
+            offset += size;
+        }
+    }
+
+    return ret == AVERROR(EAGAIN);
+#else
+    (void) planeData;
+    (void) planeStride;
+    (void) width;
+    (void) height;
+    (void) format;
+
+    return false;
+#endif
+}
+
+void DJICameraStreamEncoder::recordFrame(uint32_t size, bool isKeyFrame, double latencyMs)
+{
+    T_DjiCameraStreamEncoderStatistics &statistics = encoderStatistics;
+
+    statistics.frameCount++;
+    statistics.byteCount += size;
+    if (isKeyFrame) {
+        statistics.keyFrameCount++;
+    }
+    statistics.averageBitRate = (double) statistics.byteCount * 8 * encoderConfig.frameRate / statistics.frameCount;
+    statistics.averageLatencyMs += (latencyMs - statistics.averageLatencyMs) / statistics.frameCount;
+    if (latencyMs > statistics.maxLatencyMs) {
+        statistics.maxLatencyMs = latencyMs;
+    }
+
+    /* The bit rate is measured over frames rather than wall time, so it does not depend on how fast frames arrive. */
+    windowByteCount += size;
+    if (++windowFrameCount >= encoderConfig.frameRate) {
+        double windowBitRate = (double) windowByteCount * 8 * encoderConfig.frameRate / windowFrameCount;
+        if (windowBitRate > statistics.peakBitRate) {
+            statistics.peakBitRate = windowBitRate;
+        }
+        windowByteCount = 0;
+        windowFrameCount = 0;
+    }
+}
+
+static double DjiCameraStreamEncoder_GetTimeMs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec * 1000 + (double) now.tv_nsec / 1000000;
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,132 @@
+/**
+ ********************************************************************
+ * @file    dji_camera_stream_encoder.hpp
+ * @brief   This is the header file for "dji_camera_stream_encoder.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_CAMERA_STREAM_ENCODER_H
+#define DJI_CAMERA_STREAM_ENCODER_H
+
+/* Includes ------------------------------------------------------------------*/
+extern "C" {
+#ifdef FFMPEG_INSTALLED
+#include <libavcodec/avcodec.h>
+#include <libswscale/swscale.h>
+#endif
+}
+
+#include "pthread.h"
+#include "dji_camera_image_handler.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+// Rate control buffer of the encoder, bounds how long a frame may take on the link at the target bit rate, unit: ms
+#define DJI_CAMERA_STREAM_ENCODER_VBV_BUFFER_MS_DEFAULT     (100)
+// Frames over which intra refresh sweeps the whole picture once
+#define DJI_CAMERA_STREAM_ENCODER_REFRESH_PERIOD_DEFAULT    (30)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t frameRate;
+    uint32_t bitRate;               /*!< Constant bit rate of the stream, unit: bit/s. */
+    uint32_t vbvBufferMs;           /*!< 0 selects DJI_CAMERA_STREAM_ENCODER_VBV_BUFFER_MS_DEFAULT. */
+    uint32_t refreshPeriod;         /*!< 0 selects DJI_CAMERA_STREAM_ENCODER_REFRESH_PERIOD_DEFAULT. */
+    bool useIntraRefresh;           /*!< Spread intra blocks over the refresh period instead of sending key frames. */
+} T_DjiCameraStreamEncoderConfig;
+
+typedef struct {
+    uint64_t frameCount;
+    uint64_t keyFrameCount;
+    uint64_t byteCount;
+    uint64_t failedFrameCount;
+    uint32_t targetBitRate;
+    double averageBitRate;          /*!< Bytes produced per frame times the frame rate, unit: bit/s. */
+    double peakBitRate;             /*!< Highest bit rate over any run of frameRate frames, unit: bit/s. */
+    double averageLatencyMs;        /*!< From handing a frame to the encoder to its data being passed on. */
+    double maxLatencyMs;
+} T_DjiCameraStreamEncoderStatistics;
+
+/*! @note
+ * Keeps one H264 encoder session open for the whole stream. The encoder
+ * context, the YUV frame, the packet and the conversion context are created
+ * once by init and reused for every frame, and the encoded data of a frame is
+ * passed to the callback before encodeFrame returns. The session is tuned for
+ * latency: no B-frames, no lookahead, slice threads, and a constant bit rate
+ * held by a rate control buffer of a few frames.
+ */
+class DJICameraStreamEncoder {
+public:
+    DJICameraStreamEncoder();
+    ~DJICameraStreamEncoder();
+
+    bool init(const T_DjiCameraStreamEncoderConfig &config);
+    void cleanup();
+    void registerCallback(H264Callback f, void *param);
+
+    /*! @brief Encode a frame whose planes are packed one after another without padding. */
+    bool encodeFrame(const uint8_t *buf, uint32_t width, uint32_t height, E_DjiCameraImageFormat format);
+    bool encodeImage(const CameraRGBImage &image);
+
+    /*! @brief Make the next frame a key frame, e.g. when a receiver joins. */
+    void requestKeyFrame();
+    /*! @brief Change the bit rate of the running session, e.g. to follow the bandwidth limit of the link. */
+    void setBitRate(uint32_t bitRate);
+    void getStatistics(T_DjiCameraStreamEncoderStatistics &statistics);
+
+private:
+    bool encodePlanes(const uint8_t *const planeData[], const int planeStride[], int width, int height,
+                      E_DjiCameraImageFormat format);
+    void recordFrame(uint32_t size, bool isKeyFrame, double latencyMs);
+
+    pthread_mutex_t encodeMutex;
+    bool initSuccess;
+    bool isKeyFrameRequested;
+    H264Callback cb;
+    void *cbUserParam;
+    T_DjiCameraStreamEncoderConfig encoderConfig;
+    T_DjiCameraStreamEncoderStatistics encoderStatistics;
+    uint64_t windowByteCount;
+    uint32_t windowFrameCount;
+
+#ifdef FFMPEG_INSTALLED
+    AVCodecContext *pCodecCtx;
+    AVFrame *pFrameYUV;
+    AVPacket *pPacket;
+    SwsContext *pSwsCtx;
+    int64_t nextPts;
+#endif
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DJI_CAMERA_STREAM_ENCODER_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,597 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_frame_export.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_liveview_frame_export.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dji_logger.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define DJI_LIVEVIEW_FRAME_EXPORT_SHM_DIR          "/dev/shm/"
+#define DJI_LIVEVIEW_FRAME_EXPORT_NAME_LEN_MAX     (128)
+#define DJI_LIVEVIEW_FRAME_EXPORT_MAGIC            (0x45464A44)    // "DJFE"
+#define DJI_LIVEVIEW_FRAME_EXPORT_VERSION          (2)
+// Header and slots start on cache line boundaries, so the writer and the readers of one slot never share a line
+// with another slot
+#define DJI_LIVEVIEW_FRAME_EXPORT_ALIGN            (64)
+#define DJI_LIVEVIEW_FRAME_EXPORT_HEADER_SIZE      (64)
+#define DJI_LIVEVIEW_FRAME_EXPORT_SLOT_HEADER_SIZE (128)
+
+/* Private types -------------------------------------------------------------*/
+// Layout of the shared memory, any change has to bump DJI_LIVEVIEW_FRAME_EXPORT_VERSION
+typedef struct {
+    uint32_t magic;             /*!< Written last when the ring is created, readers ignore the ring until then. */
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotDataSize;
+    uint64_t slotOffset;        /*!< Offset of the first slot from the start of the ring. */
+    uint64_t slotStride;
+    uint64_t latestSequence;    /*!< Sequence of the newest complete frame, 0 before the first frame. */
+    uint32_t isClosed;          /*!< Set once the writer removed the ring, no frame is published into it any more. */
+} T_DjiLiveviewFrameExportHeader;
+
+typedef struct {
+    uint64_t lock;              /*!< Odd while the writer fills the slot, changes on every write. */
+    uint64_t sequence;
+    uint64_t timestampUs;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t sourceId;
+    uint32_t dataSize;
+    uint32_t planeCount;
+    uint32_t planeOffset[DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX];
+    uint32_t planeStride[DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX];
+} T_DjiLiveviewFrameExportSlotHeader;
+
+typedef struct {
+    uint8_t *map;
+    size_t mapSize;
+    T_DjiLiveviewFrameExportHeader *header;
+} T_DjiLiveviewFrameExportMapping;
+
+typedef struct {
+    T_DjiLiveviewFrameExportMapping mapping;
+    char path[sizeof(DJI_LIVEVIEW_FRAME_EXPORT_SHM_DIR) + DJI_LIVEVIEW_FRAME_EXPORT_NAME_LEN_MAX];
+    uint64_t sequence;          /*!< Sequence of the last published frame. */
+    uint8_t *writingData;       /*!< Slot data taken by BeginWrite, NULL outside of a write. */
+    uint64_t writeBeginTimeUs;
+    uint64_t publishedCount;
+    uint64_t oversizeCount;
+    uint32_t maxPublishTimeUs;
+} T_DjiLiveviewFrameExportWriter;
+
+typedef struct {
+    T_DjiLiveviewFrameExportMapping mapping;
+    uint64_t lastSequence;
+    uint64_t skippedCount;
+} T_DjiLiveviewFrameExportReader;
+
+static_assert(sizeof(T_DjiLiveviewFrameExportHeader) <= DJI_LIVEVIEW_FRAME_EXPORT_HEADER_SIZE,
+              "Frame export header does not fit.");
+static_assert(sizeof(T_DjiLiveviewFrameExportSlotHeader) <= DJI_LIVEVIEW_FRAME_EXPORT_SLOT_HEADER_SIZE,
+              "Frame export slot header does not fit.");
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static bool DjiLiveviewFrameExport_GetPath(const char *name, char *path, size_t pathSize);
+static void DjiLiveviewFrameExport_MarkClosed(const char *path);
+static T_DjiLiveviewFrameExportSlotHeader *DjiLiveviewFrameExport_GetSlot(const T_DjiLiveviewFrameExportMapping *mapping,
+                                                                          uint64_t sequence);
+static bool DjiLiveviewFrameExport_ReadSlot(T_DjiLiveviewFrameExportReader *reader, uint64_t sequence,
+                                            T_DjiLiveviewFrameExportFrame *frame);
+static uint64_t DjiLiveviewFrameExport_GetTimeUs(void);
+
+/* Exported functions definition ---------------------------------------------*/
+T_DjiReturnCode DjiLiveviewFrameExport_Create(const char *name, uint32_t slotCount, uint32_t slotDataSize,
+                                              T_DjiLiveviewFrameExportHandle *handle)
+{
+    T_DjiLiveviewFrameExportWriter *writer;
+    T_DjiLiveviewFrameExportHeader *header;
+    uint64_t slotStride;
+    uint8_t *map;
+    size_t mapSize;
+    int fd;
+
+    if (slotCount == 0) {
+        slotCount = DJI_LIVEVIEW_FRAME_EXPORT_SLOT_COUNT_DEFAULT;
+    }
+    // A single slot would be rewritten while readers still read the newest frame from it
+    if (handle == nullptr || slotCount < 2 || slotDataSize == 0) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    writer = (T_DjiLiveviewFrameExportWriter *) calloc(1, sizeof(T_DjiLiveviewFrameExportWriter));
+    if (writer == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    if (!DjiLiveviewFrameExport_GetPath(name, writer->path, sizeof(writer->path))) {
+        USER_LOG_ERROR("Invalid frame export name.");
+        free(writer);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    slotStride = DJI_LIVEVIEW_FRAME_EXPORT_SLOT_HEADER_SIZE +
+                 ((uint64_t) slotDataSize + DJI_LIVEVIEW_FRAME_EXPORT_ALIGN - 1) / DJI_LIVEVIEW_FRAME_EXPORT_ALIGN *
+                 DJI_LIVEVIEW_FRAME_EXPORT_ALIGN;
+    mapSize = DJI_LIVEVIEW_FRAME_EXPORT_HEADER_SIZE + slotStride * slotCount;
+
+    // A ring left behind by an earlier run is removed rather than reused, readers still mapping it keep the old
+    // memory and never see half initialized headers. It is marked closed first, so they know to open the new one,
+    // also when the earlier writer died without removing it.
+    DjiLiveviewFrameExport_MarkClosed(writer->path);
+    unlink(writer->path);
+    fd = open(writer->path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        USER_LOG_ERROR("Create frame export %s failed, errno %d.", writer->path, errno);
+        free(writer);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (ftruncate(fd, (off_t) mapSize) != 0) {
+        USER_LOG_ERROR("Resize frame export %s to %zu bytes failed, errno %d.", writer->path, mapSize, errno);
+        close(fd);
+        unlink(writer->path);
+        free(writer);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    map = (uint8_t *) mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        USER_LOG_ERROR("Map frame export %s failed, errno %d.", writer->path, errno);
+        unlink(writer->path);
+        free(writer);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    // Touch every page now, the first frames would otherwise pay for the page faults while publishing
+    memset(map, 0, mapSize);
+
+    header = (T_DjiLiveviewFrameExportHeader *) map;
+    header->version = DJI_LIVEVIEW_FRAME_EXPORT_VERSION;
+    header->slotCount = slotCount;
+    header->slotDataSize = slotDataSize;
+    header->slotOffset = DJI_LIVEVIEW_FRAME_EXPORT_HEADER_SIZE;
+    header->slotStride = slotStride;
+    header->latestSequence = 0;
+    __atomic_store_n(&header->magic, (uint32_t) DJI_LIVEVIEW_FRAME_EXPORT_MAGIC, __ATOMIC_RELEASE);
+
+    writer->mapping.map = map;
+    writer->mapping.mapSize = mapSize;
+    writer->mapping.header = header;
+
+    USER_LOG_INFO("Frame export %s created, %u slots of %u bytes.", writer->path, slotCount, slotDataSize);
+
+    *handle = writer;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_Destroy(T_DjiLiveviewFrameExportHandle handle)
+{
+    T_DjiLiveviewFrameExportWriter *writer = (T_DjiLiveviewFrameExportWriter *) handle;
+
+    if (writer == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    __atomic_store_n(&writer->mapping.header->isClosed, (uint32_t) 1, __ATOMIC_RELEASE);
+    munmap(writer->mapping.map, writer->mapping.mapSize);
+    unlink(writer->path);
+    free(writer);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_BeginWrite(T_DjiLiveviewFrameExportHandle handle, uint32_t dataSize,
+                                                  uint8_t **data)
+{
+    T_DjiLiveviewFrameExportWriter *writer = (T_DjiLiveviewFrameExportWriter *) handle;
+    T_DjiLiveviewFrameExportSlotHeader *slot;
+    uint64_t lock;
+
+    if (writer == nullptr || data == nullptr || writer->writingData != nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (dataSize > writer->mapping.header->slotDataSize) {
+        __atomic_store_n(&writer->oversizeCount, writer->oversizeCount + 1, __ATOMIC_RELAXED);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+    }
+
+    writer->writeBeginTimeUs = DjiLiveviewFrameExport_GetTimeUs();
+
+    slot = DjiLiveviewFrameExport_GetSlot(&writer->mapping, writer->sequence + 1);
+    lock = slot->lock + 1;
+    __atomic_store_n(&slot->lock, lock, __ATOMIC_RELAXED);
+    // Readers have to see the slot locked before any byte of the new frame
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    writer->writingData = (uint8_t *) slot + DJI_LIVEVIEW_FRAME_EXPORT_SLOT_HEADER_SIZE;
+    *data = writer->writingData;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_EndWrite(T_DjiLiveviewFrameExportHandle handle,
+                                                const T_DjiLiveviewFrameExportFrame *frame)
+{
+    T_DjiLiveviewFrameExportWriter *writer = (T_DjiLiveviewFrameExportWriter *) handle;
+    T_DjiLiveviewFrameExportSlotHeader *slot;
+    uint64_t sequence;
+    uint32_t publishTimeUs;
+    uint32_t planeCount;
+
+    if (writer == nullptr || frame == nullptr || writer->writingData == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    sequence = writer->sequence + 1;
+    slot = DjiLiveviewFrameExport_GetSlot(&writer->mapping, sequence);
+    planeCount = frame->planeCount < DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX ? frame->planeCount
+                                                                               : DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX;
+
+    slot->sequence = sequence;
+    slot->timestampUs = frame->timestampUs;
+    slot->width = frame->width;
+    slot->height = frame->height;
+    slot->format = frame->format;
+    slot->sourceId = frame->sourceId;
+    slot->dataSize = frame->dataSize < writer->mapping.header->slotDataSize ? frame->dataSize
+                                                                            : writer->mapping.header->slotDataSize;
+    slot->planeCount = planeCount;
+    for (uint32_t i = 0; i < DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX; i++) {
+        slot->planeOffset[i] = i < planeCount ? frame->planeOffset[i] : 0;
+        slot->planeStride[i] = i < planeCount ? frame->planeStride[i] : 0;
+    }
+
+    __atomic_store_n(&slot->lock, slot->lock + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&writer->mapping.header->latestSequence, sequence, __ATOMIC_RELEASE);
+
+    writer->sequence = sequence;
+    writer->writingData = nullptr;
+
+    publishTimeUs = (uint32_t) (DjiLiveviewFrameExport_GetTimeUs() - writer->writeBeginTimeUs);
+    if (publishTimeUs > writer->maxPublishTimeUs) {
+        __atomic_store_n(&writer->maxPublishTimeUs, publishTimeUs, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&writer->publishedCount, writer->publishedCount + 1, __ATOMIC_RELAXED);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_Publish(T_DjiLiveviewFrameExportHandle handle,
+                                               const T_DjiLiveviewFrameExportFrame *frame)
+{
+    T_DjiReturnCode returnCode;
+    uint8_t *data;
+
+    if (frame == nullptr || frame->data == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    returnCode = DjiLiveviewFrameExport_BeginWrite(handle, frame->dataSize, &data);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    memcpy(data, frame->data, frame->dataSize);
+
+    return DjiLiveviewFrameExport_EndWrite(handle, frame);
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_GetStatistics(T_DjiLiveviewFrameExportHandle handle,
+                                                     T_DjiLiveviewFrameExportStatistics *statistics)
+{
+    T_DjiLiveviewFrameExportWriter *writer = (T_DjiLiveviewFrameExportWriter *) handle;
+
+    if (writer == nullptr || statistics == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    statistics->publishedCount = __atomic_load_n(&writer->publishedCount, __ATOMIC_RELAXED);
+    statistics->oversizeCount = __atomic_load_n(&writer->oversizeCount, __ATOMIC_RELAXED);
+    statistics->maxPublishTimeUs = __atomic_load_n(&writer->maxPublishTimeUs, __ATOMIC_RELAXED);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_OpenReader(const char *name, T_DjiLiveviewFrameExportReaderHandle *reader)
+{
+    T_DjiLiveviewFrameExportReader *exportReader;
+    T_DjiLiveviewFrameExportHeader *header;
+    char path[sizeof(DJI_LIVEVIEW_FRAME_EXPORT_SHM_DIR) + DJI_LIVEVIEW_FRAME_EXPORT_NAME_LEN_MAX];
+    struct stat fileStat;
+    uint8_t *map;
+    size_t mapSize;
+    int fd;
+
+    if (reader == nullptr || !DjiLiveviewFrameExport_GetPath(name, path, sizeof(path))) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < DJI_LIVEVIEW_FRAME_EXPORT_HEADER_SIZE) {
+        close(fd);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    mapSize = (size_t) fileStat.st_size;
+    map = (uint8_t *) mmap(nullptr, mapSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    // The ring may still be set up by the writer, or come from another version of it
+    header = (T_DjiLiveviewFrameExportHeader *) map;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != DJI_LIVEVIEW_FRAME_EXPORT_MAGIC ||
+        header->version != DJI_LIVEVIEW_FRAME_EXPORT_VERSION || header->slotCount < 2 ||
+        header->slotStride < DJI_LIVEVIEW_FRAME_EXPORT_SLOT_HEADER_SIZE + (uint64_t) header->slotDataSize ||
+        header->slotOffset + header->slotStride * header->slotCount > mapSize) {
+        munmap(map, mapSize);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    exportReader = (T_DjiLiveviewFrameExportReader *) calloc(1, sizeof(T_DjiLiveviewFrameExportReader));
+    if (exportReader == nullptr) {
+        munmap(map, mapSize);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    exportReader->mapping.map = map;
+    exportReader->mapping.mapSize = mapSize;
+    exportReader->mapping.header = header;
+    // Frames published before opening are not replayed, reading starts with the newest one
+    exportReader->lastSequence = __atomic_load_n(&header->latestSequence, __ATOMIC_ACQUIRE);
+    if (exportReader->lastSequence > 0) {
+        exportReader->lastSequence--;
+    }
+
+    *reader = exportReader;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_CloseReader(T_DjiLiveviewFrameExportReaderHandle reader)
+{
+    T_DjiLiveviewFrameExportReader *exportReader = (T_DjiLiveviewFrameExportReader *) reader;
+
+    if (exportReader == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    munmap(exportReader->mapping.map, exportReader->mapping.mapSize);
+    free(exportReader);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_ReadNext(T_DjiLiveviewFrameExportReaderHandle reader,
+                                                T_DjiLiveviewFrameExportFrame *frame)
+{
+    T_DjiLiveviewFrameExportReader *exportReader = (T_DjiLiveviewFrameExportReader *) reader;
+    uint64_t latestSequence;
+    uint64_t sequence;
+    uint32_t slotCount;
+    bool isClosed;
+
+    if (exportReader == nullptr || frame == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    slotCount = exportReader->mapping.header->slotCount;
+
+    // Every pass either returns or moves lastSequence forward, so the loop ends once the reader caught up
+    while (true) {
+        // The flag is set after the last frame is published, so a closed ring is reported only once it is drained
+        isClosed = __atomic_load_n(&exportReader->mapping.header->isClosed, __ATOMIC_ACQUIRE) != 0;
+        latestSequence = __atomic_load_n(&exportReader->mapping.header->latestSequence, __ATOMIC_ACQUIRE);
+        if (latestSequence <= exportReader->lastSequence) {
+            return isClosed ? DJI_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE
+                            : DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+        }
+
+        sequence = exportReader->lastSequence + 1;
+        if (latestSequence - sequence >= slotCount) {
+            exportReader->skippedCount += latestSequence - slotCount + 1 - sequence;
+            sequence = latestSequence - slotCount + 1;
+        }
+
+        exportReader->lastSequence = sequence;
+        if (DjiLiveviewFrameExport_ReadSlot(exportReader, sequence, frame)) {
+            return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+        }
+
+        exportReader->skippedCount++;
+    }
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_ReadLatest(T_DjiLiveviewFrameExportReaderHandle reader,
+                                                  T_DjiLiveviewFrameExportFrame *frame)
+{
+    T_DjiLiveviewFrameExportReader *exportReader = (T_DjiLiveviewFrameExportReader *) reader;
+    uint64_t latestSequence;
+
+    if (exportReader == nullptr || frame == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    latestSequence = __atomic_load_n(&exportReader->mapping.header->latestSequence, __ATOMIC_ACQUIRE);
+    if (latestSequence > exportReader->lastSequence + 1) {
+        exportReader->skippedCount += latestSequence - 1 - exportReader->lastSequence;
+        exportReader->lastSequence = latestSequence - 1;
+    }
+
+    return DjiLiveviewFrameExport_ReadNext(reader, frame);
+}
+
+T_DjiReturnCode DjiLiveviewFrameExport_ReadEnd(T_DjiLiveviewFrameExportReaderHandle reader,
+                                               const T_DjiLiveviewFrameExportFrame *frame)
+{
+    T_DjiLiveviewFrameExportReader *exportReader = (T_DjiLiveviewFrameExportReader *) reader;
+    T_DjiLiveviewFrameExportSlotHeader *slot;
+
+    if (exportReader == nullptr || frame == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    slot = DjiLiveviewFrameExport_GetSlot(&exportReader->mapping, frame->sequence);
+    // Everything read from the slot has to be done before the lock is checked again
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->lock, __ATOMIC_RELAXED) != frame->lock) {
+        exportReader->skippedCount++;
+        return DJI_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+uint64_t DjiLiveviewFrameExport_GetSkippedCount(T_DjiLiveviewFrameExportReaderHandle reader)
+{
+    T_DjiLiveviewFrameExportReader *exportReader = (T_DjiLiveviewFrameExportReader *) reader;
+
+    if (exportReader == nullptr) {
+        return 0;
+    }
+
+    return exportReader->skippedCount;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static bool DjiLiveviewFrameExport_GetPath(const char *name, char *path, size_t pathSize)
+{
+    int len;
+
+    if (name == nullptr || name[0] == '\0' || strlen(name) >= DJI_LIVEVIEW_FRAME_EXPORT_NAME_LEN_MAX ||
+        strchr(name, '/') != nullptr) {
+        return false;
+    }
+
+    len = snprintf(path, pathSize, "%s%s", DJI_LIVEVIEW_FRAME_EXPORT_SHM_DIR, name);
+
+    return len > 0 && (size_t) len < pathSize;
+}
+
+static void DjiLiveviewFrameExport_MarkClosed(const char *path)
+{
+    T_DjiLiveviewFrameExportHeader *header;
+    struct stat fileStat;
+    void *map;
+    int fd;
+
+    fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < DJI_LIVEVIEW_FRAME_EXPORT_HEADER_SIZE) {
+        close(fd);
+        return;
+    }
+
+    map = mmap(nullptr, DJI_LIVEVIEW_FRAME_EXPORT_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return;
+    }
+
+    header = (T_DjiLiveviewFrameExportHeader *) map;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == DJI_LIVEVIEW_FRAME_EXPORT_MAGIC &&
+        header->version == DJI_LIVEVIEW_FRAME_EXPORT_VERSION) {
+        __atomic_store_n(&header->isClosed, (uint32_t) 1, __ATOMIC_RELEASE);
+    }
+    munmap(map, DJI_LIVEVIEW_FRAME_EXPORT_HEADER_SIZE);
+}
+
+static T_DjiLiveviewFrameExportSlotHeader *DjiLiveviewFrameExport_GetSlot(const T_DjiLiveviewFrameExportMapping *mapping,
+                                                                          uint64_t sequence)
+{
+    uint64_t index = (sequence - 1) % mapping->header->slotCount;
+
+    return (T_DjiLiveviewFrameExportSlotHeader *) (mapping->map + mapping->header->slotOffset +
+                                                   index * mapping->header->slotStride);
+}
+
+static bool DjiLiveviewFrameExport_ReadSlot(T_DjiLiveviewFrameExportReader *reader, uint64_t sequence,
+                                            T_DjiLiveviewFrameExportFrame *frame)
+{
+    T_DjiLiveviewFrameExportSlotHeader *slot = DjiLiveviewFrameExport_GetSlot(&reader->mapping, sequence);
+    uint64_t lock;
+
+    lock = __atomic_load_n(&slot->lock, __ATOMIC_ACQUIRE);
+    if (lock % 2 != 0) {
+        return false;
+    }
+
+    frame->sequence = slot->sequence;
+    frame->timestampUs = slot->timestampUs;
+    frame->width = slot->width;
+    frame->height = slot->height;
+    frame->format = slot->format;
+    frame->sourceId = slot->sourceId;
+    frame->dataSize = slot->dataSize;
+    frame->planeCount = slot->planeCount;
+    for (uint32_t i = 0; i < DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX; i++) {
+        frame->planeOffset[i] = slot->planeOffset[i];
+        frame->planeStride[i] = slot->planeStride[i];
+    }
+    frame->data = (const uint8_t *) slot + DJI_LIVEVIEW_FRAME_EXPORT_SLOT_HEADER_SIZE;
+    frame->lock = lock;
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&slot->lock, __ATOMIC_RELAXED) != lock) {
+        return false;
+    }
+
+    // A slot already holding a newer frame means the writer lapped the reader
+    return frame->sequence == sequence && frame->dataSize <= reader->mapping.header->slotDataSize;
+}
+
+static uint64_t DjiLiveviewFrameExport_GetTimeUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,185 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_frame_export.hpp
+ * @brief   This is the header file for "dji_liveview_frame_export.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIVEVIEW_FRAME_EXPORT_H
+#define DJI_LIVEVIEW_FRAME_EXPORT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "dji_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+// Slots in the ring, readers that fall further behind than this skip ahead to the oldest frame still held
+#define DJI_LIVEVIEW_FRAME_EXPORT_SLOT_COUNT_DEFAULT    (4)
+#define DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX         (3)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_GRAY8 = 0,
+    DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_RGB24,
+    DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_BGR24,
+    DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_YUV420P,
+    DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_NV12,
+} E_DjiLiveviewFrameExportFormat;
+
+typedef void *T_DjiLiveviewFrameExportHandle;
+typedef void *T_DjiLiveviewFrameExportReaderHandle;
+
+typedef struct {
+    uint64_t sequence;          /*!< Starts from 1 and increases by one per published frame, set by the exporter. */
+    uint64_t timestampUs;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;            /*!< One of E_DjiLiveviewFrameExportFormat. */
+    uint32_t sourceId;          /*!< Tells apart the streams sharing one ring, such as the left and right images. */
+    uint32_t dataSize;
+    uint32_t planeCount;
+    uint32_t planeOffset[DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX];   /*!< Offset of each plane inside data. */
+    uint32_t planeStride[DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX];
+    const uint8_t *data;        /*!< Points into the shared memory on the reader side, valid until the read ends. */
+    uint64_t lock;              /*!< Slot lock value seen when the read began, checked when it ends. */
+} T_DjiLiveviewFrameExportFrame;
+
+typedef struct {
+    uint64_t publishedCount;
+    uint64_t oversizeCount;     /*!< Frames not published because they did not fit into a slot. */
+    uint32_t maxPublishTimeUs;
+} T_DjiLiveviewFrameExportStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Create the shared memory ring that frames are published into.
+ * @note The ring is a file under /dev/shm, so any local process can map it without linking to the payload
+ * application. The writer keeps no state per reader and never waits for readers, publishing costs the same no
+ * matter how many processes read.
+ * @param name: name of the ring, such as "dji_liveview_main_camera".
+ * @param slotCount: number of frames held, 0 selects DJI_LIVEVIEW_FRAME_EXPORT_SLOT_COUNT_DEFAULT.
+ * @param slotDataSize: largest frame the ring takes, unit: byte.
+ * @param handle: created exporter.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_Create(const char *name, uint32_t slotCount, uint32_t slotDataSize,
+                                              T_DjiLiveviewFrameExportHandle *handle);
+
+/**
+ * @brief Mark the ring closed, unmap and remove it. Readers still mapping it keep their mapping until they close,
+ * DjiLiveviewFrameExport_ReadNext tells them the ring is closed once they read every frame left in it.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_Destroy(T_DjiLiveviewFrameExportHandle handle);
+
+/**
+ * @brief Take the next slot for writing in place, so a frame can be converted straight into shared memory.
+ * @note Must be followed by DjiLiveviewFrameExport_EndWrite before the next frame is written. Only one thread may
+ * write to an exporter.
+ * @param handle: exporter.
+ * @param dataSize: size of the frame to write.
+ * @param data: start of the slot data.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_BeginWrite(T_DjiLiveviewFrameExportHandle handle, uint32_t dataSize,
+                                                  uint8_t **data);
+
+/**
+ * @brief Fill in the description of the frame written since DjiLiveviewFrameExport_BeginWrite and publish it.
+ * @param frame: frame description, sequence and data are ignored.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_EndWrite(T_DjiLiveviewFrameExportHandle handle,
+                                                const T_DjiLiveviewFrameExportFrame *frame);
+
+/**
+ * @brief Copy a frame into the next slot and publish it.
+ * @param frame: frame description, the frame is read from data.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_Publish(T_DjiLiveviewFrameExportHandle handle,
+                                               const T_DjiLiveviewFrameExportFrame *frame);
+
+T_DjiReturnCode DjiLiveviewFrameExport_GetStatistics(T_DjiLiveviewFrameExportHandle handle,
+                                                     T_DjiLiveviewFrameExportStatistics *statistics);
+
+/**
+ * @brief Map a ring created by another process for reading.
+ * @note Reading needs neither the SDK initialized nor anything from the writing process besides the ring name. The
+ * reader functions do not log, so processes consuming frames can use them as they are:
+ *   DjiLiveviewFrameExport_OpenReader("dji_liveview_main_camera", &reader);
+ *   while (DjiLiveviewFrameExport_ReadNext(reader, &frame) == DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+ *       Process(frame.data, ...);
+ *       if (DjiLiveviewFrameExport_ReadEnd(reader, &frame) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+ *           // The writer reused the slot meanwhile, drop the result.
+ *       }
+ *   }
+ * A writer that restarts replaces the ring with a new one, the reader has to be closed and opened again when
+ * DjiLiveviewFrameExport_ReadNext returns DJI_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE.
+ * @param name: name the ring was created with.
+ * @param reader: opened reader.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_OpenReader(const char *name, T_DjiLiveviewFrameExportReaderHandle *reader);
+
+T_DjiReturnCode DjiLiveviewFrameExport_CloseReader(T_DjiLiveviewFrameExportReaderHandle reader);
+
+/**
+ * @brief Begin reading the frame following the last one read, without copying it.
+ * @note A reader that fell behind by the whole ring continues with the oldest frame still held and counts the frames
+ * it skipped.
+ * @param reader: reader.
+ * @param frame: description of the frame, data points into the shared memory.
+ * @return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND when no newer frame is published yet,
+ * DJI_ERROR_SYSTEM_MODULE_CODE_NONSUPPORT_IN_CURRENT_STATE when the writer closed or replaced the ring and every
+ * frame left in it was read.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_ReadNext(T_DjiLiveviewFrameExportReaderHandle reader,
+                                                T_DjiLiveviewFrameExportFrame *frame);
+
+/**
+ * @brief Begin reading the newest frame, skipping any older frame not read yet.
+ * @return Same as DjiLiveviewFrameExport_ReadNext.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_ReadLatest(T_DjiLiveviewFrameExportReaderHandle reader,
+                                                  T_DjiLiveviewFrameExportFrame *frame);
+
+/**
+ * @brief Finish reading a frame.
+ * @return DJI_ERROR_SYSTEM_MODULE_CODE_BUSY when the writer reused the slot while it was read, anything computed
+ * from the frame has to be dropped then.
+ */
+T_DjiReturnCode DjiLiveviewFrameExport_ReadEnd(T_DjiLiveviewFrameExportReaderHandle reader,
+                                               const T_DjiLiveviewFrameExportFrame *frame);
+
+/**
+ * @brief Number of frames a reader skipped because it fell behind or the slot was being rewritten.
+ */
+uint64_t DjiLiveviewFrameExport_GetSkippedCount(T_DjiLiveviewFrameExportReaderHandle reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DJI_LIVEVIEW_FRAME_EXPORT_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,244 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_frame_ring.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_liveview_frame_ring.hpp"
+
+#ifdef OPEN_CV_INSTALLED
+
+#include <ctime>
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static void DjiLiveviewFrameRing_GetDeadline(uint32_t timeoutMs, struct timespec *deadline);
+
+/* Exported functions definition ---------------------------------------------*/
+DJILiveviewFrameRing::DJILiveviewFrameRing(uint32_t capacity, E_DjiLiveviewFrameRingPolicy policy,
+                                           uint32_t blockTimeoutMs)
+    : m_policy(policy),
+      m_blockTimeoutMs(blockTimeoutMs),
+      m_slots(capacity > 0 ? capacity : 1),
+      m_readySlots(m_slots.size()),
+      m_readyHead(0),
+      m_readyCount(0),
+      m_isStopped(false),
+      m_statistics()
+{
+    pthread_condattr_t condAttr;
+
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&m_readyCond, &condAttr);
+    pthread_cond_init(&m_freeCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
+    m_freeSlots.reserve(m_slots.size());
+    for (uint32_t i = 0; i < m_slots.size(); i++) {
+        m_slots[i].pushTimeUs = 0;
+        m_freeSlots.push_back(i);
+    }
+}
+
+DJILiveviewFrameRing::~DJILiveviewFrameRing()
+{
+    stop();
+    pthread_cond_destroy(&m_freeCond);
+    pthread_cond_destroy(&m_readyCond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+void DJILiveviewFrameRing::preallocate(int height, int width, int type)
+{
+    pthread_mutex_lock(&m_mutex);
+    for (auto index : m_freeSlots) {
+        m_slots[index].image.create(height, width, type);
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool DJILiveviewFrameRing::push(const uint8_t *data, int height, int width, int type)
+{
+    uint32_t index;
+
+    pthread_mutex_lock(&m_mutex);
+    if (!takeFreeSlot(index)) {
+        m_statistics.droppedCount++;
+        pthread_mutex_unlock(&m_mutex);
+        return false;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    /* The slot belongs to the producer until it is queued, copyTo only allocates when the format changes. */
+    cv::Mat(height, width, type, (void *) data).copyTo(m_slots[index].image);
+
+    pthread_mutex_lock(&m_mutex);
+    m_slots[index].pushTimeUs = getTimeUs();
+    if (m_policy == DJI_LIVEVIEW_FRAME_RING_POLICY_LATEST_ONLY) {
+        dropReady(m_readyCount);
+    }
+    m_readySlots[(m_readyHead + m_readyCount) % m_readySlots.size()] = index;
+    m_readyCount++;
+    m_statistics.pushedCount++;
+    pthread_cond_signal(&m_readyCond);
+    pthread_mutex_unlock(&m_mutex);
+
+    return true;
+}
+
+bool DJILiveviewFrameRing::pop(cv::Mat &frame, uint32_t timeoutMs)
+{
+    struct timespec deadline;
+    uint32_t index;
+    double dwellMs;
+
+    DjiLiveviewFrameRing_GetDeadline(timeoutMs, &deadline);
+
+    pthread_mutex_lock(&m_mutex);
+    while (m_readyCount == 0 && !m_isStopped) {
+        if (pthread_cond_timedwait(&m_readyCond, &m_mutex, &deadline) != 0 && m_readyCount == 0) {
+            pthread_mutex_unlock(&m_mutex);
+            return false;
+        }
+    }
+    if (m_isStopped) {
+        pthread_mutex_unlock(&m_mutex);
+        return false;
+    }
+
+    index = m_readySlots[m_readyHead];
+    m_readyHead = (m_readyHead + 1) % m_readySlots.size();
+    m_readyCount--;
+
+    /* Trade buffers instead of copying, the consumer's last frame becomes the storage of this slot. */
+    cv::swap(frame, m_slots[index].image);
+    m_freeSlots.push_back(index);
+
+    dwellMs = (getTimeUs() - m_slots[index].pushTimeUs) / 1000.0;
+    m_statistics.poppedCount++;
+    m_statistics.averageDwellMs += (dwellMs - m_statistics.averageDwellMs) / m_statistics.poppedCount;
+    if (dwellMs > m_statistics.maxDwellMs) {
+        m_statistics.maxDwellMs = dwellMs;
+    }
+    pthread_cond_signal(&m_freeCond);
+    pthread_mutex_unlock(&m_mutex);
+
+    return true;
+}
+
+void DJILiveviewFrameRing::stop()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_isStopped = true;
+    pthread_cond_broadcast(&m_readyCond);
+    pthread_cond_broadcast(&m_freeCond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool DJILiveviewFrameRing::isStopped()
+{
+    bool isStopped;
+
+    pthread_mutex_lock(&m_mutex);
+    isStopped = m_isStopped;
+    pthread_mutex_unlock(&m_mutex);
+
+    return isStopped;
+}
+
+void DJILiveviewFrameRing::getStatistics(T_DjiLiveviewFrameRingStatistics &statistics)
+{
+    pthread_mutex_lock(&m_mutex);
+    statistics = m_statistics;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+/* Private functions definition-----------------------------------------------*/
+bool DJILiveviewFrameRing::takeFreeSlot(uint32_t &index)
+{
+    struct timespec deadline;
+
+    if (m_freeSlots.empty()) {
+        if (m_policy == DJI_LIVEVIEW_FRAME_RING_POLICY_BLOCK) {
+            DjiLiveviewFrameRing_GetDeadline(m_blockTimeoutMs, &deadline);
+            while (m_freeSlots.empty() && !m_isStopped) {
+                if (pthread_cond_timedwait(&m_freeCond, &m_mutex, &deadline) != 0) {
+                    break;
+                }
+            }
+        } else if (m_readyCount > 0) {
+            dropReady(1);
+        }
+    }
+
+    if (m_freeSlots.empty() || m_isStopped) {
+        return false;
+    }
+
+    index = m_freeSlots.back();
+    m_freeSlots.pop_back();
+
+    return true;
+}
+
+void DJILiveviewFrameRing::dropReady(uint32_t count)
+{
+    while (count > 0 && m_readyCount > 0) {
+        m_freeSlots.push_back(m_readySlots[m_readyHead]);
+        m_readyHead = (m_readyHead + 1) % m_readySlots.size();
+        m_readyCount--;
+        m_statistics.droppedCount++;
+        count--;
+    }
+}
+
+uint64_t DJILiveviewFrameRing::getTimeUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void DjiLiveviewFrameRing_GetDeadline(uint32_t timeoutMs, struct timespec *deadline)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += (long) (timeoutMs % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+#endif
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,118 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_frame_ring.hpp
+ * @brief   This is the header file for "dji_liveview_frame_ring.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIVEVIEW_FRAME_RING_H
+#define DJI_LIVEVIEW_FRAME_RING_H
+
+#ifdef OPEN_CV_INSTALLED
+
+/* Includes ------------------------------------------------------------------*/
+#include "pthread.h"
+#include <cstdint>
+#include <vector>
+#include "opencv2/core.hpp"
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_LIVEVIEW_FRAME_RING_POLICY_DROP_OLDEST = 0, /*!< A full ring drops its oldest frame to take the new one. */
+    DJI_LIVEVIEW_FRAME_RING_POLICY_LATEST_ONLY,     /*!< A new frame replaces every frame not taken yet. */
+    DJI_LIVEVIEW_FRAME_RING_POLICY_BLOCK,           /*!< A full ring makes the producer wait, then drop on timeout. */
+} E_DjiLiveviewFrameRingPolicy;
+
+typedef struct {
+    uint64_t pushedCount;
+    uint64_t poppedCount;
+    uint64_t droppedCount;
+    double averageDwellMs;  /*!< Time from push to pop. */
+    double maxDwellMs;
+} T_DjiLiveviewFrameRingStatistics;
+
+/*! @note
+ * Bounded frame queue between a stream callback and a processing thread. The
+ * slots are cv::Mat buffers that are written in place with copyTo, and pop
+ * swaps the slot buffer with the consumer's previous frame, so once every
+ * buffer has seen the stream resolution no frame is allocated any more. The
+ * mutex only guards slot bookkeeping, pixels are copied outside of it, and the
+ * consumer sleeps on a condition variable instead of polling.
+ */
+class DJILiveviewFrameRing {
+public:
+    DJILiveviewFrameRing(uint32_t capacity, E_DjiLiveviewFrameRingPolicy policy, uint32_t blockTimeoutMs = 0);
+    ~DJILiveviewFrameRing();
+
+    /*! @brief Allocate every slot for the given frame format ahead of the first frame. */
+    void preallocate(int height, int width, int type);
+
+    /*! @brief Copy a frame into the ring.
+     *  @return false when the frame was dropped, which only happens with the block policy.
+     */
+    bool push(const uint8_t *data, int height, int width, int type);
+
+    /*! @brief Take the oldest frame, waiting up to timeoutMs for one.
+     *  @param frame: receives the frame, its previous buffer is handed back to the ring for reuse.
+     *  @return false on timeout or once the ring is stopped.
+     */
+    bool pop(cv::Mat &frame, uint32_t timeoutMs);
+
+    /*! @brief Wake up and refuse every waiting producer and consumer. */
+    void stop();
+    bool isStopped();
+
+    void getStatistics(T_DjiLiveviewFrameRingStatistics &statistics);
+
+private:
+    struct Slot {
+        cv::Mat image;
+        uint64_t pushTimeUs;
+    };
+
+    bool takeFreeSlot(uint32_t &index);
+    void dropReady(uint32_t count);
+    static uint64_t getTimeUs();
+
+    E_DjiLiveviewFrameRingPolicy m_policy;
+    uint32_t m_blockTimeoutMs;
+    std::vector<Slot> m_slots;
+    std::vector<uint32_t> m_freeSlots;
+    std::vector<uint32_t> m_readySlots;
+    uint32_t m_readyHead;
+    uint32_t m_readyCount;
+    bool m_isStopped;
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_readyCond;
+    pthread_cond_t m_freeCond;
+    T_DjiLiveviewFrameRingStatistics m_statistics;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#endif
+
+#endif // DJI_LIVEVIEW_FRAME_RING_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
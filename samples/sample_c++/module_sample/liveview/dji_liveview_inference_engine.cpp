@@ -0,0 +1,392 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_inference_engine.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_liveview_inference_engine.hpp"
+
+#ifdef OPEN_CV_INSTALLED
+
+#include <iostream>
+#include <sstream>
+#include <dji_logger.h>
+
+using namespace cv;
+using namespace std;
+
+/* Private constants ---------------------------------------------------------*/
+#define DJI_LIVEVIEW_FACE_CASCADE_FILE          "data/haarcascade_frontalface_alt.xml"
+//Attention: If you want to run the Tensorflow Object detection demo, Please download the tensorflow model.
+//Download Url: http://download.tensorflow.org/models/object_detection/ssd_inception_v2_coco_2017_11_17.tar.gz
+#define DJI_LIVEVIEW_SSD_CONFIG_FILE            "data/tensorflow/ssd_inception_v2_coco_2017_11_17.pbtxt"
+#define DJI_LIVEVIEW_SSD_WEIGHTS_FILE           "data/tensorflow/frozen_inference_graph.pb"
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+static const char *s_classNames[] = {"background", "person", "bicycle", "car", "motorcycle", "airplane", "bus",
+                                     "train", "truck", "boat", "traffic light",
+                                     "fire hydrant", "background", "stop sign", "parking meter", "bench", "bird",
+                                     "cat", "dog", "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe",
+                                     "background", "backpack", "umbrella", "background", "background", "handbag",
+                                     "tie", "suitcase", "frisbee", "skis", "snowboard", "sports ball", "kite",
+                                     "baseball bat", "baseball glove", "skateboard", "surfboard", "tennis racket",
+                                     "bottle", "background", "wine glass", "cup", "fork", "knife", "spoon", "bowl",
+                                     "banana", "apple", "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza",
+                                     "donut", "cake", "chair", "couch", "potted plant", "bed", "background",
+                                     "dining table", "background", "background", "toilet", "background", "tv",
+                                     "laptop", "mouse", "remote", "keyboard", "cell phone", "microwave", "oven",
+                                     "toaster", "sink", "refrigerator", "background", "book", "clock", "vase",
+                                     "scissors", "teddy bear", "hair drier", "toothbrush"};
+
+static const size_t s_inWidth = 320;
+static const size_t s_inHeight = 300;
+static const float s_whRatio = s_inWidth / (float) s_inHeight;
+static const float s_confidenceThreshold = 0.50;
+
+/* Private functions declaration ---------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+DJILiveviewInferenceEngine::DJILiveviewInferenceEngine(E_DjiLiveviewInferenceModel model,
+                                                       const std::string &dataDirPath, uint32_t workerCount)
+    : m_model(model),
+      m_dataDirPath(dataDirPath),
+      m_workerCount(workerCount > 0 ? workerCount : 1),
+      m_isRunning(false),
+      m_pendingFrame(),
+      m_hasPendingFrame(false),
+      m_submittedFrameIndex(0),
+      m_replacedFrameCount(0),
+      m_resultFrameIndex(0),
+      m_readResultFrameIndex(0)
+{
+    if (!m_dataDirPath.empty() && m_dataDirPath.back() != '/') {
+        m_dataDirPath += '/';
+    }
+
+    pthread_mutex_init(&m_frameMutex, nullptr);
+    pthread_cond_init(&m_frameCond, nullptr);
+    pthread_mutex_init(&m_resultMutex, nullptr);
+    memset(m_timing, 0, sizeof(m_timing));
+}
+
+DJILiveviewInferenceEngine::~DJILiveviewInferenceEngine()
+{
+    stop();
+
+    pthread_mutex_destroy(&m_frameMutex);
+    pthread_cond_destroy(&m_frameCond);
+    pthread_mutex_destroy(&m_resultMutex);
+}
+
+bool DJILiveviewInferenceEngine::start()
+{
+    DJILiveviewModelRegistry &registry = DJILiveviewModelRegistry::getInstance();
+
+    if (m_isRunning) {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < m_workerCount; i++) {
+        std::unique_ptr<Worker> worker(new Worker());
+
+        worker->engine = this;
+        if (m_model == DJI_LIVEVIEW_INFERENCE_MODEL_FACE_CASCADE) {
+            worker->cascade = registry.acquireCascadeClassifier(m_dataDirPath + DJI_LIVEVIEW_FACE_CASCADE_FILE);
+            if (worker->cascade == nullptr) {
+                m_workers.clear();
+                return false;
+            }
+        } else {
+            worker->net = registry.acquireTensorflowNet(m_dataDirPath + DJI_LIVEVIEW_SSD_WEIGHTS_FILE,
+                                                        m_dataDirPath + DJI_LIVEVIEW_SSD_CONFIG_FILE);
+            if (worker->net == nullptr) {
+                m_workers.clear();
+                return false;
+            }
+        }
+        m_workers.push_back(std::move(worker));
+    }
+
+    pthread_mutex_lock(&m_frameMutex);
+    m_isRunning = true;
+    pthread_mutex_unlock(&m_frameMutex);
+    for (auto it = m_workers.begin(); it != m_workers.end(); ++it) {
+        if (pthread_create(&(*it)->thread, nullptr, workerThreadEntry, it->get()) != 0) {
+            USER_LOG_ERROR("Create inference worker failed.");
+            m_workers.erase(it, m_workers.end());
+            break;
+        }
+    }
+
+    if (m_workers.empty()) {
+        pthread_mutex_lock(&m_frameMutex);
+        m_isRunning = false;
+        pthread_mutex_unlock(&m_frameMutex);
+        return false;
+    }
+
+    USER_LOG_INFO("Inference engine started with %u workers, %u models loaded so far.", (uint32_t) m_workers.size(),
+                  registry.getLoadCount());
+
+    return true;
+}
+
+void DJILiveviewInferenceEngine::stop()
+{
+    pthread_mutex_lock(&m_frameMutex);
+    if (!m_isRunning) {
+        pthread_mutex_unlock(&m_frameMutex);
+        return;
+    }
+    m_isRunning = false;
+    pthread_cond_broadcast(&m_frameCond);
+    pthread_mutex_unlock(&m_frameMutex);
+
+    for (auto &worker : m_workers) {
+        pthread_join(worker->thread, nullptr);
+    }
+
+    /* The models go back to the registry and stay loaded for the next engine. */
+    m_workers.clear();
+    m_pendingFrame.release();
+    m_hasPendingFrame = false;
+}
+
+void DJILiveviewInferenceEngine::submitFrame(const CameraRGBImage &image)
+{
+    pthread_mutex_lock(&m_frameMutex);
+    if (!m_isRunning) {
+        pthread_mutex_unlock(&m_frameMutex);
+        return;
+    }
+    if (m_hasPendingFrame) {
+        m_replacedFrameCount++;
+    }
+    m_pendingFrame = image;
+    m_hasPendingFrame = true;
+    m_submittedFrameIndex++;
+    pthread_cond_signal(&m_frameCond);
+    pthread_mutex_unlock(&m_frameMutex);
+}
+
+bool DJILiveviewInferenceEngine::getLatestResult(cv::Mat &image)
+{
+    bool hasNewResult = false;
+
+    pthread_mutex_lock(&m_resultMutex);
+    if (m_resultFrameIndex != m_readResultFrameIndex) {
+        m_result.copyTo(image);
+        m_readResultFrameIndex = m_resultFrameIndex;
+        hasNewResult = true;
+    }
+    pthread_mutex_unlock(&m_resultMutex);
+
+    return hasNewResult;
+}
+
+void DJILiveviewInferenceEngine::getStageTiming(
+    T_DjiLiveviewInferenceStageTiming timing[DJI_LIVEVIEW_INFERENCE_STAGE_COUNT])
+{
+    pthread_mutex_lock(&m_resultMutex);
+    memcpy(timing, m_timing, sizeof(m_timing));
+    pthread_mutex_unlock(&m_resultMutex);
+}
+
+uint64_t DJILiveviewInferenceEngine::getReplacedFrameCount()
+{
+    uint64_t count;
+
+    pthread_mutex_lock(&m_frameMutex);
+    count = m_replacedFrameCount;
+    pthread_mutex_unlock(&m_frameMutex);
+
+    return count;
+}
+
+/* Private functions definition-----------------------------------------------*/
+void *DJILiveviewInferenceEngine::workerThreadEntry(void *p)
+{
+    Worker *worker = static_cast<Worker *>(p);
+
+    worker->engine->workerThreadFunc(*worker);
+
+    return nullptr;
+}
+
+void DJILiveviewInferenceEngine::workerThreadFunc(Worker &worker)
+{
+    CameraRGBImage frame;
+    cv::Mat result;
+    uint64_t frameIndex;
+
+    while (true) {
+        pthread_mutex_lock(&m_frameMutex);
+        while (!m_hasPendingFrame && m_isRunning) {
+            pthread_cond_wait(&m_frameCond, &m_frameMutex);
+        }
+        if (!m_isRunning) {
+            pthread_mutex_unlock(&m_frameMutex);
+            break;
+        }
+        frame = m_pendingFrame;
+        m_pendingFrame.release();
+        m_hasPendingFrame = false;
+        frameIndex = m_submittedFrameIndex;
+        pthread_mutex_unlock(&m_frameMutex);
+
+        if (frame.format != DJI_CAMERA_IMAGE_FORMAT_RGB24) {
+            /* Frames of a decoder in YUV mode are converted here, on the worker, rather than on the decoder. */
+            CameraRGBImage rgbFrame;
+            bool isConverted = frame.toRGB(rgbFrame);
+            frame = rgbFrame;
+            if (!isConverted) {
+                continue;
+            }
+        }
+
+        if (m_model == DJI_LIVEVIEW_INFERENCE_MODEL_FACE_CASCADE) {
+            processFaceCascade(worker, frame, result);
+        } else {
+            processTensorflowSsd(worker, frame, result);
+        }
+
+        /* Workers may finish out of order, an older frame never replaces a newer result. */
+        pthread_mutex_lock(&m_resultMutex);
+        if (frameIndex > m_resultFrameIndex) {
+            result.copyTo(m_result);
+            m_resultFrameIndex = frameIndex;
+        }
+        pthread_mutex_unlock(&m_resultMutex);
+    }
+}
+
+void DJILiveviewInferenceEngine::processFaceCascade(Worker &worker, CameraRGBImage &frame, cv::Mat &result)
+{
+    int64_t startTick = getTickCount();
+    Mat rgb(frame.height, frame.width, CV_8UC3, frame.rawData, frame.width * 3);
+
+    cvtColor(rgb, worker.bgr, COLOR_RGB2BGR);
+    /* The pooled frame goes back to the decoder as soon as the worker has its own copy. */
+    frame.release();
+    recordStage(DJI_LIVEVIEW_INFERENCE_STAGE_PREPROCESS, startTick);
+
+    startTick = getTickCount();
+    worker.cascade->detectMultiScale(worker.bgr, worker.faces, 1.1, 3, 0, Size(50, 50));
+    recordStage(DJI_LIVEVIEW_INFERENCE_STAGE_FORWARD, startTick);
+
+    startTick = getTickCount();
+    for (size_t i = 0; i < worker.faces.size(); ++i) {
+        cv::rectangle(worker.bgr, cv::Point(worker.faces[i].x, worker.faces[i].y),
+                      cv::Point(worker.faces[i].x + worker.faces[i].width,
+                                worker.faces[i].y + worker.faces[i].height),
+                      Scalar(0, 0, 255), 2, 1, 0);
+    }
+    result = worker.bgr;
+    recordStage(DJI_LIVEVIEW_INFERENCE_STAGE_POSTPROCESS, startTick);
+}
+
+void DJILiveviewInferenceEngine::processTensorflowSsd(Worker &worker, CameraRGBImage &frame, cv::Mat &result)
+{
+    int64_t startTick = getTickCount();
+    Mat rgb(frame.height, frame.width, CV_8UC3, frame.rawData, frame.width * 3);
+    Size frameSize = rgb.size();
+    Size cropSize;
+
+    /* blobFromImage writes into the worker's blob, which keeps its allocation from frame to frame. */
+    cv::dnn::blobFromImage(rgb, worker.blob, 1, Size(300, 300));
+    cvtColor(rgb, worker.bgr, COLOR_RGB2BGR);
+    frame.release();
+    recordStage(DJI_LIVEVIEW_INFERENCE_STAGE_PREPROCESS, startTick);
+
+    startTick = getTickCount();
+    worker.net->setInput(worker.blob);
+    worker.output = worker.net->forward();
+    recordStage(DJI_LIVEVIEW_INFERENCE_STAGE_FORWARD, startTick);
+
+    startTick = getTickCount();
+    Mat detectionMat(worker.output.size[2], worker.output.size[3], CV_32F, worker.output.ptr<float>());
+
+    if (frameSize.width / (float) frameSize.height > s_whRatio) {
+        cropSize = Size(static_cast<int>(frameSize.height * s_whRatio), frameSize.height);
+    } else {
+        cropSize = Size(frameSize.width, static_cast<int>(frameSize.width / s_whRatio));
+    }
+
+    Rect crop(Point((frameSize.width - cropSize.width) / 2, (frameSize.height - cropSize.height) / 2), cropSize);
+    Mat mat = worker.bgr(crop);
+
+    for (int i = 0; i < detectionMat.rows; i++) {
+        float confidence = detectionMat.at<float>(i, 2);
+        if (confidence > s_confidenceThreshold) {
+            auto objectClass = (size_t) (detectionMat.at<float>(i, 1));
+            if (objectClass >= sizeof(s_classNames) / sizeof(s_classNames[0])) {
+                continue;
+            }
+
+            int xLeftBottom = static_cast<int>(detectionMat.at<float>(i, 3) * mat.cols);
+            int yLeftBottom = static_cast<int>(detectionMat.at<float>(i, 4) * mat.rows);
+            int xRightTop = static_cast<int>(detectionMat.at<float>(i, 5) * mat.cols);
+            int yRightTop = static_cast<int>(detectionMat.at<float>(i, 6) * mat.rows);
+
+            ostringstream ss;
+            ss << confidence;
+            String conf(ss.str());
+
+            Rect object((int) xLeftBottom, (int) yLeftBottom,
+                        (int) (xRightTop - xLeftBottom),
+                        (int) (yRightTop - yLeftBottom));
+
+            rectangle(mat, object, Scalar(0, 255, 0), 2);
+            String label = String(s_classNames[objectClass]) + ": " + conf;
+
+            int baseLine = 0;
+            Size labelSize = getTextSize(label, FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
+            rectangle(mat, Rect(Point(xLeftBottom, yLeftBottom - labelSize.height),
+                                Size(labelSize.width, labelSize.height + baseLine)), Scalar(0, 255, 0), cv::FILLED);
+            putText(mat, label, Point(xLeftBottom, yLeftBottom), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 0, 0));
+        }
+    }
+    result = mat;
+    recordStage(DJI_LIVEVIEW_INFERENCE_STAGE_POSTPROCESS, startTick);
+}
+
+void DJILiveviewInferenceEngine::recordStage(E_DjiLiveviewInferenceStage stage, int64_t startTick)
+{
+    double costMs = (getTickCount() - startTick) * 1000.0 / getTickFrequency();
+    T_DjiLiveviewInferenceStageTiming *timing = &m_timing[stage];
+
+    pthread_mutex_lock(&m_resultMutex);
+    timing->count++;
+    timing->lastMs = costMs;
+    timing->averageMs += (costMs - timing->averageMs) / timing->count;
+    if (costMs > timing->maxMs) {
+        timing->maxMs = costMs;
+    }
+    pthread_mutex_unlock(&m_resultMutex);
+}
+
+#endif
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,141 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_inference_engine.hpp
+ * @brief   This is the header file for "dji_liveview_inference_engine.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIVEVIEW_INFERENCE_ENGINE_H
+#define DJI_LIVEVIEW_INFERENCE_ENGINE_H
+
+#ifdef OPEN_CV_INSTALLED
+
+/* Includes ------------------------------------------------------------------*/
+#include "pthread.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "opencv2/opencv.hpp"
+#include "opencv2/dnn.hpp"
+#include "dji_camera_image_handler.hpp"
+#include "dji_liveview_model_registry.hpp"
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_LIVEVIEW_INFERENCE_WORKER_COUNT_DEFAULT    (2)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_LIVEVIEW_INFERENCE_MODEL_FACE_CASCADE = 0,
+    DJI_LIVEVIEW_INFERENCE_MODEL_TENSORFLOW_SSD,
+} E_DjiLiveviewInferenceModel;
+
+typedef enum {
+    DJI_LIVEVIEW_INFERENCE_STAGE_PREPROCESS = 0,
+    DJI_LIVEVIEW_INFERENCE_STAGE_FORWARD,
+    DJI_LIVEVIEW_INFERENCE_STAGE_POSTPROCESS,
+    DJI_LIVEVIEW_INFERENCE_STAGE_COUNT,
+} E_DjiLiveviewInferenceStage;
+
+typedef struct {
+    uint64_t count;
+    double lastMs;
+    double averageMs;
+    double maxMs;
+} T_DjiLiveviewInferenceStageTiming;
+
+/*! @note
+ * Runs one of the liveview detection demos on a pool of worker threads. The
+ * models come warm from DJILiveviewModelRegistry and stay with their worker,
+ * together with the worker's conversion and input blob buffers, so steady
+ * state inference neither touches the disk nor reallocates. Only the newest
+ * submitted frame waits for a worker: a frame that is still waiting when the
+ * next one arrives is replaced, so inference never falls behind the stream.
+ */
+class DJILiveviewInferenceEngine {
+public:
+    DJILiveviewInferenceEngine(E_DjiLiveviewInferenceModel model, const std::string &dataDirPath,
+                               uint32_t workerCount = DJI_LIVEVIEW_INFERENCE_WORKER_COUNT_DEFAULT);
+    ~DJILiveviewInferenceEngine();
+
+    /*! @brief Acquire a model instance for every worker and start the workers.
+     *  @return false when the model cannot be loaded.
+     */
+    bool start();
+    void stop();
+
+    /*! @brief Hand a frame to the workers without waiting, replacing a frame that no worker has taken yet. */
+    void submitFrame(const CameraRGBImage &image);
+
+    /*! @brief Copy out the newest annotated BGR image.
+     *  @return false when no result newer than the previous call is available.
+     */
+    bool getLatestResult(cv::Mat &image);
+
+    void getStageTiming(T_DjiLiveviewInferenceStageTiming timing[DJI_LIVEVIEW_INFERENCE_STAGE_COUNT]);
+    uint64_t getReplacedFrameCount();
+
+private:
+    struct Worker {
+        DJILiveviewInferenceEngine *engine;
+        pthread_t thread;
+        std::shared_ptr<cv::CascadeClassifier> cascade;
+        std::shared_ptr<cv::dnn::Net> net;
+        cv::Mat bgr;
+        cv::Mat blob;
+        cv::Mat output;
+        std::vector<cv::Rect> faces;
+    };
+
+    static void *workerThreadEntry(void *p);
+    void workerThreadFunc(Worker &worker);
+    void processFaceCascade(Worker &worker, CameraRGBImage &frame, cv::Mat &result);
+    void processTensorflowSsd(Worker &worker, CameraRGBImage &frame, cv::Mat &result);
+    void recordStage(E_DjiLiveviewInferenceStage stage, int64_t startTick);
+
+    E_DjiLiveviewInferenceModel m_model;
+    std::string m_dataDirPath;
+    uint32_t m_workerCount;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    bool m_isRunning;
+
+    pthread_mutex_t m_frameMutex;
+    pthread_cond_t m_frameCond;
+    CameraRGBImage m_pendingFrame;
+    bool m_hasPendingFrame;
+    uint64_t m_submittedFrameIndex;
+    uint64_t m_replacedFrameCount;
+
+    pthread_mutex_t m_resultMutex;
+    cv::Mat m_result;
+    uint64_t m_resultFrameIndex;
+    uint64_t m_readResultFrameIndex;
+    T_DjiLiveviewInferenceStageTiming m_timing[DJI_LIVEVIEW_INFERENCE_STAGE_COUNT];
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#endif
+
+#endif // DJI_LIVEVIEW_INFERENCE_ENGINE_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,275 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_meta_builder.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_liveview_meta_builder.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+/* Private constants ---------------------------------------------------------*/
+// Boxes a buffer holds before addBox or take first has to grow it
+#define DJI_LIVEVIEW_META_BUILDER_BOX_COUNT_INITIAL     (16)
+#define DJI_LIVEVIEW_META_BUILDER_RATE_WINDOW_US        (60 * 1000000ULL)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static size_t DjiLiveviewMetaBuilder_GetSize(uint32_t boxCount);
+static bool DjiLiveviewMetaBuilder_IsClose(uint32_t a, uint32_t b, uint32_t tolerance);
+
+/* Exported functions definition ---------------------------------------------*/
+DJILiveviewMetaBuilder::DJILiveviewMetaBuilder(const T_DjiLiveviewMetaBuilderConfig &config)
+    : m_config(config),
+      m_minIntervalUs(0),
+      m_isFrontPending(false),
+      m_hasTaken(false),
+      m_lastTakeTimeUs(0),
+      m_rateWindowStartUs(getTimeUs()),
+      m_rateWindowStartCount(0),
+      m_statistics()
+{
+    uint32_t initialBoxCount;
+
+    if (m_config.maxBoxCount > DJI_LIVEVIEW_META_BUILDER_BOX_COUNT_MAX) {
+        m_config.maxBoxCount = DJI_LIVEVIEW_META_BUILDER_BOX_COUNT_MAX;
+    }
+    if (m_config.frameRate > 0) {
+        m_minIntervalUs = 1000000 / m_config.frameRate;
+    }
+
+    initialBoxCount = m_config.maxBoxCount < DJI_LIVEVIEW_META_BUILDER_BOX_COUNT_INITIAL ?
+                      m_config.maxBoxCount : DJI_LIVEVIEW_META_BUILDER_BOX_COUNT_INITIAL;
+    m_backMetaData = allocateMetaData(initialBoxCount);
+    m_frontMetaData = allocateMetaData(initialBoxCount);
+    m_takenMetaData = allocateMetaData(initialBoxCount);
+    if (m_backMetaData == nullptr || m_frontMetaData == nullptr || m_takenMetaData == nullptr) {
+        free(m_takenMetaData);
+        free(m_frontMetaData);
+        free(m_backMetaData);
+        throw std::bad_alloc();
+    }
+    m_backCapacity = initialBoxCount;
+    m_frontCapacity = initialBoxCount;
+    m_takenCapacity = initialBoxCount;
+    m_statistics.allocationCount = 3;
+
+    pthread_mutex_init(&m_mutex, nullptr);
+}
+
+DJILiveviewMetaBuilder::~DJILiveviewMetaBuilder()
+{
+    free(m_takenMetaData);
+    free(m_frontMetaData);
+    free(m_backMetaData);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+void DJILiveviewMetaBuilder::beginFrame()
+{
+    m_backMetaData->boxCount = 0;
+}
+
+bool DJILiveviewMetaBuilder::addBox(const T_DjiLiveViewBoundingBox &box)
+{
+    if (m_backMetaData->boxCount >= m_backCapacity) {
+        pthread_mutex_lock(&m_mutex);
+        if (m_backMetaData->boxCount >= m_config.maxBoxCount ||
+            !growMetaData(m_backMetaData, m_backCapacity, m_backMetaData->boxCount + 1)) {
+            m_statistics.truncatedBoxCount++;
+            pthread_mutex_unlock(&m_mutex);
+            return false;
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    m_backMetaData->boxData[m_backMetaData->boxCount++] = box;
+
+    return true;
+}
+
+void DJILiveviewMetaBuilder::publish()
+{
+    T_DjiLiveViewStandardMetaData *metaData;
+    uint32_t capacity;
+
+    pthread_mutex_lock(&m_mutex);
+    metaData = m_frontMetaData;
+    m_frontMetaData = m_backMetaData;
+    m_backMetaData = metaData;
+    capacity = m_frontCapacity;
+    m_frontCapacity = m_backCapacity;
+    m_backCapacity = capacity;
+
+    if (m_isFrontPending) {
+        m_statistics.replacedCount++;
+    }
+    m_isFrontPending = true;
+    m_statistics.publishedCount++;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+T_DjiLiveViewStandardMetaData *DJILiveviewMetaBuilder::take()
+{
+    uint64_t nowUs = getTimeUs();
+
+    pthread_mutex_lock(&m_mutex);
+    if (!m_isFrontPending) {
+        pthread_mutex_unlock(&m_mutex);
+        return nullptr;
+    }
+
+    /* Faster detection than video is folded into the next video frame, the newest result wins. */
+    if (m_hasTaken && nowUs - m_lastTakeTimeUs < m_minIntervalUs) {
+        pthread_mutex_unlock(&m_mutex);
+        return nullptr;
+    }
+
+    m_isFrontPending = false;
+    if (m_hasTaken && isUnchanged(m_frontMetaData) &&
+        (m_config.refreshIntervalMs == 0 || nowUs - m_lastTakeTimeUs < (uint64_t) m_config.refreshIntervalMs * 1000)) {
+        m_statistics.unchangedCount++;
+        pthread_mutex_unlock(&m_mutex);
+        return nullptr;
+    }
+
+    if (m_frontMetaData->boxCount > m_takenCapacity &&
+        !growMetaData(m_takenMetaData, m_takenCapacity, m_frontMetaData->boxCount)) {
+        pthread_mutex_unlock(&m_mutex);
+        return nullptr;
+    }
+    memcpy(m_takenMetaData, m_frontMetaData, DjiLiveviewMetaBuilder_GetSize(m_frontMetaData->boxCount));
+    m_statistics.takenCount++;
+    pthread_mutex_unlock(&m_mutex);
+
+    m_hasTaken = true;
+    m_lastTakeTimeUs = nowUs;
+
+    return m_takenMetaData;
+}
+
+void DJILiveviewMetaBuilder::getStatistics(T_DjiLiveviewMetaBuilderStatistics &statistics)
+{
+    pthread_mutex_lock(&m_mutex);
+    updateAllocationRate(getTimeUs());
+    statistics = m_statistics;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+/* Private functions definition-----------------------------------------------*/
+T_DjiLiveViewStandardMetaData *DJILiveviewMetaBuilder::allocateMetaData(uint32_t boxCount)
+{
+    return (T_DjiLiveViewStandardMetaData *) calloc(1, DjiLiveviewMetaBuilder_GetSize(boxCount));
+}
+
+bool DJILiveviewMetaBuilder::growMetaData(T_DjiLiveViewStandardMetaData *&metaData, uint32_t &capacity,
+                                          uint32_t boxCount)
+{
+    T_DjiLiveViewStandardMetaData *newMetaData;
+    uint32_t newCapacity = capacity * 2 > boxCount ? capacity * 2 : boxCount;
+
+    /* Called with m_mutex held. Doubling keeps the growth to a few steps, after that the buffers are reused for
+     * every frame.
+     */
+    if (newCapacity > m_config.maxBoxCount) {
+        newCapacity = m_config.maxBoxCount;
+    }
+
+    newMetaData = (T_DjiLiveViewStandardMetaData *) realloc(metaData, DjiLiveviewMetaBuilder_GetSize(newCapacity));
+    if (newMetaData == nullptr) {
+        return false;
+    }
+    metaData = newMetaData;
+    capacity = newCapacity;
+    m_statistics.allocationCount++;
+    updateAllocationRate(getTimeUs());
+
+    return true;
+}
+
+void DJILiveviewMetaBuilder::updateAllocationRate(uint64_t nowUs)
+{
+    uint64_t elapsedUs = nowUs - m_rateWindowStartUs;
+
+    if (elapsedUs < DJI_LIVEVIEW_META_BUILDER_RATE_WINDOW_US) {
+        return;
+    }
+
+    /* A window that ran past a minute without a call is scaled down to one minute. */
+    m_statistics.allocationsPerMinute = (double) (m_statistics.allocationCount - m_rateWindowStartCount) *
+                                        DJI_LIVEVIEW_META_BUILDER_RATE_WINDOW_US / elapsedUs;
+    m_rateWindowStartUs = nowUs;
+    m_rateWindowStartCount = m_statistics.allocationCount;
+}
+
+bool DJILiveviewMetaBuilder::isUnchanged(const T_DjiLiveViewStandardMetaData *metaData) const
+{
+    const T_DjiLiveViewBoundingBox *box;
+    const T_DjiLiveViewBoundingBox *takenBox;
+
+    if (metaData->boxCount != m_takenMetaData->boxCount) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < metaData->boxCount; i++) {
+        box = &metaData->boxData[i];
+        takenBox = &m_takenMetaData->boxData[i];
+        if (box->id != takenBox->id || box->type != takenBox->type || box->state != takenBox->state ||
+            !DjiLiveviewMetaBuilder_IsClose(box->box.cx, takenBox->box.cx, m_config.positionTolerance) ||
+            !DjiLiveviewMetaBuilder_IsClose(box->box.cy, takenBox->box.cy, m_config.positionTolerance) ||
+            !DjiLiveviewMetaBuilder_IsClose(box->box.w, takenBox->box.w, m_config.positionTolerance) ||
+            !DjiLiveviewMetaBuilder_IsClose(box->box.h, takenBox->box.h, m_config.positionTolerance) ||
+            !DjiLiveviewMetaBuilder_IsClose(box->box.distance, takenBox->box.distance, m_config.distanceTolerance)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint64_t DJILiveviewMetaBuilder::getTimeUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static size_t DjiLiveviewMetaBuilder_GetSize(uint32_t boxCount)
+{
+    /* boxData already holds one box inside the struct. */
+    return sizeof(T_DjiLiveViewStandardMetaData) + (boxCount > 1 ? boxCount - 1 : 0) * sizeof(T_DjiLiveViewBoundingBox);
+}
+
+static bool DjiLiveviewMetaBuilder_IsClose(uint32_t a, uint32_t b, uint32_t tolerance)
+{
+    return (a > b ? a - b : b - a) <= tolerance;
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,124 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_meta_builder.hpp
+ * @brief   This is the header file for "dji_liveview_meta_builder.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIVEVIEW_META_BUILDER_H
+#define DJI_LIVEVIEW_META_BUILDER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "pthread.h"
+#include <cstdint>
+#include "dji_liveview.h"
+
+/* Exported constants --------------------------------------------------------*/
+// boxCount of T_DjiLiveViewStandardMetaData is 8 bits wide
+#define DJI_LIVEVIEW_META_BUILDER_BOX_COUNT_MAX         (255)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t maxBoxCount;         /*!< Boxes kept per frame, the rest are dropped, at most 255. */
+    uint32_t frameRate;           /*!< Frame rate of the video the metadata goes along with. */
+    uint32_t refreshIntervalMs;   /*!< Unchanged metadata is still taken again after this time, 0 to never repeat. */
+    uint16_t positionTolerance;   /*!< Largest move of a box edge still counted as unchanged, unit: 1/10000 screen. */
+    uint32_t distanceTolerance;   /*!< Largest distance change still counted as unchanged, unit: mm. */
+} T_DjiLiveviewMetaBuilderConfig;
+
+typedef struct {
+    uint64_t publishedCount;
+    uint64_t takenCount;
+    uint64_t unchangedCount;      /*!< Published frames skipped because their boxes matched the last taken ones. */
+    uint64_t replacedCount;       /*!< Published frames replaced by a newer one before the video frame took them. */
+    uint64_t truncatedBoxCount;   /*!< Boxes dropped above maxBoxCount or when a buffer could not grow. */
+    uint64_t allocationCount;     /*!< Heap allocations and reallocations made by the builder since it was created. */
+    double allocationsPerMinute;  /*!< Allocations in the last full minute, 0 until the first minute is over. */
+} T_DjiLiveviewMetaBuilderStatistics;
+
+/*! @note
+ * Builds the AI metadata sent to the pilot without touching the heap per
+ * frame once its buffers fit the box counts seen. The constructor allocates
+ * three small buffers and throws std::bad_alloc when that fails, addBox and
+ * take grow them up to maxBoxCount. Every allocation is counted, so
+ * allocationsPerMinute falling to 0 shows the builder has settled.
+ * The detection thread fills the back buffer with beginFrame/addBox and swaps
+ * it with the front buffer in publish. The video side calls take once per
+ * frame, which copies the front buffer into a buffer of its own, so the
+ * detection thread never waits for the video thread to finish with it.
+ * take hands out metadata at most once per video frame interval, and skips
+ * boxes that did not move since the last taken ones until the refresh
+ * interval is up, so the metadata channel does not compete with the video for
+ * bandwidth.
+ */
+class DJILiveviewMetaBuilder {
+public:
+    explicit DJILiveviewMetaBuilder(const T_DjiLiveviewMetaBuilderConfig &config);
+    ~DJILiveviewMetaBuilder();
+
+    /*! @brief Start filling the back buffer for a new detection result. Detection thread only. */
+    void beginFrame();
+
+    /*! @brief Append a box to the back buffer.
+     *  @return false when the box count limit is reached and the box was dropped.
+     */
+    bool addBox(const T_DjiLiveViewBoundingBox &box);
+
+    /*! @brief Make the back buffer the newest metadata, replacing any that was not taken yet. */
+    void publish();
+
+    /*! @brief Take the newest metadata for the current video frame. Video thread only.
+     *  @return nullptr when nothing new is due, otherwise a buffer that stays valid until the next take.
+     */
+    T_DjiLiveViewStandardMetaData *take();
+
+    void getStatistics(T_DjiLiveviewMetaBuilderStatistics &statistics);
+
+private:
+    T_DjiLiveViewStandardMetaData *allocateMetaData(uint32_t boxCount);
+    bool growMetaData(T_DjiLiveViewStandardMetaData *&metaData, uint32_t &capacity, uint32_t boxCount);
+    void updateAllocationRate(uint64_t nowUs);
+    bool isUnchanged(const T_DjiLiveViewStandardMetaData *metaData) const;
+    static uint64_t getTimeUs();
+
+    T_DjiLiveviewMetaBuilderConfig m_config;
+    uint64_t m_minIntervalUs;
+    T_DjiLiveViewStandardMetaData *m_backMetaData;
+    T_DjiLiveViewStandardMetaData *m_frontMetaData;
+    T_DjiLiveViewStandardMetaData *m_takenMetaData;
+    bool m_isFrontPending;
+    bool m_hasTaken;
+    uint64_t m_lastTakeTimeUs;
+    uint32_t m_backCapacity;
+    uint32_t m_frontCapacity;
+    uint32_t m_takenCapacity;
+    uint64_t m_rateWindowStartUs;
+    uint64_t m_rateWindowStartCount;
+
+    pthread_mutex_t m_mutex;
+    T_DjiLiveviewMetaBuilderStatistics m_statistics;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#endif // DJI_LIVEVIEW_META_BUILDER_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
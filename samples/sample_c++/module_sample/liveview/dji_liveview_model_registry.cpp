@@ -0,0 +1,237 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_model_registry.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_liveview_model_registry.hpp"
+
+#ifdef OPEN_CV_INSTALLED
+
+#include <fstream>
+#include <iterator>
+#include <dji_logger.h>
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static bool DjiLiveview_ReadModelFile(const std::string &path, std::vector<uchar> &buffer);
+
+/* Exported functions definition ---------------------------------------------*/
+template<typename T>
+DJILiveviewModelRegistry::ModelEntry<T>::ModelEntry()
+{
+    pthread_mutex_init(&mutex, nullptr);
+}
+
+template<typename T>
+DJILiveviewModelRegistry::ModelEntry<T>::~ModelEntry()
+{
+    for (auto model : freeList) {
+        delete model;
+    }
+    freeList.clear();
+    pthread_mutex_destroy(&mutex);
+}
+
+template<typename T>
+void DJILiveviewModelRegistry::ModelEntry<T>::release(T *model)
+{
+    pthread_mutex_lock(&mutex);
+    freeList.push_back(model);
+    pthread_mutex_unlock(&mutex);
+}
+
+DJILiveviewModelRegistry &DJILiveviewModelRegistry::getInstance()
+{
+    static DJILiveviewModelRegistry registry;
+
+    return registry;
+}
+
+DJILiveviewModelRegistry::DJILiveviewModelRegistry()
+    : m_loadCount(0)
+{
+    pthread_mutex_init(&m_mutex, nullptr);
+}
+
+DJILiveviewModelRegistry::~DJILiveviewModelRegistry()
+{
+    pthread_mutex_destroy(&m_mutex);
+}
+
+std::shared_ptr<cv::CascadeClassifier> DJILiveviewModelRegistry::acquireCascadeClassifier(const std::string &path)
+{
+    std::shared_ptr<ModelEntry<cv::CascadeClassifier>> entry;
+    std::shared_ptr<cv::CascadeClassifier> classifier;
+
+    pthread_mutex_lock(&m_mutex);
+    auto &slot = m_cascadeEntries[path];
+    if (slot == nullptr) {
+        slot = std::make_shared<ModelEntry<cv::CascadeClassifier>>();
+    }
+    entry = slot;
+    pthread_mutex_unlock(&m_mutex);
+
+    classifier = takeFree(entry);
+    if (classifier != nullptr) {
+        return classifier;
+    }
+
+    auto *model = new cv::CascadeClassifier();
+    if (!model->load(path)) {
+        USER_LOG_ERROR("Load cascade classifier %s failed.", path.c_str());
+        delete model;
+        return nullptr;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_loadCount++;
+    pthread_mutex_unlock(&m_mutex);
+
+    return lease(entry, model);
+}
+
+std::shared_ptr<cv::dnn::Net> DJILiveviewModelRegistry::acquireTensorflowNet(const std::string &weightsPath,
+                                                                             const std::string &configPath)
+{
+    std::shared_ptr<ModelEntry<cv::dnn::Net>> entry;
+    std::shared_ptr<cv::dnn::Net> net;
+    cv::dnn::Net *model = nullptr;
+
+    pthread_mutex_lock(&m_mutex);
+    auto &slot = m_netEntries[weightsPath + "|" + configPath];
+    if (slot == nullptr) {
+        slot = std::make_shared<ModelEntry<cv::dnn::Net>>();
+    }
+    entry = slot;
+    pthread_mutex_unlock(&m_mutex);
+
+    net = takeFree(entry);
+    if (net != nullptr) {
+        return net;
+    }
+
+    /* The files are read once, further instances of the same net are parsed from memory. */
+    pthread_mutex_lock(&entry->mutex);
+    if (entry->weightsBuffer.empty()) {
+        if (!DjiLiveview_ReadModelFile(weightsPath, entry->weightsBuffer) ||
+            !DjiLiveview_ReadModelFile(configPath, entry->configBuffer)) {
+            entry->weightsBuffer.clear();
+            entry->configBuffer.clear();
+            pthread_mutex_unlock(&entry->mutex);
+            return nullptr;
+        }
+    }
+    pthread_mutex_unlock(&entry->mutex);
+
+    try {
+        model = new cv::dnn::Net(cv::dnn::readNetFromTensorflow(entry->weightsBuffer, entry->configBuffer));
+    } catch (const cv::Exception &e) {
+        USER_LOG_ERROR("Parse tensorflow net %s failed: %s", weightsPath.c_str(), e.what());
+        delete model;
+        return nullptr;
+    }
+
+    if (model->empty()) {
+        USER_LOG_ERROR("Tensorflow net %s is empty.", weightsPath.c_str());
+        delete model;
+        return nullptr;
+    }
+
+    model->setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+    model->setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+
+    pthread_mutex_lock(&m_mutex);
+    m_loadCount++;
+    pthread_mutex_unlock(&m_mutex);
+
+    return lease(entry, model);
+}
+
+uint32_t DJILiveviewModelRegistry::getLoadCount()
+{
+    uint32_t count;
+
+    pthread_mutex_lock(&m_mutex);
+    count = m_loadCount;
+    pthread_mutex_unlock(&m_mutex);
+
+    return count;
+}
+
+template<typename T>
+std::shared_ptr<T> DJILiveviewModelRegistry::lease(const std::shared_ptr<ModelEntry<T>> &entry, T *model)
+{
+    std::shared_ptr<ModelEntry<T>> owner = entry;
+
+    return std::shared_ptr<T>(model, [owner](T *p) {
+        owner->release(p);
+    });
+}
+
+template<typename T>
+std::shared_ptr<T> DJILiveviewModelRegistry::takeFree(const std::shared_ptr<ModelEntry<T>> &entry)
+{
+    T *model = nullptr;
+
+    pthread_mutex_lock(&entry->mutex);
+    if (!entry->freeList.empty()) {
+        model = entry->freeList.back();
+        entry->freeList.pop_back();
+    }
+    pthread_mutex_unlock(&entry->mutex);
+
+    if (model == nullptr) {
+        return nullptr;
+    }
+
+    return lease(entry, model);
+}
+
+/* Private functions definition-----------------------------------------------*/
+static bool DjiLiveview_ReadModelFile(const std::string &path, std::vector<uchar> &buffer)
+{
+    std::ifstream file(path, std::ios::binary);
+
+    if (!file.is_open()) {
+        USER_LOG_ERROR("Open model file %s failed.", path.c_str());
+        return false;
+    }
+
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (buffer.empty()) {
+        USER_LOG_ERROR("Model file %s is empty.", path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+#endif
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
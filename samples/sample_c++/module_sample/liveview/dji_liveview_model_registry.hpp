@@ -0,0 +1,100 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_model_registry.hpp
+ * @brief   This is the header file for "dji_liveview_model_registry.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIVEVIEW_MODEL_REGISTRY_H
+#define DJI_LIVEVIEW_MODEL_REGISTRY_H
+
+#ifdef OPEN_CV_INSTALLED
+
+/* Includes ------------------------------------------------------------------*/
+#include "pthread.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "opencv2/objdetect.hpp"
+#include "opencv2/dnn.hpp"
+
+/* Exported constants --------------------------------------------------------*/
+
+/* Exported types ------------------------------------------------------------*/
+/*! @note
+ * Process wide cache of the models used by the liveview demos. A model is read
+ * from disk the first time it is asked for, and every instance handed out goes
+ * back to the registry when the last reference is dropped, so the next caller
+ * gets a warm instance instead of loading it again. Neither cv::dnn::Net nor
+ * cv::CascadeClassifier may be shared between threads, so each thread running
+ * a model holds its own instance; the registry creates another one only when
+ * all loaded instances are in use, building tensorflow nets from the model
+ * files kept in memory.
+ */
+class DJILiveviewModelRegistry {
+public:
+    static DJILiveviewModelRegistry &getInstance();
+
+    /*! @return nullptr when the cascade file cannot be loaded. */
+    std::shared_ptr<cv::CascadeClassifier> acquireCascadeClassifier(const std::string &path);
+    /*! @return nullptr when the model files cannot be loaded. */
+    std::shared_ptr<cv::dnn::Net> acquireTensorflowNet(const std::string &weightsPath, const std::string &configPath);
+
+    uint32_t getLoadCount();
+
+private:
+    template<typename T>
+    struct ModelEntry {
+        pthread_mutex_t mutex;
+        std::vector<T *> freeList;
+        std::vector<uchar> weightsBuffer;
+        std::vector<uchar> configBuffer;
+
+        ModelEntry();
+        ~ModelEntry();
+        void release(T *model);
+    };
+
+    DJILiveviewModelRegistry();
+    ~DJILiveviewModelRegistry();
+    DJILiveviewModelRegistry(const DJILiveviewModelRegistry &) = delete;
+    DJILiveviewModelRegistry &operator=(const DJILiveviewModelRegistry &) = delete;
+
+    template<typename T>
+    static std::shared_ptr<T> lease(const std::shared_ptr<ModelEntry<T>> &entry, T *model);
+    template<typename T>
+    static std::shared_ptr<T> takeFree(const std::shared_ptr<ModelEntry<T>> &entry);
+
+    pthread_mutex_t m_mutex;
+    std::map<std::string, std::shared_ptr<ModelEntry<cv::CascadeClassifier>>> m_cascadeEntries;
+    std::map<std::string, std::shared_ptr<ModelEntry<cv::dnn::Net>>> m_netEntries;
+    uint32_t m_loadCount;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#endif
+
+#endif // DJI_LIVEVIEW_MODEL_REGISTRY_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
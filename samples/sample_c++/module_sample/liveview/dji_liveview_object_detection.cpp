@@ -39,19 +39,56 @@
 #include <ctime>
 #include <sstream>
 #include "dji_open_ar.h"
-#include <queue>
+#include "dji_liveview_meta_builder.hpp"
 
 #ifdef OPEN_CV_INSTALLED
 #include <opencv2/opencv.hpp>
 #include <opencv2/dnn.hpp>
 #include <opencv2/core.hpp>
 #include "image_processor_yolovfastest.hpp"
+#include "dji_liveview_frame_ring.hpp"
 #endif
 
+#include "dji_camera_stream_encoder.hpp"
+
 /* Private constants ---------------------------------------------------------*/
 #define YOLO_LABLES_NUM       76
 #define INVALID_CLASS_NUM     4
 
+// Frames buffered between the stream callback and the detection task
+#define DETECTION_FRAME_RING_SIZE           (3)
+// Detection works on the newest frame, older frames are dropped as soon as a new one arrives
+#define DETECTION_FRAME_RING_POLICY         DJI_LIVEVIEW_FRAME_RING_POLICY_LATEST_ONLY
+// Longest time the stream callback waits for a free slot with the block policy, unit: ms
+#define DETECTION_FRAME_RING_BLOCK_TIMEOUT  (30)
+// Longest time the detection task sleeps before checking whether it has to exit, unit: ms
+#define DETECTION_FRAME_WAIT_TIMEOUT        (100)
+#define DETECTION_STATISTICS_PRINT_INTERVAL (100)
+
+// Keep a copy of the re-encoded stream under data/, costs a file write per encoded frame
+#define DETECTION_SAVE_H264_FILE            0
+// Re-encode frames with the FFmpeg encoder session of this sample instead of DjiLiveview_EncodeAFrameToH264,
+// the metadata is then not carried in the stream and only reaches the pilot through DjiLiveview_SendAiMetaToPilot
+#define DETECTION_USE_FFMPEG_ENCODER        1
+#define DETECTION_ENCODER_FRAME_RATE        (30)
+// Bit rate used while the bandwidth limit of the video stream is unknown, unit: bit/s
+#define DETECTION_ENCODER_BIT_RATE_DEFAULT  (4 * 1000 * 1000)
+// Share of the realtime bandwidth limit of the video stream the encoder may use, unit: percent
+#define DETECTION_ENCODER_BANDWIDTH_PERCENT (80)
+
+// Boxes sent to the pilot per frame, the rest of the detections are dropped
+#define DETECTION_META_BOX_COUNT_MAX        (32)
+// Unchanged boxes are sent again after this time so the pilot keeps showing them, unit: ms
+#define DETECTION_META_REFRESH_INTERVAL_MS  (1000)
+// Box moves below 0.2% of the screen and distance changes below 10 cm do not count as changes
+#define DETECTION_META_POSITION_TOLERANCE   (20)
+#define DETECTION_META_DISTANCE_TOLERANCE   (100)
+
+#if DETECTION_USE_FFMPEG_ENCODER && !defined(FFMPEG_INSTALLED)
+#undef DETECTION_USE_FFMPEG_ENCODER
+#define DETECTION_USE_FFMPEG_ENCODER        0
+#endif
+
 static const char* s_classLables[] = {
     "person",        "bicycle",       "car",           "motorbike",
     "aeroplane",     "bus",           "train",         "truck",
@@ -87,15 +124,26 @@ static void outH264Tofile(const uint8_t *buf, int32_t len);
 static void outYUVTofile(const uint8_t *buf, int32_t len);
 static void DjiLiveview_RcvImageCallback(E_DjiLiveViewCameraPosition position, const uint8_t *buf, uint32_t len ,T_DjiLiveviewImageInfo imageInfo);
 static void DjiLiveview_EncoderUseCallback(const uint8_t *buf, uint32_t len);
+static void DjiLiveview_EncodeFrame(const uint8_t *buf, uint32_t len, T_DjiLiveviewImageInfo imageInfo,
+                                    T_DjiLiveViewStandardMetaData *metaData);
+static void DjiLiveview_PrintMetaStatistics(void);
+
+static DJILiveviewMetaBuilder *s_metaBuilder = nullptr;
+
+#if DETECTION_USE_FFMPEG_ENCODER
+static DJICameraStreamEncoder s_streamEncoder;
+static uint32_t s_encodedFrameCount = 0;
+static void DjiLiveview_StreamEncoderCallback(const uint8_t *buf, int bufLen, void *userData);
+static uint32_t DjiLiveview_GetEncoderBitRate(void);
+#endif
 
 #ifdef OPEN_CV_INSTALLED
 static ImageProcessorYolovFastest processor("YOLOvFastest");
-static std::queue<cv::Mat> s_imageQueue;
-static std::queue<T_DjiLiveViewStandardMetaData *> s_metaQueue;
+static DJILiveviewFrameRing *s_frameRing = nullptr;
 static void *DjiLiveview_ObjectDetectionThread(void *arg);
-T_DjiTaskHandle s_procThreadHandle;
-T_DjiMutexHandle s_metaQueueMutexHandle;
-T_DjiMutexHandle s_imageQueueMutexHandle;
+static void DjiLiveview_PrintDetectionStatistics(void);
+static void DjiLiveview_DetectionCallback(const std::vector<ImageProcessorYolovFastest::Detection> &detections);
+T_DjiTaskHandle s_procThreadHandle = nullptr;
 #endif
 
 void DjiUser_InitOpenAr(T_DjiOpenArPoint* point)
@@ -378,8 +426,12 @@ void DjiUser_RunCameraAiDetectionSample()
     char isQuit;
     E_DjiLiveViewCameraPosition CameraPostion;
     E_DjiLiveViewCameraSource MediaResource;
+    T_DjiReturnCode returnCode;
+    const T_DjiDataChannelBandwidthProportionOfHighspeedChannel bandwidthProportionOfHighspeedChannel =
+        {10, 60, 30};
 
     T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiLiveviewMetaBuilderConfig metaBuilderConfig = {};
 
     USER_LOG_INFO("Input cammera sourece(1:1080p, 3:M4 serials 4K, 7:H30 serials 4K): ");
     std::cin >> mediaSource;
@@ -389,6 +441,7 @@ void DjiUser_RunCameraAiDetectionSample()
         return;
     }
 
+#if DETECTION_SAVE_H264_FILE
     std::string timestamp = getCurrentTimestamp();
 
     // avoid miss dir error
@@ -398,28 +451,46 @@ void DjiUser_RunCameraAiDetectionSample()
     if (!outFileH264) {
         std::cerr << "cant open " << h264FileName << std::endl;
     }
+#endif
+
+    metaBuilderConfig.maxBoxCount = DETECTION_META_BOX_COUNT_MAX;
+    metaBuilderConfig.frameRate = DETECTION_ENCODER_FRAME_RATE;
+    metaBuilderConfig.refreshIntervalMs = DETECTION_META_REFRESH_INTERVAL_MS;
+    metaBuilderConfig.positionTolerance = DETECTION_META_POSITION_TOLERANCE;
+    metaBuilderConfig.distanceTolerance = DETECTION_META_DISTANCE_TOLERANCE;
+    try {
+        s_metaBuilder = new DJILiveviewMetaBuilder(metaBuilderConfig);
+    } catch (...) {
+        USER_LOG_ERROR("Create ai metadata builder failed.");
+        outFileH264.close();
+        return;
+    }
 
 #ifdef OPEN_CV_INSTALLED
-    osalHandler->MutexCreate(&s_metaQueueMutexHandle);
-    osalHandler->MutexCreate(&s_imageQueueMutexHandle);
-    osalHandler->TaskCreate("objectDetectionTask",DjiLiveview_ObjectDetectionThread,1024*1024,NULL, &s_procThreadHandle);
+    s_frameRing = new DJILiveviewFrameRing(DETECTION_FRAME_RING_SIZE, DETECTION_FRAME_RING_POLICY,
+                                           DETECTION_FRAME_RING_BLOCK_TIMEOUT);
     if (processor.Init() != 0) {
         std::cerr << "Failed to initialize the processor." << std::endl;
-        return ;
+        goto detection_init_failed;
+    }
+    processor.SetDetectionCallback(DjiLiveview_DetectionCallback);
+    returnCode = osalHandler->TaskCreate("objectDetectionTask", DjiLiveview_ObjectDetectionThread, 1024 * 1024, NULL,
+                                         &s_procThreadHandle);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Create object detection task failed, ret: 0x%08llX", returnCode);
+        s_procThreadHandle = nullptr;
+        goto detection_init_failed;
     }
 #endif
 
     CameraPostion = static_cast<E_DjiLiveViewCameraPosition>(pos);
     MediaResource = static_cast<E_DjiLiveViewCameraSource>(mediaSource);
-    T_DjiReturnCode returnCode;
-    const T_DjiDataChannelBandwidthProportionOfHighspeedChannel bandwidthProportionOfHighspeedChannel =
-        {10, 60, 30};
 
     returnCode = DjiHighSpeedDataChannel_SetBandwidthProportion(bandwidthProportionOfHighspeedChannel);
     if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS)
     {
         USER_LOG_ERROR("Liveview init failed, HighSpeed channel init error: 0x%08llX", returnCode);
-        return;
+        goto detection_init_failed;
     }
     USER_LOG_INFO("step 1: init liveview");
 
@@ -433,7 +504,7 @@ void DjiUser_RunCameraAiDetectionSample()
     returnCode = DjiAircraftInfo_GetBaseInfo(&aircraftInfoBaseInfo);
     if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("get aircraft base info error");
-        return;
+        goto init_failed;
     }
 
 #ifdef OPEN_CV_INSTALLED
@@ -498,20 +569,38 @@ init_failed:
     outFileH264.close();
     outFileYUV.close();
 
-#ifdef OPEN_CV_INSTALLED
-    osalHandler->TaskDestroy(s_procThreadHandle);
-    osalHandler->MutexDestroy(s_imageQueueMutexHandle);
-    osalHandler->MutexDestroy(s_metaQueueMutexHandle);
+#if DETECTION_USE_FFMPEG_ENCODER
+    T_DjiCameraStreamEncoderStatistics encoderStatistics;
+
+    s_streamEncoder.getStatistics(encoderStatistics);
+    USER_LOG_INFO("encoder frames %llu, key frames %llu, failed %llu, bit rate avg %.0f peak %.0f target %u bps, "
+                  "latency avg %.2f ms max %.2f ms", (unsigned long long) encoderStatistics.frameCount,
+                  (unsigned long long) encoderStatistics.keyFrameCount,
+                  (unsigned long long) encoderStatistics.failedFrameCount, encoderStatistics.averageBitRate,
+                  encoderStatistics.peakBitRate, encoderStatistics.targetBitRate, encoderStatistics.averageLatencyMs,
+                  encoderStatistics.maxLatencyMs);
+    s_streamEncoder.cleanup();
+    /* The next run opens a new session with the first frame it encodes. */
+    s_encodedFrameCount = 0;
+#endif
 
-    while(!s_imageQueue.empty()){
-        s_imageQueue.pop();
-    }
-    while(!s_metaQueue.empty()) {
-        s_metaQueue.pop();
+detection_init_failed:
+#ifdef OPEN_CV_INSTALLED
+    s_frameRing->stop();
+    if (s_procThreadHandle != nullptr) {
+        osalHandler->TaskDestroy(s_procThreadHandle);
+        s_procThreadHandle = nullptr;
     }
 
+    DjiLiveview_PrintDetectionStatistics();
+    delete s_frameRing;
+    s_frameRing = nullptr;
 #endif
 
+    DjiLiveview_PrintMetaStatistics();
+    delete s_metaBuilder;
+    s_metaBuilder = nullptr;
+
 }
 
 static std::string getCurrentTimestamp() {
@@ -551,66 +640,43 @@ static void DjiLiveview_RcvImageCallback(E_DjiLiveViewCameraPosition position, c
     USER_LOG_INFO("catch image frame data, image type = %d  height = %d, width = %d, frameId = %d, bufferLen= %d",
                   imageInfo.pixFmt ,imageInfo.height, imageInfo.width, imageInfo.frameId, len);
     T_DjiLiveViewStandardMetaData * metaData = nullptr;
-    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
 
 #ifdef OPEN_CV_INSTALLED
-    cv::Mat rgb_image( imageInfo.height, imageInfo.width, CV_8UC3, const_cast<uint8_t*>(buf));
-    cv::Mat rgb_image_copy = rgb_image.clone();
-
-    osalHandler->MutexLock(s_imageQueueMutexHandle);
-    while (s_imageQueue.size() > 30) {
-        USER_LOG_WARN("The image queue is full. Drop this strike.");
-        s_imageQueue.pop();
-    }
-    s_imageQueue.push(rgb_image_copy);
-    osalHandler->MutexUnlock(s_imageQueueMutexHandle);
-
-    osalHandler->MutexLock(s_metaQueueMutexHandle);
-    if (!s_metaQueue.empty()) {
-        metaData = s_metaQueue.front();
-        s_metaQueue.pop();
+    if (s_frameRing != nullptr && !s_frameRing->push(buf, imageInfo.height, imageInfo.width, CV_8UC3)) {
+        USER_LOG_WARN("The image queue is full. Drop this frame.");
     }
-    osalHandler->MutexUnlock(s_metaQueueMutexHandle);
-
-    DjiLiveview_EncodeAFrameToH264(buf, len, imageInfo, metaData);
-    if(metaData != nullptr) free(metaData);
-
 #else
+    T_DjiLiveViewBoundingBox boundingBox;
 
-    size_t size = sizeof(T_DjiLiveViewStandardMetaData) + 3 * sizeof(T_DjiLiveViewBoundingBox);
-    metaData = (T_DjiLiveViewStandardMetaData *)malloc(size);
-    if (!metaData) {
-        fprintf(stderr, "Failed to allocate memory\n");
-        return ;
-    }
-
-    // 初始化 boxCount
-    metaData->boxCount = 4;
-
-    // 初始化每个 T_DjiLiveViewBoundingBox
+    s_metaBuilder->beginFrame();
     for (int i = 0; i < 4; i++) {
-        metaData->boxData[i].id = i;
-        metaData->boxData[i].type = i;
-        metaData->boxData[i].state = 1;
-        metaData->boxData[i].box.cx =  (i+1)*1000;
-        metaData->boxData[i].box.cy =  (i+1)*1000;
-        metaData->boxData[i].box.w = 1000;
-        metaData->boxData[i].box.h = 1000;
-        metaData->boxData[i].box.distance = 0;
+        boundingBox.id = i;
+        boundingBox.type = i;
+        boundingBox.state = 1;
+        boundingBox.box.cx = (i + 1) * 1000;
+        boundingBox.box.cy = (i + 1) * 1000;
+        boundingBox.box.w = 1000;
+        boundingBox.box.h = 1000;
+        boundingBox.box.distance = 0;
+        s_metaBuilder->addBox(boundingBox);
     }
+    s_metaBuilder->publish();
+#endif
 
-    // 打印结果
-
-    DjiLiveview_SendAiMetaToPilot(metaData);
+    /* Metadata goes out at most once per video frame, and only when the boxes changed or are due for a refresh. */
+    metaData = s_metaBuilder->take();
+    if (metaData != nullptr) {
+        DjiLiveview_SendAiMetaToPilot(metaData);
+    }
 
-    DjiLiveview_EncodeAFrameToH264(buf, len,imageInfo, metaData);
-#endif
+    DjiLiveview_EncodeFrame(buf, len, imageInfo, metaData);
 }
 
 static void DjiLiveview_EncoderUseCallback(const uint8_t *buf, uint32_t len)
 {
     T_DjiReturnCode returnCode;
-    outH264Tofile(buf, len);
+
+    /* Send first, the copy on disk must not hold the frame back from the pilot. */
     if (aircraftInfoBaseInfo.aircraftSeries != DJI_AIRCRAFT_SERIES_M4D)
     {
         returnCode = DjiPayloadCamera_SendVideoStream(buf, len);
@@ -619,47 +685,153 @@ static void DjiLiveview_EncoderUseCallback(const uint8_t *buf, uint32_t len)
             USER_LOG_ERROR("failed to send video to pilot, ret: 0x%08llX", returnCode);
         }
     }
+#if DETECTION_SAVE_H264_FILE
+    outH264Tofile(buf, len);
+#endif
+}
+
+static void DjiLiveview_EncodeFrame(const uint8_t *buf, uint32_t len, T_DjiLiveviewImageInfo imageInfo,
+                                    T_DjiLiveViewStandardMetaData *metaData)
+{
+#if DETECTION_USE_FFMPEG_ENCODER
+    T_DjiCameraStreamEncoderConfig encoderConfig = {};
+    E_DjiCameraImageFormat format;
+
+    (void) len;
+    (void) metaData;
+
+    if (imageInfo.pixFmt == PIXFMT_NV12) {
+        format = DJI_CAMERA_IMAGE_FORMAT_NV12;
+    } else if (imageInfo.pixFmt == PIXFMT_RGB_PACKED) {
+        format = DJI_CAMERA_IMAGE_FORMAT_RGB24;
+    } else {
+        USER_LOG_ERROR("unsupported pixel format %d for the encoder", imageInfo.pixFmt);
+        return;
+    }
+
+    /* The session is opened once with the size of the first frame and kept for the whole stream. */
+    if (s_encodedFrameCount == 0) {
+        encoderConfig.width = imageInfo.width;
+        encoderConfig.height = imageInfo.height;
+        encoderConfig.frameRate = DETECTION_ENCODER_FRAME_RATE;
+        encoderConfig.bitRate = DjiLiveview_GetEncoderBitRate();
+        encoderConfig.useIntraRefresh = true;
+        if (!s_streamEncoder.init(encoderConfig)) {
+            USER_LOG_ERROR("init stream encoder failed");
+            return;
+        }
+        s_streamEncoder.registerCallback(DjiLiveview_StreamEncoderCallback, nullptr);
+    } else if (s_encodedFrameCount % DETECTION_ENCODER_FRAME_RATE == 0) {
+        s_streamEncoder.setBitRate(DjiLiveview_GetEncoderBitRate());
+    }
+    s_encodedFrameCount++;
+
+    s_streamEncoder.encodeFrame(buf, imageInfo.width, imageInfo.height, format);
+#else
+    DjiLiveview_EncodeAFrameToH264(buf, len, imageInfo, metaData);
+#endif
+}
+
+#if DETECTION_USE_FFMPEG_ENCODER
+static void DjiLiveview_StreamEncoderCallback(const uint8_t *buf, int bufLen, void *userData)
+{
+    (void) userData;
+
+    DjiLiveview_EncoderUseCallback(buf, bufLen);
+}
+
+static uint32_t DjiLiveview_GetEncoderBitRate(void)
+{
+    T_DjiDataChannelState videoStreamState;
+
+    if (DjiPayloadCamera_GetVideoStreamState(&videoStreamState) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+        videoStreamState.realtimeBandwidthLimit <= 0) {
+        return DETECTION_ENCODER_BIT_RATE_DEFAULT;
+    }
+
+    return (uint32_t) ((uint64_t) videoStreamState.realtimeBandwidthLimit * 8 *
+                       DETECTION_ENCODER_BANDWIDTH_PERCENT / 100);
+}
+#endif
+
+static void DjiLiveview_PrintMetaStatistics(void)
+{
+    T_DjiLiveviewMetaBuilderStatistics statistics;
+
+    s_metaBuilder->getStatistics(statistics);
+    USER_LOG_INFO("ai metadata published %llu, sent %llu, unchanged %llu, replaced %llu, truncated boxes %llu, "
+                  "allocations %llu (%.2f per minute)", (unsigned long long) statistics.publishedCount,
+                  (unsigned long long) statistics.takenCount, (unsigned long long) statistics.unchangedCount,
+                  (unsigned long long) statistics.replacedCount, (unsigned long long) statistics.truncatedBoxCount,
+                  (unsigned long long) statistics.allocationCount, statistics.allocationsPerMinute);
 }
 
 static void* DjiLiveview_ObjectDetectionThread(void *arg) {
     T_DjiReturnCode DjiStat;
-    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+#ifdef OPEN_CV_INSTALLED
+    /* Both frames live across iterations, the ring trades rgb_image for a filled slot and cvtColor reuses bgr_image. */
+    cv::Mat rgb_image;
+    std::shared_ptr<cv::Mat> image_ptr = std::make_shared<cv::Mat>();
+    std::vector<T_DjiLiveViewBoundingBox> bounding_boxes;
+    uint32_t processedCount = 0;
+#endif
 
     while(1) {
         #ifdef OPEN_CV_INSTALLED
-        osalHandler->MutexLock(s_imageQueueMutexHandle);
-        if (s_imageQueue.empty()) {
-            osalHandler->MutexUnlock(s_imageQueueMutexHandle);
+        if (!s_frameRing->pop(rgb_image, DETECTION_FRAME_WAIT_TIMEOUT)) {
+            if (s_frameRing->isStopped()) {
+                break;
+            }
             continue;
         }
-        cv::Mat rgb_image = s_imageQueue.front();
-        s_imageQueue.pop();
-        osalHandler->MutexUnlock(s_imageQueueMutexHandle);
-        cv::Mat bgr_image;
-        cv::cvtColor(rgb_image, bgr_image, cv::COLOR_RGB2BGR);
-
-        std::shared_ptr<cv::Mat> image_ptr = std::make_shared<cv::Mat>(bgr_image);
-
+        cv::cvtColor(rgb_image, *image_ptr, cv::COLOR_RGB2BGR);
 
-        std::vector<T_DjiLiveViewBoundingBox> bounding_boxes;
+        bounding_boxes.clear();
         processor.Process(image_ptr, bounding_boxes);
 
-        T_DjiLiveViewStandardMetaData *metaData = (T_DjiLiveViewStandardMetaData *)malloc(
-            sizeof(T_DjiLiveViewStandardMetaData) + bounding_boxes.size() * sizeof(T_DjiLiveViewBoundingBox));
-        metaData->boxCount = bounding_boxes.size();
-        for (int i = 0; i < bounding_boxes.size(); i++) {
-            metaData->boxData[i] = bounding_boxes[i];
+        s_metaBuilder->beginFrame();
+        for (size_t i = 0; i < bounding_boxes.size(); i++) {
+            s_metaBuilder->addBox(bounding_boxes[i]);
         }
+        s_metaBuilder->publish();
 
-        DjiLiveview_SendAiMetaToPilot(metaData);
-
-        osalHandler->MutexLock(s_metaQueueMutexHandle);
-        s_metaQueue.push(metaData);
-        osalHandler->MutexUnlock(s_metaQueueMutexHandle);
-
+        if (++processedCount % DETECTION_STATISTICS_PRINT_INTERVAL == 0) {
+            DjiLiveview_PrintDetectionStatistics();
+            DjiLiveview_PrintMetaStatistics();
+        }
         #else
             break;
         #endif
     }
     return NULL;
 }
+
+#ifdef OPEN_CV_INSTALLED
+static void DjiLiveview_PrintDetectionStatistics(void)
+{
+    T_DjiLiveviewFrameRingStatistics statistics;
+
+    const char *stageNames[ImageProcessorYolovFastest::kStageCount] = {"preprocess", "forward", "postprocess"};
+    ImageProcessorYolovFastest::StageTiming timing[ImageProcessorYolovFastest::kStageCount];
+
+    s_frameRing->getStatistics(statistics);
+    USER_LOG_INFO("detection frames pushed %llu, processed %llu, dropped %llu, dwell avg %.2f ms max %.2f ms",
+                  (unsigned long long) statistics.pushedCount, (unsigned long long) statistics.poppedCount,
+                  (unsigned long long) statistics.droppedCount, statistics.averageDwellMs, statistics.maxDwellMs);
+
+    processor.GetStageTiming(timing);
+    for (int i = 0; i < ImageProcessorYolovFastest::kStageCount; i++) {
+        USER_LOG_INFO("detection %s: last %.2f ms, avg %.2f ms, max %.2f ms", stageNames[i], timing[i].last_ms,
+                      timing[i].average_ms, timing[i].max_ms);
+    }
+}
+
+static void DjiLiveview_DetectionCallback(const std::vector<ImageProcessorYolovFastest::Detection> &detections)
+{
+    for (size_t i = 0; i < detections.size(); i++) {
+        USER_LOG_DEBUG("Bounding Box %d: Class ID = %d, Confidence = %.2f, Box = [%d, %d, %d, %d]", (int) i,
+                       detections[i].class_id, detections[i].confidence, detections[i].box.x, detections[i].box.y,
+                       detections[i].box.width, detections[i].box.height);
+    }
+}
+#endif
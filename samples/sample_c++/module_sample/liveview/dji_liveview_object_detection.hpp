@@ -30,6 +30,13 @@ extern "C" {
 #endif
 
 /* Exported constants --------------------------------------------------------*/
+/*! @note
+ * With DETECTION_USE_FFMPEG_ENCODER set to 1, the default when FFmpeg is
+ * installed, the annotated frames are re-encoded by DJICameraStreamEncoder
+ * and the detection metadata is not written into the video stream, it only
+ * reaches the pilot through DjiLiveview_SendAiMetaToPilot. Set it to 0 to have
+ * DjiLiveview_EncodeAFrameToH264 carry the metadata along with the frames.
+ */
 void DjiUser_RunCameraAiDetectionSample(void);
 void DjiUser_RunOpenArSample(void);
 
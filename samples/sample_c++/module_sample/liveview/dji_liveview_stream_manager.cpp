@@ -0,0 +1,520 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_stream_manager.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_liveview_stream_manager.hpp"
+#include "dji_logger.h"
+#include "dji_liveview_trace.hpp"
+
+/* Private constants ---------------------------------------------------------*/
+// Streams are restored once the decode load falls below this share of the budget
+#define DJI_LIVEVIEW_STREAM_MANAGER_RESTORE_RATIO          (0.7)
+// Longest wait for a key frame after a start or a dropped queue, decoding then resumes without one, unit: ms
+#define DJI_LIVEVIEW_STREAM_MANAGER_RESYNC_TIMEOUT_MS      (2000)
+// Queue wait that counts as one priority level when the workers pick the next stream, unit: ms
+#define DJI_LIVEVIEW_STREAM_MANAGER_AGING_INTERVAL_MS      (100)
+#define DJI_LIVEVIEW_STREAM_MANAGER_NAL_TYPE_IDR           (5)
+#define DJI_LIVEVIEW_STREAM_MANAGER_NAL_TYPE_SEI           (6)
+#define DJI_LIVEVIEW_STREAM_MANAGER_NAL_TYPE_SPS           (7)
+#define DJI_LIVEVIEW_STREAM_MANAGER_SEI_RECOVERY_POINT     (6)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+DJILiveviewStreamManager *DJILiveviewStreamManager::s_instance = nullptr;
+
+static const E_DjiLiveViewCameraPosition s_cameraPositions[] = {
+    DJI_LIVEVIEW_CAMERA_POSITION_FPV,
+    DJI_LIVEVIEW_CAMERA_POSITION_NO_1,
+    DJI_LIVEVIEW_CAMERA_POSITION_NO_2,
+    DJI_LIVEVIEW_CAMERA_POSITION_NO_3,
+};
+
+/* Private functions declaration ---------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+DJILiveviewStreamManager::DJILiveviewStreamManager(uint32_t workerCount, uint32_t queueDepth)
+    : m_isStopping(false),
+      m_decodeBudget(0),
+      m_budgetIntervalStartUs(getTimeUs())
+{
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_cond_init(&m_workCond, nullptr);
+    pthread_cond_init(&m_idleCond, nullptr);
+
+    for (auto position : s_cameraPositions) {
+        std::unique_ptr<Stream> stream(new Stream());
+
+        stream->position = position;
+        stream->config = {0, 0, 0};
+        stream->callback = nullptr;
+        stream->userData = nullptr;
+        stream->isRunning = false;
+        stream->isBusy = false;
+        stream->isResyncing = false;
+        stream->resyncStartUs = 0;
+        stream->chunks.resize(queueDepth > 0 ? queueDepth : 1);
+        stream->chunkArrivalTimesUs.resize(stream->chunks.size());
+        stream->chunkHead = 0;
+        stream->chunkCount = 0;
+        stream->decodeTimeUs = 0;
+        stream->statistics = {};
+        /* The workers take every decoded frame right away, frames can leave the decoder as soon as they are done. */
+        stream->decoder.setDecodeMode(DJI_CAMERA_STREAM_DECODER_MODE_LOW_DELAY);
+        m_streams[position] = std::move(stream);
+    }
+
+    s_instance = this;
+
+    for (uint32_t i = 0; i < (workerCount > 0 ? workerCount : 1); i++) {
+        pthread_t worker;
+        if (pthread_create(&worker, nullptr, workerThreadEntry, this) != 0) {
+            USER_LOG_ERROR("Create liveview decode worker %u failed.", i);
+            continue;
+        }
+        m_workers.push_back(worker);
+    }
+}
+
+DJILiveviewStreamManager::~DJILiveviewStreamManager()
+{
+    for (auto position : s_cameraPositions) {
+        stopStream(position);
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_isStopping = true;
+    pthread_cond_broadcast(&m_workCond);
+    pthread_mutex_unlock(&m_mutex);
+    for (auto worker : m_workers) {
+        pthread_join(worker, nullptr);
+    }
+
+    s_instance = nullptr;
+    m_streams.clear();
+    pthread_cond_destroy(&m_idleCond);
+    pthread_cond_destroy(&m_workCond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+T_DjiReturnCode DJILiveviewStreamManager::startStream(E_DjiLiveViewCameraPosition position,
+                                                      const T_DjiLiveviewStreamConfig &config,
+                                                      CameraImageCallback callback, void *userData)
+{
+    T_DjiReturnCode returnCode;
+    Stream *stream = findStream(position);
+
+    if (stream == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    stream->decoder.init();
+    stream->decoder.setRGBMaxResolution(config.maxWidth, config.maxHeight);
+    applyDegradeLevel(*stream, DJI_LIVEVIEW_STREAM_DEGRADE_NONE);
+
+    pthread_mutex_lock(&m_mutex);
+    stream->config = config;
+    stream->callback = callback;
+    stream->userData = userData;
+    stream->chunkHead = 0;
+    stream->chunkCount = 0;
+    stream->isResyncing = true;
+    stream->resyncStartUs = getTimeUs();
+    stream->decodeTimeUs = 0;
+    stream->statistics = {};
+    stream->isRunning = true;
+    pthread_mutex_unlock(&m_mutex);
+
+    returnCode = DjiLiveview_StartH264Stream(position, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT, h264Callback);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        pthread_mutex_lock(&m_mutex);
+        stream->isRunning = false;
+        pthread_mutex_unlock(&m_mutex);
+        stream->decoder.cleanup();
+    }
+
+    return returnCode;
+}
+
+T_DjiReturnCode DJILiveviewStreamManager::stopStream(E_DjiLiveViewCameraPosition position)
+{
+    T_DjiReturnCode returnCode;
+    Stream *stream = findStream(position);
+
+    if (stream == nullptr) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    if (!stream->isRunning) {
+        pthread_mutex_unlock(&m_mutex);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    returnCode = DjiLiveview_StopH264Stream(position, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    /* Queued data is dropped, but a chunk already taken by a worker is decoded and delivered first. */
+    pthread_mutex_lock(&m_mutex);
+    stream->isRunning = false;
+    stream->chunkCount = 0;
+    while (stream->isBusy) {
+        pthread_cond_wait(&m_idleCond, &m_mutex);
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    printStreamStatistics(*stream);
+    stream->decoder.cleanup();
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+void DJILiveviewStreamManager::setDecodeBudget(double cores)
+{
+    pthread_mutex_lock(&m_mutex);
+    m_decodeBudget = cores;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+void DJILiveviewStreamManager::setOutputFormat(E_DjiCameraStreamDecoderOutputFormat format)
+{
+    for (auto &pair : m_streams) {
+        pair.second->decoder.setOutputFormat(format);
+    }
+}
+
+bool DJILiveviewStreamManager::getStreamStatistics(E_DjiLiveViewCameraPosition position,
+                                                   T_DjiLiveviewStreamStatistics &statistics)
+{
+    Stream *stream = findStream(position);
+
+    if (stream == nullptr) {
+        return false;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    statistics = stream->statistics;
+    pthread_mutex_unlock(&m_mutex);
+
+    return true;
+}
+
+/* Private functions definition-----------------------------------------------*/
+void DJILiveviewStreamManager::h264Callback(E_DjiLiveViewCameraPosition position, const uint8_t *buf, uint32_t len)
+{
+    DJILiveviewStreamManager *manager = s_instance;
+
+    if (manager != nullptr) {
+        manager->pushChunk(position, buf, len);
+    }
+}
+
+void *DJILiveviewStreamManager::workerThreadEntry(void *p)
+{
+    static_cast<DJILiveviewStreamManager *>(p)->workerThreadFunc();
+
+    return nullptr;
+}
+
+void DJILiveviewStreamManager::workerThreadFunc()
+{
+    std::vector<uint8_t> chunk;
+    CameraRGBImage image;
+    Stream *stream;
+    uint64_t startTimeUs;
+    uint64_t decodeTimeUs;
+    uint32_t deliveredCount;
+    int64_t arrivalTimeUs;
+    int64_t callbackStartUs;
+    int64_t callbackEndUs;
+
+    while (true) {
+        pthread_mutex_lock(&m_mutex);
+        while (!m_isStopping && (stream = takeReadyStream()) == nullptr) {
+            pthread_cond_wait(&m_workCond, &m_mutex);
+        }
+        if (m_isStopping) {
+            pthread_mutex_unlock(&m_mutex);
+            break;
+        }
+        /* The worker trades its spare buffer for the queued one, both keep their capacity. */
+        stream->isBusy = true;
+        chunk.swap(stream->chunks[stream->chunkHead]);
+        arrivalTimeUs = stream->chunkArrivalTimesUs[stream->chunkHead];
+        stream->chunkHead = (stream->chunkHead + 1) % stream->chunks.size();
+        stream->chunkCount--;
+        pthread_mutex_unlock(&m_mutex);
+
+        startTimeUs = getTimeUs();
+        DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_QUEUE, arrivalTimeUs, arrivalTimeUs, startTimeUs);
+        stream->decoder.decodeBuffer(chunk.data(), chunk.size(), arrivalTimeUs);
+        decodeTimeUs = getTimeUs() - startTimeUs;
+
+        deliveredCount = 0;
+        while (stream->decoder.decodedImageHandler.getNewImageWithLock(image, 0)) {
+            if (stream->callback) {
+                callbackStartUs = DjiLiveviewTrace_GetTimeUs();
+                (*stream->callback)(image, stream->userData);
+                if (image.traceId != 0) {
+                    callbackEndUs = DjiLiveviewTrace_GetTimeUs();
+                    DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_CALLBACK, image.traceId, callbackStartUs,
+                                            callbackEndUs);
+                    DjiLiveviewTrace_Record(DJI_LIVEVIEW_TRACE_STAGE_TOTAL, image.traceId, image.traceId,
+                                            callbackEndUs);
+                }
+            }
+            deliveredCount++;
+        }
+        image.release();
+
+        pthread_mutex_lock(&m_mutex);
+        stream->isBusy = false;
+        stream->decodeTimeUs += decodeTimeUs;
+        stream->statistics.decodedChunkCount++;
+        stream->statistics.deliveredFrameCount += deliveredCount;
+        checkDecodeBudget();
+        if (stream->chunkCount > 0) {
+            pthread_cond_signal(&m_workCond);
+        }
+        pthread_cond_broadcast(&m_idleCond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+void DJILiveviewStreamManager::pushChunk(E_DjiLiveViewCameraPosition position, const uint8_t *buf, uint32_t len)
+{
+    Stream *stream = findStream(position);
+    int64_t arrivalTimeUs = getTimeUs();
+    uint32_t slot;
+
+    if (stream == nullptr) {
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    if (!stream->isRunning) {
+        pthread_mutex_unlock(&m_mutex);
+        return;
+    }
+    stream->statistics.receivedChunkCount++;
+
+    if (stream->chunkCount == stream->chunks.size()) {
+        /* The decoder cannot use the rest of a group of pictures it missed a part of, so the whole queue goes
+         * and decoding restarts at the next key frame.
+         */
+        stream->statistics.droppedChunkCount += stream->chunkCount;
+        stream->chunkCount = 0;
+        stream->isResyncing = true;
+        stream->resyncStartUs = arrivalTimeUs;
+    }
+    if (stream->isResyncing) {
+        bool isKeyFrame = containsKeyFrame(buf, len);
+
+        if (!isKeyFrame &&
+            arrivalTimeUs - stream->resyncStartUs < DJI_LIVEVIEW_STREAM_MANAGER_RESYNC_TIMEOUT_MS * 1000) {
+            stream->statistics.droppedChunkCount++;
+            pthread_mutex_unlock(&m_mutex);
+            return;
+        }
+        /* A stream with key frames far apart, or none at all, still gets decoded, the decoder conceals the
+         * missing references until the picture has refreshed.
+         */
+        if (!isKeyFrame) {
+            USER_LOG_WARN("Camera %d sent no key frame in %d ms, decoding resumes without one.", position,
+                          DJI_LIVEVIEW_STREAM_MANAGER_RESYNC_TIMEOUT_MS);
+        }
+        stream->isResyncing = false;
+    }
+
+    slot = (stream->chunkHead + stream->chunkCount) % stream->chunks.size();
+    stream->chunks[slot].assign(buf, buf + len);
+    stream->chunkArrivalTimesUs[slot] = arrivalTimeUs;
+    stream->chunkCount++;
+    pthread_cond_signal(&m_workCond);
+    pthread_mutex_unlock(&m_mutex);
+}
+
+DJILiveviewStreamManager::Stream *DJILiveviewStreamManager::findStream(E_DjiLiveViewCameraPosition position)
+{
+    auto stream = m_streams.find(position);
+
+    return stream != m_streams.end() ? stream->second.get() : nullptr;
+}
+
+DJILiveviewStreamManager::Stream *DJILiveviewStreamManager::takeReadyStream()
+{
+    int64_t nowUs = getTimeUs();
+    Stream *readyStream = nullptr;
+    int64_t readyRank = 0;
+    int64_t rank;
+
+    for (auto &pair : m_streams) {
+        Stream *stream = pair.second.get();
+        if (!stream->isRunning || stream->isBusy || stream->chunkCount == 0) {
+            continue;
+        }
+        /* The oldest chunk raises its stream one priority level per aging interval it has waited, so the higher
+         * priority streams go first but cannot keep a lower one from being decoded at all.
+         */
+        rank = (int64_t) stream->config.priority * DJI_LIVEVIEW_STREAM_MANAGER_AGING_INTERVAL_MS * 1000 +
+               (nowUs - stream->chunkArrivalTimesUs[stream->chunkHead]);
+        if (readyStream == nullptr || rank > readyRank) {
+            readyStream = stream;
+            readyRank = rank;
+        }
+    }
+
+    return readyStream;
+}
+
+void DJILiveviewStreamManager::checkDecodeBudget()
+{
+    uint64_t nowUs = getTimeUs();
+    uint64_t intervalUs = nowUs - m_budgetIntervalStartUs;
+    double totalLoad = 0;
+    Stream *degradeStream = nullptr;
+    Stream *restoreStream = nullptr;
+
+    if (intervalUs < DJI_LIVEVIEW_STREAM_MANAGER_BUDGET_INTERVAL_MS * 1000) {
+        return;
+    }
+    m_budgetIntervalStartUs = nowUs;
+
+    for (auto &pair : m_streams) {
+        Stream *stream = pair.second.get();
+
+        stream->statistics.decodeLoad = (double) stream->decodeTimeUs / intervalUs;
+        stream->decodeTimeUs = 0;
+        if (!stream->isRunning) {
+            continue;
+        }
+        totalLoad += stream->statistics.decodeLoad;
+
+        if (stream->statistics.degradeLevel < DJI_LIVEVIEW_STREAM_DEGRADE_LEVEL_NUM - 1 &&
+            (degradeStream == nullptr || stream->config.priority < degradeStream->config.priority)) {
+            degradeStream = stream;
+        }
+        if (stream->statistics.degradeLevel > DJI_LIVEVIEW_STREAM_DEGRADE_NONE &&
+            (restoreStream == nullptr || stream->config.priority > restoreStream->config.priority)) {
+            restoreStream = stream;
+        }
+    }
+
+    if (m_decodeBudget <= 0) {
+        degradeStream = nullptr;
+        if (restoreStream != nullptr) {
+            applyDegradeLevel(*restoreStream, DJI_LIVEVIEW_STREAM_DEGRADE_NONE);
+        }
+    } else if (totalLoad > m_decodeBudget && degradeStream != nullptr) {
+        applyDegradeLevel(*degradeStream,
+                          (E_DjiLiveviewStreamDegradeLevel) (degradeStream->statistics.degradeLevel + 1));
+        USER_LOG_WARN("Liveview decode load %.2f over budget %.2f, camera %d degraded to level %d.", totalLoad,
+                      m_decodeBudget, degradeStream->position, degradeStream->statistics.degradeLevel);
+    } else if (totalLoad < m_decodeBudget * DJI_LIVEVIEW_STREAM_MANAGER_RESTORE_RATIO && restoreStream != nullptr) {
+        applyDegradeLevel(*restoreStream,
+                          (E_DjiLiveviewStreamDegradeLevel) (restoreStream->statistics.degradeLevel - 1));
+        USER_LOG_INFO("Liveview decode load %.2f within budget %.2f, camera %d restored to level %d.", totalLoad,
+                      m_decodeBudget, restoreStream->position, restoreStream->statistics.degradeLevel);
+    }
+}
+
+void DJILiveviewStreamManager::applyDegradeLevel(Stream &stream, E_DjiLiveviewStreamDegradeLevel level)
+{
+    stream.statistics.degradeLevel = level;
+
+    switch (level) {
+        case DJI_LIVEVIEW_STREAM_DEGRADE_REDUCED:
+            stream.decoder.setFrameDiscard(DJI_CAMERA_STREAM_DECODER_DISCARD_NON_REFERENCE);
+            stream.decoder.setRGBDownscaleFactor(2);
+            break;
+        case DJI_LIVEVIEW_STREAM_DEGRADE_KEY_FRAMES_ONLY:
+            stream.decoder.setFrameDiscard(DJI_CAMERA_STREAM_DECODER_DISCARD_NON_KEY);
+            stream.decoder.setRGBDownscaleFactor(2);
+            break;
+        default:
+            stream.decoder.setFrameDiscard(DJI_CAMERA_STREAM_DECODER_DISCARD_NONE);
+            stream.decoder.setRGBDownscaleFactor(1);
+            break;
+    }
+}
+
+void DJILiveviewStreamManager::printStreamStatistics(Stream &stream)
+{
+    T_DjiLiveviewStreamStatistics statistics;
+    T_DjiCameraStreamDecoderLatency latency;
+    char histogram[256];
+    int offset = 0;
+
+    getStreamStatistics(stream.position, statistics);
+    stream.decoder.getDecodeLatency(latency);
+    for (int i = 0; i < DJI_CAMERA_STREAM_DECODER_LATENCY_BUCKET_NUM && offset < (int) sizeof(histogram); i++) {
+        bool isLastBucket = i == DJI_CAMERA_STREAM_DECODER_LATENCY_BUCKET_NUM - 1;
+        offset += snprintf(histogram + offset, sizeof(histogram) - offset, " %s%dms:%llu", isLastBucket ? ">=" : "<",
+                           isLastBucket ? 1 << (i - 1) : 1 << i, (unsigned long long) latency.bucketCount[i]);
+    }
+
+    USER_LOG_INFO("Camera %d stream: %llu chunks received, %llu dropped, %llu frames delivered, degrade level %d.",
+                  stream.position, (unsigned long long) statistics.receivedChunkCount,
+                  (unsigned long long) statistics.droppedChunkCount,
+                  (unsigned long long) statistics.deliveredFrameCount, statistics.degradeLevel);
+    USER_LOG_INFO("Camera %d decode latency: %llu frames, %llu skipped, avg %.2f ms, max %.2f ms,%s",
+                  stream.position, (unsigned long long) latency.frameCount,
+                  (unsigned long long) latency.skippedFrameCount, latency.averageMs, latency.maxMs, histogram);
+    if (DjiLiveviewTrace_IsEnabled()) {
+        DjiLiveviewTrace_PrintSummary();
+    }
+}
+
+bool DJILiveviewStreamManager::containsKeyFrame(const uint8_t *buf, uint32_t len)
+{
+    for (uint32_t i = 0; i + 3 < len; i++) {
+        if (buf[i] == 0 && buf[i + 1] == 0 && buf[i + 2] == 1) {
+            uint8_t nalType = buf[i + 3] & 0x1F;
+            if (nalType == DJI_LIVEVIEW_STREAM_MANAGER_NAL_TYPE_IDR ||
+                nalType == DJI_LIVEVIEW_STREAM_MANAGER_NAL_TYPE_SPS) {
+                return true;
+            }
+            /* Streams coded with intra refresh mark where decoding can start with a recovery point SEI instead. */
+            if (nalType == DJI_LIVEVIEW_STREAM_MANAGER_NAL_TYPE_SEI && i + 4 < len &&
+                buf[i + 4] == DJI_LIVEVIEW_STREAM_MANAGER_SEI_RECOVERY_POINT) {
+                return true;
+            }
+            i += 2;
+        }
+    }
+
+    return false;
+}
+
+uint64_t DJILiveviewStreamManager::getTimeUs()
+{
+    /* Same clock as the trace, so queue times and decode latencies line up with the trace events. */
+    return (uint64_t) DjiLiveviewTrace_GetTimeUs();
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
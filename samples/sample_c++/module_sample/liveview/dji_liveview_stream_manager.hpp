@@ -0,0 +1,153 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_stream_manager.hpp
+ * @brief   This is the header file for "dji_liveview_stream_manager.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIVEVIEW_STREAM_MANAGER_H
+#define DJI_LIVEVIEW_STREAM_MANAGER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "pthread.h"
+#include <map>
+#include <memory>
+#include <vector>
+#include "dji_liveview.h"
+#include "dji_camera_stream_decoder.hpp"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_LIVEVIEW_STREAM_MANAGER_WORKER_NUM_DEFAULT     (2)
+// Stream data received from the aircraft and not decoded yet, unit: callback chunks
+#define DJI_LIVEVIEW_STREAM_MANAGER_QUEUE_DEPTH_DEFAULT    (16)
+// Interval at which the decode time of the streams is compared with the budget, unit: ms
+#define DJI_LIVEVIEW_STREAM_MANAGER_BUDGET_INTERVAL_MS     (1000)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_LIVEVIEW_STREAM_DEGRADE_NONE = 0,
+    DJI_LIVEVIEW_STREAM_DEGRADE_REDUCED,          /*!< Non-reference frames discarded, RGB output at half size. */
+    DJI_LIVEVIEW_STREAM_DEGRADE_KEY_FRAMES_ONLY,  /*!< Only key frames decoded, RGB output at half size. */
+    DJI_LIVEVIEW_STREAM_DEGRADE_LEVEL_NUM,
+} E_DjiLiveviewStreamDegradeLevel;
+
+typedef struct {
+    uint8_t priority;       /*!< Streams with a higher priority are decoded first and degraded last. */
+    uint32_t maxWidth;      /*!< Cap of the RGB output width, 0 for no cap. */
+    uint32_t maxHeight;     /*!< Cap of the RGB output height, 0 for no cap. */
+} T_DjiLiveviewStreamConfig;
+
+typedef struct {
+    uint64_t receivedChunkCount;
+    uint64_t droppedChunkCount;     /*!< Chunks dropped on queue overflow or while waiting for a key frame. */
+    uint64_t decodedChunkCount;
+    uint64_t deliveredFrameCount;
+    double decodeLoad;              /*!< Decode time per wall time over the last budget interval, 1.0 is one core. */
+    E_DjiLiveviewStreamDegradeLevel degradeLevel;
+} T_DjiLiveviewStreamStatistics;
+
+/*! @note
+ * Owns one decoder per camera position and runs all of them on a shared pool
+ * of decode workers. The stream callback only queues the H264 data, a worker
+ * decodes it and hands the frames to the user callback, so no decoder keeps a
+ * thread of its own. A worker takes the highest priority stream with queued
+ * data, where every 100 ms its oldest chunk has waited counts as one more
+ * priority level, and only one worker decodes a given stream at a time.
+ * After a start or a dropped queue, decoding resumes at the next key frame or
+ * recovery point, or after 2 s without one.
+ * When the streams together spend more decode time than the budget allows,
+ * the lowest priority stream is degraded one level per interval, and streams
+ * are restored highest priority first once there is room again.
+ * The liveview H264 callback carries no user data, so only one manager can
+ * exist at a time.
+ */
+class DJILiveviewStreamManager {
+public:
+    explicit DJILiveviewStreamManager(uint32_t workerCount = DJI_LIVEVIEW_STREAM_MANAGER_WORKER_NUM_DEFAULT,
+                                      uint32_t queueDepth = DJI_LIVEVIEW_STREAM_MANAGER_QUEUE_DEPTH_DEFAULT);
+    ~DJILiveviewStreamManager();
+
+    T_DjiReturnCode startStream(E_DjiLiveViewCameraPosition position, const T_DjiLiveviewStreamConfig &config,
+                                CameraImageCallback callback, void *userData);
+    T_DjiReturnCode stopStream(E_DjiLiveViewCameraPosition position);
+
+    /*! @brief Decode time the streams may use together, in cores, 0 to never degrade a stream. */
+    void setDecodeBudget(double cores);
+    void setOutputFormat(E_DjiCameraStreamDecoderOutputFormat format);
+    bool getStreamStatistics(E_DjiLiveViewCameraPosition position, T_DjiLiveviewStreamStatistics &statistics);
+
+private:
+    struct Stream {
+        E_DjiLiveViewCameraPosition position;
+        DJICameraStreamDecoder decoder;
+        T_DjiLiveviewStreamConfig config;
+        CameraImageCallback callback;
+        void *userData;
+        bool isRunning;
+        bool isBusy;
+        bool isResyncing;
+        int64_t resyncStartUs;
+        std::vector<std::vector<uint8_t>> chunks;
+        std::vector<int64_t> chunkArrivalTimesUs;
+        uint32_t chunkHead;
+        uint32_t chunkCount;
+        uint64_t decodeTimeUs;
+        T_DjiLiveviewStreamStatistics statistics;
+    };
+
+    static void h264Callback(E_DjiLiveViewCameraPosition position, const uint8_t *buf, uint32_t len);
+    static void *workerThreadEntry(void *p);
+    static bool containsKeyFrame(const uint8_t *buf, uint32_t len);
+    static uint64_t getTimeUs();
+
+    void workerThreadFunc();
+    void pushChunk(E_DjiLiveViewCameraPosition position, const uint8_t *buf, uint32_t len);
+    Stream *findStream(E_DjiLiveViewCameraPosition position);
+    Stream *takeReadyStream();
+    void checkDecodeBudget();
+    void applyDegradeLevel(Stream &stream, E_DjiLiveviewStreamDegradeLevel level);
+    void printStreamStatistics(Stream &stream);
+
+    static DJILiveviewStreamManager *s_instance;
+
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_workCond;
+    pthread_cond_t m_idleCond;
+    std::vector<pthread_t> m_workers;
+    bool m_isStopping;
+    std::map<E_DjiLiveViewCameraPosition, std::unique_ptr<Stream>> m_streams;
+    double m_decodeBudget;
+    uint64_t m_budgetIntervalStartUs;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DJI_LIVEVIEW_STREAM_MANAGER_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,265 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_trace.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_liveview_trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <new>
+#include <vector>
+#include "dji_logger.h"
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    int64_t traceId;
+    int64_t beginUs;
+    uint32_t durationUs;
+    uint32_t stage;
+} T_DjiLiveviewTraceEvent;
+
+/*! @note
+ * Only the owning thread writes a buffer. It fills the slot first and then
+ * publishes it by advancing writeCount, so a reader sees complete events up
+ * to writeCount, and can tell from writeCount whether a slot it has just
+ * read was overwritten meanwhile. Buffers are never freed, a thread that
+ * exits hands its buffer on to the next thread that starts recording.
+ */
+typedef struct T_DjiLiveviewTraceBuffer {
+    T_DjiLiveviewTraceEvent events[DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD];
+    std::atomic<uint64_t> writeCount;
+    std::atomic<bool> isOwned;
+    uint32_t threadIndex;
+    struct T_DjiLiveviewTraceBuffer *next;
+} T_DjiLiveviewTraceBuffer;
+
+class DjiLiveviewTraceBufferOwner {
+public:
+    T_DjiLiveviewTraceBuffer *buffer = nullptr;
+
+    ~DjiLiveviewTraceBufferOwner()
+    {
+        if (buffer != nullptr) {
+            buffer->isOwned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+/* Private values -------------------------------------------------------------*/
+static const char *s_traceStageNames[DJI_LIVEVIEW_TRACE_STAGE_NUM] = {
+    "queue", "parse", "decode", "convert", "handoff", "callback", "total",
+};
+
+static std::atomic<bool> s_isTraceEnabled(false);
+static std::atomic<T_DjiLiveviewTraceBuffer *> s_traceBufferList(nullptr);
+static std::atomic<uint32_t> s_traceThreadCount(0);
+static thread_local DjiLiveviewTraceBufferOwner s_traceBufferOwner;
+
+/* Private functions declaration ---------------------------------------------*/
+static T_DjiLiveviewTraceBuffer *DjiLiveviewTrace_GetThreadBuffer(void);
+static bool DjiLiveviewTrace_ReadEvent(T_DjiLiveviewTraceBuffer *buffer, uint64_t index,
+                                       T_DjiLiveviewTraceEvent *event);
+
+/* Exported functions definition ---------------------------------------------*/
+void DjiLiveviewTrace_SetEnable(bool enable)
+{
+    s_isTraceEnabled.store(enable, std::memory_order_relaxed);
+}
+
+bool DjiLiveviewTrace_IsEnabled(void)
+{
+    return s_isTraceEnabled.load(std::memory_order_relaxed);
+}
+
+int64_t DjiLiveviewTrace_GetTimeUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (int64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void DjiLiveviewTrace_Record(E_DjiLiveviewTraceStage stage, int64_t traceId, int64_t beginUs, int64_t endUs)
+{
+    T_DjiLiveviewTraceBuffer *buffer;
+    T_DjiLiveviewTraceEvent *event;
+    uint64_t writeCount;
+
+    if (!s_isTraceEnabled.load(std::memory_order_relaxed) || stage >= DJI_LIVEVIEW_TRACE_STAGE_NUM) {
+        return;
+    }
+
+    buffer = DjiLiveviewTrace_GetThreadBuffer();
+    if (buffer == nullptr) {
+        return;
+    }
+
+    writeCount = buffer->writeCount.load(std::memory_order_relaxed);
+    event = &buffer->events[writeCount % DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD];
+    event->traceId = traceId;
+    event->beginUs = beginUs;
+    event->durationUs = endUs > beginUs ? (uint32_t) (endUs - beginUs) : 0;
+    event->stage = stage;
+    buffer->writeCount.store(writeCount + 1, std::memory_order_release);
+}
+
+T_DjiReturnCode DjiLiveviewTrace_ExportChromeTrace(const char *path)
+{
+    T_DjiLiveviewTraceEvent event;
+    uint64_t writeCount;
+    uint64_t eventCount = 0;
+    FILE *fp;
+
+    fp = fopen(path, "w");
+    if (fp == nullptr) {
+        USER_LOG_ERROR("Open trace file %s failed.", path);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (T_DjiLiveviewTraceBuffer *buffer = s_traceBufferList.load(std::memory_order_acquire); buffer != nullptr;
+         buffer = buffer->next) {
+        fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                    "\"args\":{\"name\":\"liveview %u\"}}", eventCount > 0 ? ",\n" : "", buffer->threadIndex,
+                buffer->threadIndex);
+        eventCount++;
+
+        writeCount = buffer->writeCount.load(std::memory_order_acquire);
+        for (uint64_t i = writeCount > DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD ?
+                          writeCount - DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD : 0; i < writeCount; i++) {
+            if (!DjiLiveviewTrace_ReadEvent(buffer, i, &event)) {
+                continue;
+            }
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"liveview\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                        "\"ts\":%lld,\"dur\":%u,\"args\":{\"frame\":%lld}}", s_traceStageNames[event.stage],
+                    buffer->threadIndex, (long long) event.beginUs, event.durationUs, (long long) event.traceId);
+            eventCount++;
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    if (fclose(fp) != 0) {
+        USER_LOG_ERROR("Write trace file %s failed.", path);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    USER_LOG_INFO("Liveview trace written to %s.", path);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+void DjiLiveviewTrace_PrintSummary(void)
+{
+    std::vector<uint32_t> durations[DJI_LIVEVIEW_TRACE_STAGE_NUM];
+    T_DjiLiveviewTraceEvent event;
+    uint64_t writeCount;
+
+    for (T_DjiLiveviewTraceBuffer *buffer = s_traceBufferList.load(std::memory_order_acquire); buffer != nullptr;
+         buffer = buffer->next) {
+        writeCount = buffer->writeCount.load(std::memory_order_acquire);
+        for (uint64_t i = writeCount > DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD ?
+                          writeCount - DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD : 0; i < writeCount; i++) {
+            if (DjiLiveviewTrace_ReadEvent(buffer, i, &event)) {
+                durations[event.stage].push_back(event.durationUs);
+            }
+        }
+    }
+
+    for (int stage = 0; stage < DJI_LIVEVIEW_TRACE_STAGE_NUM; stage++) {
+        std::vector<uint32_t> &stageDurations = durations[stage];
+        size_t count = stageDurations.size();
+
+        if (count == 0) {
+            continue;
+        }
+        std::sort(stageDurations.begin(), stageDurations.end());
+        USER_LOG_INFO("Liveview trace %-8s: %u events, p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms",
+                      s_traceStageNames[stage], (uint32_t) count, stageDurations[(count - 1) * 50 / 100] / 1000.0,
+                      stageDurations[(count - 1) * 90 / 100] / 1000.0, stageDurations[(count - 1) * 99 / 100] / 1000.0,
+                      stageDurations[count - 1] / 1000.0);
+    }
+}
+
+void DjiLiveviewTrace_Reset(void)
+{
+    for (T_DjiLiveviewTraceBuffer *buffer = s_traceBufferList.load(std::memory_order_acquire); buffer != nullptr;
+         buffer = buffer->next) {
+        buffer->writeCount.store(0, std::memory_order_release);
+    }
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_DjiLiveviewTraceBuffer *DjiLiveviewTrace_GetThreadBuffer(void)
+{
+    T_DjiLiveviewTraceBuffer *buffer = s_traceBufferOwner.buffer;
+
+    if (buffer != nullptr) {
+        return buffer;
+    }
+
+    /* Claiming or adding a buffer happens once per thread, later records only touch the thread local pointer. */
+    for (buffer = s_traceBufferList.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->next) {
+        bool isOwned = false;
+        if (buffer->isOwned.compare_exchange_strong(isOwned, true, std::memory_order_acquire)) {
+            s_traceBufferOwner.buffer = buffer;
+            return buffer;
+        }
+    }
+
+    buffer = new(std::nothrow) T_DjiLiveviewTraceBuffer;
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+    buffer->writeCount.store(0, std::memory_order_relaxed);
+    buffer->isOwned.store(true, std::memory_order_relaxed);
+    buffer->threadIndex = s_traceThreadCount.fetch_add(1, std::memory_order_relaxed);
+    buffer->next = s_traceBufferList.load(std::memory_order_relaxed);
+    while (!s_traceBufferList.compare_exchange_weak(buffer->next, buffer, std::memory_order_release,
+                                                    std::memory_order_relaxed)) {
+    }
+
+    s_traceBufferOwner.buffer = buffer;
+
+    return buffer;
+}
+
+static bool DjiLiveviewTrace_ReadEvent(T_DjiLiveviewTraceBuffer *buffer, uint64_t index,
+                                       T_DjiLiveviewTraceEvent *event)
+{
+    *event = buffer->events[index % DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD];
+
+    /* The slot may have been reused while it was copied, keep the event only if the writer has not come round. */
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (buffer->writeCount.load(std::memory_order_relaxed) - index >= DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD) {
+        return false;
+    }
+
+    return event->stage < DJI_LIVEVIEW_TRACE_STAGE_NUM;
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,102 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_trace.hpp
+ * @brief   This is the header file for "dji_liveview_trace.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIVEVIEW_TRACE_H
+#define DJI_LIVEVIEW_TRACE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <cstdint>
+#include "dji_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+// Events kept per thread, the oldest are overwritten once a thread has recorded more
+#define DJI_LIVEVIEW_TRACE_EVENT_NUM_PER_THREAD    (16384)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_LIVEVIEW_TRACE_STAGE_QUEUE = 0,     /*!< Stream data waiting for a decode worker. */
+    DJI_LIVEVIEW_TRACE_STAGE_PARSE,         /*!< Splitting stream data into frames. */
+    DJI_LIVEVIEW_TRACE_STAGE_DECODE,
+    DJI_LIVEVIEW_TRACE_STAGE_CONVERT,       /*!< Conversion and scaling with sws_scale. */
+    DJI_LIVEVIEW_TRACE_STAGE_HANDOFF,       /*!< Decoded image waiting in the image handler for its reader. */
+    DJI_LIVEVIEW_TRACE_STAGE_CALLBACK,      /*!< User callback. */
+    DJI_LIVEVIEW_TRACE_STAGE_TOTAL,         /*!< From the arrival of the stream data to the end of the user callback. */
+    DJI_LIVEVIEW_TRACE_STAGE_NUM,
+} E_DjiLiveviewTraceStage;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Turn recording on or off, recording is off by default.
+ * @note While off, recording an event costs one relaxed atomic load.
+ */
+void DjiLiveviewTrace_SetEnable(bool enable);
+bool DjiLiveviewTrace_IsEnabled(void);
+
+/**
+ * @brief Monotonic time used by all trace events, also the arrival time frames are traced by, unit: us.
+ */
+int64_t DjiLiveviewTrace_GetTimeUs(void);
+
+/**
+ * @brief Record one stage of a frame into the trace buffer of the calling thread.
+ * @note The trace ID of a frame is the arrival time of the first stream data of the frame, which the decoder already
+ * carries through the codec as the pts. Recording takes no lock, each thread only writes its own buffer.
+ * @param stage: pipeline stage.
+ * @param traceId: arrival time of the frame, unit: us.
+ * @param beginUs: start of the stage, unit: us.
+ * @param endUs: end of the stage, unit: us.
+ */
+void DjiLiveviewTrace_Record(E_DjiLiveviewTraceStage stage, int64_t traceId, int64_t beginUs, int64_t endUs);
+
+/**
+ * @brief Write the recorded events as Chrome trace JSON, viewable in chrome://tracing or Perfetto.
+ * @note Events a thread overwrites while they are being exported are left out.
+ * @param path: file to write.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiLiveviewTrace_ExportChromeTrace(const char *path);
+
+/**
+ * @brief Print the 50th, 90th and 99th percentile and the maximum duration of every stage.
+ */
+void DjiLiveviewTrace_PrintSummary(void);
+
+/**
+ * @brief Drop the recorded events of all threads.
+ * @note Only call while no thread is recording.
+ */
+void DjiLiveviewTrace_Reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DJI_LIVEVIEW_TRACE_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -37,6 +37,13 @@ using namespace cv;
 using namespace dnn;
 using namespace std;
 
+namespace {
+const float kConfidenceThreshold = 0.5f;
+const float kNmsThreshold = 0.4f;
+// Row layout of a region layer output: cx, cy, w, h, objectness, then one score per class.
+const int kClassScoreOffset = 5;
+}
+
 int32_t ImageProcessorYolovFastest::Init() {
 
     memset(cur_file_dir_path_, 0, kCurrentFilePathSizeMax);
@@ -63,45 +70,101 @@ int32_t ImageProcessorYolovFastest::Init() {
         USER_LOG_ERROR("Failed to load network");
         return -1;
     }
+    out_names_ = net_.getUnconnectedOutLayersNames();
 
     return 0;
 }
 
+void ImageProcessorYolovFastest::GetStageTiming(StageTiming timing[kStageCount]) const {
+    for (int i = 0; i < kStageCount; ++i) {
+        timing[i] = timing_[i];
+    }
+}
+
+void ImageProcessorYolovFastest::pre_process(const cv::Mat& frame) {
+    if (frame.type() != CV_8UC3) {
+        cv::dnn::blobFromImage(frame, blob_, 1 / 255.0, cv::Size(kInputSize, kInputSize), cv::Scalar(0, 0, 0), true, false);
+        return;
+    }
+
+    // Stretched to the input size without letterboxing, as blobFromImage did, so box coordinates stay relative
+    // to the whole frame.
+    cv::resize(frame, resized_, cv::Size(kInputSize, kInputSize), 0, 0, cv::INTER_LINEAR);
+
+    const int blob_shape[] = {1, 3, kInputSize, kInputSize};
+    blob_.create(4, blob_shape, CV_32F);
+
+    // Scale, swap to RGB and split into planes in a single pass, rows are spread over the OpenCV thread pool.
+    float* planes = (float*)blob_.data;
+    cv::parallel_for_(cv::Range(0, kInputSize), [&](const cv::Range& range) {
+        const int plane_size = kInputSize * kInputSize;
+        const float scale = 1 / 255.0f;
+        for (int y = range.start; y < range.end; ++y) {
+            const uchar* src = resized_.ptr<uchar>(y);
+            float* r = planes + y * kInputSize;
+            float* g = r + plane_size;
+            float* b = g + plane_size;
+            for (int x = 0; x < kInputSize; ++x, src += 3) {
+                b[x] = src[0] * scale;
+                g[x] = src[1] * scale;
+                r[x] = src[2] * scale;
+            }
+        }
+    });
+}
+
 void ImageProcessorYolovFastest::post_process(cv::Mat& frame, const std::vector<cv::Mat>& outs, std::vector<T_DjiLiveViewBoundingBox>& bounding_boxes) {
-    std::vector<int> class_ids;
-    std::vector<float> confidences;
-    std::vector<cv::Rect> boxes;
+    class_ids_.clear();
+    confidences_.clear();
+    boxes_.clear();
+    indices_.clear();
+    detections_.clear();
 
     for (size_t i = 0; i < outs.size(); ++i) {
-        float* data = (float*)outs[i].data;
-        for (int j = 0; j < outs[i].rows; ++j, data += outs[i].cols) {
-            cv::Mat scores = outs[i].row(j).colRange(5, outs[i].cols);
-            cv::Point classid_point;
-            double confidence;
-            cv::minMaxLoc(scores, 0, &confidence, 0, &classid_point);
-            if (confidence > 0.5) {
-                int cx = (int)(data[0] * frame.cols);
-                int cy = (int)(data[1] * frame.rows);
-                int w = (int)(data[2] * frame.cols);
-                int h = (int)(data[3] * frame.rows);
-                int left = cx - (w >> 1);
-                int top = cy - (h >> 1);
-                class_ids.push_back(classid_point.x);
-                confidences.push_back((float)confidence);
-                boxes.push_back(cv::Rect(left, top, w, h));
+        const int class_count = outs[i].cols - kClassScoreOffset;
+        for (int j = 0; j < outs[i].rows; ++j) {
+            const float* data = outs[i].ptr<float>(j);
+
+            // The region layer multiplies every class score by the objectness, so a row whose objectness is
+            // below the threshold cannot hold a passing score. This rejects most rows after one compare.
+            if (data[4] <= kConfidenceThreshold) {
+                continue;
+            }
+
+            // Single pass argmax over the contiguous scores, the first maximum wins as with minMaxLoc.
+            const float* scores = data + kClassScoreOffset;
+            int class_id = 0;
+            float confidence = scores[0];
+            for (int k = 1; k < class_count; ++k) {
+                if (scores[k] > confidence) {
+                    confidence = scores[k];
+                    class_id = k;
+                }
             }
+            if (confidence <= kConfidenceThreshold) {
+                continue;
+            }
+
+            int cx = (int)(data[0] * frame.cols);
+            int cy = (int)(data[1] * frame.rows);
+            int w = (int)(data[2] * frame.cols);
+            int h = (int)(data[3] * frame.rows);
+            class_ids_.push_back(class_id);
+            confidences_.push_back(confidence);
+            boxes_.push_back(cv::Rect(cx - (w >> 1), cy - (h >> 1), w, h));
         }
     }
 
-    std::vector<int> indices;
-    cv::dnn::NMSBoxes(boxes, confidences, 0.5, 0.4, indices);
-    for (size_t i = 0; i < indices.size(); ++i) {
-        int idx = indices[i];
-        cv::Rect box = boxes[idx];
+    if (!boxes_.empty()) {
+        cv::dnn::NMSBoxes(boxes_, confidences_, kConfidenceThreshold, kNmsThreshold, indices_);
+    }
+    for (size_t i = 0; i < indices_.size(); ++i) {
+        int idx = indices_[i];
+        const cv::Rect& box = boxes_[idx];
 
         T_DjiLiveViewBoundingBox bounding_box;
         bounding_box.id = i;
-        bounding_box.type = class_ids[idx];
+        bounding_box.type = class_ids_[idx];
         bounding_box.state = 1;
         bounding_box.box.cx = (uint16_t)((box.x + box.width / 2) * 10000 / frame.cols);
         bounding_box.box.cy = (uint16_t)((box.y + box.height / 2) * 10000 / frame.rows);
@@ -110,31 +173,47 @@ void ImageProcessorYolovFastest::post_process(cv::Mat& frame, const std::vector<
         bounding_box.box.distance = 0;
         bounding_boxes.push_back(bounding_box);
 
-        std::cout << "Bounding Box " << i << ": "
-                  << "Class ID = " << class_ids[idx] << ", "
-                  << "Confidence = " << confidences[idx] << ", "
-                  << "Box = [" << box.x << ", " << box.y << ", " << box.width << ", " << box.height << "]"
-                  << std::endl;
+        detections_.push_back({class_ids_[idx], confidences_[idx], box});
 
-        cv::rectangle(frame, box, cv::Scalar(0, 255, 0), 2);
-        std::string label = cv::format("ID: %d Conf: %.2f", class_ids[idx], confidences[idx]);
-        cv::putText(frame, label, cv::Point(box.x, box.y - 10), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 0), 2);
+        if (draw_detections_) {
+            cv::rectangle(frame, box, cv::Scalar(0, 255, 0), 2);
+            std::string label = cv::format("ID: %d Conf: %.2f", class_ids_[idx], confidences_[idx]);
+            cv::putText(frame, label, cv::Point(box.x, box.y - 10), cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 255, 0), 2);
+        }
+    }
+
+    if (detection_callback_) {
+        detection_callback_(detections_);
+    }
+}
+
+void ImageProcessorYolovFastest::update_timing(Stage stage, int64_t start_tick) {
+    double cost_ms = (cv::getTickCount() - start_tick) * 1000.0 / cv::getTickFrequency();
+    StageTiming& timing = timing_[stage];
+
+    timing.count++;
+    timing.last_ms = cost_ms;
+    timing.average_ms += (cost_ms - timing.average_ms) / timing.count;
+    if (cost_ms > timing.max_ms) {
+        timing.max_ms = cost_ms;
     }
 }
 
 void ImageProcessorYolovFastest::Process(const std::shared_ptr<Image>& image, std::vector<T_DjiLiveViewBoundingBox>& bounding_boxes) {
-    auto detect = [&](cv::Mat& frame, std::vector<cv::Mat>& outs) {
-        cv::Mat blob;
-        cv::dnn::blobFromImage(frame, blob, 1 / 255.0, cv::Size(320, 320), cv::Scalar(0, 0, 0), true, false);
-        net_.setInput(blob);
-        net_.forward(outs, net_.getUnconnectedOutLayersNames());
-    };
-
-    cv::Mat frame = *image;
-    std::vector<cv::Mat> outs;
-    detect(frame, outs);
-
-    post_process(frame, outs, bounding_boxes);
+    cv::Mat& frame = *image;
+
+    int64_t start_tick = cv::getTickCount();
+    pre_process(frame);
+    update_timing(kStagePreprocess, start_tick);
+
+    start_tick = cv::getTickCount();
+    net_.setInput(blob_);
+    net_.forward(outs_, out_names_);
+    update_timing(kStageForward, start_tick);
+
+    start_tick = cv::getTickCount();
+    post_process(frame, outs_, bounding_boxes);
+    update_timing(kStagePostprocess, start_tick);
 }
 
 #endif
@@ -23,18 +23,45 @@
 #define __IMAGE_PROCESSOR_DIAPLAY_H__
 #ifdef OPEN_CV_INSTALLED
 
+#include <functional>
 #include <memory>
 #include "opencv2/opencv.hpp"
 #include <dji_liveview.h>
 
 class ImageProcessorYolovFastest {
 public:
-    ImageProcessorYolovFastest(const std::string& name) : show_name_(name) {}
+    struct Detection {
+        int class_id;
+        float confidence;
+        cv::Rect box;    // In pixels of the processed frame.
+    };
+    using DetectionCallback = std::function<void(const std::vector<Detection>& detections)>;
+
+    enum Stage {
+        kStagePreprocess = 0,
+        kStageForward,
+        kStagePostprocess,
+        kStageCount,
+    };
+    struct StageTiming {
+        uint64_t count;
+        double last_ms;
+        double average_ms;
+        double max_ms;
+    };
+
+    ImageProcessorYolovFastest(const std::string& name) : show_name_(name), draw_detections_(false), timing_() {}
 
     ~ImageProcessorYolovFastest() {}
 
     int32_t Init();
 
+    // Called from Process with the detections kept after NMS, replaces printing them to stdout.
+    void SetDetectionCallback(const DetectionCallback& callback) { detection_callback_ = callback; }
+    // Draw the kept boxes and labels onto the processed frame.
+    void SetDrawDetections(bool draw) { draw_detections_ = draw; }
+    void GetStageTiming(StageTiming timing[kStageCount]) const;
+
     using Image = cv::Mat;
     void Process(const std::shared_ptr<Image>& image, std::vector<T_DjiLiveViewBoundingBox>& bounding_boxes);
     std::vector<T_DjiLiveViewBoundingBox> Process(const std::shared_ptr<Image>& image);
@@ -44,13 +71,32 @@ private:
     enum {
         kFilePathSizeMax = 256,
         kCurrentFilePathSizeMax = 128,
+        kInputSize = 320,
     };
 
     cv::dnn::Net net_;
+    std::vector<cv::String> out_names_;
     char cur_file_dir_path_[kCurrentFilePathSizeMax];
     char prototxt_file_dir_path_[kFilePathSizeMax];
     char weights_file_dir_path_[kFilePathSizeMax];
+
+    // Kept across frames so that a stream at a fixed resolution allocates nothing per frame.
+    cv::Mat resized_;
+    cv::Mat blob_;
+    std::vector<cv::Mat> outs_;
+    std::vector<int> class_ids_;
+    std::vector<float> confidences_;
+    std::vector<cv::Rect> boxes_;
+    std::vector<int> indices_;
+    std::vector<Detection> detections_;
+
+    DetectionCallback detection_callback_;
+    bool draw_detections_;
+    StageTiming timing_[kStageCount];
+
+    void pre_process(const cv::Mat& frame);
     void post_process(cv::Mat& frame, const std::vector<cv::Mat>& outs, std::vector<T_DjiLiveViewBoundingBox>& bounding_boxes);
+    void update_timing(Stage stage, int64_t start_tick);
 };
 #endif
 #endif
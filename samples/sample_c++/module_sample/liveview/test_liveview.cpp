@@ -24,16 +24,25 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "test_liveview.hpp"
+#include "dji_liveview_trace.hpp"
 
 /* Private constants ---------------------------------------------------------*/
+// Decode time all liveview streams may use together, unit: cores
+#define LIVEVIEW_DECODE_BUDGET_CORES              (1.5)
+#define LIVEVIEW_MAIN_CAMERA_STREAM_PRIORITY      (3)
+#define LIVEVIEW_VICE_CAMERA_STREAM_PRIORITY      (2)
+#define LIVEVIEW_TOP_CAMERA_STREAM_PRIORITY       (2)
+#define LIVEVIEW_FPV_CAMERA_STREAM_PRIORITY       (1)
+// Trace every frame through the pipeline, a stage summary is printed when a stream stops
+#define LIVEVIEW_TRACE_ENABLE                     1
+// Chrome trace JSON written when the sample exits, open it in chrome://tracing or Perfetto
+#define LIVEVIEW_TRACE_FILE_PATH                  "liveview_trace.json"
 
 /* Private types -------------------------------------------------------------*/
 
 /* Private values -------------------------------------------------------------*/
-std::map<::E_DjiLiveViewCameraPosition, DJICameraStreamDecoder *> streamDecoder;
 
 /* Private functions declaration ---------------------------------------------*/
-static void LiveviewConvertH264ToRgbCallback(E_DjiLiveViewCameraPosition position, const uint8_t *buf, uint32_t bufLen);
 
 /* Exported functions definition ---------------------------------------------*/
 LiveviewSample::LiveviewSample()
@@ -45,165 +54,90 @@ LiveviewSample::LiveviewSample()
         throw ("Liveview init failed");
     }
 
-    streamDecoder = {
-        {DJI_LIVEVIEW_CAMERA_POSITION_FPV,  (new DJICameraStreamDecoder())},
-        {DJI_LIVEVIEW_CAMERA_POSITION_NO_1, (new DJICameraStreamDecoder())},
-        {DJI_LIVEVIEW_CAMERA_POSITION_NO_2, (new DJICameraStreamDecoder())},
-        {DJI_LIVEVIEW_CAMERA_POSITION_NO_3, (new DJICameraStreamDecoder())},
-    };
+    DjiLiveviewTrace_SetEnable(LIVEVIEW_TRACE_ENABLE);
+    m_streamManager = new DJILiveviewStreamManager();
+    m_streamManager->setDecodeBudget(LIVEVIEW_DECODE_BUDGET_CORES);
 }
 
 LiveviewSample::~LiveviewSample()
 {
     T_DjiReturnCode returnCode;
 
+    /* The manager stops the streams still running, which needs liveview to be initialized. */
+    delete m_streamManager;
+    if (DjiLiveviewTrace_IsEnabled()) {
+        DjiLiveviewTrace_SetEnable(false);
+        DjiLiveviewTrace_ExportChromeTrace(LIVEVIEW_TRACE_FILE_PATH);
+    }
+
     returnCode = DjiLiveview_Deinit();
     if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         perror("Liveview deinit failed");
     }
-
-    for (auto pair : streamDecoder) {
-        if (pair.second) {
-            delete pair.second;
-        }
-    }
 }
 
-T_DjiReturnCode LiveviewSample::StartFpvCameraStream(CameraImageCallback callback, void *userData)
+void LiveviewSample::SetCameraStreamOutputFormat(E_DjiCameraStreamDecoderOutputFormat format)
 {
-    auto deocder = streamDecoder.find(DJI_LIVEVIEW_CAMERA_POSITION_FPV);
+    m_streamManager->setOutputFormat(format);
+}
 
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->init();
-        deocder->second->registerCallback(callback, userData);
+T_DjiReturnCode LiveviewSample::StartCameraStream(E_DjiLiveViewCameraPosition position, uint8_t priority,
+                                                  CameraImageCallback callback, void *userData)
+{
+    T_DjiLiveviewStreamConfig config = {priority, 0, 0};
 
-        return DjiLiveview_StartH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_FPV, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT,
-                                           LiveviewConvertH264ToRgbCallback);
-    } else {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-    }
+    return m_streamManager->startStream(position, config, callback, userData);
 }
 
-T_DjiReturnCode LiveviewSample::StartMainCameraStream(CameraImageCallback callback, void *userData)
+T_DjiReturnCode LiveviewSample::StopCameraStream(E_DjiLiveViewCameraPosition position)
 {
-    auto deocder = streamDecoder.find(DJI_LIVEVIEW_CAMERA_POSITION_NO_1);
+    return m_streamManager->stopStream(position);
+}
 
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->init();
-        deocder->second->registerCallback(callback, userData);
+T_DjiReturnCode LiveviewSample::StartFpvCameraStream(CameraImageCallback callback, void *userData)
+{
+    return StartCameraStream(DJI_LIVEVIEW_CAMERA_POSITION_FPV, LIVEVIEW_FPV_CAMERA_STREAM_PRIORITY, callback,
+                             userData);
+}
 
-        return DjiLiveview_StartH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_NO_1, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT,
-                                           LiveviewConvertH264ToRgbCallback);
-    } else {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-    }
+T_DjiReturnCode LiveviewSample::StartMainCameraStream(CameraImageCallback callback, void *userData)
+{
+    return StartCameraStream(DJI_LIVEVIEW_CAMERA_POSITION_NO_1, LIVEVIEW_MAIN_CAMERA_STREAM_PRIORITY, callback,
+                             userData);
 }
 
 T_DjiReturnCode LiveviewSample::StartViceCameraStream(CameraImageCallback callback, void *userData)
 {
-    auto deocder = streamDecoder.find(DJI_LIVEVIEW_CAMERA_POSITION_NO_2);
-
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->init();
-        deocder->second->registerCallback(callback, userData);
-
-        return DjiLiveview_StartH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_NO_2, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT,
-                                           LiveviewConvertH264ToRgbCallback);
-    } else {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-    }
+    return StartCameraStream(DJI_LIVEVIEW_CAMERA_POSITION_NO_2, LIVEVIEW_VICE_CAMERA_STREAM_PRIORITY, callback,
+                             userData);
 }
 
 T_DjiReturnCode LiveviewSample::StartTopCameraStream(CameraImageCallback callback, void *userData)
 {
-    auto deocder = streamDecoder.find(DJI_LIVEVIEW_CAMERA_POSITION_NO_3);
-
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->init();
-        deocder->second->registerCallback(callback, userData);
-
-        return DjiLiveview_StartH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_NO_3, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT,
-                                           LiveviewConvertH264ToRgbCallback);
-    } else {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-    }
+    return StartCameraStream(DJI_LIVEVIEW_CAMERA_POSITION_NO_3, LIVEVIEW_TOP_CAMERA_STREAM_PRIORITY, callback,
+                             userData);
 }
 
 T_DjiReturnCode LiveviewSample::StopFpvCameraStream()
 {
-    T_DjiReturnCode returnCode;
-
-    returnCode = DjiLiveview_StopH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_FPV, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT);
-    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        return returnCode;
-    }
-
-    auto deocder = streamDecoder.find(DJI_LIVEVIEW_CAMERA_POSITION_FPV);
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->cleanup();
-    }
-
-    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return StopCameraStream(DJI_LIVEVIEW_CAMERA_POSITION_FPV);
 }
 
 T_DjiReturnCode LiveviewSample::StopMainCameraStream()
 {
-    T_DjiReturnCode returnCode;
-
-    returnCode = DjiLiveview_StopH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_NO_1, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT);
-    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        return returnCode;
-    }
-
-    auto deocder = streamDecoder.find(DJI_LIVEVIEW_CAMERA_POSITION_NO_1);
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->cleanup();
-    }
-
-    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return StopCameraStream(DJI_LIVEVIEW_CAMERA_POSITION_NO_1);
 }
 
 T_DjiReturnCode LiveviewSample::StopViceCameraStream()
 {
-    T_DjiReturnCode returnCode;
-
-    returnCode = DjiLiveview_StopH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_NO_2, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT);
-    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        return returnCode;
-    }
-
-    auto deocder = streamDecoder.find(DJI_LIVEVIEW_CAMERA_POSITION_NO_2);
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->cleanup();
-    }
-
-    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return StopCameraStream(DJI_LIVEVIEW_CAMERA_POSITION_NO_2);
 }
 
 T_DjiReturnCode LiveviewSample::StopTopCameraStream()
 {
-    T_DjiReturnCode returnCode;
-
-    returnCode = DjiLiveview_StopH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_NO_3, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT);
-    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        return returnCode;
-    }
-
-    auto deocder = streamDecoder.find(DJI_LIVEVIEW_CAMERA_POSITION_NO_3);
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->cleanup();
-    }
-
-    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return StopCameraStream(DJI_LIVEVIEW_CAMERA_POSITION_NO_3);
 }
 
 /* Private functions definition-----------------------------------------------*/
-static void LiveviewConvertH264ToRgbCallback(E_DjiLiveViewCameraPosition position, const uint8_t *buf, uint32_t bufLen)
-{
-    auto deocder = streamDecoder.find(position);
-    if ((deocder != streamDecoder.end()) && deocder->second) {
-        deocder->second->decodeBuffer(buf, bufLen);
-    }
-}
 
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
\ No newline at end of file
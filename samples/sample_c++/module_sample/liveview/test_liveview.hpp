@@ -29,8 +29,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "dji_liveview.h"
-#include <map>
-#include "dji_camera_stream_decoder.hpp"
+#include "dji_liveview_stream_manager.hpp"
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,6 +45,8 @@ public:
     LiveviewSample();
     ~LiveviewSample();
 
+    void SetCameraStreamOutputFormat(E_DjiCameraStreamDecoderOutputFormat format);
+
     T_DjiReturnCode StartFpvCameraStream(CameraImageCallback callback, void *userData);
     T_DjiReturnCode StopFpvCameraStream();
 
@@ -57,6 +58,13 @@ public:
 
     T_DjiReturnCode StartTopCameraStream(CameraImageCallback callback, void *userData);
     T_DjiReturnCode StopTopCameraStream();
+
+private:
+    T_DjiReturnCode StartCameraStream(E_DjiLiveViewCameraPosition position, uint8_t priority,
+                                      CameraImageCallback callback, void *userData);
+    T_DjiReturnCode StopCameraStream(E_DjiLiveViewCameraPosition position);
+
+    DJILiveviewStreamManager *m_streamManager;
 };
 
 /* Exported functions --------------------------------------------------------*/
@@ -27,12 +27,15 @@
 #include <dji_logger.h>
 #include "test_liveview_entry.hpp"
 #include "test_liveview.hpp"
+#include "dji_liveview_frame_export.hpp"
+#include "dji_liveview_trace.hpp"
 
 #ifdef OPEN_CV_INSTALLED
 
 #include "opencv2/opencv.hpp"
 #include "opencv2/dnn.hpp"
 #include "opencv2/highgui/highgui.hpp"
+#include "dji_liveview_inference_engine.hpp"
 #include "../../../sample_c/module_sample/utils/util_misc.h"
 
 using namespace cv;
@@ -40,36 +43,31 @@ using namespace cv;
 using namespace std;
 
 /* Private constants ---------------------------------------------------------*/
+//Print the inference stage timing every this many displayed results
+#define DJI_LIVEVIEW_INFERENCE_TIMING_PRINT_INTERVAL    (100)
+//Frames of the headless demo are exported to /dev/shm/<prefix><camera name>
+#define DJI_LIVEVIEW_FRAME_EXPORT_NAME_PREFIX           "dji_liveview_"
 
 /* Private types -------------------------------------------------------------*/
 
 /* Private values -------------------------------------------------------------*/
-const char *classNames[] = {"background", "person", "bicycle", "car", "motorcycle", "airplane", "bus", "train", "truck",
-                            "boat", "traffic light",
-                            "fire hydrant", "background", "stop sign", "parking meter", "bench", "bird", "cat", "dog",
-                            "horse", "sheep", "cow", "elephant", "bear", "zebra", "giraffe", "background", "backpack",
-                            "umbrella", "background", "background", "handbag", "tie", "suitcase", "frisbee", "skis",
-                            "snowboard", "sports ball", "kite", "baseball bat", "baseball glove", "skateboard",
-                            "surfboard", "tennis racket",
-                            "bottle", "background", "wine glass", "cup", "fork", "knife", "spoon", "bowl", "banana",
-                            "apple", "sandwich", "orange", "broccoli", "carrot", "hot dog", "pizza", "donut",
-                            "cake", "chair", "couch", "potted plant", "bed", "background", "dining table", "background",
-                            "background", "toilet", "background", "tv", "laptop", "mouse", "remote", "keyboard",
-                            "cell phone", "microwave", "oven", "toaster", "sink", "refrigerator", "background", "book",
-                            "clock", "vase", "scissors", "teddy bear", "hair drier", "toothbrush"};
-
-const size_t inWidth = 320;
-const size_t inHeight = 300;
-const float WHRatio = inWidth / (float) inHeight;
 static int32_t s_demoIndex = -1;
 char curFileDirPath[DJI_FILE_PATH_SIZE_MAX];
-char tempFileDirPath[DJI_FILE_PATH_SIZE_MAX];
-char prototxtFileDirPath[DJI_FILE_PATH_SIZE_MAX];
-char weightsFileDirPath[DJI_FILE_PATH_SIZE_MAX];
+static T_DjiLiveviewFrameExportHandle s_frameExport = nullptr;
+static bool s_isFrameExportFailed = false;
+#ifdef OPEN_CV_INSTALLED
+static DJILiveviewInferenceEngine *s_inferenceEngine = nullptr;
+static Mat s_inferenceResult;
+static uint32_t s_inferenceResultCount = 0;
+#endif
 
 /* Private functions declaration ---------------------------------------------*/
-static void DjiUser_ShowRgbImageCallback(CameraRGBImage img, void *userData);
+static void DjiUser_ShowRgbImageCallback(const CameraRGBImage &img, void *userData);
 static T_DjiReturnCode DjiUser_GetCurrentFileDirPath(const char *filePath, uint32_t pathBufferSize, char *dirPath);
+static void DjiUser_ExportImage(const CameraRGBImage &img, const string &name);
+#ifdef OPEN_CV_INSTALLED
+static void DjiUser_PrintInferenceTiming(void);
+#endif
 
 /* Exported functions definition ---------------------------------------------*/
 void DjiUser_RunCameraStreamViewSample()
@@ -101,6 +99,7 @@ void DjiUser_RunCameraStreamViewSample()
          << "--> [1] Binary image display\n"
          << "--> [2] Faces detection demo\n"
          << "--> [3] Tensorflow Object detection demo\n"
+         << "--> [4] Export frames to shared memory (headless)\n"
          << endl;
     cin >> demoIndexChar;
 
@@ -117,12 +116,38 @@ void DjiUser_RunCameraStreamViewSample()
         case '3':
             s_demoIndex = 3;
             break;
+        case '4':
+            s_demoIndex = 4;
+            break;
         default:
             cout << "No demo selected";
             delete liveviewSample;
             return;
     }
 
+#ifdef OPEN_CV_INSTALLED
+    if (s_demoIndex == 2 || s_demoIndex == 3) {
+        /* Load the models before the stream starts, so no frame waits for the disk. */
+        E_DjiLiveviewInferenceModel model = s_demoIndex == 2 ? DJI_LIVEVIEW_INFERENCE_MODEL_FACE_CASCADE
+                                                             : DJI_LIVEVIEW_INFERENCE_MODEL_TENSORFLOW_SSD;
+
+        s_inferenceEngine = new DJILiveviewInferenceEngine(model, curFileDirPath);
+        if (!s_inferenceEngine->start()) {
+            USER_LOG_ERROR("Start inference engine failed, please check the model files in %sdata.", curFileDirPath);
+            delete s_inferenceEngine;
+            s_inferenceEngine = nullptr;
+            delete liveviewSample;
+            return;
+        }
+    }
+#endif
+
+    if (s_demoIndex == 1 || s_demoIndex == 4) {
+        /* The binary image only needs luma, the decoder hands out its planes without converting them to RGB.
+         * Exported frames stay in YUV as well, converting them is left to the processes reading them. */
+        liveviewSample->SetCameraStreamOutputFormat(DJI_CAMERA_STREAM_DECODER_OUTPUT_YUV);
+    }
+
     cout << "Please enter the type of camera stream you want to view\n\n"
          << "--> [0] Fpv Camera\n"
          << "--> [1] Main Camera\n"
@@ -179,104 +204,69 @@ void DjiUser_RunCameraStreamViewSample()
             return;
     }
 
+#ifdef OPEN_CV_INSTALLED
+    if (s_inferenceEngine != nullptr) {
+        DjiUser_PrintInferenceTiming();
+        delete s_inferenceEngine;
+        s_inferenceEngine = nullptr;
+    }
+#endif
+
+    /* The streams are stopped, no callback publishes into the exporter any more. */
+    if (s_frameExport != nullptr) {
+        T_DjiLiveviewFrameExportStatistics statistics;
+
+        DjiLiveviewFrameExport_GetStatistics(s_frameExport, &statistics);
+        USER_LOG_INFO("Frame export published %llu frames, %llu too large, max publish time %u us.",
+                      (unsigned long long) statistics.publishedCount,
+                      (unsigned long long) statistics.oversizeCount, statistics.maxPublishTimeUs);
+        DjiLiveviewFrameExport_Destroy(s_frameExport);
+        s_frameExport = nullptr;
+    }
+    s_isFrameExportFailed = false;
+
     delete liveviewSample;
 }
 
 /* Private functions definition-----------------------------------------------*/
-static void DjiUser_ShowRgbImageCallback(CameraRGBImage img, void *userData)
+static void DjiUser_ShowRgbImageCallback(const CameraRGBImage &img, void *userData)
 {
     string name = string(reinterpret_cast<char *>(userData));
 
-#ifdef OPEN_CV_INSTALLED
-    Mat mat(img.height, img.width, CV_8UC3, img.rawData.data(), img.width * 3);
+    if (s_demoIndex == 4) {
+        DjiUser_ExportImage(img, name);
+        return;
+    }
 
+#ifdef OPEN_CV_INSTALLED
     if (s_demoIndex == 0) {
+        CameraRGBImage rgbImg;
+        if (!img.toRGB(rgbImg)) {
+            return;
+        }
+        Mat mat(rgbImg.height, rgbImg.width, CV_8UC3, rgbImg.rawData, rgbImg.width * 3);
         cvtColor(mat, mat, COLOR_RGB2BGR);
         imshow(name, mat);
     } else if (s_demoIndex == 1) {
-        cvtColor(mat, mat, COLOR_RGB2GRAY);
+        Mat mat;
+        if (img.format == DJI_CAMERA_IMAGE_FORMAT_RGB24) {
+            cvtColor(Mat(img.height, img.width, CV_8UC3, img.rawData, img.width * 3), mat, COLOR_RGB2GRAY);
+        } else {
+            /* The luma plane already is the gray image. */
+            mat = Mat(img.height, img.width, CV_8UC1, img.planeData[0], img.planeStride[0]);
+        }
         Mat mask;
         cv::threshold(mat, mask, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
         imshow(name, mask);
-    } else if (s_demoIndex == 2) {
-        cvtColor(mat, mat, COLOR_RGB2BGR);
-        snprintf(tempFileDirPath, DJI_FILE_PATH_SIZE_MAX, "%s/data/haarcascade_frontalface_alt.xml", curFileDirPath);
-        auto faceDetector = cv::CascadeClassifier(tempFileDirPath);
-        std::vector<Rect> faces;
-        faceDetector.detectMultiScale(mat, faces, 1.1, 3, 0, Size(50, 50));
-
-        for (int i = 0; i < faces.size(); ++i) {
-            cout << "index: " << i;
-            cout << "  x: " << faces[i].x;
-            cout << "  y: " << faces[i].y << endl;
-
-            cv::rectangle(mat, cv::Point(faces[i].x, faces[i].y),
-                          cv::Point(faces[i].x + faces[i].width, faces[i].y + faces[i].height),
-                          Scalar(0, 0, 255), 2, 1, 0);
-        }
-        imshow(name, mat);
-    } else if (s_demoIndex == 3) {
-        snprintf(prototxtFileDirPath, DJI_FILE_PATH_SIZE_MAX,
-                 "%s/data/tensorflow/ssd_inception_v2_coco_2017_11_17.pbtxt",
-                 curFileDirPath);
-        //Attention: If you want to run the Tensorflow Object detection demo, Please download the tensorflow model.
-        //Download Url: http://download.tensorflow.org/models/object_detection/ssd_inception_v2_coco_2017_11_17.tar.gz
-        snprintf(weightsFileDirPath, DJI_FILE_PATH_SIZE_MAX, "%s/data/tensorflow/frozen_inference_graph.pb",
-                 curFileDirPath);
-
-        dnn::Net net = cv::dnn::readNetFromTensorflow(weightsFileDirPath, prototxtFileDirPath);
-        Size frame_size = mat.size();
-
-        Size cropSize;
-        if (frame_size.width / (float) frame_size.height > WHRatio) {
-            cropSize = Size(static_cast<int>(frame_size.height * WHRatio),
-                            frame_size.height);
-        } else {
-            cropSize = Size(frame_size.width,
-                            static_cast<int>(frame_size.width / WHRatio));
-        }
-
-        Rect crop(Point((frame_size.width - cropSize.width) / 2,
-                        (frame_size.height - cropSize.height) / 2),
-                  cropSize);
-
-        cv::Mat blob = cv::dnn::blobFromImage(mat, 1, Size(300, 300));
-        net.setInput(blob);
-        Mat output = net.forward();
-        Mat detectionMat(output.size[2], output.size[3], CV_32F, output.ptr<float>());
-
-        mat = mat(crop);
-        float confidenceThreshold = 0.50;
-
-        for (int i = 0; i < detectionMat.rows; i++) {
-            float confidence = detectionMat.at<float>(i, 2);
-            if (confidence > confidenceThreshold) {
-                auto objectClass = (size_t) (detectionMat.at<float>(i, 1));
-
-                int xLeftBottom = static_cast<int>(detectionMat.at<float>(i, 3) * mat.cols);
-                int yLeftBottom = static_cast<int>(detectionMat.at<float>(i, 4) * mat.rows);
-                int xRightTop = static_cast<int>(detectionMat.at<float>(i, 5) * mat.cols);
-                int yRightTop = static_cast<int>(detectionMat.at<float>(i, 6) * mat.rows);
-
-                ostringstream ss;
-                ss << confidence;
-                String conf(ss.str());
-
-                Rect object((int) xLeftBottom, (int) yLeftBottom,
-                            (int) (xRightTop - xLeftBottom),
-                            (int) (yRightTop - yLeftBottom));
-
-                rectangle(mat, object, Scalar(0, 255, 0), 2);
-                String label = String(classNames[objectClass]) + ": " + conf;
-
-                int baseLine = 0;
-                Size labelSize = getTextSize(label, FONT_HERSHEY_SIMPLEX, 0.5, 1, &baseLine);
-                rectangle(mat, Rect(Point(xLeftBottom, yLeftBottom - labelSize.height),
-                                    Size(labelSize.width, labelSize.height + baseLine)), Scalar(0, 255, 0), cv::FILLED);
-                putText(mat, label, Point(xLeftBottom, yLeftBottom), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(0, 0, 0));
+    } else if (s_inferenceEngine != nullptr) {
+        /* Inference runs on the engine workers, the callback only shows the newest annotated frame. */
+        s_inferenceEngine->submitFrame(img);
+        if (s_inferenceEngine->getLatestResult(s_inferenceResult)) {
+            imshow(name, s_inferenceResult);
+            if (++s_inferenceResultCount % DJI_LIVEVIEW_INFERENCE_TIMING_PRINT_INTERVAL == 0) {
+                DjiUser_PrintInferenceTiming();
             }
         }
-        imshow(name, mat);
     }
 
     cv::waitKey(1);
@@ -304,4 +294,99 @@ static T_DjiReturnCode DjiUser_GetCurrentFileDirPath(const char *filePath, uint3
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
+static void DjiUser_ExportImage(const CameraRGBImage &img, const string &name)
+{
+    T_DjiLiveviewFrameExportFrame frame = {};
+    uint32_t rowSize[DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX] = {0};
+    uint32_t rowCount[DJI_LIVEVIEW_FRAME_EXPORT_PLANE_NUM_MAX] = {0};
+    uint32_t chromaWidth = (img.width + 1) / 2;
+    uint32_t chromaHeight = (img.height + 1) / 2;
+    T_DjiReturnCode returnCode;
+    uint8_t *data;
+
+    if (s_isFrameExportFailed) {
+        return;
+    }
+
+    if (s_frameExport == nullptr) {
+        /* Slots are sized for the first frame as packed RGB, which also holds it in any 4:2:0 layout. */
+        returnCode = DjiLiveviewFrameExport_Create((DJI_LIVEVIEW_FRAME_EXPORT_NAME_PREFIX + name).c_str(), 0,
+                                                   img.width * img.height * 3, &s_frameExport);
+        if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("Create frame export failed, stat = 0x%08llX", returnCode);
+            s_isFrameExportFailed = true;
+            return;
+        }
+    }
+
+    switch (img.format) {
+        case DJI_CAMERA_IMAGE_FORMAT_RGB24:
+            frame.format = DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_RGB24;
+            frame.planeCount = 1;
+            rowSize[0] = img.width * 3;
+            rowCount[0] = img.height;
+            break;
+        case DJI_CAMERA_IMAGE_FORMAT_YUV420P:
+            frame.format = DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_YUV420P;
+            frame.planeCount = 3;
+            rowSize[0] = img.width;
+            rowCount[0] = img.height;
+            rowSize[1] = rowSize[2] = chromaWidth;
+            rowCount[1] = rowCount[2] = chromaHeight;
+            break;
+        case DJI_CAMERA_IMAGE_FORMAT_NV12:
+            frame.format = DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_NV12;
+            frame.planeCount = 2;
+            rowSize[0] = img.width;
+            rowCount[0] = img.height;
+            rowSize[1] = chromaWidth * 2;
+            rowCount[1] = chromaHeight;
+            break;
+        default:
+            return;
+    }
+
+    /* Planes are packed one after another without the padding of the decoder. */
+    for (uint32_t i = 0; i < frame.planeCount; i++) {
+        frame.planeOffset[i] = frame.dataSize;
+        frame.planeStride[i] = rowSize[i];
+        frame.dataSize += rowSize[i] * rowCount[i];
+    }
+
+    if (DjiLiveviewFrameExport_BeginWrite(s_frameExport, frame.dataSize, &data) !=
+        DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < frame.planeCount; i++) {
+        for (uint32_t row = 0; row < rowCount[i]; row++) {
+            memcpy(data + frame.planeOffset[i] + row * rowSize[i],
+                   img.planeData[i] + (size_t) row * img.planeStride[i], rowSize[i]);
+        }
+    }
+
+    frame.timestampUs = img.traceId != 0 ? img.traceId : DjiLiveviewTrace_GetTimeUs();
+    frame.width = img.width;
+    frame.height = img.height;
+    DjiLiveviewFrameExport_EndWrite(s_frameExport, &frame);
+}
+
+#ifdef OPEN_CV_INSTALLED
+static void DjiUser_PrintInferenceTiming(void)
+{
+    T_DjiLiveviewInferenceStageTiming timing[DJI_LIVEVIEW_INFERENCE_STAGE_COUNT];
+
+    s_inferenceEngine->getStageTiming(timing);
+    USER_LOG_INFO("Inference preprocess %.2f/%.2f ms, forward %.2f/%.2f ms, postprocess %.2f/%.2f ms (avg/max), "
+                  "%llu frames replaced before inference.",
+                  timing[DJI_LIVEVIEW_INFERENCE_STAGE_PREPROCESS].averageMs,
+                  timing[DJI_LIVEVIEW_INFERENCE_STAGE_PREPROCESS].maxMs,
+                  timing[DJI_LIVEVIEW_INFERENCE_STAGE_FORWARD].averageMs,
+                  timing[DJI_LIVEVIEW_INFERENCE_STAGE_FORWARD].maxMs,
+                  timing[DJI_LIVEVIEW_INFERENCE_STAGE_POSTPROCESS].averageMs,
+                  timing[DJI_LIVEVIEW_INFERENCE_STAGE_POSTPROCESS].maxMs,
+                  (unsigned long long) s_inferenceEngine->getReplacedFrameCount());
+}
+#endif
+
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,263 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_benchmark_frames.cpp
+ * @brief   Synthetic and recorded lidar frames shared by the lidar benchmarks.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Only used by the benchmark targets of the platform CMakeLists. */
+#ifdef DJI_SAMPLE_BENCHMARK
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_lidar_benchmark_frames.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <string>
+
+/* Private constants ---------------------------------------------------------*/
+#define LIDAR_BENCHMARK_POINT_NUM_MAX           (DJI_LIDAR_PKG_BUFFER_NUM * DJI_PTS_NUM_PER_PKG)
+#define LIDAR_BENCHMARK_PCD_HEADER_LINE_MAX     (16)
+// Rosette scan: the beam turns around the optical axis while swinging out to the edge of the field of view and back
+#define LIDAR_BENCHMARK_HALF_FOV                (0.61f)     // unit: rad
+#define LIDAR_BENCHMARK_PETAL_COUNT             (7.013f)    // not whole, so the petals move and fill the field of view
+#define LIDAR_BENCHMARK_SCAN_STEP               (0.003f)    // turn of the beam between two points, unit: rad
+#define LIDAR_BENCHMARK_TILT                    (0.35f)     // sensor pitched down, unit: rad
+#define LIDAR_BENCHMARK_SENSOR_HEIGHT           (3.0f)      // unit: m
+#define LIDAR_BENCHMARK_WALL_DISTANCE           (40.0f)     // unit: m
+#define LIDAR_BENCHMARK_WALL_HEIGHT             (12.0f)     // unit: m
+#define LIDAR_BENCHMARK_RANGE_MAX               (100.0f)    // unit: m
+#define LIDAR_BENCHMARK_RANGE_NOISE             (0.02f)     // unit: m
+#define LIDAR_BENCHMARK_LABEL_NO_RETURN         (3)
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static T_DJIPerceptionLidarPoint DjiLidarBenchmark_TracePoint(uint64_t pointIndex, uint32_t &seed);
+static bool DjiLidarBenchmark_LoadPcdFile(const std::string &filePath, uint32_t frameCnt,
+                                          T_DjiLidarBenchmarkFrame &frame);
+
+/* Exported functions definition ---------------------------------------------*/
+void DjiLidarBenchmark_MakeSyntheticFrames(uint32_t frameCount, uint16_t pkgNum,
+                                           std::vector<T_DjiLidarBenchmarkFrame> &frames)
+{
+    uint64_t frameIntervalNs = 1000000000ULL / DJI_LIDAR_BENCHMARK_FRAME_RATE_DEFAULT;
+    uint64_t pkgIntervalNs;
+    uint32_t seed = 0x9E3779B9;
+    uint64_t pointIndex = 0;
+
+    pkgNum = std::min<uint16_t>(std::max<uint16_t>(pkgNum, 1), DJI_LIDAR_PKG_BUFFER_NUM);
+    pkgIntervalNs = frameIntervalNs / pkgNum;
+
+    frames.resize(frameCount);
+    for (uint32_t i = 0; i < frameCount; i++) {
+        T_DjiLidarBenchmarkFrame &frame = frames[i];
+
+        frame.timeStampNs = i * frameIntervalNs;
+        frame.frameCnt = i;
+        frame.pkgs.resize(pkgNum);
+        for (uint16_t j = 0; j < pkgNum; j++) {
+            T_DjiPerceptionLidarDecodePkg &pkg = frame.pkgs[j];
+
+            memset(&pkg.header, 0, sizeof(pkg.header));
+            pkg.header.timeInterval = (uint16_t) (pkgIntervalNs / 100);
+            pkg.header.dotNum = DJI_PTS_NUM_PER_PKG;
+            pkg.header.dataType = 1;
+            pkg.header.timeStamp = frame.timeStampNs + j * pkgIntervalNs;
+            for (uint32_t k = 0; k < DJI_PTS_NUM_PER_PKG; k++) {
+                pkg.points[k] = DjiLidarBenchmark_TracePoint(pointIndex++, seed);
+            }
+        }
+    }
+}
+
+bool DjiLidarBenchmark_LoadPcdFrames(const char *folderPath, std::vector<T_DjiLidarBenchmarkFrame> &frames)
+{
+    std::vector<std::string> fileNames;
+    struct dirent *entry;
+    DIR *dir;
+
+    dir = opendir(folderPath);
+    if (dir == nullptr) {
+        return false;
+    }
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+
+        if (name.size() > 4 && name.compare(name.size() - 4, 4, ".pcd") == 0) {
+            fileNames.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(fileNames.begin(), fileNames.end());
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        T_DjiLidarBenchmarkFrame frame;
+
+        if (DjiLidarBenchmark_LoadPcdFile(std::string(folderPath) + "/" + fileNames[i], (uint32_t) frames.size(),
+                                          frame)) {
+            frames.push_back(frame);
+        }
+    }
+
+    return !frames.empty();
+}
+
+T_DjiLidarFrameView DjiLidarBenchmark_GetFrameView(const T_DjiLidarBenchmarkFrame &frame)
+{
+    T_DjiLidarFrameView view = {};
+
+    view.timeStampNs = frame.timeStampNs;
+    view.frameCnt = frame.frameCnt;
+    view.pkgNum = (uint16_t) frame.pkgs.size();
+    view.pkgs = frame.pkgs.data();
+
+    return view;
+}
+
+uint32_t DjiLidarBenchmark_GetPointCount(const T_DjiLidarBenchmarkFrame &frame)
+{
+    uint32_t pointCount = 0;
+
+    for (size_t i = 0; i < frame.pkgs.size(); i++) {
+        pointCount += std::min<uint32_t>(frame.pkgs[i].header.dotNum, DJI_PTS_NUM_PER_PKG);
+    }
+
+    return pointCount;
+}
+
+double DjiLidarBenchmark_GetTimeMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec * 1000 + (double) ts.tv_nsec / 1000000;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_DJIPerceptionLidarPoint DjiLidarBenchmark_TracePoint(uint64_t pointIndex, uint32_t &seed)
+{
+    T_DJIPerceptionLidarPoint point = {};
+    double turn = (double) pointIndex * LIDAR_BENCHMARK_SCAN_STEP;
+    float offAxis = (float) (LIDAR_BENCHMARK_HALF_FOV * sin(LIDAR_BENCHMARK_PETAL_COUNT * turn));
+    float dirX = cosf(offAxis);
+    float dirY = sinf(offAxis) * (float) cos(turn);
+    float dirZ = sinf(offAxis) * (float) sin(turn);
+    float worldX = dirX * cosf(LIDAR_BENCHMARK_TILT) + dirZ * sinf(LIDAR_BENCHMARK_TILT);
+    float worldZ = dirZ * cosf(LIDAR_BENCHMARK_TILT) - dirX * sinf(LIDAR_BENCHMARK_TILT);
+    float range = LIDAR_BENCHMARK_RANGE_MAX + 1;
+    uint8_t intensity = 0;
+
+    if (worldZ < 0) {
+        float groundRange = LIDAR_BENCHMARK_SENSOR_HEIGHT / -worldZ;
+        float groundX = groundRange * worldX;
+        float groundY = groundRange * dirY;
+
+        range = groundRange;
+        // Painted tiles of one metre, so the intensity changes along the scan as on a real surface
+        intensity = (((int) floorf(groundX) + (int) floorf(groundY)) & 1) ? 70 : 30;
+    }
+    if (worldX > 0) {
+        float wallRange = LIDAR_BENCHMARK_WALL_DISTANCE / worldX;
+
+        if (wallRange < range && wallRange * worldZ < LIDAR_BENCHMARK_WALL_HEIGHT - LIDAR_BENCHMARK_SENSOR_HEIGHT) {
+            range = wallRange;
+            intensity = 150;
+        }
+    }
+
+    if (range > LIDAR_BENCHMARK_RANGE_MAX) {
+        point.label = LIDAR_BENCHMARK_LABEL_NO_RETURN;
+        return point;
+    }
+
+    seed = seed * 1664525 + 1013904223;
+    range += LIDAR_BENCHMARK_RANGE_NOISE * ((float) (seed >> 8) / (1 << 24) * 2 - 1);
+    point.x = range * dirX;
+    point.y = range * dirY;
+    point.z = range * dirZ;
+    point.intensity = intensity;
+
+    return point;
+}
+
+static bool DjiLidarBenchmark_LoadPcdFile(const std::string &filePath, uint32_t frameCnt,
+                                          T_DjiLidarBenchmarkFrame &frame)
+{
+    char line[128];
+    uint32_t pointCount = 0;
+    bool isBinary = false;
+    bool isLayoutKnown = false;
+    FILE *file;
+
+    file = fopen(filePath.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    for (int i = 0; i < LIDAR_BENCHMARK_PCD_HEADER_LINE_MAX && fgets(line, sizeof(line), file) != nullptr; i++) {
+        if (strcmp(line, "FIELDS x y z intensity label\n") == 0) {
+            isLayoutKnown = true;
+        } else if (strncmp(line, "POINTS ", 7) == 0) {
+            sscanf(line + 7, "%u", &pointCount);
+        } else if (strncmp(line, "DATA ", 5) == 0) {
+            isBinary = strcmp(line, "DATA binary\n") == 0;
+            break;
+        }
+    }
+
+    // Only the layout the lidar sample writes, binary_compressed files have to be converted first
+    if (!isBinary || !isLayoutKnown || pointCount == 0) {
+        fclose(file);
+        return false;
+    }
+
+    pointCount = std::min<uint32_t>(pointCount, LIDAR_BENCHMARK_POINT_NUM_MAX);
+    frame.timeStampNs = (uint64_t) frameCnt * (1000000000ULL / DJI_LIDAR_BENCHMARK_FRAME_RATE_DEFAULT);
+    frame.frameCnt = frameCnt;
+    frame.pkgs.resize((pointCount + DJI_PTS_NUM_PER_PKG - 1) / DJI_PTS_NUM_PER_PKG);
+    for (size_t i = 0; i < frame.pkgs.size(); i++) {
+        T_DjiPerceptionLidarDecodePkg &pkg = frame.pkgs[i];
+        uint32_t dotNum = std::min<uint32_t>(pointCount - i * DJI_PTS_NUM_PER_PKG, DJI_PTS_NUM_PER_PKG);
+
+        memset(&pkg.header, 0, sizeof(pkg.header));
+        pkg.header.dotNum = (uint16_t) dotNum;
+        pkg.header.dataType = 1;
+        pkg.header.timeStamp = frame.timeStampNs;
+        if (fread(pkg.points, sizeof(T_DJIPerceptionLidarPoint), dotNum, file) != dotNum) {
+            fclose(file);
+            return false;
+        }
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+#endif
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,70 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_benchmark_frames.hpp
+ * @brief   This is the header file for "dji_lidar_benchmark_frames.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIDAR_BENCHMARK_FRAMES_H
+#define DJI_LIDAR_BENCHMARK_FRAMES_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <cstdint>
+#include <vector>
+#include "perception/dji_lidar_frame_pool.hpp"
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_LIDAR_BENCHMARK_FRAME_RATE_DEFAULT     (10)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint64_t timeStampNs;
+    uint32_t frameCnt;
+    std::vector<T_DjiPerceptionLidarDecodePkg> pkgs;
+} T_DjiLidarBenchmarkFrame;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Generate frames of a rosette scan over flat ground and a wall with range noise, so that neighbouring points
+ * are close to each other as in a real scan. The frames are the same for every run.
+ * @param frameCount: number of frames, each one starting where the scan of the previous frame ended.
+ * @param pkgNum: decode packages per frame, DJI_LIDAR_PKG_BUFFER_NUM for the largest frame.
+ * @param frames: generated frames.
+ */
+void DjiLidarBenchmark_MakeSyntheticFrames(uint32_t frameCount, uint16_t pkgNum,
+                                           std::vector<T_DjiLidarBenchmarkFrame> &frames);
+
+/**
+ * @brief Load the binary PCD files of a folder, as recorded by the lidar sample, in file name order.
+ * @note Files in another format and points beyond the largest frame are skipped.
+ * @return false when no frame was loaded.
+ */
+bool DjiLidarBenchmark_LoadPcdFrames(const char *folderPath, std::vector<T_DjiLidarBenchmarkFrame> &frames);
+
+T_DjiLidarFrameView DjiLidarBenchmark_GetFrameView(const T_DjiLidarBenchmarkFrame &frame);
+
+uint32_t DjiLidarBenchmark_GetPointCount(const T_DjiLidarBenchmarkFrame &frame);
+
+double DjiLidarBenchmark_GetTimeMs(void);
+
+#endif // DJI_LIDAR_BENCHMARK_FRAMES_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,214 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_cloud_reducer_benchmark.cpp
+ * @brief   Throughput and compression ratio of DJILidarCloudFilter and DJILidarCloudCodec on lidar frames.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* The benchmark has its own main, it is only compiled by the benchmark target of the platform CMakeLists. */
+#ifdef DJI_SAMPLE_BENCHMARK
+
+/* Includes ------------------------------------------------------------------*/
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "dji_lidar_benchmark_frames.hpp"
+#include "perception/dji_lidar_cloud_reducer.hpp"
+
+/* Private constants ---------------------------------------------------------*/
+#define REDUCER_BENCHMARK_VOXEL_SIZE_DEFAULT    (0.1f)      // unit: m
+#define REDUCER_BENCHMARK_PRECISION_DEFAULT     (0.001f)    // unit: m
+#define REDUCER_BENCHMARK_RANGE_MAX             (100.0f)    // unit: m
+// Synthetic frames of 250 packages hold 24000 points, about what the lidar sends in a frame
+#define REDUCER_BENCHMARK_SYNTHETIC_FRAME_COUNT (20)
+#define REDUCER_BENCHMARK_SYNTHETIC_PKG_NUM     (250)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    const char *name;
+    uint64_t inputPointCount;
+    uint64_t outputPointCount;
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+    double encodeMs;
+    double decodeMs;
+    double maxError;
+    uint32_t mismatchCount;     /*!< Frames that did not decode, or in lossless mode not bit exact. */
+} T_ReducerBenchmarkResult;
+
+/* Private values -------------------------------------------------------------*/
+static T_DJIPerceptionLidarPoint s_filteredPoints[DJI_LIDAR_CLOUD_POINT_NUM_MAX];
+static T_DJIPerceptionLidarPoint s_framePoints[DJI_LIDAR_CLOUD_POINT_NUM_MAX];
+static T_DJIPerceptionLidarPoint s_decodedPoints[DJI_LIDAR_CLOUD_POINT_NUM_MAX];
+
+/* Private functions declaration ---------------------------------------------*/
+static void ReducerBenchmark_RunCodec(const std::vector<T_DjiLidarBenchmarkFrame> &frames, DJILidarCloudFilter *filter,
+                                      E_DjiLidarCloudCodecMode mode, float precision,
+                                      T_ReducerBenchmarkResult &result);
+static void ReducerBenchmark_PrintResult(const T_ReducerBenchmarkResult &result);
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_DjiLidarCloudFilterConfig filterConfig = {};
+    T_DjiLidarCloudReducerStatistics filterStatistics;
+    T_ReducerBenchmarkResult results[3] = {};
+    std::vector<T_DjiLidarBenchmarkFrame> frames;
+    float precision = REDUCER_BENCHMARK_PRECISION_DEFAULT;
+    uint32_t mismatchCount = 0;
+
+    if (argc != 1 && argc != 3 && argc != 4) {
+        printf("usage: %s [voxelSize precision [recorded pcd folder]]\n", argv[0]);
+        printf("  voxelSize and precision in m, recorded frames replace the synthetic 24000 point frames\n");
+        return -1;
+    }
+
+    filterConfig.maxRange = REDUCER_BENCHMARK_RANGE_MAX;
+    filterConfig.isNoiseDropped = true;
+    filterConfig.voxelSize = REDUCER_BENCHMARK_VOXEL_SIZE_DEFAULT;
+    if (argc >= 3) {
+        filterConfig.voxelSize = strtof(argv[1], nullptr);
+        precision = strtof(argv[2], nullptr);
+    }
+
+    if (argc == 4) {
+        if (!DjiLidarBenchmark_LoadPcdFrames(argv[3], frames)) {
+            printf("no binary pcd frames found in %s\n", argv[3]);
+            return -1;
+        }
+    } else {
+        DjiLidarBenchmark_MakeSyntheticFrames(REDUCER_BENCHMARK_SYNTHETIC_FRAME_COUNT,
+                                              REDUCER_BENCHMARK_SYNTHETIC_PKG_NUM, frames);
+    }
+
+    DJILidarCloudFilter filter(filterConfig);
+    for (size_t i = 0; i < frames.size(); i++) {
+        filter.apply(frames[i].pkgs.data(), (uint16_t) frames[i].pkgs.size(), s_filteredPoints,
+                     DJI_LIDAR_CLOUD_POINT_NUM_MAX);
+    }
+    filter.getStatistics(filterStatistics);
+
+    results[0].name = "lossless";
+    ReducerBenchmark_RunCodec(frames, nullptr, DJI_LIDAR_CLOUD_CODEC_MODE_LOSSLESS, precision, results[0]);
+    results[1].name = "quantized";
+    ReducerBenchmark_RunCodec(frames, nullptr, DJI_LIDAR_CLOUD_CODEC_MODE_QUANTIZED, precision, results[1]);
+    results[2].name = "voxel+quant";
+    ReducerBenchmark_RunCodec(frames, &filter, DJI_LIDAR_CLOUD_CODEC_MODE_QUANTIZED, precision, results[2]);
+
+    printf("frames: %zu, %.0f points avg, voxel %.3f m, precision %.4f m\n", frames.size(),
+           (double) filterStatistics.inputPointCount / frames.size(), filterConfig.voxelSize, precision);
+    printf("filter: %llu -> %llu points, %.1f Mpt/s\n", (unsigned long long) filterStatistics.inputPointCount,
+           (unsigned long long) filterStatistics.outputPointCount,
+           filterStatistics.totalTimeMs > 0 ? filterStatistics.inputPointCount / 1e3 / filterStatistics.totalTimeMs
+                                            : 0.0);
+    for (int i = 0; i < 3; i++) {
+        ReducerBenchmark_PrintResult(results[i]);
+        mismatchCount += results[i].mismatchCount;
+    }
+
+    return mismatchCount == 0 ? 0 : -1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void ReducerBenchmark_RunCodec(const std::vector<T_DjiLidarBenchmarkFrame> &frames, DJILidarCloudFilter *filter,
+                                      E_DjiLidarCloudCodecMode mode, float precision,
+                                      T_ReducerBenchmarkResult &result)
+{
+    DJILidarCloudCodec codec(mode, precision);
+    std::vector<uint8_t> encoded(DJILidarCloudCodec::getMaxEncodedSize(DJI_LIDAR_CLOUD_POINT_NUM_MAX));
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        const T_DjiLidarBenchmarkFrame &frame = frames[i];
+        uint32_t inputCount = DjiLidarBenchmark_GetPointCount(frame);
+        uint32_t pointCount = 0;
+        uint32_t decodedCount = 0;
+        size_t encodedSize;
+        double startMs;
+
+        // The reference the decoded points are compared with, either the filtered points or the frame as it is
+        if (filter != nullptr) {
+            pointCount = filter->apply(frame.pkgs.data(), (uint16_t) frame.pkgs.size(), s_framePoints,
+                                       DJI_LIDAR_CLOUD_POINT_NUM_MAX);
+        } else {
+            for (size_t j = 0; j < frame.pkgs.size(); j++) {
+                uint32_t dotNum = std::min<uint32_t>(frame.pkgs[j].header.dotNum, DJI_PTS_NUM_PER_PKG);
+
+                memcpy(&s_framePoints[pointCount], frame.pkgs[j].points, dotNum * sizeof(T_DJIPerceptionLidarPoint));
+                pointCount += dotNum;
+            }
+        }
+
+        startMs = DjiLidarBenchmark_GetTimeMs();
+        if (filter != nullptr) {
+            encodedSize = codec.encode(s_framePoints, pointCount, encoded.data(), encoded.size());
+        } else {
+            encodedSize = codec.encode(frame.pkgs.data(), (uint16_t) frame.pkgs.size(), encoded.data(),
+                                       encoded.size());
+        }
+        result.encodeMs += DjiLidarBenchmark_GetTimeMs() - startMs;
+
+        startMs = DjiLidarBenchmark_GetTimeMs();
+        if (encodedSize == 0 || !codec.decode(encoded.data(), encodedSize, s_decodedPoints,
+                                              DJI_LIDAR_CLOUD_POINT_NUM_MAX, decodedCount) ||
+            decodedCount != pointCount) {
+            result.mismatchCount++;
+            continue;
+        }
+        result.decodeMs += DjiLidarBenchmark_GetTimeMs() - startMs;
+
+        if (mode == DJI_LIDAR_CLOUD_CODEC_MODE_LOSSLESS &&
+            memcmp(s_decodedPoints, s_framePoints, pointCount * sizeof(T_DJIPerceptionLidarPoint)) != 0) {
+            result.mismatchCount++;
+        }
+        for (uint32_t j = 0; j < pointCount; j++) {
+            double error = std::max(std::max(fabs((double) s_decodedPoints[j].x - s_framePoints[j].x),
+                                             fabs((double) s_decodedPoints[j].y - s_framePoints[j].y)),
+                                    fabs((double) s_decodedPoints[j].z - s_framePoints[j].z));
+
+            if (error > result.maxError) {
+                result.maxError = error;
+            }
+        }
+
+        // Sizes are counted against the frame as the lidar sent it, the filter is part of the reduction
+        result.inputPointCount += inputCount;
+        result.outputPointCount += pointCount;
+        result.inputBytes += (uint64_t) inputCount * sizeof(T_DJIPerceptionLidarPoint);
+        result.outputBytes += encodedSize;
+    }
+}
+
+static void ReducerBenchmark_PrintResult(const T_ReducerBenchmarkResult &result)
+{
+    printf("%-12s %9llu -> %8llu bytes (%5.2fx), %7llu points coded, encode %.2f Mpt/s, decode %.2f Mpt/s, "
+           "max error %.6f m, %u mismatches\n",
+           result.name, (unsigned long long) result.inputBytes, (unsigned long long) result.outputBytes,
+           result.outputBytes ? (double) result.inputBytes / result.outputBytes : 0.0,
+           (unsigned long long) result.outputPointCount,
+           result.encodeMs > 0 ? result.outputPointCount / 1e3 / result.encodeMs : 0.0,
+           result.decodeMs > 0 ? result.outputPointCount / 1e3 / result.decodeMs : 0.0, result.maxError,
+           result.mismatchCount);
+}
+
+#endif
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,171 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_cloud_writer_benchmark.cpp
+ * @brief   Sustained recording of lidar frames at the lidar frame rate with DJILidarCloudWriter.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* The benchmark has its own main, it is only compiled by the benchmark target of the platform CMakeLists. */
+#ifdef DJI_SAMPLE_BENCHMARK
+
+/* Includes ------------------------------------------------------------------*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "dji_lidar_benchmark_frames.hpp"
+#include "perception/dji_lidar_cloud_writer.hpp"
+
+/* Private constants ---------------------------------------------------------*/
+#define WRITER_BENCHMARK_DURATION_S_DEFAULT     (30)
+// Distinct synthetic frames, written over and over for the whole run
+#define WRITER_BENCHMARK_SYNTHETIC_FRAME_COUNT  (20)
+#define WRITER_BENCHMARK_FILE_PREFIX            "benchmark"
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static bool WriterBenchmark_ParseFormat(const char *name, E_DjiLidarCloudFormat &format);
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_DjiLidarCloudWriterConfig config = {};
+    T_DjiLidarCloudWriterStatistics statistics;
+    std::vector<T_DjiLidarBenchmarkFrame> frames;
+    uint32_t frameRate = DJI_LIDAR_BENCHMARK_FRAME_RATE_DEFAULT;
+    uint32_t durationS = WRITER_BENCHMARK_DURATION_S_DEFAULT;
+    uint32_t frameCount;
+    uint32_t lateFrameCount = 0;
+    double callerTotalMs = 0;
+    double callerMaxMs = 0;
+    double startMs;
+    double elapsedMs;
+
+    if (argc < 2 || argc > 7 || argc == 3 || argc == 5) {
+        printf("usage: %s <output folder> [format container [frameRate durationS [recorded pcd folder]]]\n", argv[0]);
+        printf("  format: pcd, pcdc (binary_compressed) or ply, container: 1 appends every frame to one .dcl file\n");
+        printf("  frameRate: 0 writes as fast as possible, recorded frames replace the synthetic full size frames\n");
+        return -1;
+    }
+
+    config.folderPath = argv[1];
+    config.filePrefix = WRITER_BENCHMARK_FILE_PREFIX;
+    config.format = DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY;
+    if (argc >= 4) {
+        if (!WriterBenchmark_ParseFormat(argv[2], config.format)) {
+            printf("unknown format %s\n", argv[2]);
+            return -1;
+        }
+        config.isContainer = atoi(argv[3]) != 0;
+    }
+    if (argc >= 6) {
+        frameRate = (uint32_t) strtoul(argv[4], nullptr, 0);
+        durationS = (uint32_t) strtoul(argv[5], nullptr, 0);
+    }
+
+    if (argc == 7) {
+        if (!DjiLidarBenchmark_LoadPcdFrames(argv[6], frames)) {
+            printf("no binary pcd frames found in %s\n", argv[6]);
+            return -1;
+        }
+    } else {
+        DjiLidarBenchmark_MakeSyntheticFrames(WRITER_BENCHMARK_SYNTHETIC_FRAME_COUNT, DJI_LIDAR_PKG_BUFFER_NUM, frames);
+    }
+
+    DJILidarCloudWriter writer(config);
+    if (!writer.start()) {
+        printf("start writer in %s failed\n", argv[1]);
+        return -1;
+    }
+
+    // Without a frame rate the run lasts as many frames as the lidar would send in the duration
+    frameCount = durationS * (frameRate != 0 ? frameRate : DJI_LIDAR_BENCHMARK_FRAME_RATE_DEFAULT);
+    startMs = DjiLidarBenchmark_GetTimeMs();
+    for (uint32_t i = 0; i < frameCount; i++) {
+        T_DjiLidarFrameView view = DjiLidarBenchmark_GetFrameView(frames[i % frames.size()]);
+        double frameStartMs = DjiLidarBenchmark_GetTimeMs();
+        double costMs;
+
+        view.frameCnt = i;
+        writer.writeFrame(view);
+
+        costMs = DjiLidarBenchmark_GetTimeMs() - frameStartMs;
+        callerTotalMs += costMs;
+        if (costMs > callerMaxMs) {
+            callerMaxMs = costMs;
+        }
+
+        if (frameRate != 0) {
+            double nextFrameMs = startMs + (double) (i + 1) * 1000 / frameRate;
+            double waitMs = nextFrameMs - DjiLidarBenchmark_GetTimeMs();
+
+            if (waitMs > 0) {
+                usleep((useconds_t) (waitMs * 1000));
+            } else {
+                lateFrameCount++;
+            }
+        }
+    }
+
+    // Stopping writes out the buffered frames, so the elapsed time covers every byte reaching the disk
+    writer.stop();
+    elapsedMs = DjiLidarBenchmark_GetTimeMs() - startMs;
+    writer.getStatistics(statistics);
+
+    printf("frames: %u of %u points avg, %u fps target, %s%s\n", frameCount,
+           (uint32_t) (statistics.frameCount ? statistics.pointCount / statistics.frameCount : 0), frameRate,
+           argc >= 4 ? argv[2] : "pcd", config.isContainer ? " in a container" : "");
+    printf("caller: avg %.3f ms, max %.3f ms per frame, %u frames late\n", callerTotalMs / frameCount, callerMaxMs,
+           lateFrameCount);
+    printf("writer: %.1f MB raw, %.1f MB written (%.2fx), %u files, %u write errors\n", statistics.rawBytes / 1e6,
+           statistics.writtenBytes / 1e6,
+           statistics.writtenBytes ? (double) statistics.rawBytes / statistics.writtenBytes : 0.0,
+           statistics.fileCount, statistics.writeErrorCount);
+    printf("io: max write %.1f ms, %u buffer waits, max wait %.1f ms\n", statistics.maxWriteMs,
+           statistics.bufferWaitCount, statistics.maxBufferWaitMs);
+    printf("throughput: %.1f MB/s written, %.2f Mpt/s, %.1f fps over %.1f s\n",
+           statistics.writtenBytes / 1e3 / elapsedMs, statistics.pointCount / 1e3 / elapsedMs,
+           frameCount * 1000.0 / elapsedMs, elapsedMs / 1000);
+
+    return statistics.writeErrorCount == 0 && statistics.frameCount == frameCount ? 0 : -1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static bool WriterBenchmark_ParseFormat(const char *name, E_DjiLidarCloudFormat &format)
+{
+    if (strcmp(name, "pcd") == 0) {
+        format = DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY;
+    } else if (strcmp(name, "pcdc") == 0) {
+        format = DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY_COMPRESSED;
+    } else if (strcmp(name, "ply") == 0) {
+        format = DJI_LIDAR_CLOUD_FORMAT_PLY_BINARY;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
+#endif
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,445 @@
+/**
+ ********************************************************************
+ * @file    dji_stereo_depth_pipeline_benchmark.cpp
+ * @brief   Depth rate per direction of DJIStereoDepthPipeline, fed with stereo pairs at the camera rate.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* The benchmark has its own main, it is only compiled by the benchmark target of the platform CMakeLists. */
+#ifdef DJI_SAMPLE_BENCHMARK
+
+/* Includes ------------------------------------------------------------------*/
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <dirent.h>
+#include <string>
+#include <unistd.h>
+#include "perception/dji_stereo_depth_pipeline.hpp"
+
+/* Private constants ---------------------------------------------------------*/
+#define STEREO_DEPTH_BENCHMARK_FEED_RATE_DEFAULT    (20)        // unit: Hz
+#define STEREO_DEPTH_BENCHMARK_DURATION_S_DEFAULT   (5)
+#define STEREO_DEPTH_BENCHMARK_PARAMETERS_FILE      "camera_parameters.bin"
+// Synthetic scene: each direction looks at a textured plane through a slightly misaligned camera pair
+#define STEREO_DEPTH_BENCHMARK_WIDTH                (640)
+#define STEREO_DEPTH_BENCHMARK_HEIGHT               (480)
+#define STEREO_DEPTH_BENCHMARK_FOCAL                (400.0f)    // unit: pixel
+#define STEREO_DEPTH_BENCHMARK_BASELINE             (0.1)       // unit: m
+#define STEREO_DEPTH_BENCHMARK_FINE_TEXTURE         (60.0)      // noise cells per metre
+#define STEREO_DEPTH_BENCHMARK_COARSE_TEXTURE       (13.0)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    std::vector<std::vector<uint8_t> > lefts;
+    std::vector<std::vector<uint8_t> > rights;
+    float planeDepth;                   /*!< Synthetic scene only, depth of the plane in front of the pair. */
+    bool isChecked;                     /*!< Set by the callback once the first result was compared with the plane. */
+    float validRatio;
+    float medianError;                  /*!< Relative to the plane depth. */
+} T_StereoDepthBenchmarkDirection;
+
+/* Private values -------------------------------------------------------------*/
+static const char *s_directionNames[DJI_STEREO_DEPTH_DIRECTION_NUM] = {"down", "front", "rear", "up", "left", "right"};
+static const float s_planeDepths[DJI_STEREO_DEPTH_DIRECTION_NUM] = {2, 3, 5, 8, 4, 6};
+static T_StereoDepthBenchmarkDirection s_directions[DJI_STEREO_DEPTH_DIRECTION_NUM];
+static bool s_isSynthetic = true;
+
+/* Private functions declaration ---------------------------------------------*/
+static void StereoDepthBenchmark_MakeSyntheticScene(T_DjiPerceptionCameraParametersPacket &packet);
+static void StereoDepthBenchmark_RenderPlane(const double *rotation, const double *translation, float planeDepth,
+                                             uint8_t *left, uint8_t *right);
+static double StereoDepthBenchmark_GetTexture(double x, double y);
+static double StereoDepthBenchmark_GetNoise(double x, double y);
+static bool StereoDepthBenchmark_LoadRecording(const char *folderPath, T_DjiPerceptionCameraParametersPacket &packet);
+static bool StereoDepthBenchmark_LoadPgm(const std::string &filePath, std::vector<uint8_t> &image, uint32_t &width,
+                                         uint32_t &height);
+static void StereoDepthBenchmark_Callback(const T_DjiStereoDepthResult *result, void *userData);
+static double StereoDepthBenchmark_GetTimeMs(void);
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_DjiPerceptionCameraParametersPacket packet = {};
+    T_DjiStereoDepthConfig config = {};
+    T_DjiPerceptionImageInfo info = {};
+    uint32_t directionCount = DJI_STEREO_DEPTH_DIRECTION_NUM;
+    uint32_t feedRate = STEREO_DEPTH_BENCHMARK_FEED_RATE_DEFAULT;
+    uint32_t durationS = STEREO_DEPTH_BENCHMARK_DURATION_S_DEFAULT;
+    uint32_t tickCount;
+    uint32_t lateTickCount = 0;
+    uint32_t activeCount = 0;
+    double startMs;
+    double elapsedMs;
+
+    if (argc != 1 && argc != 5 && argc != 6) {
+        printf("usage: %s [workerCount directionCount feedRateHz durationS [recorded folder]]\n", argv[0]);
+        printf("  workerCount: 0 runs one worker per online CPU, directionCount: directions fed, from down to right\n");
+        printf("  recorded folder: %s with the camera parameters packet as the SDK returns it,\n",
+               STEREO_DEPTH_BENCHMARK_PARAMETERS_FILE);
+        printf("  and 8 bit binary PGM pairs named <direction>_<sequence>_left.pgm and _right.pgm\n");
+        return -1;
+    }
+
+    if (argc >= 5) {
+        config.workerCount = (uint32_t) strtoul(argv[1], nullptr, 0);
+        directionCount = std::min<uint32_t>((uint32_t) strtoul(argv[2], nullptr, 0), DJI_STEREO_DEPTH_DIRECTION_NUM);
+        feedRate = std::max<uint32_t>((uint32_t) strtoul(argv[3], nullptr, 0), 1);
+        durationS = (uint32_t) strtoul(argv[4], nullptr, 0);
+    }
+
+    if (argc == 6) {
+        s_isSynthetic = false;
+        if (!StereoDepthBenchmark_LoadRecording(argv[5], packet)) {
+            printf("no camera parameters or stereo pairs found in %s\n", argv[5]);
+            return -1;
+        }
+    } else {
+        StereoDepthBenchmark_MakeSyntheticScene(packet);
+    }
+
+    config.uniquenessRatio = DJI_STEREO_DEPTH_UNIQUENESS_RATIO_DEFAULT;
+    config.output = DJI_STEREO_DEPTH_OUTPUT_DEPTH_IMAGE;
+    config.dropPolicy = DJI_STEREO_DEPTH_DROP_OLDEST;
+    config.callback = StereoDepthBenchmark_Callback;
+
+    DJIStereoDepthPipeline pipeline(config);
+    if (!pipeline.setCameraParameters(packet) || !pipeline.start()) {
+        printf("start pipeline failed\n");
+        return -1;
+    }
+
+    // One thread feeds every direction, as the perception image callback does
+    tickCount = durationS * feedRate;
+    startMs = StereoDepthBenchmark_GetTimeMs();
+    for (uint32_t i = 0; i < tickCount; i++) {
+        double nextTickMs;
+        double waitMs;
+
+        info.sequence = (uint16_t) i;
+        info.timeStamp = (uint64_t) i * 1000 / feedRate;
+        for (uint32_t j = 0; j < directionCount; j++) {
+            const T_StereoDepthBenchmarkDirection &direction = s_directions[j];
+
+            if (direction.lefts.empty()) {
+                continue;
+            }
+            pipeline.submitPair((E_DjiPerceptionDirection) j, info, direction.lefts[i % direction.lefts.size()].data(),
+                                direction.rights[i % direction.rights.size()].data(), direction.width,
+                                direction.height);
+        }
+
+        nextTickMs = startMs + (double) (i + 1) * 1000 / feedRate;
+        waitMs = nextTickMs - StereoDepthBenchmark_GetTimeMs();
+        if (waitMs > 0) {
+            usleep((useconds_t) (waitMs * 1000));
+        } else {
+            lateTickCount++;
+        }
+    }
+    elapsedMs = StereoDepthBenchmark_GetTimeMs() - startMs;
+    pipeline.stop();
+
+    printf("%u directions fed at %u Hz for %.1f s, %u feed ticks late\n", directionCount, feedRate, elapsedMs / 1000,
+           lateTickCount);
+    for (uint32_t i = 0; i < directionCount; i++) {
+        const T_StereoDepthBenchmarkDirection &direction = s_directions[i];
+        T_DjiStereoDepthStatistics statistics;
+
+        if (direction.lefts.empty()) {
+            continue;
+        }
+        pipeline.getStatistics((E_DjiPerceptionDirection) i, statistics);
+        if (statistics.processedCount > 0) {
+            activeCount++;
+        }
+
+        printf("[%-5s] %5.1f Hz, avg %.1f ms, max %.1f ms, max latency %.1f ms, received %u, dropped busy %u, "
+               "dropped budget %u", s_directionNames[i], statistics.processedCount * 1000.0 / elapsedMs,
+               statistics.processedCount ? statistics.totalProcessMs / statistics.processedCount : 0.0,
+               statistics.maxProcessMs, statistics.maxLatencyMs, statistics.receivedCount,
+               statistics.droppedBusyCount, statistics.droppedBudgetCount);
+        if (s_isSynthetic && direction.isChecked) {
+            printf(", plane at %.0f m: %.1f%% valid, median error %.2f%%", direction.planeDepth,
+                   direction.validRatio * 100, direction.medianError * 100);
+        }
+        printf("\n");
+    }
+
+    return activeCount > 0 ? 0 : -1;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void StereoDepthBenchmark_MakeSyntheticScene(T_DjiPerceptionCameraParametersPacket &packet)
+{
+    const float intrinsics[9] = {
+        STEREO_DEPTH_BENCHMARK_FOCAL, 0, STEREO_DEPTH_BENCHMARK_WIDTH / 2,
+        0, STEREO_DEPTH_BENCHMARK_FOCAL, STEREO_DEPTH_BENCHMARK_HEIGHT / 2,
+        0, 0, 1,
+    };
+
+    packet.directionNum = DJI_STEREO_DEPTH_DIRECTION_NUM;
+    for (uint32_t i = 0; i < DJI_STEREO_DEPTH_DIRECTION_NUM; i++) {
+        T_DjiPerceptionCameraParameters &parameters = packet.cameraParameters[i];
+        T_StereoDepthBenchmarkDirection &direction = s_directions[i];
+        // Every pair is misaligned a little differently, so the rectification has real work to do
+        double rotationVector[3] = {0.004 * i, 0.01 * (i % 3) - 0.01, 0.003 * i};
+        double translation[3] = {-STEREO_DEPTH_BENCHMARK_BASELINE, 0.002 * i, -0.001 * i};
+        double rotation[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+        double angle = sqrt(rotationVector[0] * rotationVector[0] + rotationVector[1] * rotationVector[1] +
+                            rotationVector[2] * rotationVector[2]);
+
+        if (angle > 0) {
+            double axis[3] = {rotationVector[0] / angle, rotationVector[1] / angle, rotationVector[2] / angle};
+            double cosAngle = cos(angle);
+            double sinAngle = sin(angle);
+
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 3; col++) {
+                    rotation[row * 3 + col] = (1 - cosAngle) * axis[row] * axis[col] + (row == col ? cosAngle : 0);
+                }
+            }
+            rotation[1] -= sinAngle * axis[2];
+            rotation[2] += sinAngle * axis[1];
+            rotation[3] += sinAngle * axis[2];
+            rotation[5] -= sinAngle * axis[0];
+            rotation[6] -= sinAngle * axis[1];
+            rotation[7] += sinAngle * axis[0];
+        }
+
+        parameters.direction = (uint8_t) i;
+        memcpy(parameters.leftIntrinsics, intrinsics, sizeof(intrinsics));
+        memcpy(parameters.rightIntrinsics, intrinsics, sizeof(intrinsics));
+        for (int j = 0; j < 9; j++) {
+            parameters.rotationLeftInRight[j] = (float) rotation[j];
+        }
+        for (int j = 0; j < 3; j++) {
+            parameters.translationLeftInRight[j] = (float) translation[j];
+        }
+
+        direction.width = STEREO_DEPTH_BENCHMARK_WIDTH;
+        direction.height = STEREO_DEPTH_BENCHMARK_HEIGHT;
+        direction.planeDepth = s_planeDepths[i];
+        direction.lefts.assign(1, std::vector<uint8_t>(direction.width * direction.height));
+        direction.rights.assign(1, std::vector<uint8_t>(direction.width * direction.height));
+        StereoDepthBenchmark_RenderPlane(rotation, translation, direction.planeDepth, direction.lefts[0].data(),
+                                         direction.rights[0].data());
+    }
+}
+
+static void StereoDepthBenchmark_RenderPlane(const double *rotation, const double *translation, float planeDepth,
+                                             uint8_t *left, uint8_t *right)
+{
+    double rightCenter[3];
+
+    // Centre of the right camera in the left camera frame
+    for (int i = 0; i < 3; i++) {
+        rightCenter[i] = -(rotation[0 * 3 + i] * translation[0] + rotation[1 * 3 + i] * translation[1] +
+                           rotation[2 * 3 + i] * translation[2]);
+    }
+
+    for (uint32_t v = 0; v < STEREO_DEPTH_BENCHMARK_HEIGHT; v++) {
+        for (uint32_t u = 0; u < STEREO_DEPTH_BENCHMARK_WIDTH; u++) {
+            double ray[3] = {
+                (u - STEREO_DEPTH_BENCHMARK_WIDTH / 2.0) / STEREO_DEPTH_BENCHMARK_FOCAL,
+                (v - STEREO_DEPTH_BENCHMARK_HEIGHT / 2.0) / STEREO_DEPTH_BENCHMARK_FOCAL,
+                1,
+            };
+            double rightRay[3];
+            double scale;
+
+            left[v * STEREO_DEPTH_BENCHMARK_WIDTH + u] =
+                (uint8_t) StereoDepthBenchmark_GetTexture(planeDepth * ray[0], planeDepth * ray[1]);
+
+            // The same pixel of the right camera, its ray turned into the left camera frame and cut with the plane
+            for (int i = 0; i < 3; i++) {
+                rightRay[i] = rotation[0 * 3 + i] * ray[0] + rotation[1 * 3 + i] * ray[1] +
+                              rotation[2 * 3 + i] * ray[2];
+            }
+            scale = (planeDepth - rightCenter[2]) / rightRay[2];
+            right[v * STEREO_DEPTH_BENCHMARK_WIDTH + u] =
+                (uint8_t) StereoDepthBenchmark_GetTexture(rightCenter[0] + scale * rightRay[0],
+                                                          rightCenter[1] + scale * rightRay[1]);
+        }
+    }
+}
+
+static double StereoDepthBenchmark_GetTexture(double x, double y)
+{
+    return 40 + 170 * StereoDepthBenchmark_GetNoise(x * STEREO_DEPTH_BENCHMARK_FINE_TEXTURE,
+                                                    y * STEREO_DEPTH_BENCHMARK_FINE_TEXTURE) +
+           40 * StereoDepthBenchmark_GetNoise(x * STEREO_DEPTH_BENCHMARK_COARSE_TEXTURE,
+                                              y * STEREO_DEPTH_BENCHMARK_COARSE_TEXTURE);
+}
+
+static double StereoDepthBenchmark_GetNoise(double x, double y)
+{
+    int32_t cellX = (int32_t) floor(x);
+    int32_t cellY = (int32_t) floor(y);
+    double fracX = x - cellX;
+    double fracY = y - cellY;
+    double corners[4];
+
+    // Value noise: a hashed brightness at each cell corner, blended bilinearly
+    for (int i = 0; i < 4; i++) {
+        uint32_t hash = (uint32_t) (cellX + (i & 1)) * 374761393u + (uint32_t) (cellY + (i >> 1)) * 668265263u;
+
+        hash = (hash ^ (hash >> 13)) * 1274126177u;
+        corners[i] = ((hash ^ (hash >> 16)) & 0xFF) / 255.0;
+    }
+
+    return (corners[0] * (1 - fracX) + corners[1] * fracX) * (1 - fracY) +
+           (corners[2] * (1 - fracX) + corners[3] * fracX) * fracY;
+}
+
+static bool StereoDepthBenchmark_LoadRecording(const char *folderPath, T_DjiPerceptionCameraParametersPacket &packet)
+{
+    std::string parametersPath = std::string(folderPath) + "/" + STEREO_DEPTH_BENCHMARK_PARAMETERS_FILE;
+    std::vector<std::string> fileNames;
+    struct dirent *entry;
+    bool isAnyLoaded = false;
+    FILE *file;
+    DIR *dir;
+
+    file = fopen(parametersPath.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    if (fread(&packet, sizeof(packet), 1, file) != 1) {
+        fclose(file);
+        return false;
+    }
+    fclose(file);
+
+    dir = opendir(folderPath);
+    if (dir == nullptr) {
+        return false;
+    }
+    while ((entry = readdir(dir)) != nullptr) {
+        std::string name = entry->d_name;
+
+        if (name.size() > 9 && name.compare(name.size() - 9, 9, "_left.pgm") == 0) {
+            fileNames.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    // Sequences are replayed in file name order, so they are best written with leading zeros
+    std::sort(fileNames.begin(), fileNames.end());
+    for (size_t i = 0; i < fileNames.size(); i++) {
+        std::string prefix = std::string(folderPath) + "/" + fileNames[i].substr(0, fileNames[i].size() - 9);
+        std::vector<uint8_t> left;
+        std::vector<uint8_t> right;
+        uint32_t directionIndex;
+        uint32_t leftWidth, leftHeight;
+        uint32_t rightWidth, rightHeight;
+
+        if (sscanf(fileNames[i].c_str(), "%u_", &directionIndex) != 1 ||
+            directionIndex >= DJI_STEREO_DEPTH_DIRECTION_NUM ||
+            !StereoDepthBenchmark_LoadPgm(prefix + "_left.pgm", left, leftWidth, leftHeight) ||
+            !StereoDepthBenchmark_LoadPgm(prefix + "_right.pgm", right, rightWidth, rightHeight) ||
+            leftWidth != rightWidth || leftHeight != rightHeight) {
+            continue;
+        }
+
+        T_StereoDepthBenchmarkDirection &direction = s_directions[directionIndex];
+        if (!direction.lefts.empty() && (direction.width != leftWidth || direction.height != leftHeight)) {
+            continue;
+        }
+        direction.width = leftWidth;
+        direction.height = leftHeight;
+        direction.lefts.push_back(left);
+        direction.rights.push_back(right);
+        isAnyLoaded = true;
+    }
+
+    return isAnyLoaded;
+}
+
+static bool StereoDepthBenchmark_LoadPgm(const std::string &filePath, std::vector<uint8_t> &image, uint32_t &width,
+                                         uint32_t &height)
+{
+    uint32_t maxValue;
+    FILE *file;
+    bool isRead;
+
+    file = fopen(filePath.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    // One whitespace character separates the header from the pixels
+    if (fscanf(file, "P5 %u %u %u", &width, &height, &maxValue) != 3 || maxValue != 255 || width == 0 ||
+        height == 0 || fgetc(file) == EOF) {
+        fclose(file);
+        return false;
+    }
+
+    image.resize((size_t) width * height);
+    isRead = fread(image.data(), 1, image.size(), file) == image.size();
+    fclose(file);
+
+    return isRead;
+}
+
+static void StereoDepthBenchmark_Callback(const T_DjiStereoDepthResult *result, void *userData)
+{
+    T_StereoDepthBenchmarkDirection &direction = s_directions[result->direction];
+    uint32_t pixelCount = result->width * result->height;
+    std::vector<float> errors;
+
+    (void) userData;
+    // Results of one direction never run at the same time, the first one is compared with the plane it looks at
+    if (!s_isSynthetic || direction.isChecked) {
+        return;
+    }
+
+    errors.reserve(pixelCount);
+    for (uint32_t i = 0; i < pixelCount; i++) {
+        if (result->depth[i] > 0) {
+            errors.push_back(fabsf(result->depth[i] - direction.planeDepth) / direction.planeDepth);
+        }
+    }
+
+    direction.validRatio = (float) errors.size() / pixelCount;
+    if (!errors.empty()) {
+        std::nth_element(errors.begin(), errors.begin() + errors.size() / 2, errors.end());
+        direction.medianError = errors[errors.size() / 2];
+    }
+    direction.isChecked = true;
+}
+
+static double StereoDepthBenchmark_GetTimeMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double) ts.tv_sec * 1000 + (double) ts.tv_nsec / 1000000;
+}
+
+#endif
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,747 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_cloud_reducer.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_lidar_cloud_reducer.hpp"
+#include <cmath>
+#include <cstring>
+#include <ctime>
+
+/* Private constants ---------------------------------------------------------*/
+#define DJI_LIDAR_CLOUD_VOXEL_TABLE_SIZE        (1 << 17)   // At least twice the largest frame, probes stay short
+#define DJI_LIDAR_CLOUD_VOXEL_KEY_EMPTY         (UINT64_MAX)
+#define DJI_LIDAR_CLOUD_VOXEL_CELL_BITS         (21)
+#define DJI_LIDAR_CLOUD_VOXEL_CELL_MAX          ((1 << (DJI_LIDAR_CLOUD_VOXEL_CELL_BITS - 1)) - 1)
+
+// Adaptive binary models as in LZMA: 11 bit probabilities of a zero, moved by a 32th of the miss on every bit
+#define DJI_LIDAR_CLOUD_CODEC_PROB_BITS         (11)
+#define DJI_LIDAR_CLOUD_CODEC_PROB_INIT         (1 << (DJI_LIDAR_CLOUD_CODEC_PROB_BITS - 1))
+#define DJI_LIDAR_CLOUD_CODEC_MOVE_BITS         (5)
+#define DJI_LIDAR_CLOUD_CODEC_RANGE_TOP         (1U << 24)
+#define DJI_LIDAR_CLOUD_CODEC_LENGTH_BITS       (6)
+#define DJI_LIDAR_CLOUD_CODEC_LENGTH_NUM        (33)
+// Bits right after the leading one of a delta that are modelled, the bits below are close to random
+#define DJI_LIDAR_CLOUD_CODEC_HIGH_BITS         (4)
+#define DJI_LIDAR_CLOUD_CODEC_LABEL_CONTEXT_NUM (4)
+// Worst case of a point, every modelled bit costing about six bits after a run of the opposite bits
+#define DJI_LIDAR_CLOUD_CODEC_POINT_SIZE_MAX    (48)
+
+/* Private types -------------------------------------------------------------*/
+struct DJILidarCloudCodec::ValueModel {
+    uint16_t lengthProbs[DJI_LIDAR_CLOUD_CODEC_LENGTH_NUM][1 << DJI_LIDAR_CLOUD_CODEC_LENGTH_BITS];
+    uint16_t highProbs[DJI_LIDAR_CLOUD_CODEC_LENGTH_NUM][1 << DJI_LIDAR_CLOUD_CODEC_HIGH_BITS];
+    uint32_t previousLength;    /*!< Length of the previous value, the context of the next length. */
+};
+
+struct DJILidarCloudCodec::Models {
+    ValueModel coordinate[3];
+    ValueModel intensity;
+    uint16_t labelProbs[DJI_LIDAR_CLOUD_CODEC_LABEL_CONTEXT_NUM][1 << 8];
+};
+
+class DJILidarCloudCodec::RangeEncoder {
+public:
+    RangeEncoder(uint8_t *out, size_t outSize)
+        : m_out(out), m_outSize(outSize), m_pos(0), m_low(0), m_range(0xFFFFFFFF), m_cache(0), m_cacheSize(1),
+          m_isOverflow(false)
+    {
+    }
+
+    void encodeBit(uint16_t &prob, uint32_t bit)
+    {
+        uint32_t bound = (m_range >> DJI_LIDAR_CLOUD_CODEC_PROB_BITS) * prob;
+
+        if (bit == 0) {
+            m_range = bound;
+            prob += ((1 << DJI_LIDAR_CLOUD_CODEC_PROB_BITS) - prob) >> DJI_LIDAR_CLOUD_CODEC_MOVE_BITS;
+        } else {
+            m_low += bound;
+            m_range -= bound;
+            prob -= prob >> DJI_LIDAR_CLOUD_CODEC_MOVE_BITS;
+        }
+        while (m_range < DJI_LIDAR_CLOUD_CODEC_RANGE_TOP) {
+            m_range <<= 8;
+            shiftLow();
+        }
+    }
+
+    void encodeBitTree(uint16_t *probs, uint32_t value, uint32_t bitCount)
+    {
+        uint32_t node = 1;
+
+        for (uint32_t i = bitCount; i > 0; i--) {
+            uint32_t bit = (value >> (i - 1)) & 1;
+
+            encodeBit(probs[node], bit);
+            node = (node << 1) | bit;
+        }
+    }
+
+    void encodeDirectBits(uint32_t value, uint32_t bitCount)
+    {
+        // Up to a byte of equiprobable bits per step, the range keeps at least 16 bits of precision
+        while (bitCount > 0) {
+            uint32_t stepBitCount = bitCount < 8 ? bitCount : 8;
+
+            bitCount -= stepBitCount;
+            m_range >>= stepBitCount;
+            m_low += (uint64_t) m_range * ((value >> bitCount) & ((1U << stepBitCount) - 1));
+            while (m_range < DJI_LIDAR_CLOUD_CODEC_RANGE_TOP) {
+                m_range <<= 8;
+                shiftLow();
+            }
+        }
+    }
+
+    size_t finish()
+    {
+        for (int i = 0; i < 5; i++) {
+            shiftLow();
+        }
+
+        return m_isOverflow ? 0 : m_pos;
+    }
+
+private:
+    void shiftLow()
+    {
+        // A carry out of the low 32 bits still has to reach the bytes held back in the cache
+        if ((uint32_t) m_low < 0xFF000000 || (m_low >> 32) != 0) {
+            uint8_t carry = (uint8_t) (m_low >> 32);
+            uint8_t byte = m_cache;
+
+            do {
+                writeByte((uint8_t) (byte + carry));
+                byte = 0xFF;
+            } while (--m_cacheSize != 0);
+            m_cache = (uint8_t) (m_low >> 24);
+        }
+        m_cacheSize++;
+        m_low = (m_low & 0x00FFFFFF) << 8;
+    }
+
+    void writeByte(uint8_t byte)
+    {
+        if (m_pos < m_outSize) {
+            m_out[m_pos++] = byte;
+        } else {
+            m_isOverflow = true;
+        }
+    }
+
+    uint8_t *m_out;
+    size_t m_outSize;
+    size_t m_pos;
+    uint64_t m_low;
+    uint32_t m_range;
+    uint8_t m_cache;
+    uint64_t m_cacheSize;
+    bool m_isOverflow;
+};
+
+class DJILidarCloudCodec::RangeDecoder {
+public:
+    RangeDecoder(const uint8_t *in, size_t inSize)
+        : m_in(in), m_inSize(inSize), m_pos(0), m_code(0), m_range(0xFFFFFFFF), m_isOverrun(false)
+    {
+        for (int i = 0; i < 5; i++) {
+            m_code = (m_code << 8) | readByte();
+        }
+    }
+
+    uint32_t decodeBit(uint16_t &prob)
+    {
+        uint32_t bound = (m_range >> DJI_LIDAR_CLOUD_CODEC_PROB_BITS) * prob;
+        uint32_t bit;
+
+        if (m_code < bound) {
+            m_range = bound;
+            prob += ((1 << DJI_LIDAR_CLOUD_CODEC_PROB_BITS) - prob) >> DJI_LIDAR_CLOUD_CODEC_MOVE_BITS;
+            bit = 0;
+        } else {
+            m_code -= bound;
+            m_range -= bound;
+            prob -= prob >> DJI_LIDAR_CLOUD_CODEC_MOVE_BITS;
+            bit = 1;
+        }
+        while (m_range < DJI_LIDAR_CLOUD_CODEC_RANGE_TOP) {
+            m_range <<= 8;
+            m_code = (m_code << 8) | readByte();
+        }
+
+        return bit;
+    }
+
+    uint32_t decodeBitTree(uint16_t *probs, uint32_t bitCount)
+    {
+        uint32_t node = 1;
+
+        for (uint32_t i = 0; i < bitCount; i++) {
+            node = (node << 1) | decodeBit(probs[node]);
+        }
+
+        return node - (1U << bitCount);
+    }
+
+    uint32_t decodeDirectBits(uint32_t bitCount)
+    {
+        uint32_t value = 0;
+
+        while (bitCount > 0) {
+            uint32_t stepBitCount = bitCount < 8 ? bitCount : 8;
+            uint32_t step;
+
+            bitCount -= stepBitCount;
+            m_range >>= stepBitCount;
+            step = m_code / m_range;
+            // Only a corrupted stream can land past the last step
+            if (step >= (1U << stepBitCount)) {
+                step = (1U << stepBitCount) - 1;
+                m_isOverrun = true;
+            }
+            m_code -= step * m_range;
+            value = (value << stepBitCount) | step;
+            while (m_range < DJI_LIDAR_CLOUD_CODEC_RANGE_TOP) {
+                m_range <<= 8;
+                m_code = (m_code << 8) | readByte();
+            }
+        }
+
+        return value;
+    }
+
+    bool isOverrun() const
+    {
+        return m_isOverrun;
+    }
+
+private:
+    uint8_t readByte()
+    {
+        if (m_pos < m_inSize) {
+            return m_in[m_pos++];
+        }
+        m_isOverrun = true;
+
+        return 0;
+    }
+
+    const uint8_t *m_in;
+    size_t m_inSize;
+    size_t m_pos;
+    uint32_t m_code;
+    uint32_t m_range;
+    bool m_isOverrun;
+};
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static uint32_t DjiLidarCloudReducer_ZigZag(int32_t value);
+static int32_t DjiLidarCloudReducer_UnZigZag(uint32_t value);
+static int32_t DjiLidarCloudReducer_GetCell(float coordinate, float inverseVoxelSize);
+static int32_t DjiLidarCloudReducer_GetKeyCell(uint64_t key, uint32_t shift);
+
+/* Exported functions definition ---------------------------------------------*/
+DJILidarCloudFilter::DJILidarCloudFilter(const T_DjiLidarCloudFilterConfig &config)
+    : m_config(config),
+      m_inverseVoxelSize(config.voxelSize > 0 ? 1.0f / config.voxelSize : 0),
+      m_voxels(nullptr),
+      m_voxelMask(DJI_LIDAR_CLOUD_VOXEL_TABLE_SIZE - 1),
+      m_usedVoxels(nullptr),
+      m_usedVoxelCount(0),
+      m_statistics()
+{
+    if (m_config.voxelSize > 0) {
+        m_voxels = new Voxel[DJI_LIDAR_CLOUD_VOXEL_TABLE_SIZE];
+        m_usedVoxels = new uint32_t[DJI_LIDAR_CLOUD_POINT_NUM_MAX];
+        for (uint32_t i = 0; i < DJI_LIDAR_CLOUD_VOXEL_TABLE_SIZE; i++) {
+            m_voxels[i].key = DJI_LIDAR_CLOUD_VOXEL_KEY_EMPTY;
+        }
+    }
+}
+
+DJILidarCloudFilter::~DJILidarCloudFilter()
+{
+    delete[] m_usedVoxels;
+    delete[] m_voxels;
+}
+
+uint32_t DJILidarCloudFilter::apply(const T_DjiPerceptionLidarDecodePkg *pkgs, uint16_t pkgNum,
+                                    T_DJIPerceptionLidarPoint *points, uint32_t pointCapacity)
+{
+    uint64_t startTimeUs = getTimeUs();
+    uint32_t inputCount = 0;
+    uint32_t outputCount = 0;
+
+    if (pkgNum > DJI_LIDAR_PKG_BUFFER_NUM) {
+        pkgNum = DJI_LIDAR_PKG_BUFFER_NUM;
+    }
+
+    for (uint16_t i = 0; i < pkgNum; i++) {
+        uint32_t dotNum = pkgs[i].header.dotNum < DJI_PTS_NUM_PER_PKG ? pkgs[i].header.dotNum : DJI_PTS_NUM_PER_PKG;
+
+        inputCount += dotNum;
+        for (uint32_t j = 0; j < dotNum; j++) {
+            const T_DJIPerceptionLidarPoint &point = pkgs[i].points[j];
+
+            if (!isKept(point)) {
+                continue;
+            }
+            if (m_voxels != nullptr) {
+                addToVoxel(point);
+            } else if (outputCount < pointCapacity) {
+                points[outputCount++] = point;
+            }
+        }
+    }
+
+    // Emit the centroids and empty the slots for the next frame, touching only the slots this frame used
+    for (uint32_t i = 0; i < m_usedVoxelCount; i++) {
+        Voxel &voxel = m_voxels[m_usedVoxels[i]];
+
+        if (outputCount < pointCapacity) {
+            T_DJIPerceptionLidarPoint &point = points[outputCount++];
+            float inverseCount = 1.0f / (float) voxel.count;
+
+            point.x = (float) DjiLidarCloudReducer_GetKeyCell(voxel.key, 2 * DJI_LIDAR_CLOUD_VOXEL_CELL_BITS) *
+                      m_config.voxelSize + voxel.sumX * inverseCount;
+            point.y = (float) DjiLidarCloudReducer_GetKeyCell(voxel.key, DJI_LIDAR_CLOUD_VOXEL_CELL_BITS) *
+                      m_config.voxelSize + voxel.sumY * inverseCount;
+            point.z = (float) DjiLidarCloudReducer_GetKeyCell(voxel.key, 0) * m_config.voxelSize +
+                      voxel.sumZ * inverseCount;
+            point.intensity = (uint8_t) ((voxel.sumIntensity + voxel.count / 2) / voxel.count);
+            point.label = voxel.label;
+        }
+        voxel.key = DJI_LIDAR_CLOUD_VOXEL_KEY_EMPTY;
+    }
+    m_usedVoxelCount = 0;
+
+    m_statistics.inputPointCount += inputCount;
+    m_statistics.outputPointCount += outputCount;
+    m_statistics.inputBytes += inputCount * sizeof(T_DJIPerceptionLidarPoint);
+    m_statistics.outputBytes += outputCount * sizeof(T_DJIPerceptionLidarPoint);
+    m_statistics.totalTimeMs += (double) (getTimeUs() - startTimeUs) / 1000.0;
+
+    return outputCount;
+}
+
+void DJILidarCloudFilter::getStatistics(T_DjiLidarCloudReducerStatistics &statistics)
+{
+    statistics = m_statistics;
+}
+
+DJILidarCloudCodec::DJILidarCloudCodec(E_DjiLidarCloudCodecMode mode, float precision)
+    : m_mode(mode),
+      m_precision(precision > 0 ? precision : 0.001f),
+      m_inversePrecision(1.0f / m_precision),
+      m_models(nullptr),
+      m_previous(),
+      m_previousIntensity(0),
+      m_previousLabel(0),
+      m_statistics()
+{
+    m_models = new Models;
+}
+
+DJILidarCloudCodec::~DJILidarCloudCodec()
+{
+    delete m_models;
+}
+
+size_t DJILidarCloudCodec::getMaxEncodedSize(uint32_t pointCount)
+{
+    return DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE + (size_t) pointCount * DJI_LIDAR_CLOUD_CODEC_POINT_SIZE_MAX + 16;
+}
+
+size_t DJILidarCloudCodec::encode(const T_DJIPerceptionLidarPoint *points, uint32_t pointCount, uint8_t *out,
+                                  size_t outSize)
+{
+    uint64_t startTimeUs = getTimeUs();
+    size_t encodedSize;
+
+    if (outSize <= DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE) {
+        return 0;
+    }
+
+    RangeEncoder encoder(out + DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE, outSize - DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE);
+
+    resetModels();
+    for (uint32_t i = 0; i < pointCount; i++) {
+        encodePoint(encoder, points[i]);
+    }
+
+    encodedSize = encoder.finish();
+    if (encodedSize == 0) {
+        return 0;
+    }
+    writeHeader(out, pointCount);
+    encodedSize += DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE;
+
+    m_statistics.inputPointCount += pointCount;
+    m_statistics.outputPointCount += pointCount;
+    m_statistics.inputBytes += pointCount * sizeof(T_DJIPerceptionLidarPoint);
+    m_statistics.outputBytes += encodedSize;
+    m_statistics.totalTimeMs += (double) (getTimeUs() - startTimeUs) / 1000.0;
+
+    return encodedSize;
+}
+
+size_t DJILidarCloudCodec::encode(const T_DjiPerceptionLidarDecodePkg *pkgs, uint16_t pkgNum, uint8_t *out,
+                                  size_t outSize)
+{
+    uint64_t startTimeUs = getTimeUs();
+    uint32_t pointCount = 0;
+    size_t encodedSize;
+
+    if (outSize <= DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE) {
+        return 0;
+    }
+    if (pkgNum > DJI_LIDAR_PKG_BUFFER_NUM) {
+        pkgNum = DJI_LIDAR_PKG_BUFFER_NUM;
+    }
+
+    RangeEncoder encoder(out + DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE, outSize - DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE);
+
+    resetModels();
+    for (uint16_t i = 0; i < pkgNum; i++) {
+        uint32_t dotNum = pkgs[i].header.dotNum < DJI_PTS_NUM_PER_PKG ? pkgs[i].header.dotNum : DJI_PTS_NUM_PER_PKG;
+
+        for (uint32_t j = 0; j < dotNum; j++) {
+            encodePoint(encoder, pkgs[i].points[j]);
+        }
+        pointCount += dotNum;
+    }
+
+    encodedSize = encoder.finish();
+    if (encodedSize == 0) {
+        return 0;
+    }
+    writeHeader(out, pointCount);
+    encodedSize += DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE;
+
+    m_statistics.inputPointCount += pointCount;
+    m_statistics.outputPointCount += pointCount;
+    m_statistics.inputBytes += pointCount * sizeof(T_DJIPerceptionLidarPoint);
+    m_statistics.outputBytes += encodedSize;
+    m_statistics.totalTimeMs += (double) (getTimeUs() - startTimeUs) / 1000.0;
+
+    return encodedSize;
+}
+
+bool DJILidarCloudCodec::decode(const uint8_t *data, size_t size, T_DJIPerceptionLidarPoint *points,
+                                uint32_t pointCapacity, uint32_t &pointCount)
+{
+    uint32_t magic;
+    uint32_t count;
+    float precision;
+    bool isValid = true;
+
+    if (size < DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE) {
+        return false;
+    }
+
+    memcpy(&magic, data, sizeof(magic));
+    memcpy(&count, data + 8, sizeof(count));
+    memcpy(&precision, data + 12, sizeof(precision));
+    if (magic != DJI_LIDAR_CLOUD_CODEC_MAGIC || data[4] != DJI_LIDAR_CLOUD_CODEC_VERSION ||
+        data[5] > DJI_LIDAR_CLOUD_CODEC_MODE_QUANTIZED || count > pointCapacity ||
+        (data[5] == DJI_LIDAR_CLOUD_CODEC_MODE_QUANTIZED && !(precision > 0))) {
+        return false;
+    }
+
+    RangeDecoder decoder(data + DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE, size - DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE);
+
+    resetModels();
+    for (uint32_t i = 0; i < count && isValid; i++) {
+        T_DJIPerceptionLidarPoint &point = points[i];
+        float coordinate[3];
+
+        for (int axis = 0; axis < 3; axis++) {
+            int32_t delta = DjiLidarCloudReducer_UnZigZag(decodeValue(decoder, m_models->coordinate[axis], isValid));
+
+            m_previous[axis] += (uint32_t) delta;
+            if (data[5] == DJI_LIDAR_CLOUD_CODEC_MODE_LOSSLESS) {
+                memcpy(&coordinate[axis], &m_previous[axis], sizeof(float));
+            } else {
+                coordinate[axis] = (float) ((double) (int32_t) m_previous[axis] * precision);
+            }
+        }
+        point.x = coordinate[0];
+        point.y = coordinate[1];
+        point.z = coordinate[2];
+
+        m_previousIntensity += (uint8_t) DjiLidarCloudReducer_UnZigZag(
+            decodeValue(decoder, m_models->intensity, isValid));
+        point.intensity = m_previousIntensity;
+
+        point.label = (uint8_t) decoder.decodeBitTree(
+            m_models->labelProbs[m_previousLabel % DJI_LIDAR_CLOUD_CODEC_LABEL_CONTEXT_NUM], 8);
+        m_previousLabel = point.label;
+    }
+
+    if (!isValid || decoder.isOverrun()) {
+        return false;
+    }
+    pointCount = count;
+
+    return true;
+}
+
+void DJILidarCloudCodec::getStatistics(T_DjiLidarCloudReducerStatistics &statistics)
+{
+    statistics = m_statistics;
+}
+
+/* Private functions definition-----------------------------------------------*/
+bool DJILidarCloudFilter::isKept(const T_DJIPerceptionLidarPoint &point)
+{
+    float squaredRange = point.x * point.x + point.y * point.y + point.z * point.z;
+
+    if (m_config.isNoiseDropped && (point.label == 1 || point.label == 3)) {
+        return false;
+    }
+    if (point.intensity < m_config.minIntensity) {
+        return false;
+    }
+    if (squaredRange < m_config.minRange * m_config.minRange) {
+        return false;
+    }
+    if (m_config.maxRange > 0 && squaredRange > m_config.maxRange * m_config.maxRange) {
+        return false;
+    }
+
+    return true;
+}
+
+void DJILidarCloudFilter::addToVoxel(const T_DJIPerceptionLidarPoint &point)
+{
+    const uint64_t cellMask = (1ULL << DJI_LIDAR_CLOUD_VOXEL_CELL_BITS) - 1;
+    int32_t cellX = DjiLidarCloudReducer_GetCell(point.x, m_inverseVoxelSize);
+    int32_t cellY = DjiLidarCloudReducer_GetCell(point.y, m_inverseVoxelSize);
+    int32_t cellZ = DjiLidarCloudReducer_GetCell(point.z, m_inverseVoxelSize);
+    uint64_t key = (((uint64_t) cellX & cellMask) << (2 * DJI_LIDAR_CLOUD_VOXEL_CELL_BITS)) |
+                   (((uint64_t) cellY & cellMask) << DJI_LIDAR_CLOUD_VOXEL_CELL_BITS) |
+                   ((uint64_t) cellZ & cellMask);
+    uint32_t index = (uint32_t) ((key * 0x9E3779B97F4A7C15ULL) >> 40) & m_voxelMask;
+
+    // The table holds twice as many slots as a frame has points, so a free slot is always found
+    while (m_voxels[index].key != DJI_LIDAR_CLOUD_VOXEL_KEY_EMPTY && m_voxels[index].key != key) {
+        index = (index + 1) & m_voxelMask;
+    }
+
+    Voxel &voxel = m_voxels[index];
+    if (voxel.key == DJI_LIDAR_CLOUD_VOXEL_KEY_EMPTY) {
+        voxel.key = key;
+        voxel.sumX = 0;
+        voxel.sumY = 0;
+        voxel.sumZ = 0;
+        voxel.sumIntensity = 0;
+        voxel.count = 0;
+        voxel.label = point.label;
+        m_usedVoxels[m_usedVoxelCount++] = index;
+    }
+    voxel.sumX += point.x - (float) cellX * m_config.voxelSize;
+    voxel.sumY += point.y - (float) cellY * m_config.voxelSize;
+    voxel.sumZ += point.z - (float) cellZ * m_config.voxelSize;
+    voxel.sumIntensity += point.intensity;
+    voxel.count++;
+}
+
+uint64_t DJILidarCloudFilter::getTimeUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void DJILidarCloudCodec::resetModels()
+{
+    // Every frame decodes on its own, a lost frame on the link does not break the following ones
+    for (auto &model : m_models->coordinate) {
+        for (auto &probs : model.lengthProbs) {
+            for (auto &prob : probs) {
+                prob = DJI_LIDAR_CLOUD_CODEC_PROB_INIT;
+            }
+        }
+        for (auto &probs : model.highProbs) {
+            for (auto &prob : probs) {
+                prob = DJI_LIDAR_CLOUD_CODEC_PROB_INIT;
+            }
+        }
+        model.previousLength = 0;
+    }
+    m_models->intensity = m_models->coordinate[0];
+    for (auto &probs : m_models->labelProbs) {
+        for (auto &prob : probs) {
+            prob = DJI_LIDAR_CLOUD_CODEC_PROB_INIT;
+        }
+    }
+
+    memset(m_previous, 0, sizeof(m_previous));
+    m_previousIntensity = 0;
+    m_previousLabel = 0;
+}
+
+void DJILidarCloudCodec::encodePoint(RangeEncoder &encoder, const T_DJIPerceptionLidarPoint &point)
+{
+    float coordinate[3] = {point.x, point.y, point.z};
+    uint32_t value;
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (m_mode == DJI_LIDAR_CLOUD_CODEC_MODE_LOSSLESS) {
+            memcpy(&value, &coordinate[axis], sizeof(value));
+        } else {
+            double fixedPoint = std::round((double) coordinate[axis] * m_inversePrecision);
+
+            // NaN fails both range checks below and has no fixed point value, it is sent as the origin instead
+            if (std::isnan(fixedPoint)) {
+                fixedPoint = 0;
+            }
+            fixedPoint = fixedPoint > INT32_MAX ? INT32_MAX : (fixedPoint < INT32_MIN ? INT32_MIN : fixedPoint);
+            value = (uint32_t) (int32_t) fixedPoint;
+        }
+        encodeValue(encoder, m_models->coordinate[axis], DjiLidarCloudReducer_ZigZag((int32_t) (value -
+                                                                                                 m_previous[axis])));
+        m_previous[axis] = value;
+    }
+
+    encodeValue(encoder, m_models->intensity,
+                DjiLidarCloudReducer_ZigZag((int8_t) (uint8_t) (point.intensity - m_previousIntensity)));
+    m_previousIntensity = point.intensity;
+
+    encoder.encodeBitTree(m_models->labelProbs[m_previousLabel % DJI_LIDAR_CLOUD_CODEC_LABEL_CONTEXT_NUM],
+                          point.label, 8);
+    m_previousLabel = point.label;
+}
+
+void DJILidarCloudCodec::encodeValue(RangeEncoder &encoder, ValueModel &model, uint32_t value)
+{
+    uint32_t length = value != 0 ? 32 - __builtin_clz(value) : 0;
+    uint32_t lowBitCount;
+    uint32_t highBitCount;
+
+    encoder.encodeBitTree(model.lengthProbs[model.previousLength], length, DJI_LIDAR_CLOUD_CODEC_LENGTH_BITS);
+    model.previousLength = length;
+    if (length <= 1) {
+        return;
+    }
+
+    // The leading one is implied by the length
+    lowBitCount = length - 1;
+    highBitCount = lowBitCount < DJI_LIDAR_CLOUD_CODEC_HIGH_BITS ? lowBitCount : DJI_LIDAR_CLOUD_CODEC_HIGH_BITS;
+    lowBitCount -= highBitCount;
+    encoder.encodeBitTree(model.highProbs[length], (value >> lowBitCount) & ((1U << highBitCount) - 1),
+                          highBitCount);
+    if (lowBitCount > 0) {
+        encoder.encodeDirectBits(value & ((1U << lowBitCount) - 1), lowBitCount);
+    }
+}
+
+uint32_t DJILidarCloudCodec::decodeValue(RangeDecoder &decoder, ValueModel &model, bool &isValid)
+{
+    uint32_t length = decoder.decodeBitTree(model.lengthProbs[model.previousLength],
+                                            DJI_LIDAR_CLOUD_CODEC_LENGTH_BITS);
+    uint32_t lowBitCount;
+    uint32_t highBitCount;
+    uint32_t value;
+
+    if (length >= DJI_LIDAR_CLOUD_CODEC_LENGTH_NUM) {
+        isValid = false;
+        return 0;
+    }
+    model.previousLength = length;
+    if (length <= 1) {
+        return length;
+    }
+
+    lowBitCount = length - 1;
+    highBitCount = lowBitCount < DJI_LIDAR_CLOUD_CODEC_HIGH_BITS ? lowBitCount : DJI_LIDAR_CLOUD_CODEC_HIGH_BITS;
+    lowBitCount -= highBitCount;
+    value = (1U << highBitCount) | decoder.decodeBitTree(model.highProbs[length], highBitCount);
+    value <<= lowBitCount;
+    if (lowBitCount > 0) {
+        value |= decoder.decodeDirectBits(lowBitCount);
+    }
+
+    return value;
+}
+
+void DJILidarCloudCodec::writeHeader(uint8_t *out, uint32_t pointCount)
+{
+    uint32_t magic = DJI_LIDAR_CLOUD_CODEC_MAGIC;
+
+    memcpy(out, &magic, sizeof(magic));
+    out[4] = DJI_LIDAR_CLOUD_CODEC_VERSION;
+    out[5] = (uint8_t) m_mode;
+    out[6] = 0;
+    out[7] = 0;
+    memcpy(out + 8, &pointCount, sizeof(pointCount));
+    memcpy(out + 12, &m_precision, sizeof(m_precision));
+}
+
+uint64_t DJILidarCloudCodec::getTimeUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint32_t DjiLidarCloudReducer_ZigZag(int32_t value)
+{
+    return ((uint32_t) value << 1) ^ (uint32_t) (value >> 31);
+}
+
+static int32_t DjiLidarCloudReducer_UnZigZag(uint32_t value)
+{
+    return (int32_t) (value >> 1) ^ -(int32_t) (value & 1);
+}
+
+static int32_t DjiLidarCloudReducer_GetCell(float coordinate, float inverseVoxelSize)
+{
+    float cell = std::floor(coordinate * inverseVoxelSize);
+
+    if (!(cell > -DJI_LIDAR_CLOUD_VOXEL_CELL_MAX)) {
+        return -DJI_LIDAR_CLOUD_VOXEL_CELL_MAX;
+    }
+    if (cell > DJI_LIDAR_CLOUD_VOXEL_CELL_MAX) {
+        return DJI_LIDAR_CLOUD_VOXEL_CELL_MAX;
+    }
+
+    return (int32_t) cell;
+}
+
+static int32_t DjiLidarCloudReducer_GetKeyCell(uint64_t key, uint32_t shift)
+{
+    // Sign extend the cell coordinate from its field of the key
+    return (int32_t) ((int64_t) (key << (64 - DJI_LIDAR_CLOUD_VOXEL_CELL_BITS - shift)) >>
+                      (64 - DJI_LIDAR_CLOUD_VOXEL_CELL_BITS));
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
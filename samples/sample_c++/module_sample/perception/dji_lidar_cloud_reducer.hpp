@@ -0,0 +1,175 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_cloud_reducer.hpp
+ * @brief   This is the header file for "dji_lidar_cloud_reducer.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIDAR_CLOUD_REDUCER_H
+#define DJI_LIDAR_CLOUD_REDUCER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <cstddef>
+#include <cstdint>
+#include "dji_perception.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_LIDAR_CLOUD_POINT_NUM_MAX          (DJI_LIDAR_PKG_BUFFER_NUM * DJI_PTS_NUM_PER_PKG)
+#define DJI_LIDAR_CLOUD_CODEC_MAGIC            (0x434C4344)    // "DCLC"
+#define DJI_LIDAR_CLOUD_CODEC_VERSION          (1)
+#define DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE      (16)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    float minRange;             /*!< Points closer than this are dropped, unit: m. */
+    float maxRange;             /*!< Points further than this are dropped, 0 for no limit, unit: m. */
+    uint8_t minIntensity;
+    bool isNoiseDropped;        /*!< Drop the points labelled as noise or as no return. */
+    float voxelSize;            /*!< Edge of the voxel grid cells, 0 to keep every point passing the filter, unit: m. */
+} T_DjiLidarCloudFilterConfig;
+
+typedef enum {
+    DJI_LIDAR_CLOUD_CODEC_MODE_LOSSLESS = 0,    /*!< Coordinates come back bit exact. */
+    DJI_LIDAR_CLOUD_CODEC_MODE_QUANTIZED,       /*!< Coordinates are rounded to the precision. */
+} E_DjiLidarCloudCodecMode;
+
+typedef struct {
+    uint64_t inputPointCount;
+    uint64_t outputPointCount;
+    uint64_t inputBytes;
+    uint64_t outputBytes;
+    double totalTimeMs;
+} T_DjiLidarCloudReducerStatistics;
+
+/*! @note
+ * Reduces a lidar frame before it goes over a slow link. The range,
+ * intensity and label filter runs first, then the points left are merged
+ * into the centroid of their voxel. The voxel grid is an open addressing
+ * hash table sized for the largest frame and allocated once, cells are
+ * emitted in the order the scan first reached them, so neighbouring output
+ * points stay close to each other for the codec.
+ */
+class DJILidarCloudFilter {
+public:
+    explicit DJILidarCloudFilter(const T_DjiLidarCloudFilterConfig &config);
+    ~DJILidarCloudFilter();
+
+    /*! @brief Filter the points of the valid decode packages of a frame.
+     *  @param pkgs: decode packages, as in T_DjiLidarFrame or a pool frame view.
+     *  @param pkgNum: number of valid packages.
+     *  @param points: filtered points, room for DJI_LIDAR_CLOUD_POINT_NUM_MAX points is always enough.
+     *  @param pointCapacity: size of points.
+     *  @return Number of points written.
+     */
+    uint32_t apply(const T_DjiPerceptionLidarDecodePkg *pkgs, uint16_t pkgNum, T_DJIPerceptionLidarPoint *points,
+                   uint32_t pointCapacity);
+
+    void getStatistics(T_DjiLidarCloudReducerStatistics &statistics);
+
+private:
+    struct Voxel {
+        uint64_t key;           /*!< Cell coordinates, UINT64_MAX while the slot is empty. */
+        float sumX;             /*!< Point offsets from the cell corner, which keeps float sums precise far out. */
+        float sumY;
+        float sumZ;
+        uint32_t sumIntensity;
+        uint32_t count;
+        uint8_t label;
+    };
+
+    bool isKept(const T_DJIPerceptionLidarPoint &point);
+    void addToVoxel(const T_DJIPerceptionLidarPoint &point);
+    static uint64_t getTimeUs();
+
+    T_DjiLidarCloudFilterConfig m_config;
+    float m_inverseVoxelSize;
+    Voxel *m_voxels;
+    uint32_t m_voxelMask;
+    uint32_t *m_usedVoxels;     /*!< Slots taken in the current frame, in the order they were taken. */
+    uint32_t m_usedVoxelCount;
+    T_DjiLidarCloudReducerStatistics m_statistics;
+};
+
+/*! @note
+ * Lossless or quantized point cloud codec. Coordinates are delta coded
+ * against the previous point, as 32 bit float patterns in lossless mode or as
+ * fixed point multiples of the precision in quantized mode, and every field
+ * goes through an adaptive binary range coder with its own models. A delta
+ * is coded as its bit length followed by its bits, the leading ones modelled
+ * and the rest stored as they are, so small steps between neighbouring
+ * points take few bits. Encoding allocates nothing after construction.
+ *
+ * Encoded frame: DJI_LIDAR_CLOUD_CODEC_HEADER_SIZE bytes of header (magic,
+ * version, mode, point count, precision), then the range coded points.
+ */
+class DJILidarCloudCodec {
+public:
+    DJILidarCloudCodec(E_DjiLidarCloudCodecMode mode, float precision);
+    ~DJILidarCloudCodec();
+
+    /*! @brief Largest encoded size of a frame with this many points. */
+    static size_t getMaxEncodedSize(uint32_t pointCount);
+
+    /*! @brief Encode filtered points.
+     *  @return Encoded size, 0 when out is too small.
+     */
+    size_t encode(const T_DJIPerceptionLidarPoint *points, uint32_t pointCount, uint8_t *out, size_t outSize);
+
+    /*! @brief Encode the points of the valid decode packages of a frame as they are. */
+    size_t encode(const T_DjiPerceptionLidarDecodePkg *pkgs, uint16_t pkgNum, uint8_t *out, size_t outSize);
+
+    /*! @brief Decode a frame, on the receiving side.
+     *  @param pointCount: number of points decoded.
+     *  @return false when the data is not a valid encoded frame or does not fit into points.
+     */
+    bool decode(const uint8_t *data, size_t size, T_DJIPerceptionLidarPoint *points, uint32_t pointCapacity,
+                uint32_t &pointCount);
+
+    void getStatistics(T_DjiLidarCloudReducerStatistics &statistics);
+
+private:
+    struct ValueModel;
+    struct Models;
+    class RangeEncoder;
+    class RangeDecoder;
+
+    void resetModels();
+    void encodePoint(RangeEncoder &encoder, const T_DJIPerceptionLidarPoint &point);
+    static void encodeValue(RangeEncoder &encoder, ValueModel &model, uint32_t value);
+    static uint32_t decodeValue(RangeDecoder &decoder, ValueModel &model, bool &isValid);
+    void writeHeader(uint8_t *out, uint32_t pointCount);
+    static uint64_t getTimeUs();
+
+    E_DjiLidarCloudCodecMode m_mode;
+    float m_precision;
+    float m_inversePrecision;
+    Models *m_models;
+    uint32_t m_previous[3];     /*!< Previous coordinates as float patterns or fixed point values. */
+    uint8_t m_previousIntensity;
+    uint8_t m_previousLabel;
+    T_DjiLidarCloudReducerStatistics m_statistics;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#endif // DJI_LIDAR_CLOUD_REDUCER_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
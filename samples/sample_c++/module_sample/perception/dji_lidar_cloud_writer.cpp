@@ -0,0 +1,700 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_cloud_writer.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_lidar_cloud_writer.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dji_logger.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define DJI_LIDAR_CLOUD_WRITER_ALIGN              (4096)
+#define DJI_LIDAR_CLOUD_WRITER_HEADER_SIZE_MAX    (512)
+#define DJI_LIDAR_CLOUD_WRITER_POINT_NUM_MAX      (DJI_LIDAR_PKG_BUFFER_NUM * DJI_PTS_NUM_PER_PKG)
+#define DJI_LIDAR_CLOUD_WRITER_POINT_SIZE         (sizeof(T_DJIPerceptionLidarPoint))
+// Index entries reserved when a container is opened, about an hour of frames at 10 Hz
+#define DJI_LIDAR_CLOUD_WRITER_INDEX_RESERVE      (36000)
+#define DJI_LIDAR_CLOUD_WRITER_FILE_RESERVE       (16)
+#define DJI_LIDAR_CLOUD_LZF_HASH_LOG              (14)
+#define DJI_LIDAR_CLOUD_LZF_OFFSET_MAX            (1 << 13)
+#define DJI_LIDAR_CLOUD_LZF_LITERAL_MAX           (1 << 5)
+#define DJI_LIDAR_CLOUD_LZF_MATCH_MAX             ((1 << 8) + (1 << 3))
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+// Both file formats store a point as x, y, z, intensity and label without padding, which is the SDK layout too
+static_assert(sizeof(T_DJIPerceptionLidarPoint) == 3 * sizeof(float) + 2 * sizeof(uint8_t),
+              "Lidar points are expected to be packed.");
+
+/* Private functions declaration ---------------------------------------------*/
+static uint32_t DjiLidarCloudWriter_GetCompressBound(uint32_t size);
+
+/* Exported functions definition ---------------------------------------------*/
+DJILidarCloudWriter::DJILidarCloudWriter(const T_DjiLidarCloudWriterConfig &config)
+    : m_config(config),
+      m_folderPath(config.folderPath != nullptr ? config.folderPath : "."),
+      m_filePrefix(config.filePrefix != nullptr ? config.filePrefix : "cloud"),
+      m_bufferSize(0),
+      m_currentBuffer(nullptr),
+      m_currentBufferIndex(0),
+      m_isRunning(false),
+      m_ioThread(),
+      m_columnBuffer(nullptr),
+      m_hashTable(nullptr),
+      m_containerFd(-1),
+      m_containerOffset(0),
+      m_writtenOffset(0),
+      m_syncedOffset(0),
+      m_statistics()
+{
+    m_config.folderPath = nullptr;
+    m_config.filePrefix = nullptr;
+    if (m_config.bufferCount == 0) {
+        m_config.bufferCount = DJI_LIDAR_CLOUD_WRITER_BUFFER_COUNT_DEFAULT;
+    }
+    if (m_config.bufferSize == 0) {
+        m_config.bufferSize = DJI_LIDAR_CLOUD_WRITER_BUFFER_SIZE_DEFAULT;
+    }
+
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_cond_init(&m_queuedCond, nullptr);
+    pthread_cond_init(&m_freeCond, nullptr);
+}
+
+DJILidarCloudWriter::~DJILidarCloudWriter()
+{
+    stop();
+
+    for (auto &buffer : m_buffers) {
+        free(buffer.data);
+    }
+    free(m_columnBuffer);
+    free(m_hashTable);
+
+    pthread_cond_destroy(&m_freeCond);
+    pthread_cond_destroy(&m_queuedCond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool DJILidarCloudWriter::start()
+{
+    char timeString[32];
+    char containerPath[DJI_LIDAR_CLOUD_WRITER_FILE_NAME_LEN_MAX];
+    time_t now = time(nullptr);
+    struct tm localTime;
+
+    if (m_isRunning) {
+        return true;
+    }
+
+    if (mkdir(m_folderPath.c_str(), 0755) != 0 && errno != EEXIST) {
+        USER_LOG_ERROR("Create cloud folder %s failed, errno %d.", m_folderPath.c_str(), errno);
+        return false;
+    }
+
+    // Every buffer has to hold at least the largest possible frame
+    m_bufferSize = m_config.bufferSize > getMaxFrameSize() ? m_config.bufferSize : getMaxFrameSize();
+    m_bufferSize = (m_bufferSize + DJI_LIDAR_CLOUD_WRITER_ALIGN - 1) / DJI_LIDAR_CLOUD_WRITER_ALIGN *
+                   DJI_LIDAR_CLOUD_WRITER_ALIGN;
+
+    if (m_buffers.empty()) {
+        m_buffers.resize(m_config.bufferCount);
+        for (auto &buffer : m_buffers) {
+            void *data = nullptr;
+
+            if (posix_memalign(&data, DJI_LIDAR_CLOUD_WRITER_ALIGN, m_bufferSize) != 0) {
+                USER_LOG_ERROR("Allocate cloud buffer of %zu bytes failed.", m_bufferSize);
+                // Leave no half allocated set behind, the next start would take it as ready
+                for (auto &allocatedBuffer : m_buffers) {
+                    free(allocatedBuffer.data);
+                }
+                m_buffers.clear();
+                return false;
+            }
+            // Touch every page now, the first frames would otherwise pay for the page faults
+            memset(data, 0, m_bufferSize);
+            buffer.data = (uint8_t *) data;
+            buffer.size = 0;
+            // Grows once when many small frames fill a buffer, the capacity is kept from then on
+            buffer.files.reserve(DJI_LIDAR_CLOUD_WRITER_FILE_RESERVE);
+        }
+    }
+
+    if (m_config.format == DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY_COMPRESSED && m_columnBuffer == nullptr) {
+        void *data = nullptr;
+
+        if (posix_memalign(&data, DJI_LIDAR_CLOUD_WRITER_ALIGN,
+                           DJI_LIDAR_CLOUD_WRITER_POINT_NUM_MAX * DJI_LIDAR_CLOUD_WRITER_POINT_SIZE) != 0) {
+            return false;
+        }
+        m_columnBuffer = (uint8_t *) data;
+        m_hashTable = (uint32_t *) malloc(sizeof(uint32_t) << DJI_LIDAR_CLOUD_LZF_HASH_LOG);
+        if (m_hashTable == nullptr) {
+            free(m_columnBuffer);
+            m_columnBuffer = nullptr;
+            return false;
+        }
+    }
+
+    m_freeBuffers.clear();
+    m_queuedBuffers.clear();
+    for (uint32_t i = 0; i < m_buffers.size(); i++) {
+        m_buffers[i].size = 0;
+        m_buffers[i].files.clear();
+        m_freeBuffers.push_back(i);
+    }
+    m_queuedBuffers.reserve(m_buffers.size());
+    m_currentBuffer = nullptr;
+
+    if (m_config.isContainer) {
+        localtime_r(&now, &localTime);
+        strftime(timeString, sizeof(timeString), "%Y%m%d_%H%M%S", &localTime);
+        snprintf(containerPath, sizeof(containerPath), "%s/%s_%s.dcl", m_folderPath.c_str(), m_filePrefix.c_str(),
+                 timeString);
+
+        m_containerFd = open(containerPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (m_containerFd < 0) {
+            USER_LOG_ERROR("Open cloud container %s failed, errno %d.", containerPath, errno);
+            return false;
+        }
+        m_containerOffset = 0;
+        m_writtenOffset = 0;
+        m_syncedOffset = 0;
+        m_index.clear();
+        m_index.reserve(DJI_LIDAR_CLOUD_WRITER_INDEX_RESERVE);
+        USER_LOG_INFO("Writing lidar frames into %s.", containerPath);
+    }
+
+    m_isRunning = true;
+    if (pthread_create(&m_ioThread, nullptr, ioThreadEntry, this) != 0) {
+        USER_LOG_ERROR("Create cloud writer thread failed.");
+        m_isRunning = false;
+        if (m_containerFd >= 0) {
+            close(m_containerFd);
+            m_containerFd = -1;
+        }
+        return false;
+    }
+
+    return true;
+}
+
+void DJILidarCloudWriter::stop()
+{
+    if (!m_isRunning) {
+        return;
+    }
+
+    if (m_currentBuffer != nullptr) {
+        submitCurrentBuffer();
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    m_isRunning = false;
+    pthread_cond_broadcast(&m_queuedCond);
+    pthread_mutex_unlock(&m_mutex);
+
+    // The I/O thread writes out every queued buffer before it leaves
+    pthread_join(m_ioThread, nullptr);
+
+    if (m_containerFd >= 0) {
+        finishContainer();
+    }
+}
+
+bool DJILidarCloudWriter::writeFrame(const T_DjiLidarFrameView &frame)
+{
+    size_t recordHeaderSize = m_config.isContainer ? sizeof(T_DjiLidarCloudContainerFrameHeader) : 0;
+    uint32_t pointCount = 0;
+    size_t maxSize;
+    size_t dataSize;
+    uint8_t *out;
+
+    if (!m_isRunning) {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < frame.pkgNum; i++) {
+        pointCount += frame.pkgs[i].header.dotNum < DJI_PTS_NUM_PER_PKG ? frame.pkgs[i].header.dotNum
+                                                                        : DJI_PTS_NUM_PER_PKG;
+    }
+
+    maxSize = recordHeaderSize + DJI_LIDAR_CLOUD_WRITER_HEADER_SIZE_MAX + 2 * sizeof(uint32_t) +
+              DjiLidarCloudWriter_GetCompressBound(pointCount * DJI_LIDAR_CLOUD_WRITER_POINT_SIZE);
+    if (m_currentBuffer != nullptr && m_currentBuffer->size + maxSize > m_bufferSize) {
+        submitCurrentBuffer();
+    }
+    if (m_currentBuffer == nullptr) {
+        takeFreeBuffer();
+    }
+
+    out = m_currentBuffer->data + m_currentBuffer->size;
+    dataSize = packFrame(frame, pointCount, out + recordHeaderSize);
+
+    if (m_config.isContainer) {
+        T_DjiLidarCloudContainerFrameHeader recordHeader;
+        T_DjiLidarCloudContainerIndexEntry entry;
+
+        recordHeader.magic = DJI_LIDAR_CLOUD_CONTAINER_FRAME_MAGIC;
+        recordHeader.frameCnt = frame.frameCnt;
+        recordHeader.pointCount = pointCount;
+        recordHeader.dataSize = (uint32_t) dataSize;
+        recordHeader.timeStampNs = frame.timeStampNs;
+        memcpy(out, &recordHeader, sizeof(recordHeader));
+
+        entry.timeStampNs = frame.timeStampNs;
+        entry.offset = m_containerOffset + recordHeaderSize;
+        entry.dataSize = (uint32_t) dataSize;
+        entry.frameCnt = frame.frameCnt;
+        entry.pointCount = pointCount;
+        entry.reserved = 0;
+        m_index.push_back(entry);
+        m_containerOffset += recordHeaderSize + dataSize;
+    } else {
+        FileSegment file;
+        char timeString[32];
+        struct timespec now;
+        struct tm localTime;
+
+        clock_gettime(CLOCK_REALTIME, &now);
+        localtime_r(&now.tv_sec, &localTime);
+        strftime(timeString, sizeof(timeString), "%Y%m%d_%H%M%S", &localTime);
+        snprintf(file.path, sizeof(file.path), "%s/%s_%s%03ld_%u.%s", m_folderPath.c_str(), m_filePrefix.c_str(),
+                 timeString, now.tv_nsec / 1000000, frame.frameCnt,
+                 m_config.format == DJI_LIDAR_CLOUD_FORMAT_PLY_BINARY ? "ply" : "pcd");
+        file.offset = m_currentBuffer->size;
+        file.size = dataSize;
+        m_currentBuffer->files.push_back(file);
+    }
+
+    m_currentBuffer->size += recordHeaderSize + dataSize;
+
+    pthread_mutex_lock(&m_mutex);
+    m_statistics.frameCount++;
+    m_statistics.pointCount += pointCount;
+    m_statistics.rawBytes += pointCount * DJI_LIDAR_CLOUD_WRITER_POINT_SIZE;
+    pthread_mutex_unlock(&m_mutex);
+
+    return true;
+}
+
+void DJILidarCloudWriter::getStatistics(T_DjiLidarCloudWriterStatistics &statistics)
+{
+    pthread_mutex_lock(&m_mutex);
+    statistics = m_statistics;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+/* Private functions definition-----------------------------------------------*/
+void *DJILidarCloudWriter::ioThreadEntry(void *p)
+{
+    static_cast<DJILidarCloudWriter *>(p)->ioThreadFunc();
+
+    return nullptr;
+}
+
+void DJILidarCloudWriter::ioThreadFunc()
+{
+    uint32_t bufferIndex;
+
+    while (true) {
+        pthread_mutex_lock(&m_mutex);
+        while (m_queuedBuffers.empty() && m_isRunning) {
+            pthread_cond_wait(&m_queuedCond, &m_mutex);
+        }
+        if (m_queuedBuffers.empty()) {
+            pthread_mutex_unlock(&m_mutex);
+            break;
+        }
+        bufferIndex = m_queuedBuffers.front();
+        m_queuedBuffers.erase(m_queuedBuffers.begin());
+        pthread_mutex_unlock(&m_mutex);
+
+        writeBuffer(m_buffers[bufferIndex]);
+
+        m_buffers[bufferIndex].size = 0;
+        m_buffers[bufferIndex].files.clear();
+        pthread_mutex_lock(&m_mutex);
+        m_freeBuffers.push_back(bufferIndex);
+        pthread_cond_signal(&m_freeCond);
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+void DJILidarCloudWriter::takeFreeBuffer()
+{
+    uint64_t startTimeUs = 0;
+    double waitMs;
+
+    pthread_mutex_lock(&m_mutex);
+    if (m_freeBuffers.empty()) {
+        // Storage is slower than the lidar right now, the frame waits here and the frame pool drops the next ones
+        startTimeUs = getTimeUs();
+        m_statistics.bufferWaitCount++;
+        while (m_freeBuffers.empty()) {
+            pthread_cond_wait(&m_freeCond, &m_mutex);
+        }
+        waitMs = (double) (getTimeUs() - startTimeUs) / 1000.0;
+        if (waitMs > m_statistics.maxBufferWaitMs) {
+            m_statistics.maxBufferWaitMs = waitMs;
+        }
+    }
+    m_currentBufferIndex = m_freeBuffers.back();
+    m_freeBuffers.pop_back();
+    pthread_mutex_unlock(&m_mutex);
+
+    m_currentBuffer = &m_buffers[m_currentBufferIndex];
+}
+
+void DJILidarCloudWriter::submitCurrentBuffer()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_queuedBuffers.push_back(m_currentBufferIndex);
+    pthread_cond_signal(&m_queuedCond);
+    pthread_mutex_unlock(&m_mutex);
+
+    m_currentBuffer = nullptr;
+}
+
+void DJILidarCloudWriter::writeBuffer(Buffer &buffer)
+{
+    uint64_t startTimeUs = getTimeUs();
+    uint64_t writtenBytes = 0;
+    uint32_t fileCount = 0;
+    uint32_t errorCount = 0;
+    double writeMs;
+    int fd;
+
+    if (m_containerFd >= 0) {
+        uint64_t start = m_writtenOffset;
+
+        if (writeAll(m_containerFd, buffer.data, buffer.size)) {
+            writtenBytes += buffer.size;
+            // Start writing this buffer back right away
+            sync_file_range(m_containerFd, (off_t) start, (off_t) buffer.size, SYNC_FILE_RANGE_WRITE);
+        } else {
+            errorCount++;
+            // The index already holds the offsets the packer gave this buffer and the ones after it, so the next
+            // buffer still goes where the index expects it. The lost frames read back as a hole without the record
+            // magic.
+            lseek(m_containerFd, (off_t) (start + buffer.size), SEEK_SET);
+        }
+        m_writtenOffset = start + buffer.size;
+
+        // Wait for the previous buffers to be written back, then drop them from the page cache. Dirty pages stay
+        // bounded to about two buffers instead of piling up until the kernel flushes them all at once and stalls the
+        // storage.
+        if (start > m_syncedOffset) {
+            sync_file_range(m_containerFd, (off_t) m_syncedOffset, (off_t) (start - m_syncedOffset),
+                            SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+            posix_fadvise(m_containerFd, (off_t) m_syncedOffset, (off_t) (start - m_syncedOffset),
+                          POSIX_FADV_DONTNEED);
+            m_syncedOffset = start;
+        }
+    } else {
+        for (const auto &file : buffer.files) {
+            fd = open(file.path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                USER_LOG_ERROR("Open cloud file %s failed, errno %d.", file.path, errno);
+                errorCount++;
+                continue;
+            }
+            if (writeAll(fd, buffer.data + file.offset, file.size)) {
+                writtenBytes += file.size;
+                fileCount++;
+            } else {
+                errorCount++;
+            }
+            close(fd);
+        }
+    }
+
+    writeMs = (double) (getTimeUs() - startTimeUs) / 1000.0;
+
+    pthread_mutex_lock(&m_mutex);
+    m_statistics.writtenBytes += writtenBytes;
+    m_statistics.fileCount += fileCount;
+    m_statistics.writeErrorCount += errorCount;
+    if (writeMs > m_statistics.maxWriteMs) {
+        m_statistics.maxWriteMs = writeMs;
+    }
+    pthread_mutex_unlock(&m_mutex);
+}
+
+bool DJILidarCloudWriter::writeAll(int fd, const uint8_t *data, size_t size)
+{
+    ssize_t len;
+
+    while (size > 0) {
+        len = write(fd, data, size);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            USER_LOG_ERROR("Write cloud data failed, errno %d.", errno);
+            return false;
+        }
+        data += len;
+        size -= (size_t) len;
+    }
+
+    return true;
+}
+
+void DJILidarCloudWriter::finishContainer()
+{
+    T_DjiLidarCloudContainerTrailer trailer;
+
+    trailer.magic = DJI_LIDAR_CLOUD_CONTAINER_TRAILER_MAGIC;
+    trailer.version = DJI_LIDAR_CLOUD_CONTAINER_VERSION;
+    trailer.frameCount = (uint32_t) m_index.size();
+    trailer.format = m_config.format;
+    trailer.indexOffset = m_containerOffset;
+
+    if (!writeAll(m_containerFd, (const uint8_t *) m_index.data(),
+                  m_index.size() * sizeof(T_DjiLidarCloudContainerIndexEntry)) ||
+        !writeAll(m_containerFd, (const uint8_t *) &trailer, sizeof(trailer))) {
+        pthread_mutex_lock(&m_mutex);
+        m_statistics.writeErrorCount++;
+        pthread_mutex_unlock(&m_mutex);
+    }
+
+    fdatasync(m_containerFd);
+    close(m_containerFd);
+    m_containerFd = -1;
+
+    USER_LOG_INFO("Lidar cloud container finished with %u frames.", trailer.frameCount);
+}
+
+size_t DJILidarCloudWriter::packFrame(const T_DjiLidarFrameView &frame, uint32_t pointCount, uint8_t *out)
+{
+    uint32_t columnSize;
+    uint32_t compressedSize;
+    size_t headerSize;
+    uint8_t *pos;
+    int len;
+
+    if (m_config.format == DJI_LIDAR_CLOUD_FORMAT_PLY_BINARY) {
+        len = snprintf((char *) out, DJI_LIDAR_CLOUD_WRITER_HEADER_SIZE_MAX,
+                       "ply\n"
+                       "format binary_little_endian 1.0\n"
+                       "comment frameCnt %u timeStampNs %llu\n"
+                       "element vertex %u\n"
+                       "property float x\n"
+                       "property float y\n"
+                       "property float z\n"
+                       "property uchar intensity\n"
+                       "property uchar label\n"
+                       "end_header\n",
+                       frame.frameCnt, (unsigned long long) frame.timeStampNs, pointCount);
+    } else {
+        len = snprintf((char *) out, DJI_LIDAR_CLOUD_WRITER_HEADER_SIZE_MAX,
+                       "# .PCD v0.7 - Point Cloud Data file format\n"
+                       "VERSION 0.7\n"
+                       "FIELDS x y z intensity label\n"
+                       "SIZE 4 4 4 1 1\n"
+                       "TYPE F F F U U\n"
+                       "COUNT 1 1 1 1 1\n"
+                       "WIDTH %u\n"
+                       "HEIGHT 1\n"
+                       "VIEWPOINT 0 0 0 1 0 0 0\n"
+                       "POINTS %u\n"
+                       "DATA %s\n",
+                       pointCount, pointCount,
+                       m_config.format == DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY_COMPRESSED ? "binary_compressed"
+                                                                                        : "binary");
+    }
+    headerSize = (size_t) len;
+    pos = out + headerSize;
+
+    if (m_config.format != DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY_COMPRESSED) {
+        for (uint16_t i = 0; i < frame.pkgNum; i++) {
+            uint32_t dotNum = frame.pkgs[i].header.dotNum < DJI_PTS_NUM_PER_PKG ? frame.pkgs[i].header.dotNum
+                                                                                : DJI_PTS_NUM_PER_PKG;
+
+            memcpy(pos, frame.pkgs[i].points, dotNum * DJI_LIDAR_CLOUD_WRITER_POINT_SIZE);
+            pos += dotNum * DJI_LIDAR_CLOUD_WRITER_POINT_SIZE;
+        }
+
+        return (size_t) (pos - out);
+    }
+
+    // binary_compressed keeps every field in its own column: all x, then all y, z, intensity and label
+    float *xColumn = (float *) m_columnBuffer;
+    float *yColumn = xColumn + pointCount;
+    float *zColumn = yColumn + pointCount;
+    uint8_t *intensityColumn = (uint8_t *) (zColumn + pointCount);
+    uint8_t *labelColumn = intensityColumn + pointCount;
+    uint32_t index = 0;
+
+    for (uint16_t i = 0; i < frame.pkgNum; i++) {
+        const T_DJIPerceptionLidarPoint *points = frame.pkgs[i].points;
+        uint32_t dotNum = frame.pkgs[i].header.dotNum < DJI_PTS_NUM_PER_PKG ? frame.pkgs[i].header.dotNum
+                                                                            : DJI_PTS_NUM_PER_PKG;
+
+        for (uint32_t j = 0; j < dotNum; j++, index++) {
+            xColumn[index] = points[j].x;
+            yColumn[index] = points[j].y;
+            zColumn[index] = points[j].z;
+            intensityColumn[index] = points[j].intensity;
+            labelColumn[index] = points[j].label;
+        }
+    }
+
+    columnSize = pointCount * DJI_LIDAR_CLOUD_WRITER_POINT_SIZE;
+    compressedSize = compressLzf(m_columnBuffer, columnSize, pos + 2 * sizeof(uint32_t),
+                                 DjiLidarCloudWriter_GetCompressBound(columnSize), m_hashTable);
+    memcpy(pos, &compressedSize, sizeof(uint32_t));
+    memcpy(pos + sizeof(uint32_t), &columnSize, sizeof(uint32_t));
+
+    return headerSize + 2 * sizeof(uint32_t) + compressedSize;
+}
+
+size_t DJILidarCloudWriter::getMaxFrameSize()
+{
+    return sizeof(T_DjiLidarCloudContainerFrameHeader) + DJI_LIDAR_CLOUD_WRITER_HEADER_SIZE_MAX +
+           2 * sizeof(uint32_t) +
+           DjiLidarCloudWriter_GetCompressBound(DJI_LIDAR_CLOUD_WRITER_POINT_NUM_MAX *
+                                                DJI_LIDAR_CLOUD_WRITER_POINT_SIZE);
+}
+
+/**
+ * @brief Compress with LZF, the compression PCL reads binary_compressed point clouds with.
+ * @note A literal run is one control byte holding the run length minus one, up to 32 bytes, followed by the bytes.
+ * A back reference is three bits of length minus two, an extra length byte when those bits are all set, and 13 bits
+ * of distance minus one.
+ * @return Size of the compressed data, 0 when it does not fit into the output.
+ */
+uint32_t DJILidarCloudWriter::compressLzf(const uint8_t *in, uint32_t inSize, uint8_t *out, uint32_t outSize,
+                                          uint32_t *hashTable)
+{
+    uint32_t inPos = 0;
+    uint32_t outPos = 1;        // The control byte of the first literal run is filled in once its length is known
+    uint32_t literalCount = 0;
+
+    if (inSize == 0 || outSize == 0) {
+        return 0;
+    }
+
+    memset(hashTable, 0, sizeof(uint32_t) << DJI_LIDAR_CLOUD_LZF_HASH_LOG);
+
+    while (inPos < inSize) {
+        uint32_t matchLen = 0;
+        uint32_t distance = 0;
+
+        if (inPos + 2 < inSize) {
+            uint32_t value = ((uint32_t) in[inPos] << 16) | ((uint32_t) in[inPos + 1] << 8) | in[inPos + 2];
+            uint32_t hash = (value * 2654435761U) >> (32 - DJI_LIDAR_CLOUD_LZF_HASH_LOG);
+            uint32_t ref = hashTable[hash];
+
+            // Positions are stored plus one, so an empty entry reads as zero
+            hashTable[hash] = inPos + 1;
+            if (ref != 0) {
+                ref--;
+                distance = inPos - ref;
+                if (distance <= DJI_LIDAR_CLOUD_LZF_OFFSET_MAX && in[ref] == in[inPos] &&
+                    in[ref + 1] == in[inPos + 1] && in[ref + 2] == in[inPos + 2]) {
+                    uint32_t maxLen = inSize - inPos < DJI_LIDAR_CLOUD_LZF_MATCH_MAX ? inSize - inPos
+                                                                                     : DJI_LIDAR_CLOUD_LZF_MATCH_MAX;
+
+                    matchLen = 3;
+                    while (matchLen < maxLen && in[ref + matchLen] == in[inPos + matchLen]) {
+                        matchLen++;
+                    }
+                }
+            }
+        }
+
+        if (matchLen == 0) {
+            if (outPos >= outSize) {
+                return 0;
+            }
+            out[outPos++] = in[inPos++];
+            literalCount++;
+            if (literalCount == DJI_LIDAR_CLOUD_LZF_LITERAL_MAX) {
+                out[outPos - literalCount - 1] = (uint8_t) (literalCount - 1);
+                literalCount = 0;
+                outPos++;
+            }
+            continue;
+        }
+
+        // Close the literal run, or take back its control byte when the run is empty
+        if (literalCount > 0) {
+            out[outPos - literalCount - 1] = (uint8_t) (literalCount - 1);
+        } else {
+            outPos--;
+        }
+
+        if (outPos + 4 > outSize) {
+            return 0;
+        }
+
+        distance--;
+        if (matchLen - 2 < 7) {
+            out[outPos++] = (uint8_t) (((matchLen - 2) << 5) | (distance >> 8));
+        } else {
+            out[outPos++] = (uint8_t) ((7 << 5) | (distance >> 8));
+            out[outPos++] = (uint8_t) (matchLen - 2 - 7);
+        }
+        out[outPos++] = (uint8_t) distance;
+
+        literalCount = 0;
+        outPos++;
+        inPos += matchLen;
+    }
+
+    if (literalCount > 0) {
+        out[outPos - literalCount - 1] = (uint8_t) (literalCount - 1);
+    } else {
+        outPos--;
+    }
+
+    return outPos;
+}
+
+uint64_t DJILidarCloudWriter::getTimeUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint32_t DjiLidarCloudWriter_GetCompressBound(uint32_t size)
+{
+    // Incompressible data costs one control byte per 32 literals
+    return size + size / DJI_LIDAR_CLOUD_LZF_LITERAL_MAX + 16;
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,188 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_cloud_writer.hpp
+ * @brief   This is the header file for "dji_lidar_cloud_writer.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIDAR_CLOUD_WRITER_H
+#define DJI_LIDAR_CLOUD_WRITER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "pthread.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "dji_lidar_frame_pool.hpp"
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_LIDAR_CLOUD_WRITER_BUFFER_SIZE_DEFAULT     (4 * 1024 * 1024)
+#define DJI_LIDAR_CLOUD_WRITER_BUFFER_COUNT_DEFAULT    (4)
+#define DJI_LIDAR_CLOUD_WRITER_FILE_NAME_LEN_MAX       (256)
+
+// Container file layout, all fields little endian:
+//   frame record header, frame file as it would be written on its own, repeated for every frame
+//   index entry for every frame
+//   trailer, locating the index
+// The frame record headers let the frames be recovered by walking the file when the recording ended before the index
+// was written.
+#define DJI_LIDAR_CLOUD_CONTAINER_FRAME_MAGIC          (0x464C4344)    // "DCLF"
+#define DJI_LIDAR_CLOUD_CONTAINER_TRAILER_MAGIC        (0x494C4344)    // "DCLI"
+#define DJI_LIDAR_CLOUD_CONTAINER_VERSION              (1)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY = 0,
+    DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY_COMPRESSED,   /*!< Fields stored one after another and compressed with LZF. */
+    DJI_LIDAR_CLOUD_FORMAT_PLY_BINARY,
+} E_DjiLidarCloudFormat;
+
+typedef struct {
+    const char *folderPath;     /*!< Created when it does not exist. */
+    const char *filePrefix;
+    E_DjiLidarCloudFormat format;
+    bool isContainer;           /*!< Append every frame to one indexed .dcl file instead of writing a file per frame. */
+    uint32_t bufferSize;        /*!< 0 selects the default, raised to the largest possible frame, unit: byte. */
+    uint32_t bufferCount;       /*!< 0 selects the default. */
+} T_DjiLidarCloudWriterConfig;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t frameCnt;
+    uint32_t pointCount;
+    uint32_t dataSize;          /*!< Size of the frame file following the header. */
+    uint64_t timeStampNs;
+} T_DjiLidarCloudContainerFrameHeader;
+
+typedef struct {
+    uint64_t timeStampNs;
+    uint64_t offset;            /*!< Offset of the frame file in the container. */
+    uint32_t dataSize;
+    uint32_t frameCnt;
+    uint32_t pointCount;
+    uint32_t reserved;
+} T_DjiLidarCloudContainerIndexEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frameCount;
+    uint32_t format;            /*!< E_DjiLidarCloudFormat of every frame file. */
+    uint64_t indexOffset;
+} T_DjiLidarCloudContainerTrailer;
+
+typedef struct {
+    uint64_t frameCount;
+    uint64_t pointCount;
+    uint64_t rawBytes;          /*!< Size of the points before packing. */
+    uint64_t writtenBytes;
+    uint32_t fileCount;
+    uint32_t bufferWaitCount;   /*!< Frames that had to wait for the I/O thread to free a buffer. */
+    double maxBufferWaitMs;
+    double maxWriteMs;          /*!< Longest write of a single buffer. */
+    uint32_t writeErrorCount;
+} T_DjiLidarCloudWriterStatistics;
+
+/*! @note
+ * Writes lidar frames as PCD or PLY files from a background I/O thread. A
+ * frame is packed straight into one of a few large page aligned buffers:
+ * the uncompressed formats store the points exactly as the SDK lays them
+ * out, so packing is one copy per package, and the compressed PCD format
+ * splits the fields into columns in one pass before compressing them. Full
+ * buffers go to the I/O thread, which writes each with as few calls as the
+ * files allow and keeps the page cache from piling up dirty pages, so the
+ * storage sees steady writes. The caller only waits when every buffer is
+ * still queued for writing.
+ */
+class DJILidarCloudWriter {
+public:
+    explicit DJILidarCloudWriter(const T_DjiLidarCloudWriterConfig &config);
+    ~DJILidarCloudWriter();
+
+    /*! @brief Allocate the buffers, open the container file when used and start the I/O thread. */
+    bool start();
+
+    /*! @brief Write out the buffered frames, finish the container file and stop the I/O thread. */
+    void stop();
+
+    /*! @brief Pack a frame into the current buffer. Called from one thread only.
+     *  @return false when the writer is not started.
+     */
+    bool writeFrame(const T_DjiLidarFrameView &frame);
+
+    void getStatistics(T_DjiLidarCloudWriterStatistics &statistics);
+
+private:
+    struct FileSegment {
+        size_t offset;
+        size_t size;
+        char path[DJI_LIDAR_CLOUD_WRITER_FILE_NAME_LEN_MAX];
+    };
+
+    struct Buffer {
+        uint8_t *data;
+        size_t size;
+        std::vector<FileSegment> files;     /*!< Files in the buffer, empty when writing a container. */
+    };
+
+    static void *ioThreadEntry(void *p);
+    void ioThreadFunc();
+    void takeFreeBuffer();
+    void submitCurrentBuffer();
+    void writeBuffer(Buffer &buffer);
+    bool writeAll(int fd, const uint8_t *data, size_t size);
+    void finishContainer();
+    size_t packFrame(const T_DjiLidarFrameView &frame, uint32_t pointCount, uint8_t *out);
+    size_t getMaxFrameSize();
+    static uint32_t compressLzf(const uint8_t *in, uint32_t inSize, uint8_t *out, uint32_t outSize,
+                               uint32_t *hashTable);
+    static uint64_t getTimeUs();
+
+    T_DjiLidarCloudWriterConfig m_config;
+    std::string m_folderPath;
+    std::string m_filePrefix;
+    std::vector<Buffer> m_buffers;
+    std::vector<uint32_t> m_freeBuffers;
+    std::vector<uint32_t> m_queuedBuffers;
+    size_t m_bufferSize;
+    Buffer *m_currentBuffer;
+    uint32_t m_currentBufferIndex;
+    bool m_isRunning;
+    pthread_t m_ioThread;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_queuedCond;
+    pthread_cond_t m_freeCond;
+
+    uint8_t *m_columnBuffer;                /*!< Points split into fields, before compression. */
+    uint32_t *m_hashTable;
+    int m_containerFd;
+    uint64_t m_containerOffset;             /*!< Offset the next packed byte lands at in the container. */
+    uint64_t m_writtenOffset;               /*!< Offset the next buffer is written at, I/O thread only. */
+    uint64_t m_syncedOffset;                /*!< Container bytes written back and dropped from the page cache. */
+    std::vector<T_DjiLidarCloudContainerIndexEntry> m_index;
+    T_DjiLidarCloudWriterStatistics m_statistics;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#endif // DJI_LIDAR_CLOUD_WRITER_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,140 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_frame_pool.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_lidar_frame_pool.hpp"
+#include <cstring>
+
+/* Private constants ---------------------------------------------------------*/
+
+/* Private types -------------------------------------------------------------*/
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+DJILidarFramePool::DJILidarFramePool(uint32_t slotCount)
+    : m_slots(nullptr),
+      m_pkgs(nullptr),
+      m_slotCount(slotCount > 0 ? slotCount : DJI_LIDAR_FRAME_POOL_SLOT_COUNT_DEFAULT),
+      m_pushIndex(0),
+      m_pushPadding(),
+      m_releaseIndex(0),
+      m_releasePadding(),
+      m_pushedCount(0),
+      m_droppedCount(0),
+      m_copiedBytes(0),
+      m_maxPendingCount(0)
+{
+    m_slots = new Slot[m_slotCount];
+    m_pkgs = new T_DjiPerceptionLidarDecodePkg[(size_t) m_slotCount * DJI_LIDAR_PKG_BUFFER_NUM];
+    // Touch every page now, the first frames would otherwise pay for the page faults in the lidar callback
+    memset(m_pkgs, 0, sizeof(T_DjiPerceptionLidarDecodePkg) * m_slotCount * DJI_LIDAR_PKG_BUFFER_NUM);
+
+    for (uint32_t i = 0; i < m_slotCount; i++) {
+        memset(&m_slots[i].view, 0, sizeof(m_slots[i].view));
+        m_slots[i].pkgs = m_pkgs + (size_t) i * DJI_LIDAR_PKG_BUFFER_NUM;
+        m_slots[i].view.pkgs = m_slots[i].pkgs;
+    }
+}
+
+DJILidarFramePool::~DJILidarFramePool()
+{
+    delete[] m_pkgs;
+    delete[] m_slots;
+}
+
+bool DJILidarFramePool::push(const T_DjiLidarFrame *frame)
+{
+    uint64_t pushIndex = m_pushIndex.load(std::memory_order_relaxed);
+    uint32_t pendingCount = (uint32_t) (pushIndex - m_releaseIndex.load(std::memory_order_acquire));
+    uint16_t pkgNum;
+    Slot *slot;
+
+    if (pendingCount >= m_slotCount) {
+        m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    slot = &m_slots[pushIndex % m_slotCount];
+    pkgNum = frame->pkgNum < DJI_LIDAR_PKG_BUFFER_NUM ? frame->pkgNum : DJI_LIDAR_PKG_BUFFER_NUM;
+
+    memcpy(slot->pkgs, frame->pkgs, sizeof(T_DjiPerceptionLidarDecodePkg) * pkgNum);
+    slot->view.timeStampNs = frame->timeStampNs;
+    slot->view.frameCnt = frame->frameCnt;
+    slot->view.pkgNum = pkgNum;
+    slot->view.poseTimeMs = frame->poseTimeMs;
+    slot->view.naviFlag = frame->naviFlag;
+    memcpy(slot->view.naviPos, frame->naviPos, sizeof(slot->view.naviPos));
+    memcpy(slot->view.naviQuat, frame->naviQuat, sizeof(slot->view.naviQuat));
+
+    m_pushIndex.store(pushIndex + 1, std::memory_order_release);
+
+    m_pushedCount.fetch_add(1, std::memory_order_relaxed);
+    m_copiedBytes.fetch_add(sizeof(T_DjiPerceptionLidarDecodePkg) * pkgNum, std::memory_order_relaxed);
+    if (pendingCount + 1 > m_maxPendingCount.load(std::memory_order_relaxed)) {
+        m_maxPendingCount.store(pendingCount + 1, std::memory_order_relaxed);
+    }
+
+    return true;
+}
+
+bool DJILidarFramePool::peek(T_DjiLidarFrameView &view)
+{
+    uint64_t releaseIndex = m_releaseIndex.load(std::memory_order_relaxed);
+
+    if (m_pushIndex.load(std::memory_order_acquire) == releaseIndex) {
+        return false;
+    }
+
+    view = m_slots[releaseIndex % m_slotCount].view;
+
+    return true;
+}
+
+void DJILidarFramePool::release()
+{
+    uint64_t releaseIndex = m_releaseIndex.load(std::memory_order_relaxed);
+
+    if (m_pushIndex.load(std::memory_order_acquire) == releaseIndex) {
+        return;
+    }
+
+    m_releaseIndex.store(releaseIndex + 1, std::memory_order_release);
+}
+
+void DJILidarFramePool::getStatistics(T_DjiLidarFramePoolStatistics &statistics)
+{
+    statistics.pushedCount = m_pushedCount.load(std::memory_order_relaxed);
+    statistics.releasedCount = m_releaseIndex.load(std::memory_order_relaxed);
+    statistics.droppedCount = m_droppedCount.load(std::memory_order_relaxed);
+    statistics.copiedBytes = m_copiedBytes.load(std::memory_order_relaxed);
+    statistics.maxPendingCount = m_maxPendingCount.load(std::memory_order_relaxed);
+}
+
+/* Private functions definition-----------------------------------------------*/
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,115 @@
+/**
+ ********************************************************************
+ * @file    dji_lidar_frame_pool.hpp
+ * @brief   This is the header file for "dji_lidar_frame_pool.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIDAR_FRAME_POOL_H
+#define DJI_LIDAR_FRAME_POOL_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <atomic>
+#include <cstdint>
+#include "dji_perception.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_LIDAR_FRAME_POOL_SLOT_COUNT_DEFAULT    (4)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint64_t timeStampNs;
+    uint32_t frameCnt;
+    uint16_t pkgNum;                                /*!< Number of packages in pkgs, all of them valid. */
+    const T_DjiPerceptionLidarDecodePkg *pkgs;
+    uint32_t poseTimeMs;
+    uint16_t naviFlag;
+    float naviPos[3];
+    float naviQuat[4];
+} T_DjiLidarFrameView;
+
+typedef struct {
+    uint64_t pushedCount;
+    uint64_t releasedCount;
+    uint64_t droppedCount;      /*!< Frames dropped without copying because every slot was taken. */
+    uint64_t copiedBytes;
+    uint32_t maxPendingCount;   /*!< Most frames waiting for the consumer at once. */
+} T_DjiLidarFramePoolStatistics;
+
+/*! @note
+ * Fixed set of lidar frame slots between the lidar callback and a processing
+ * thread. Every slot is allocated and touched once when the pool is created,
+ * so the memory of the pool never grows however far the consumer falls
+ * behind. The producer copies only the valid decode packages of a frame into
+ * the next free slot, or drops the frame without copying when none is free.
+ * The consumer reads the slot in place through a view and hands it back
+ * with release. Slots are passed in order through a single producer single
+ * consumer ring of two atomic counters, neither side ever takes a lock.
+ */
+class DJILidarFramePool {
+public:
+    explicit DJILidarFramePool(uint32_t slotCount = DJI_LIDAR_FRAME_POOL_SLOT_COUNT_DEFAULT);
+    ~DJILidarFramePool();
+
+    /*! @brief Copy the valid packages of a frame into the next free slot. Producer side only.
+     *  @return false when the frame was dropped because every slot was taken.
+     */
+    bool push(const T_DjiLidarFrame *frame);
+
+    /*! @brief Get the oldest frame not released yet. Consumer side only.
+     *  @param view: frame in its slot, valid until release is called.
+     *  @return false when no frame is waiting.
+     */
+    bool peek(T_DjiLidarFrameView &view);
+
+    /*! @brief Hand the slot of the frame returned by peek back to the producer. */
+    void release();
+
+    void getStatistics(T_DjiLidarFramePoolStatistics &statistics);
+
+private:
+    struct Slot {
+        T_DjiLidarFrameView view;
+        T_DjiPerceptionLidarDecodePkg *pkgs;
+    };
+
+    Slot *m_slots;
+    T_DjiPerceptionLidarDecodePkg *m_pkgs;
+    uint32_t m_slotCount;
+
+    // Both counters only ever increase, the slot of a counter is its value modulo the slot count. The padding keeps
+    // the producer and the consumer from writing to the same cache line.
+    std::atomic<uint64_t> m_pushIndex;
+    uint8_t m_pushPadding[64 - sizeof(std::atomic<uint64_t>)];
+    std::atomic<uint64_t> m_releaseIndex;
+    uint8_t m_releasePadding[64 - sizeof(std::atomic<uint64_t>)];
+
+    std::atomic<uint64_t> m_pushedCount;
+    std::atomic<uint64_t> m_droppedCount;
+    std::atomic<uint64_t> m_copiedBytes;
+    std::atomic<uint32_t> m_maxPendingCount;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#endif // DJI_LIDAR_FRAME_POOL_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -0,0 +1,887 @@
+/**
+ ********************************************************************
+ * @file    dji_stereo_depth_pipeline.cpp
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_stereo_depth_pipeline.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+
+/* Private constants ---------------------------------------------------------*/
+#define DJI_STEREO_DEPTH_COST_INVALID      (0xFFFF)
+#define DJI_STEREO_DEPTH_MAP_WEIGHT_BITS   (8)
+#define DJI_STEREO_DEPTH_COST_VECTOR_LANES (8)
+// Largest disparity that still fits the fixed point output
+#define DJI_STEREO_DEPTH_DISPARITY_MAX     (1024)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint32_t dataType;          /*!< E_DjiPerceptionCameraPosition */
+    uint32_t direction;         /*!< E_DjiPerceptionDirection */
+    bool isLeft;
+} T_DjiStereoDepthCameraPosition;
+
+/* Private values -------------------------------------------------------------*/
+static const T_DjiStereoDepthCameraPosition s_cameraPositions[] = {
+    {RECTIFY_DOWN_LEFT,   DJI_PERCEPTION_RECTIFY_DOWN,  true},
+    {RECTIFY_DOWN_RIGHT,  DJI_PERCEPTION_RECTIFY_DOWN,  false},
+    {RECTIFY_FRONT_LEFT,  DJI_PERCEPTION_RECTIFY_FRONT, true},
+    {RECTIFY_FRONT_RIGHT, DJI_PERCEPTION_RECTIFY_FRONT, false},
+    {RECTIFY_REAR_LEFT,   DJI_PERCEPTION_RECTIFY_REAR,  true},
+    {RECTIFY_REAR_RIGHT,  DJI_PERCEPTION_RECTIFY_REAR,  false},
+    {RECTIFY_UP_LEFT,     DJI_PERCEPTION_RECTIFY_UP,    true},
+    {RECTIFY_UP_RIGHT,    DJI_PERCEPTION_RECTIFY_UP,    false},
+    {RECTIFY_LEFT_LEFT,   DJI_PERCEPTION_RECTIFY_LEFT,  true},
+    {RECTIFY_LEFT_RIGHT,  DJI_PERCEPTION_RECTIFY_LEFT,  false},
+    {RECTIFY_RIGHT_LEFT,  DJI_PERCEPTION_RECTIFY_RIGHT, true},
+    {RECTIFY_RIGHT_RIGHT, DJI_PERCEPTION_RECTIFY_RIGHT, false},
+};
+
+/* Private functions declaration ---------------------------------------------*/
+static void DjiStereoDepth_GetRotationMatrix(const double *vector, double *matrix);
+static void DjiStereoDepth_GetRotationVector(const double *matrix, double *vector);
+static void DjiStereoDepth_MultiplyMatrix(const double *a, const double *b, bool isBTransposed, double *out);
+static void DjiStereoDepth_MultiplyVector(const double *matrix, const double *vector, double *out);
+
+/* Exported functions definition ---------------------------------------------*/
+DJIStereoDepthPipeline::DJIStereoDepthPipeline(const T_DjiStereoDepthConfig &config)
+    : m_config(config), m_directions(nullptr), m_isRunning(false), m_queue(), m_queueHead(0), m_queueCount(0)
+{
+    long cpuCount = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (m_config.workerCount == 0) {
+        m_config.workerCount = cpuCount > 0 ? (uint32_t) cpuCount : 1;
+    }
+    m_config.workerCount = std::min<uint32_t>(m_config.workerCount, DJI_STEREO_DEPTH_DIRECTION_NUM);
+
+    if (m_config.maxDisparity == 0) {
+        m_config.maxDisparity = DJI_STEREO_DEPTH_MAX_DISPARITY_DEFAULT;
+    }
+    m_config.maxDisparity = std::min<uint32_t>((m_config.maxDisparity + DJI_STEREO_DEPTH_COST_VECTOR_LANES - 1) &
+                                               ~(DJI_STEREO_DEPTH_COST_VECTOR_LANES - 1),
+                                               DJI_STEREO_DEPTH_DISPARITY_MAX);
+
+    if (m_config.blockSize == 0) {
+        m_config.blockSize = DJI_STEREO_DEPTH_BLOCK_SIZE_DEFAULT;
+    }
+    m_config.blockSize = std::min<uint32_t>(std::max<uint32_t>(m_config.blockSize | 1, 3),
+                                            DJI_STEREO_DEPTH_BLOCK_SIZE_MAX);
+    m_config.uniquenessRatio = std::min<uint32_t>(m_config.uniquenessRatio, 99);
+
+    m_directions = new Direction[DJI_STEREO_DEPTH_DIRECTION_NUM];
+    for (uint32_t i = 0; i < DJI_STEREO_DEPTH_DIRECTION_NUM; i++) {
+        Direction &direction = m_directions[i];
+
+        direction.hasParameters = false;
+        for (auto &pair: direction.pairs) {
+            pair.info = {};
+            pair.width = 0;
+            pair.height = 0;
+            pair.hasLeft = false;
+            pair.hasRight = false;
+            pair.isDropped = false;
+            pair.readyTimeUs = 0;
+        }
+        direction.input = &direction.pairs[0];
+        direction.pending = &direction.pairs[1];
+        direction.working = &direction.pairs[2];
+        direction.isPending = false;
+        direction.isBusy = false;
+        direction.lastAcceptedUs = 0;
+        direction.mapWidth = 0;
+        direction.mapHeight = 0;
+        direction.statistics = {};
+    }
+
+    pthread_mutex_init(&m_mutex, nullptr);
+    pthread_cond_init(&m_workCond, nullptr);
+}
+
+DJIStereoDepthPipeline::~DJIStereoDepthPipeline()
+{
+    stop();
+    delete[] m_directions;
+    pthread_cond_destroy(&m_workCond);
+    pthread_mutex_destroy(&m_mutex);
+}
+
+bool DJIStereoDepthPipeline::setCameraParameters(const T_DjiPerceptionCameraParametersPacket &packet)
+{
+    uint32_t directionNum = std::min<uint32_t>(packet.directionNum, IMAGE_MAX_DIRECTION_NUM);
+    bool isAnyValid = false;
+
+    if (m_isRunning) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < directionNum; i++) {
+        const T_DjiPerceptionCameraParameters &parameters = packet.cameraParameters[i];
+        double rotation[9];
+        double translation[3];
+        double halfRotationVector[3];
+        double halfRotation[9];
+        double rotatedTranslation[3];
+        double axis[3];
+        double alignRotation[9];
+        double rectifiedTranslation[3];
+        double translationNorm;
+        double axisNorm;
+
+        if (parameters.direction >= DJI_STEREO_DEPTH_DIRECTION_NUM) {
+            continue;
+        }
+        Direction &direction = m_directions[parameters.direction];
+
+        for (int j = 0; j < 9; j++) {
+            rotation[j] = parameters.rotationLeftInRight[j];
+        }
+        for (int j = 0; j < 3; j++) {
+            translation[j] = parameters.translationLeftInRight[j];
+        }
+        translationNorm = std::sqrt(translation[0] * translation[0] + translation[1] * translation[1] +
+                                    translation[2] * translation[2]);
+        if (translationNorm <= 0 || parameters.leftIntrinsics[0] <= 0 || parameters.rightIntrinsics[0] <= 0) {
+            direction.hasParameters = false;
+            continue;
+        }
+
+        // Rectify as OpenCV stereoRectify does: turn each camera half way towards the other, then turn both so
+        // the baseline runs along the rows
+        DjiStereoDepth_GetRotationVector(rotation, halfRotationVector);
+        for (auto &value: halfRotationVector) {
+            value *= -0.5;
+        }
+        DjiStereoDepth_GetRotationMatrix(halfRotationVector, halfRotation);
+        DjiStereoDepth_MultiplyVector(halfRotation, translation, rotatedTranslation);
+
+        axis[0] = 0;
+        axis[1] = rotatedTranslation[2] * (rotatedTranslation[0] > 0 ? 1 : -1);
+        axis[2] = -rotatedTranslation[1] * (rotatedTranslation[0] > 0 ? 1 : -1);
+        axisNorm = std::sqrt(axis[1] * axis[1] + axis[2] * axis[2]);
+        if (axisNorm > 0) {
+            double angle = std::acos(std::min(std::fabs(rotatedTranslation[0]) / translationNorm, 1.0));
+
+            for (auto &value: axis) {
+                value *= angle / axisNorm;
+            }
+        }
+        DjiStereoDepth_GetRotationMatrix(axis, alignRotation);
+        DjiStereoDepth_MultiplyMatrix(alignRotation, halfRotation, true, direction.leftRotation);
+        DjiStereoDepth_MultiplyMatrix(alignRotation, halfRotation, false, direction.rightRotation);
+        DjiStereoDepth_MultiplyVector(direction.rightRotation, translation, rectifiedTranslation);
+
+        memcpy(direction.leftIntrinsics, parameters.leftIntrinsics, sizeof(direction.leftIntrinsics));
+        memcpy(direction.rightIntrinsics, parameters.rightIntrinsics, sizeof(direction.rightIntrinsics));
+        direction.focal = (parameters.leftIntrinsics[0] + parameters.leftIntrinsics[4] +
+                           parameters.rightIntrinsics[0] + parameters.rightIntrinsics[4]) / 4;
+        direction.centerX = (parameters.leftIntrinsics[2] + parameters.rightIntrinsics[2]) / 2;
+        direction.centerY = (parameters.leftIntrinsics[5] + parameters.rightIntrinsics[5]) / 2;
+        direction.baseline = (float) std::fabs(rectifiedTranslation[0]);
+        direction.mapWidth = 0;
+        direction.mapHeight = 0;
+        direction.hasParameters = true;
+        isAnyValid = true;
+    }
+
+    return isAnyValid;
+}
+
+bool DJIStereoDepthPipeline::start()
+{
+    if (m_isRunning) {
+        return true;
+    }
+
+    m_isRunning = true;
+    for (uint32_t i = 0; i < m_config.workerCount; i++) {
+        pthread_t worker;
+
+        if (pthread_create(&worker, nullptr, workerEntry, this) != 0) {
+            stop();
+            return false;
+        }
+        m_workers.push_back(worker);
+    }
+
+    return true;
+}
+
+void DJIStereoDepthPipeline::stop()
+{
+    pthread_mutex_lock(&m_mutex);
+    m_isRunning = false;
+    pthread_cond_broadcast(&m_workCond);
+    pthread_mutex_unlock(&m_mutex);
+
+    for (auto &worker: m_workers) {
+        pthread_join(worker, nullptr);
+    }
+    m_workers.clear();
+
+    m_queueHead = 0;
+    m_queueCount = 0;
+    for (uint32_t i = 0; i < DJI_STEREO_DEPTH_DIRECTION_NUM; i++) {
+        m_directions[i].isPending = false;
+    }
+}
+
+bool DJIStereoDepthPipeline::submitImage(const T_DjiPerceptionImageInfo &info, const uint8_t *image,
+                                         uint32_t imageSize)
+{
+    const T_DjiStereoDepthCameraPosition *position = nullptr;
+    uint32_t width = info.rawInfo.width;
+    uint32_t height = info.rawInfo.height;
+
+    for (const auto &cameraPosition: s_cameraPositions) {
+        if (cameraPosition.dataType == info.dataType) {
+            position = &cameraPosition;
+            break;
+        }
+    }
+    if (position == nullptr || image == nullptr || width == 0 || height == 0 ||
+        (uint64_t) width * height > imageSize) {
+        return false;
+    }
+
+    Direction &direction = m_directions[position->direction];
+    if (!direction.hasParameters || !m_isRunning) {
+        return false;
+    }
+
+    // A half pair left behind by a lost image is given up on as soon as the next pair starts
+    Pair *pair = direction.input;
+    if ((pair->hasLeft || pair->hasRight) &&
+        (pair->info.sequence != info.sequence || pair->width != width || pair->height != height)) {
+        if (!pair->isDropped) {
+            pthread_mutex_lock(&m_mutex);
+            direction.statistics.unpairedCount++;
+            pthread_mutex_unlock(&m_mutex);
+        }
+        pair->hasLeft = false;
+        pair->hasRight = false;
+    }
+
+    if (!pair->hasLeft && !pair->hasRight) {
+        pair->isDropped = !acceptPair(direction, position->direction);
+        pair->info = info;
+        pair->width = width;
+        pair->height = height;
+    }
+
+    if (!pair->isDropped) {
+        std::vector<uint8_t> &buffer = position->isLeft ? pair->left : pair->right;
+
+        buffer.resize((size_t) width * height);
+        memcpy(buffer.data(), image, buffer.size());
+    }
+    if (position->isLeft) {
+        pair->hasLeft = true;
+    } else {
+        pair->hasRight = true;
+    }
+
+    if (pair->hasLeft && pair->hasRight) {
+        if (pair->isDropped) {
+            pair->hasLeft = false;
+            pair->hasRight = false;
+        } else {
+            commitPair(direction, position->direction);
+        }
+    }
+
+    return true;
+}
+
+bool DJIStereoDepthPipeline::submitPair(E_DjiPerceptionDirection direction, const T_DjiPerceptionImageInfo &info,
+                                        const uint8_t *left, const uint8_t *right, uint32_t width,
+                                        uint32_t height)
+{
+    if ((uint32_t) direction >= DJI_STEREO_DEPTH_DIRECTION_NUM || left == nullptr || right == nullptr ||
+        width == 0 || height == 0) {
+        return false;
+    }
+
+    Direction &target = m_directions[direction];
+    if (!target.hasParameters || !m_isRunning) {
+        return false;
+    }
+
+    Pair *pair = target.input;
+    pair->hasLeft = false;
+    pair->hasRight = false;
+    if (!acceptPair(target, direction)) {
+        return true;
+    }
+
+    pair->info = info;
+    pair->width = width;
+    pair->height = height;
+    pair->left.resize((size_t) width * height);
+    pair->right.resize((size_t) width * height);
+    memcpy(pair->left.data(), left, pair->left.size());
+    memcpy(pair->right.data(), right, pair->right.size());
+    pair->hasLeft = true;
+    pair->hasRight = true;
+    commitPair(target, direction);
+
+    return true;
+}
+
+void DJIStereoDepthPipeline::getStatistics(E_DjiPerceptionDirection direction, T_DjiStereoDepthStatistics &statistics)
+{
+    if ((uint32_t) direction >= DJI_STEREO_DEPTH_DIRECTION_NUM) {
+        statistics = {};
+        return;
+    }
+
+    pthread_mutex_lock(&m_mutex);
+    statistics = m_directions[direction].statistics;
+    pthread_mutex_unlock(&m_mutex);
+}
+
+/* Private functions definition-----------------------------------------------*/
+void *DJIStereoDepthPipeline::workerEntry(void *p)
+{
+    static_cast<DJIStereoDepthPipeline *>(p)->workerFunc();
+
+    return nullptr;
+}
+
+void DJIStereoDepthPipeline::workerFunc()
+{
+    T_DjiStereoDepthResult result;
+    uint32_t directionIndex;
+    uint64_t startTimeUs;
+    uint64_t endTimeUs;
+
+    while (true) {
+        pthread_mutex_lock(&m_mutex);
+        while (m_isRunning && m_queueCount == 0) {
+            pthread_cond_wait(&m_workCond, &m_mutex);
+        }
+        if (!m_isRunning) {
+            pthread_mutex_unlock(&m_mutex);
+            break;
+        }
+
+        directionIndex = m_queue[m_queueHead];
+        m_queueHead = (m_queueHead + 1) % DJI_STEREO_DEPTH_DIRECTION_NUM;
+        m_queueCount--;
+
+        Direction &direction = m_directions[directionIndex];
+        std::swap(direction.pending, direction.working);
+        direction.isPending = false;
+        direction.isBusy = true;
+        pthread_mutex_unlock(&m_mutex);
+
+        startTimeUs = getTimeUs();
+        processPair(direction, directionIndex, result);
+        result.processTimeMs = (double) (getTimeUs() - startTimeUs) / 1000.0;
+        if (m_config.callback != nullptr) {
+            m_config.callback(&result, m_config.userData);
+        }
+        endTimeUs = getTimeUs();
+
+        // A pair that came in meanwhile waited for this worker, it is queued only now so a direction stays serial
+        pthread_mutex_lock(&m_mutex);
+        T_DjiStereoDepthStatistics &statistics = direction.statistics;
+        statistics.processedCount++;
+        statistics.totalProcessMs += result.processTimeMs;
+        statistics.maxProcessMs = std::max(statistics.maxProcessMs, result.processTimeMs);
+        statistics.maxLatencyMs = std::max(statistics.maxLatencyMs,
+                                           (double) (endTimeUs - direction.working->readyTimeUs) / 1000.0);
+        direction.isBusy = false;
+        if (direction.isPending) {
+            m_queue[(m_queueHead + m_queueCount) % DJI_STEREO_DEPTH_DIRECTION_NUM] = directionIndex;
+            m_queueCount++;
+            pthread_cond_signal(&m_workCond);
+        }
+        pthread_mutex_unlock(&m_mutex);
+    }
+}
+
+bool DJIStereoDepthPipeline::acceptPair(Direction &direction, uint32_t directionIndex)
+{
+    uint64_t nowUs = getTimeUs();
+    uint64_t intervalUs = (uint64_t) (m_config.frameIntervalMs[directionIndex] * 1000.0f);
+    bool isAccepted = true;
+
+    pthread_mutex_lock(&m_mutex);
+    direction.statistics.receivedCount++;
+    if (intervalUs > 0 && direction.lastAcceptedUs != 0 && nowUs - direction.lastAcceptedUs < intervalUs) {
+        direction.statistics.droppedBudgetCount++;
+        isAccepted = false;
+    } else if (m_config.dropPolicy == DJI_STEREO_DEPTH_DROP_NEWEST && direction.isPending) {
+        direction.statistics.droppedBusyCount++;
+        isAccepted = false;
+    } else {
+        direction.lastAcceptedUs = nowUs;
+    }
+    pthread_mutex_unlock(&m_mutex);
+
+    return isAccepted;
+}
+
+void DJIStereoDepthPipeline::commitPair(Direction &direction, uint32_t directionIndex)
+{
+    direction.input->readyTimeUs = getTimeUs();
+
+    pthread_mutex_lock(&m_mutex);
+    if (direction.isPending) {
+        direction.statistics.droppedBusyCount++;
+    }
+    std::swap(direction.input, direction.pending);
+    if (!direction.isPending && !direction.isBusy) {
+        m_queue[(m_queueHead + m_queueCount) % DJI_STEREO_DEPTH_DIRECTION_NUM] = directionIndex;
+        m_queueCount++;
+        pthread_cond_signal(&m_workCond);
+    }
+    direction.isPending = true;
+    pthread_mutex_unlock(&m_mutex);
+
+    direction.input->hasLeft = false;
+    direction.input->hasRight = false;
+    direction.input->isDropped = false;
+}
+
+void DJIStereoDepthPipeline::processPair(Direction &direction, uint32_t directionIndex,
+                                         T_DjiStereoDepthResult &result)
+{
+    const Pair &pair = *direction.working;
+    uint32_t width = pair.width;
+    uint32_t height = pair.height;
+    uint32_t pixelCount = width * height;
+    float focalBaseline = direction.focal * direction.baseline * (float) (1 << DJI_STEREO_DEPTH_DISPARITY_SHIFT);
+    uint32_t pointCount = 0;
+
+    if (direction.mapWidth != width || direction.mapHeight != height) {
+        buildMaps(direction, width, height);
+    }
+
+    remap(pair.left.data(), direction.leftMapOffset.data(), direction.leftMapWeight.data(), width, pixelCount,
+          direction.rectifiedLeft.data());
+    remap(pair.right.data(), direction.rightMapOffset.data(), direction.rightMapWeight.data(), width, pixelCount,
+          direction.rectifiedRight.data());
+    computeDisparity(direction, width, height);
+
+    if (m_config.output == DJI_STEREO_DEPTH_OUTPUT_DEPTH_IMAGE) {
+        const int16_t *disparity = direction.disparity.data();
+        float *depth = direction.depth.data();
+
+        for (uint32_t i = 0; i < pixelCount; i++) {
+            depth[i] = disparity[i] > 0 ? focalBaseline / (float) disparity[i] : 0;
+        }
+    } else {
+        float inverseFocal = 1.0f / direction.focal;
+
+        for (uint32_t y = 0; y < height; y++) {
+            const int16_t *disparity = direction.disparity.data() + (size_t) y * width;
+            float rayY = ((float) y - direction.centerY) * inverseFocal;
+
+            for (uint32_t x = 0; x < width; x++) {
+                if (disparity[x] <= 0) {
+                    continue;
+                }
+                T_DjiStereoDepthPoint &point = direction.points[pointCount++];
+                point.z = focalBaseline / (float) disparity[x];
+                point.x = ((float) x - direction.centerX) * inverseFocal * point.z;
+                point.y = rayY * point.z;
+            }
+        }
+    }
+
+    result.direction = (E_DjiPerceptionDirection) directionIndex;
+    result.sequence = pair.info.sequence;
+    result.timeStamp = pair.info.timeStamp;
+    result.width = width;
+    result.height = height;
+    result.disparity = direction.disparity.data();
+    result.depth = m_config.output == DJI_STEREO_DEPTH_OUTPUT_DEPTH_IMAGE ? direction.depth.data() : nullptr;
+    result.points = m_config.output == DJI_STEREO_DEPTH_OUTPUT_POINT_CLOUD ? direction.points.data() : nullptr;
+    result.pointCount = pointCount;
+}
+
+void DJIStereoDepthPipeline::buildMaps(Direction &direction, uint32_t width, uint32_t height)
+{
+    size_t pixelCount = (size_t) width * height;
+    size_t vectorCount = m_config.maxDisparity / DJI_STEREO_DEPTH_COST_VECTOR_LANES;
+
+    // Sized once per image size, the following pairs of the direction allocate nothing
+    direction.leftMapOffset.resize(pixelCount);
+    direction.leftMapWeight.resize(pixelCount);
+    direction.rightMapOffset.resize(pixelCount);
+    direction.rightMapWeight.resize(pixelCount);
+    direction.rectifiedLeft.resize(pixelCount);
+    direction.rectifiedRight.resize(pixelCount);
+    direction.reversedRight.resize((size_t) height * (width + m_config.maxDisparity));
+    direction.columnCost.resize(vectorCount * width);
+    direction.blockCost.resize(vectorCount);
+    direction.disparity.resize(pixelCount);
+    if (m_config.output == DJI_STEREO_DEPTH_OUTPUT_DEPTH_IMAGE) {
+        direction.depth.resize(pixelCount);
+    } else {
+        direction.points.resize(pixelCount);
+    }
+
+    buildMap(direction.leftIntrinsics, direction.leftRotation, direction, width, height,
+             direction.leftMapOffset.data(), direction.leftMapWeight.data());
+    buildMap(direction.rightIntrinsics, direction.rightRotation, direction, width, height,
+             direction.rightMapOffset.data(), direction.rightMapWeight.data());
+    direction.mapWidth = width;
+    direction.mapHeight = height;
+}
+
+void DJIStereoDepthPipeline::buildMap(const float *intrinsics, const double *rotation, const Direction &direction,
+                                      uint32_t width, uint32_t height, int32_t *offset, uint16_t *weight)
+{
+    const double weightScale = 1 << DJI_STEREO_DEPTH_MAP_WEIGHT_BITS;
+
+    // Every rectified pixel is traced back through the rectifying rotation into the original image
+    for (uint32_t v = 0; v < height; v++) {
+        for (uint32_t u = 0; u < width; u++) {
+            size_t index = (size_t) v * width + u;
+            double rayX = ((double) u - direction.centerX) / direction.focal;
+            double rayY = ((double) v - direction.centerY) / direction.focal;
+            double cameraX = rotation[0] * rayX + rotation[3] * rayY + rotation[6];
+            double cameraY = rotation[1] * rayX + rotation[4] * rayY + rotation[7];
+            double cameraZ = rotation[2] * rayX + rotation[5] * rayY + rotation[8];
+            double sourceX;
+            double sourceY;
+            double floorX;
+            double floorY;
+
+            offset[index] = -1;
+            weight[index] = 0;
+            if (cameraZ <= 0) {
+                continue;
+            }
+
+            sourceX = intrinsics[0] * cameraX / cameraZ + intrinsics[1] * cameraY / cameraZ + intrinsics[2];
+            sourceY = intrinsics[4] * cameraY / cameraZ + intrinsics[5];
+            floorX = std::floor(sourceX);
+            floorY = std::floor(sourceY);
+            if (floorX < 0 || floorY < 0 || floorX + 1 >= width || floorY + 1 >= height) {
+                continue;
+            }
+
+            offset[index] = (int32_t) floorY * (int32_t) width + (int32_t) floorX;
+            weight[index] = (uint16_t) (std::min((int) ((sourceX - floorX) * weightScale + 0.5), 255) |
+                                        (std::min((int) ((sourceY - floorY) * weightScale + 0.5), 255) << 8));
+        }
+    }
+}
+
+void DJIStereoDepthPipeline::remap(const uint8_t *in, const int32_t *offset, const uint16_t *weight, uint32_t width,
+                                   uint32_t pixelCount, uint8_t *out)
+{
+    for (uint32_t i = 0; i < pixelCount; i++) {
+        if (offset[i] < 0) {
+            out[i] = 0;
+            continue;
+        }
+
+        const uint8_t *pixel = in + offset[i];
+        uint32_t weightX = weight[i] & 0xFF;
+        uint32_t weightY = weight[i] >> 8;
+        uint32_t top = pixel[0] * (256 - weightX) + pixel[1] * weightX;
+        uint32_t bottom = pixel[width] * (256 - weightX) + pixel[width + 1] * weightX;
+
+        out[i] = (uint8_t) ((top * (256 - weightY) + bottom * weightY + (1 << 15)) >> 16);
+    }
+}
+
+void DJIStereoDepthPipeline::computeDisparity(Direction &direction, uint32_t width, uint32_t height)
+{
+    const uint32_t disparityNum = m_config.maxDisparity;
+    const uint32_t vectorCount = disparityNum / DJI_STEREO_DEPTH_COST_VECTOR_LANES;
+    const uint32_t radius = m_config.blockSize / 2;
+    const uint32_t stride = width + disparityNum;
+    const uint8_t *right = direction.rectifiedRight.data();
+    int16_t *reversedRight = direction.reversedRight.data();
+    CostVector *columnCost = direction.columnCost.data();
+    CostVector *blockCost = direction.blockCost.data();
+
+    std::fill(direction.disparity.begin(), direction.disparity.end(), -1);
+    if (width < 2 * radius + 1 || height < 2 * radius + 1) {
+        return;
+    }
+
+    // The right pixel of disparity d for left pixel x lands at (width - 1 - x) + d, pixels left of the image are 0
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *rightRow = right + (size_t) y * width;
+        int16_t *reversedRow = reversedRight + (size_t) y * stride;
+
+        for (uint32_t x = 0; x < width; x++) {
+            reversedRow[x] = rightRow[width - 1 - x];
+        }
+        std::fill(reversedRow + width, reversedRow + stride, 0);
+    }
+
+    std::fill(direction.columnCost.begin(), direction.columnCost.end(), CostVector{});
+    for (uint32_t y = 0; y < 2 * radius + 1; y++) {
+        updateColumnCost(direction, width, y, -1);
+    }
+
+    for (uint32_t y = radius; y < height - radius; y++) {
+        int16_t *disparity = direction.disparity.data() + (size_t) y * width;
+
+        if (y > radius) {
+            updateColumnCost(direction, width, y + radius, (int32_t) (y - radius - 1));
+        }
+
+        // Slide the window along the row, all disparities of a pixel at once
+        for (uint32_t j = 0; j < vectorCount; j++) {
+            blockCost[j] = CostVector{};
+        }
+        for (uint32_t k = 0; k < 2 * radius + 1; k++) {
+            const CostVector *column = columnCost + (size_t) k * vectorCount;
+
+            for (uint32_t j = 0; j < vectorCount; j++) {
+                blockCost[j] += column[j];
+            }
+        }
+
+        for (uint32_t x = radius; x < width - radius; x++) {
+            if (x > radius) {
+                const CostVector *added = columnCost + (size_t) (x + radius) * vectorCount;
+                const CostVector *removed = columnCost + (size_t) (x - radius - 1) * vectorCount;
+
+                for (uint32_t j = 0; j < vectorCount; j++) {
+                    blockCost[j] += added[j] - removed[j];
+                }
+            }
+
+            // Only disparities keeping the whole right window inside the image take part
+            disparity[x] = selectDisparity(blockCost, std::min(disparityNum, x - radius + 1));
+        }
+    }
+}
+
+void DJIStereoDepthPipeline::updateColumnCost(Direction &direction, uint32_t width, uint32_t addRow,
+                                              int32_t removeRow)
+{
+    const uint32_t vectorCount = m_config.maxDisparity / DJI_STEREO_DEPTH_COST_VECTOR_LANES;
+    const uint32_t stride = width + m_config.maxDisparity;
+    const uint8_t *addLeft = direction.rectifiedLeft.data() + (size_t) addRow * width;
+    const int16_t *addRight = direction.reversedRight.data() + (size_t) addRow * stride;
+    const uint8_t *removeLeft = removeRow >= 0 ? direction.rectifiedLeft.data() + (size_t) removeRow * width : nullptr;
+    const int16_t *removeRight = removeRow >= 0 ? direction.reversedRight.data() + (size_t) removeRow * stride
+                                                : nullptr;
+    CostVector *columnCost = direction.columnCost.data();
+
+    for (uint32_t x = 0; x < width; x++) {
+        CostVector *cost = columnCost + (size_t) x * vectorCount;
+        int16_t removeValue = removeLeft != nullptr ? removeLeft[x] : 0;
+        PixelVector addPixel = PixelVector{} + (int16_t) addLeft[x];
+        PixelVector removePixel = PixelVector{} + removeValue;
+
+        for (uint32_t j = 0; j < vectorCount; j++) {
+            PixelVector addCandidate;
+            PixelVector addDifference;
+            PixelVector addSign;
+
+            memcpy(&addCandidate, addRight + (width - 1 - x) + j * DJI_STEREO_DEPTH_COST_VECTOR_LANES,
+                   sizeof(addCandidate));
+            addDifference = addPixel - addCandidate;
+            addSign = addDifference >> 15;
+            cost[j] += (CostVector) ((addDifference ^ addSign) - addSign);
+
+            if (removeRight != nullptr) {
+                PixelVector removeCandidate;
+                PixelVector removeDifference;
+                PixelVector removeSign;
+
+                memcpy(&removeCandidate, removeRight + (width - 1 - x) + j * DJI_STEREO_DEPTH_COST_VECTOR_LANES,
+                       sizeof(removeCandidate));
+                removeDifference = removePixel - removeCandidate;
+                removeSign = removeDifference >> 15;
+                cost[j] -= (CostVector) ((removeDifference ^ removeSign) - removeSign);
+            }
+        }
+    }
+}
+
+int16_t DJIStereoDepthPipeline::selectDisparity(const CostVector *blockCost, uint32_t validCount)
+{
+    const uint32_t lanes = DJI_STEREO_DEPTH_COST_VECTOR_LANES;
+    const uint32_t vectorCount = (validCount + lanes - 1) / lanes;
+    const uint32_t ratio = m_config.uniquenessRatio;
+    CostVector laneIndex;
+    CostVector bestCost = CostVector{} + (uint16_t) DJI_STEREO_DEPTH_COST_INVALID;
+    CostVector bestIndex = CostVector{};
+    CostVector limit = CostVector{} + (uint16_t) validCount;
+    uint32_t best = DJI_STEREO_DEPTH_COST_INVALID;
+    uint32_t bestDisparity = 0;
+    int32_t value;
+
+    for (uint32_t i = 0; i < lanes; i++) {
+        laneIndex[i] = (uint16_t) i;
+    }
+
+    // Lane wise minimum first, the lanes are merged once per pixel
+    for (uint32_t j = 0; j < vectorCount; j++) {
+        CostVector index = laneIndex + (uint16_t) (j * lanes);
+        CostVector cost = blockCost[j] | (CostVector) (index >= limit);
+        CostVector isBetter = (CostVector) (cost < bestCost);
+
+        bestCost = (cost & isBetter) | (bestCost & ~isBetter);
+        bestIndex = (index & isBetter) | (bestIndex & ~isBetter);
+    }
+    for (uint32_t i = 0; i < lanes; i++) {
+        if (bestCost[i] < best || (bestCost[i] == best && bestIndex[i] < bestDisparity)) {
+            best = bestCost[i];
+            bestDisparity = bestIndex[i];
+        }
+    }
+    if (best == DJI_STEREO_DEPTH_COST_INVALID) {
+        return -1;
+    }
+
+    // The best match has to beat every disparity apart from its neighbours by the uniqueness ratio
+    if (ratio > 0) {
+        CostVector otherCost = CostVector{} + (uint16_t) DJI_STEREO_DEPTH_COST_INVALID;
+        uint16_t lowestDisparity = bestDisparity > 0 ? bestDisparity - 1 : 0;
+        CostVector lowest = CostVector{} + lowestDisparity;
+        CostVector highest = CostVector{} + (uint16_t) (bestDisparity + 1);
+        uint32_t other = DJI_STEREO_DEPTH_COST_INVALID;
+
+        for (uint32_t j = 0; j < vectorCount; j++) {
+            CostVector index = laneIndex + (uint16_t) (j * lanes);
+            CostVector isExcluded = (CostVector) ((index >= limit) | ((index >= lowest) & (index <= highest)));
+            CostVector cost = blockCost[j] | isExcluded;
+            CostVector isLower = (CostVector) (cost < otherCost);
+
+            otherCost = (cost & isLower) | (otherCost & ~isLower);
+        }
+        for (uint32_t i = 0; i < lanes; i++) {
+            other = std::min<uint32_t>(other, otherCost[i]);
+        }
+        if (other * (100 - ratio) < best * 100) {
+            return -1;
+        }
+    }
+
+    // Sub pixel position from a parabola through the costs of the neighbouring disparities
+    value = (int32_t) (bestDisparity << DJI_STEREO_DEPTH_DISPARITY_SHIFT);
+    if (bestDisparity > 0 && bestDisparity + 1 < validCount) {
+        int32_t previous = blockCost[(bestDisparity - 1) / lanes][(bestDisparity - 1) % lanes];
+        int32_t next = blockCost[(bestDisparity + 1) / lanes][(bestDisparity + 1) % lanes];
+        int32_t denominator = previous + next - 2 * (int32_t) best;
+
+        if (denominator > 0) {
+            value += (previous - next) * (1 << DJI_STEREO_DEPTH_DISPARITY_SHIFT) / (2 * denominator);
+        }
+    }
+
+    return (int16_t) value;
+}
+
+uint64_t DJIStereoDepthPipeline::getTimeUs()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void DjiStereoDepth_GetRotationMatrix(const double *vector, double *matrix)
+{
+    double angle = std::sqrt(vector[0] * vector[0] + vector[1] * vector[1] + vector[2] * vector[2]);
+    double axis[3];
+    double cosAngle;
+    double sinAngle;
+
+    if (angle < 1e-12) {
+        const double identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+
+        memcpy(matrix, identity, sizeof(identity));
+        return;
+    }
+
+    for (int i = 0; i < 3; i++) {
+        axis[i] = vector[i] / angle;
+    }
+    cosAngle = std::cos(angle);
+    sinAngle = std::sin(angle);
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            matrix[i * 3 + j] = (1 - cosAngle) * axis[i] * axis[j] + (i == j ? cosAngle : 0);
+        }
+    }
+    matrix[1] -= sinAngle * axis[2];
+    matrix[2] += sinAngle * axis[1];
+    matrix[3] += sinAngle * axis[2];
+    matrix[5] -= sinAngle * axis[0];
+    matrix[6] -= sinAngle * axis[1];
+    matrix[7] += sinAngle * axis[0];
+}
+
+static void DjiStereoDepth_GetRotationVector(const double *matrix, double *vector)
+{
+    double cosAngle = std::max(-1.0, std::min(1.0, (matrix[0] + matrix[4] + matrix[8] - 1) / 2));
+    double angle = std::acos(cosAngle);
+    double sinAngle = std::sin(angle);
+    double scale;
+
+    // Stereo pairs are close to parallel, rotations near half a turn do not occur
+    if (sinAngle < 1e-12) {
+        vector[0] = 0;
+        vector[1] = 0;
+        vector[2] = 0;
+        return;
+    }
+
+    scale = angle / (2 * sinAngle);
+    vector[0] = (matrix[7] - matrix[5]) * scale;
+    vector[1] = (matrix[2] - matrix[6]) * scale;
+    vector[2] = (matrix[3] - matrix[1]) * scale;
+}
+
+static void DjiStereoDepth_MultiplyMatrix(const double *a, const double *b, bool isBTransposed, double *out)
+{
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            double sum = 0;
+
+            for (int k = 0; k < 3; k++) {
+                sum += a[i * 3 + k] * (isBTransposed ? b[j * 3 + k] : b[k * 3 + j]);
+            }
+            out[i * 3 + j] = sum;
+        }
+    }
+}
+
+static void DjiStereoDepth_MultiplyVector(const double *matrix, const double *vector, double *out)
+{
+    for (int i = 0; i < 3; i++) {
+        out[i] = matrix[i * 3] * vector[0] + matrix[i * 3 + 1] * vector[1] + matrix[i * 3 + 2] * vector[2];
+    }
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,223 @@
+/**
+ ********************************************************************
+ * @file    dji_stereo_depth_pipeline.hpp
+ * @brief   This is the header file for "dji_stereo_depth_pipeline.cpp", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_STEREO_DEPTH_PIPELINE_H
+#define DJI_STEREO_DEPTH_PIPELINE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "pthread.h"
+#include <cstdint>
+#include <vector>
+#include "dji_perception.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_STEREO_DEPTH_DIRECTION_NUM             (6)
+#define DJI_STEREO_DEPTH_MAX_DISPARITY_DEFAULT     (64)
+#define DJI_STEREO_DEPTH_BLOCK_SIZE_DEFAULT        (9)
+// Window sums of absolute differences have to fit into 16 bits
+#define DJI_STEREO_DEPTH_BLOCK_SIZE_MAX            (15)
+#define DJI_STEREO_DEPTH_UNIQUENESS_RATIO_DEFAULT  (10)
+// Disparities are fixed point with this many fractional bits
+#define DJI_STEREO_DEPTH_DISPARITY_SHIFT           (4)
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_STEREO_DEPTH_OUTPUT_DEPTH_IMAGE = 0,
+    DJI_STEREO_DEPTH_OUTPUT_POINT_CLOUD,
+} E_DjiStereoDepthOutput;
+
+typedef enum {
+    DJI_STEREO_DEPTH_DROP_OLDEST = 0,   /*!< A new pair replaces the pair of its direction still waiting for a worker. */
+    DJI_STEREO_DEPTH_DROP_NEWEST,       /*!< A new pair is dropped while a pair of its direction is waiting. */
+} E_DjiStereoDepthDropPolicy;
+
+typedef struct {
+    float x;
+    float y;
+    float z;
+} T_DjiStereoDepthPoint;
+
+typedef struct {
+    E_DjiPerceptionDirection direction;
+    uint16_t sequence;
+    uint64_t timeStamp;
+    uint32_t width;
+    uint32_t height;
+    const int16_t *disparity;               /*!< Rectified left view, fixed point, negative where nothing matched. */
+    const float *depth;                     /*!< Depth image output only, 0 where unknown. */
+    const T_DjiStereoDepthPoint *points;    /*!< Point cloud output only, in the rectified left camera frame. */
+    uint32_t pointCount;
+    double processTimeMs;
+} T_DjiStereoDepthResult;
+
+/*! Called from a worker thread, the result is only valid until the callback returns. */
+typedef void (*DjiStereoDepthCallback)(const T_DjiStereoDepthResult *result, void *userData);
+
+typedef struct {
+    uint32_t workerCount;       /*!< 0 selects one worker per online CPU, at most one per direction. */
+    uint32_t maxDisparity;      /*!< Disparities searched, rounded up to a multiple of 8, 0 selects the default. */
+    uint32_t blockSize;         /*!< Odd edge of the matching window, 0 selects the default, unit: pixel. */
+    uint32_t uniquenessRatio;   /*!< Margin the best match must win by, 0 disables the check, unit: percent. */
+    E_DjiStereoDepthOutput output;
+    E_DjiStereoDepthDropPolicy dropPolicy;
+    /*! Frame budget of each direction, indexed by E_DjiPerceptionDirection: a pair starting sooner than this after
+     *  the last accepted pair of its direction is dropped, 0 accepts every pair, unit: ms. */
+    float frameIntervalMs[DJI_STEREO_DEPTH_DIRECTION_NUM];
+    DjiStereoDepthCallback callback;
+    void *userData;
+} T_DjiStereoDepthConfig;
+
+typedef struct {
+    uint32_t receivedCount;         /*!< Pairs whose first image arrived. */
+    uint32_t processedCount;
+    uint32_t droppedBudgetCount;    /*!< Pairs dropped by the frame budget. */
+    uint32_t droppedBusyCount;      /*!< Pairs dropped by the drop policy while the workers were behind. */
+    uint32_t unpairedCount;         /*!< Images whose partner never arrived. */
+    double totalProcessMs;
+    double maxProcessMs;
+    double maxLatencyMs;            /*!< Longest time from a pair being complete to its result. */
+} T_DjiStereoDepthStatistics;
+
+/*! @note
+ * Computes depth from the stereo pairs of every perception direction on a
+ * shared pool of worker threads. Each direction keeps three pairs of image
+ * buffers: one being filled by the image callback, one waiting for a worker
+ * and one being processed, so the callback never waits for the workers and
+ * a direction is never processed by two workers at once. A worker rectifies
+ * the pair through lookup tables built once from the camera parameters,
+ * matches blocks along the rows by their sums of absolute differences with
+ * sub pixel refinement, and turns the disparities into a depth image or a
+ * point cloud. Depth comes out in the unit of translationLeftInRight.
+ */
+class DJIStereoDepthPipeline {
+public:
+    explicit DJIStereoDepthPipeline(const T_DjiStereoDepthConfig &config);
+    ~DJIStereoDepthPipeline();
+
+    /*! @brief Compute the rectification of every direction in the packet. Called before start. */
+    bool setCameraParameters(const T_DjiPerceptionCameraParametersPacket &packet);
+
+    bool start();
+
+    /*! @brief Stop the workers, pairs still waiting are dropped. */
+    void stop();
+
+    /*! @brief Take an image from the perception image callback and submit its pair once both images arrived.
+     *  @note Images are paired by their sequence. The images of a direction have to come from one thread.
+     *  @return false when the image belongs to no direction with camera parameters.
+     */
+    bool submitImage(const T_DjiPerceptionImageInfo &info, const uint8_t *image, uint32_t imageSize);
+
+    /*! @brief Submit a complete 8 bit pair, as read back from a recording. */
+    bool submitPair(E_DjiPerceptionDirection direction, const T_DjiPerceptionImageInfo &info, const uint8_t *left,
+                    const uint8_t *right, uint32_t width, uint32_t height);
+
+    void getStatistics(E_DjiPerceptionDirection direction, T_DjiStereoDepthStatistics &statistics);
+
+private:
+    // Costs of eight neighbouring disparities, GCC vector extensions map these onto SSE2 or NEON registers
+    typedef uint16_t CostVector __attribute__((vector_size(16)));
+    typedef int16_t PixelVector __attribute__((vector_size(16)));
+
+    struct Pair {
+        std::vector<uint8_t> left;
+        std::vector<uint8_t> right;
+        T_DjiPerceptionImageInfo info;
+        uint32_t width;
+        uint32_t height;
+        bool hasLeft;
+        bool hasRight;
+        bool isDropped;         /*!< Refused by the frame budget or the drop policy, its images are not copied. */
+        uint64_t readyTimeUs;
+    };
+
+    struct Direction {
+        bool hasParameters;
+        float leftIntrinsics[9];
+        float rightIntrinsics[9];
+        double leftRotation[9];     /*!< Rotates the left camera frame into the rectified frame. */
+        double rightRotation[9];
+        float focal;                /*!< Shared by both rectified views, unit: pixel. */
+        float centerX;
+        float centerY;
+        float baseline;
+
+        Pair pairs[3];
+        Pair *input;                /*!< Owned by the submitting thread. */
+        Pair *pending;              /*!< Swapped under the pipeline mutex. */
+        Pair *working;              /*!< Owned by the worker processing the direction. */
+        bool isPending;
+        bool isBusy;
+        uint64_t lastAcceptedUs;
+
+        uint32_t mapWidth;
+        uint32_t mapHeight;
+        std::vector<int32_t> leftMapOffset;     /*!< Top left source pixel of each rectified pixel, -1 outside. */
+        std::vector<uint16_t> leftMapWeight;    /*!< Horizontal and vertical bilinear weights, 8 bits each. */
+        std::vector<int32_t> rightMapOffset;
+        std::vector<uint16_t> rightMapWeight;
+        std::vector<uint8_t> rectifiedLeft;
+        std::vector<uint8_t> rectifiedRight;
+        std::vector<int16_t> reversedRight;     /*!< Right rows back to front, so disparities run forwards in memory. */
+        std::vector<CostVector> columnCost;     /*!< Window column sums of every pixel of a row, pixel major. */
+        std::vector<CostVector> blockCost;      /*!< Window sums of the current pixel. */
+        std::vector<int16_t> disparity;
+        std::vector<float> depth;
+        std::vector<T_DjiStereoDepthPoint> points;
+
+        T_DjiStereoDepthStatistics statistics;
+    };
+
+    static void *workerEntry(void *p);
+    void workerFunc();
+    bool acceptPair(Direction &direction, uint32_t directionIndex);
+    void commitPair(Direction &direction, uint32_t directionIndex);
+    void processPair(Direction &direction, uint32_t directionIndex, T_DjiStereoDepthResult &result);
+    void buildMaps(Direction &direction, uint32_t width, uint32_t height);
+    static void buildMap(const float *intrinsics, const double *rotation, const Direction &direction, uint32_t width,
+                         uint32_t height, int32_t *offset, uint16_t *weight);
+    static void remap(const uint8_t *in, const int32_t *offset, const uint16_t *weight, uint32_t width,
+                      uint32_t pixelCount, uint8_t *out);
+    void computeDisparity(Direction &direction, uint32_t width, uint32_t height);
+    void updateColumnCost(Direction &direction, uint32_t width, uint32_t addRow, int32_t removeRow);
+    int16_t selectDisparity(const CostVector *blockCost, uint32_t validCount);
+    static uint64_t getTimeUs();
+
+    T_DjiStereoDepthConfig m_config;
+    Direction *m_directions;
+    std::vector<pthread_t> m_workers;
+    bool m_isRunning;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_workCond;
+    uint32_t m_queue[DJI_STEREO_DEPTH_DIRECTION_NUM];     /*!< Directions with a pending pair and no worker. */
+    uint32_t m_queueHead;
+    uint32_t m_queueCount;
+};
+
+/* Exported functions --------------------------------------------------------*/
+
+#endif // DJI_STEREO_DEPTH_PIPELINE_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
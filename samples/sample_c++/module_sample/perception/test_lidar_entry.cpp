@@ -24,6 +24,9 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "test_lidar_entry.hpp"
+#include "dji_lidar_frame_pool.hpp"
+#include "dji_lidar_cloud_writer.hpp"
+#include "dji_lidar_cloud_reducer.hpp"
 #include <dirent.h>
 #include "dji_logger.h"
 #include <iostream>
@@ -39,37 +42,97 @@
 #include <sstream>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <queue>
+#include <atomic>
 /* Private constants ---------------------------------------------------------*/
-#define PCD_FILE_DEFAULT_LENGTH                 (512)
 #define FRAME_BUFFER_LENGTH                     (1024 * 1024)
 #define SUBSCRIBE_DATA_TIME_MS                  (1000 * 10)
 #define USER_PERCEPTION_LIRDAR_TASK_STACK_SIZE  (2042)
 #define PCD_FILE_PATH                           "./DJI_cloud_data"
+#define PCD_FILE_PREFIX                         "DJI_cloud_data"
+//Format of the recorded point clouds, see E_DjiLidarCloudFormat
+#define LIDAR_CLOUD_FORMAT                      DJI_LIDAR_CLOUD_FORMAT_PCD_BINARY
+//Append every frame to one indexed container file instead of writing a file per frame
+#define LIDAR_CLOUD_CONTAINER_ON                0
+//Frames waiting to be written, further frames are dropped while the writer is behind
+#define LIDAR_FRAME_POOL_SLOT_COUNT             (4)
+//Downsample and encode every frame as it would be forwarded over a constrained link
+#define LIDAR_CLOUD_REDUCE_ON                   0
+#define LIDAR_CLOUD_VOXEL_SIZE                  (0.1f)      // unit: m, 0 to keep every point passing the filter
+#define LIDAR_CLOUD_RANGE_MAX                   (100.0f)    // unit: m
+#define LIDAR_CLOUD_CODEC_PRECISION             (0.001f)    // unit: m
 
 /* Private types -------------------------------------------------------------*/
 
 /* Private values -------------------------------------------------------------*/
 static int lastFrameCnt = 0;
-static std::queue<T_DjiLidarFrame *> lidarFrameQueue;
-static T_DjiMutexHandle queueMutex;
+static DJILidarFramePool *lidarFramePool = nullptr;
+static DJILidarCloudWriter *lidarCloudWriter = nullptr;
 static T_DjiSemaHandle dataSemaphore;
-static bool stopProcessing = false;
+static std::atomic<bool> stopProcessing(false);
 static T_DjiSemaHandle taskExitSema;
+#if LIDAR_CLOUD_REDUCE_ON
+static DJILidarCloudFilter *lidarCloudFilter = nullptr;
+static DJILidarCloudCodec *lidarCloudCodec = nullptr;
+static T_DJIPerceptionLidarPoint *reducedPoints = nullptr;
+static uint8_t *encodedCloud = nullptr;
+static size_t encodedCloudSize = 0;
+#endif
 
 /* Private functions declaration ---------------------------------------------*/
 static void DjiTest_PerceptionLidarCallback(uint8_t *recvBuffer, uint32_t bufferLen);
-static std::string DjiTest_getCurrentTimestamp();
-static void DjiTest_WriteLidarFrameToBinaryPcdFile(const T_DjiLidarFrame *frame);
 static void* DjiTest_ProcessLidarDataTask(void* arg);
+#if LIDAR_CLOUD_REDUCE_ON
+static bool DjiTest_CreateLidarCloudReducer(void);
+static void DjiTest_DestroyLidarCloudReducer(void);
+static void DjiTest_ReduceLidarFrame(const T_DjiLidarFrameView &lidarFrame);
+#endif
 
 /* Exported functions definition ---------------------------------------------*/
 void DjiUser_RunLidarDataSubscriptionSample(void) {
     int subscriptionDuration = 10;
     lastFrameCnt = 0;
+    stopProcessing = false;
     T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiLidarFramePoolStatistics poolStatistics;
+    T_DjiLidarCloudWriterStatistics writerStatistics;
+    T_DjiLidarCloudWriterConfig writerConfig = {};
+
+    writerConfig.folderPath = PCD_FILE_PATH;
+    writerConfig.filePrefix = PCD_FILE_PREFIX;
+    writerConfig.format = LIDAR_CLOUD_FORMAT;
+    writerConfig.isContainer = LIDAR_CLOUD_CONTAINER_ON;
+
+    try {
+        lidarFramePool = new DJILidarFramePool(LIDAR_FRAME_POOL_SLOT_COUNT);
+        lidarCloudWriter = new DJILidarCloudWriter(writerConfig);
+    } catch (...) {
+        std::cout << "Allocate Lidar frame pool and cloud writer failed" << std::endl;
+        delete lidarFramePool;
+        lidarFramePool = nullptr;
+        return;
+    }
+
+    if (!lidarCloudWriter->start()) {
+        std::cout << "Start Lidar cloud writer failed" << std::endl;
+        delete lidarCloudWriter;
+        lidarCloudWriter = nullptr;
+        delete lidarFramePool;
+        lidarFramePool = nullptr;
+        return;
+    }
+
+#if LIDAR_CLOUD_REDUCE_ON
+    if (!DjiTest_CreateLidarCloudReducer()) {
+        std::cout << "Allocate Lidar cloud reducer failed" << std::endl;
+        lidarCloudWriter->stop();
+        delete lidarCloudWriter;
+        lidarCloudWriter = nullptr;
+        delete lidarFramePool;
+        lidarFramePool = nullptr;
+        return;
+    }
+#endif
 
-    osalHandler->MutexCreate(&queueMutex);
     osalHandler->SemaphoreCreate(0, &dataSemaphore);
     osalHandler->SemaphoreCreate(0, &taskExitSema);
 
@@ -112,16 +175,34 @@ start:
 
     std::cout << "unsubscribe Lidar data success" << std::endl;
 
-    osalHandler->MutexLock(queueMutex);
     stopProcessing = true;
-    osalHandler->MutexUnlock(queueMutex);
 
     osalHandler->SemaphorePost(dataSemaphore);
     osalHandler->SemaphoreWait(taskExitSema);
     osalHandler->TaskDestroy(processingThread);
-    osalHandler->MutexDestroy(queueMutex);
     osalHandler->SemaphoreDestroy(dataSemaphore);
     osalHandler->SemaphoreDestroy(taskExitSema);
+
+    // Writes out the frames still buffered and finishes the container file
+    lidarCloudWriter->stop();
+    lidarCloudWriter->getStatistics(writerStatistics);
+    std::cout << "Lidar points written: " << writerStatistics.pointCount
+              << ", bytes written: " << writerStatistics.writtenBytes
+              << ", longest write: " << writerStatistics.maxWriteMs << " ms"
+              << ", write errors: " << writerStatistics.writeErrorCount << std::endl;
+    delete lidarCloudWriter;
+    lidarCloudWriter = nullptr;
+
+    lidarFramePool->getStatistics(poolStatistics);
+    std::cout << "Lidar frames written: " << poolStatistics.releasedCount
+              << ", dropped while the writer was behind: " << poolStatistics.droppedCount
+              << ", most frames waiting: " << poolStatistics.maxPendingCount << std::endl;
+    delete lidarFramePool;
+    lidarFramePool = nullptr;
+
+#if LIDAR_CLOUD_REDUCE_ON
+    DjiTest_DestroyLidarCloudReducer();
+#endif
 }
 
 /* Private functions definition-----------------------------------------------*/
@@ -132,141 +213,102 @@ static void DjiTest_PerceptionLidarCallback(uint8_t *LidarFrame, uint32_t buffer
     }
 
     T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
-    T_DjiLidarFrame * curFrame =  (T_DjiLidarFrame *)osalHandler->Malloc(bufferLen);
-    memcpy(curFrame, LidarFrame, bufferLen);
-
-    osalHandler->MutexLock(queueMutex);
-    lidarFrameQueue.push(curFrame);
-    osalHandler->MutexUnlock(queueMutex);
-
-    osalHandler->SemaphorePost(dataSemaphore);
-}
-std::string DjiTest_getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-
-    std::time_t nowTimeT = std::chrono::system_clock::to_time_t(now);
-
-    auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-
-    std::tm nowTm = *std::localtime(&nowTimeT);
-    std::ostringstream oss;
-    oss << std::put_time(&nowTm, "%Y%m%d_%H%M%S");
-    oss << std::setfill('0') << std::setw(3) << milliseconds.count();
-
-    return oss.str();
-}
-
-static void DjiTest_WriteLidarFrameToBinaryPcdFile(const T_DjiLidarFrame *frame) {
-    uint32_t totalPoints = 0;
-    size_t headerLen = 0;
-    size_t pointDataSize = 0;
-    size_t bufferSize = 0;
-    char *buffer = NULL;
-    size_t bufferPos = 0;
-    int fd = 0;
-    std::string directory = PCD_FILE_PATH;
-    std::string filename = directory + "/DJI_cloud_data_" + DjiTest_getCurrentTimestamp() + ".pcd";
-    char header[PCD_FILE_DEFAULT_LENGTH];
-
-    if (mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) {
-        fprintf(stderr, "Error creating directory: %s\n", strerror(errno));
-        return;
-    }
-
-    for (uint16_t i = 0; i < frame->pkgNum; ++i) {
-        totalPoints += frame->pkgs[i].header.dotNum;
-    }
-
-    snprintf(header, sizeof(header),
-             "# .PCD v0.7 - Point Cloud Data file format\n"
-             "VERSION 0.7\n"
-             "FIELDS x y z intensity label\n"
-             "SIZE 4 4 4 1 1\n"
-             "TYPE F F F U U\n"
-             "COUNT 1 1 1 1 1\n"
-             "WIDTH %u\n"
-             "HEIGHT 1\n"
-             "VIEWPOINT 0 0 0 1 0 0 0\n"
-             "POINTS %u\n"
-             "DATA binary\n",
-             totalPoints, totalPoints);
-
-    // Calculate the size of the buffer needed
-    headerLen = strlen(header);
-    pointDataSize = totalPoints * (sizeof(float) * 3 + sizeof(uint8_t) * 2);
-    bufferSize = headerLen + pointDataSize;
-
-    buffer = (char *)malloc(bufferSize);
-    if (buffer == NULL) {
-        fprintf(stderr, "Error allocating memory for buffer\n");
-        return;
-    }
-
-    memcpy(buffer + bufferPos, header, headerLen);
-    bufferPos += headerLen;
-
-    for (uint16_t i = 0; i < frame->pkgNum; ++i) {
-        const T_DjiPerceptionLidarDecodePkg *pkg = &frame->pkgs[i];
-        for (uint16_t j = 0; j < pkg->header.dotNum; ++j) {
-            const T_DJIPerceptionLidarPoint *point = &pkg->points[j];
-            memcpy(buffer + bufferPos, &point->x, sizeof(float));
-            bufferPos += sizeof(float);
-            memcpy(buffer + bufferPos, &point->y, sizeof(float));
-            bufferPos += sizeof(float);
-            memcpy(buffer + bufferPos, &point->z, sizeof(float));
-            bufferPos += sizeof(float);
-            memcpy(buffer + bufferPos, &point->intensity, sizeof(uint8_t));
-            bufferPos += sizeof(uint8_t);
-            memcpy(buffer + bufferPos, &point->label, sizeof(uint8_t));
-            bufferPos += sizeof(uint8_t);
-        }
-    }
 
-    fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
-    if (fd == -1) {
-        fprintf(stderr, "Error opening file for writing\n");
-        free(buffer);
+    // Only the valid packages are copied, and nothing at all when the writer is too far behind
+    if (!lidarFramePool->push((const T_DjiLidarFrame *) LidarFrame)) {
         return;
     }
 
-    if (write(fd, buffer, bufferSize) == -1) {
-        fprintf(stderr, "Error writing buffer to file\n");
-    }
-
-    close(fd);
-    free(buffer);
+    osalHandler->SemaphorePost(dataSemaphore);
 }
-
 static void* DjiTest_ProcessLidarDataTask(void* arg) {
     T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiLidarFrameView lidarFrame;
 
     while(true) {
         osalHandler->SemaphoreWait(dataSemaphore);
 
-        osalHandler->MutexLock(queueMutex);
-        bool shouldStop = stopProcessing && lidarFrameQueue.empty();
-        if(shouldStop) {
-            osalHandler->MutexUnlock(queueMutex);
+        // The frame is packed straight from its pool slot, the slot goes back to the callback once packed
+        while (lidarFramePool->peek(lidarFrame)) {
+            lidarCloudWriter->writeFrame(lidarFrame);
+#if LIDAR_CLOUD_REDUCE_ON
+            DjiTest_ReduceLidarFrame(lidarFrame);
+#endif
+
+            int curFrameCnt = lidarFrame.frameCnt;
+            lidarFramePool->release();
+
+            std::cout << "Lidar data : curFrameCnt=" << curFrameCnt << std::endl;
+            if(lastFrameCnt != 0 && (curFrameCnt - lastFrameCnt) > 1) {
+                std::cout << "The number of lost packets during transmission is: " << curFrameCnt - lastFrameCnt - 1 << std::endl;
+            }
+            lastFrameCnt = curFrameCnt;
+        }
+
+        if(stopProcessing) {
             break;
         }
+    }
 
-        T_DjiLidarFrame *lidarFrame = lidarFrameQueue.front();
-        lidarFrameQueue.pop();
-        osalHandler->MutexUnlock(queueMutex);
+    osalHandler->SemaphorePost(taskExitSema);
+    return nullptr;
+}
 
-        DjiTest_WriteLidarFrameToBinaryPcdFile(lidarFrame);
+#if LIDAR_CLOUD_REDUCE_ON
+static bool DjiTest_CreateLidarCloudReducer(void) {
+    T_DjiLidarCloudFilterConfig filterConfig = {};
+
+    filterConfig.maxRange = LIDAR_CLOUD_RANGE_MAX;
+    filterConfig.isNoiseDropped = true;
+    filterConfig.voxelSize = LIDAR_CLOUD_VOXEL_SIZE;
+
+    try {
+        lidarCloudFilter = new DJILidarCloudFilter(filterConfig);
+        lidarCloudCodec = new DJILidarCloudCodec(DJI_LIDAR_CLOUD_CODEC_MODE_QUANTIZED, LIDAR_CLOUD_CODEC_PRECISION);
+        reducedPoints = new T_DJIPerceptionLidarPoint[DJI_LIDAR_CLOUD_POINT_NUM_MAX];
+        encodedCloudSize = DJILidarCloudCodec::getMaxEncodedSize(DJI_LIDAR_CLOUD_POINT_NUM_MAX);
+        encodedCloud = new uint8_t[encodedCloudSize];
+    } catch (...) {
+        DjiTest_DestroyLidarCloudReducer();
+        return false;
+    }
 
-        int curFrameCnt = lidarFrame->frameCnt;
-        std::cout << "Lidar data : curFrameCnt=" << curFrameCnt << std::endl;
-        if(lastFrameCnt != 0 && (curFrameCnt - lastFrameCnt) > 1) {
-            std::cout << "The number of lost packets during transmission is: " << curFrameCnt - lastFrameCnt - 1 << std::endl;
-        }
-        lastFrameCnt = curFrameCnt;
+    return true;
+}
 
-        osalHandler->Free(lidarFrame);
+static void DjiTest_DestroyLidarCloudReducer(void) {
+    T_DjiLidarCloudReducerStatistics filterStatistics;
+    T_DjiLidarCloudReducerStatistics codecStatistics;
+
+    if (lidarCloudFilter != nullptr && lidarCloudCodec != nullptr) {
+        lidarCloudFilter->getStatistics(filterStatistics);
+        lidarCloudCodec->getStatistics(codecStatistics);
+        std::cout << "Lidar points reduced: " << filterStatistics.inputPointCount
+                  << " -> " << filterStatistics.outputPointCount
+                  << ", bytes: " << filterStatistics.inputBytes << " -> " << codecStatistics.outputBytes
+                  << ", filter time: " << filterStatistics.totalTimeMs << " ms"
+                  << ", encode time: " << codecStatistics.totalTimeMs << " ms" << std::endl;
     }
 
-    osalHandler->SemaphorePost(taskExitSema);
-    return nullptr;
+    delete[] encodedCloud;
+    encodedCloud = nullptr;
+    delete[] reducedPoints;
+    reducedPoints = nullptr;
+    delete lidarCloudCodec;
+    lidarCloudCodec = nullptr;
+    delete lidarCloudFilter;
+    lidarCloudFilter = nullptr;
+}
+
+static void DjiTest_ReduceLidarFrame(const T_DjiLidarFrameView &lidarFrame) {
+    uint32_t pointCount = lidarCloudFilter->apply(lidarFrame.pkgs, lidarFrame.pkgNum, reducedPoints,
+                                                  DJI_LIDAR_CLOUD_POINT_NUM_MAX);
+    size_t encodedSize = lidarCloudCodec->encode(reducedPoints, pointCount, encodedCloud, encodedCloudSize);
+
+    // The encoded frame decodes on its own, hand encodedCloud to the link here
+    if (encodedSize == 0) {
+        std::cout << "Encode Lidar frame " << lidarFrame.frameCnt << " failed" << std::endl;
+    }
 }
+#endif
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -29,6 +29,9 @@
 #include "dji_perception.h"
 #include "test_perception.hpp"
 #include <iostream>
+#include <atomic>
+#include "liveview/dji_liveview_frame_export.hpp"
+#include "dji_stereo_depth_pipeline.hpp"
 
 #ifdef OPEN_CV_INSTALLED
 
@@ -41,14 +44,41 @@
 #define USER_PERCEPTION_TASK_STACK_SIZE    (1024)
 #define USER_PERCEPTION_DIRECTION_NUM      (12)
 #define FPS_STRING_LEN                     (50)
+//Buffers per camera position: one being filled, the latest frame, and one being displayed
+#define USER_PERCEPTION_IMAGE_BUFFER_NUM   (3)
+//Buffers are allocated for this image size up front and grow once if the camera sends larger images
+#define USER_PERCEPTION_IMAGE_SIZE_DEFAULT (640 * 480)
+//Longest wait of the display task before it checks whether it has to stop, unit: ms
+#define USER_PERCEPTION_DISPLAY_WAIT_MS    (100)
+//Stereo images are exported to /dev/shm/<name>, both images of a pair go into the same ring
+#define USER_PERCEPTION_FRAME_EXPORT_NAME          "dji_perception_stereo"
+#define USER_PERCEPTION_FRAME_EXPORT_SLOT_COUNT    (8)
+//Depth of each direction is computed at most this often, unit: ms
+#define USER_PERCEPTION_DEPTH_FRAME_INTERVAL_MS    (100)
 
 /* Private types -------------------------------------------------------------*/
 typedef struct {
     T_DjiPerceptionImageInfo info;
-    uint8_t *imageRawBuffer;
+    uint8_t *data;
+    uint32_t size;
+} T_DjiTestStereoImageBuffer;
+
+typedef struct {
+    T_DjiTestStereoImageBuffer buffers[USER_PERCEPTION_IMAGE_BUFFER_NUM];
+    T_DjiTestStereoImageBuffer *writing;    /*!< Owned by the image callback. */
+    T_DjiTestStereoImageBuffer *latest;     /*!< Swapped under the pool mutex. */
+    T_DjiTestStereoImageBuffer *reading;    /*!< Owned by the display task. */
+    bool isLatestNew;
+    uint32_t receivedCount;
+    uint32_t consumedCount;
+    uint32_t overwrittenCount;  /*!< Frames replaced by a newer one before the display task took them. */
+} T_DjiTestStereoImageSlot;
+
+typedef struct {
+    T_DjiTestStereoImageSlot slots[USER_PERCEPTION_DIRECTION_NUM];
     T_DjiMutexHandle mutex;
-    bool gotData;
-} T_DjiTestStereoImagePacket;
+    T_DjiSemaHandle semaphore;  /*!< Posted for every new frame, wakes the display task. */
+} T_DjiTestStereoImagePool;
 
 typedef struct {
     E_DjiPerceptionCameraPosition cameraPosition;
@@ -62,11 +92,8 @@ typedef struct {
 
 /* Private values -------------------------------------------------------------*/
 static T_DjiTaskHandle s_stereoImageThread;
-static T_DjiTestStereoImagePacket s_stereoImagePacket = {
-    .info           = {0},
-    .imageRawBuffer = nullptr,
-    .mutex          = nullptr,
-    .gotData        = false};
+static T_DjiTestStereoImagePool s_stereoImagePool = {};
+static std::atomic<bool> s_isDisplayStopRequested(false);
 
 static const T_DjiTestPerceptionDirectionName directionName[] = {
     {.direction = DJI_PERCEPTION_RECTIFY_DOWN, .name = "down"},
@@ -92,10 +119,24 @@ static const T_DjiTestPerceptionCameraPositionName positionName[] = {
     {.cameraPosition = RECTIFY_RIGHT_RIGHT, .name = "right_r"},
 };
 
+static std::atomic<bool> s_isFrameExportEnabled(false);
+static T_DjiLiveviewFrameExportHandle s_frameExport = nullptr;
+static std::atomic<bool> s_isStereoDepthEnabled(false);
+static DJIStereoDepthPipeline *s_stereoDepthPipeline = nullptr;
+
 /* Private functions declaration ---------------------------------------------*/
+static void DjiTest_ExportStereoImage(const T_DjiPerceptionImageInfo &imageInfo, const uint8_t *imageRawBuffer,
+                                      uint32_t bufferLen);
 static void DjiTest_PerceptionImageCallback(T_DjiPerceptionImageInfo imageInfo, uint8_t *imageRawBuffer,
                                             uint32_t bufferLen);
 static void *DjiTest_StereoImagesDisplayTask(void *arg);
+static bool DjiTest_StartStereoDepth(const T_DjiPerceptionCameraParametersPacket &cameraParametersPacket);
+static void DjiTest_StopStereoDepth(void);
+static void DjiTest_StereoDepthCallback(const T_DjiStereoDepthResult *result, void *userData);
+static T_DjiReturnCode DjiTest_CreateStereoImagePool(T_DjiTestStereoImagePool *pool);
+static void DjiTest_DestroyStereoImagePool(T_DjiTestStereoImagePool *pool);
+static int DjiTest_GetCameraPositionIndex(uint32_t dataType);
+static bool DjiTest_TakeLatestStereoImage(T_DjiTestStereoImagePool *pool, int index);
 
 /* Exported functions definition ---------------------------------------------*/
 void DjiUser_RunStereoVisionViewSample(void)
@@ -113,17 +154,18 @@ void DjiUser_RunStereoVisionViewSample(void)
         return;
     }
 
-    returnCode = osalHandler->MutexCreate(&s_stereoImagePacket.mutex);
+    returnCode = DjiTest_CreateStereoImagePool(&s_stereoImagePool);
     if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("Crete mutex failed, return code:0x%08X", returnCode);
+        USER_LOG_ERROR("Crete image pool failed, return code:0x%08X", returnCode);
         goto DeletePerception;
     }
 
+    s_isDisplayStopRequested = false;
     returnCode = osalHandler->TaskCreate("user_perception_task", DjiTest_StereoImagesDisplayTask,
-                                         USER_PERCEPTION_TASK_STACK_SIZE, &s_stereoImagePacket, &s_stereoImageThread);
+                                         USER_PERCEPTION_TASK_STACK_SIZE, &s_stereoImagePool, &s_stereoImageThread);
     if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Crete task failed, return code:0x%08X", returnCode);
-        goto DestroyMutex;
+        goto DestroyPool;
     }
 
     returnCode = DjiPerception_GetStereoCameraParameters(&cameraParametersPacket);
@@ -203,6 +245,14 @@ void DjiUser_RunStereoVisionViewSample(void)
             << "| [t] Subscribe right stereo camera pair images                  |"
             <<
             std::endl;
+        std::cout
+            << "| [e] Toggle exporting the images to shared memory               |"
+            <<
+            std::endl;
+        std::cout
+            << "| [p] Toggle computing depth from the stereo pairs               |"
+            <<
+            std::endl;
         std::cout
             << "| [q] quit                                                       |"
             <<
@@ -237,6 +287,19 @@ void DjiUser_RunStereoVisionViewSample(void)
             case 'g':
                 USER_LOG_INFO("Do stereo camera parameters subscription");
                 break;
+            case 'e':
+                s_isFrameExportEnabled = !s_isFrameExportEnabled;
+                USER_LOG_INFO("Export stereo images to /dev/shm/%s %s.", USER_PERCEPTION_FRAME_EXPORT_NAME,
+                              s_isFrameExportEnabled ? "enabled" : "disabled");
+                continue;
+            case 'p':
+                if (!s_isStereoDepthEnabled && !DjiTest_StartStereoDepth(cameraParametersPacket)) {
+                    USER_LOG_ERROR("Start stereo depth pipeline failed.");
+                    continue;
+                }
+                s_isStereoDepthEnabled = !s_isStereoDepthEnabled;
+                USER_LOG_INFO("Stereo depth %s.", s_isStereoDepthEnabled ? "enabled" : "disabled");
+                continue;
             case 'q':
                 goto DestroyTask;
             default:
@@ -289,18 +352,34 @@ void DjiUser_RunStereoVisionViewSample(void)
     }
 
 DestroyTask:
+    /* The display task returns on its own once it sees the request, it never stops while holding the pool mutex. */
+    s_isDisplayStopRequested = true;
+    osalHandler->SemaphorePost(s_stereoImagePool.semaphore);
     returnCode = osalHandler->TaskDestroy(s_stereoImageThread);
     if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("Destroy task failed, return code:0x%08X", returnCode);
     }
 
-DestroyMutex:
-    returnCode = osalHandler->MutexDestroy(s_stereoImagePacket.mutex);
-    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("Destroy mutex failed, return code:0x%08X", returnCode);
+    for (int i = 0; i < USER_PERCEPTION_DIRECTION_NUM; i++) {
+        const T_DjiTestStereoImageSlot &slot = s_stereoImagePool.slots[i];
+
+        if (slot.receivedCount == 0) {
+            continue;
+        }
+        USER_LOG_INFO("[%-7s] images received: %u, consumed: %u, overwritten: %u", positionName[i].name,
+                      slot.receivedCount, slot.consumedCount, slot.overwrittenCount);
     }
 
+DestroyPool:
+    DjiTest_DestroyStereoImagePool(&s_stereoImagePool);
+
 DeletePerception:
+    /* Every image subscription is cancelled by now, nothing publishes into the exporter any more. */
+    if (s_frameExport != nullptr) {
+        DjiLiveviewFrameExport_Destroy(s_frameExport);
+        s_frameExport = nullptr;
+    }
+    DjiTest_StopStereoDepth();
     delete perceptionSample;
 }
 
@@ -309,6 +388,9 @@ static void DjiTest_PerceptionImageCallback(T_DjiPerceptionImageInfo imageInfo,
                                             uint32_t bufferLen)
 {
     T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiTestStereoImageSlot *slot;
+    T_DjiTestStereoImageBuffer *buffer;
+    int index;
 
     USER_LOG_INFO("image info : dataId(%d) seq(%d) timestamp(%llu) datatype(%d) index(%d) h(%d) w(%d) dir(%d) "
                   "bpp(%d) bufferlen(%d)", imageInfo.dataId, imageInfo.sequence, imageInfo.timeStamp,
@@ -317,21 +399,87 @@ static void DjiTest_PerceptionImageCallback(T_DjiPerceptionImageInfo imageInfo,
                   imageInfo.rawInfo.direction,
                   imageInfo.rawInfo.bpp, bufferLen);
 
-    if (imageRawBuffer) {
-        osalHandler->MutexLock(s_stereoImagePacket.mutex);
-        s_stereoImagePacket.info = imageInfo;
-        if (s_stereoImagePacket.imageRawBuffer) osalHandler->Free(s_stereoImagePacket.imageRawBuffer);
-        s_stereoImagePacket.imageRawBuffer = (uint8_t *) osalHandler->Malloc(bufferLen);
-        memcpy(s_stereoImagePacket.imageRawBuffer, imageRawBuffer, bufferLen);
-        s_stereoImagePacket.gotData = true;
-        osalHandler->MutexUnlock(s_stereoImagePacket.mutex);
+    if (imageRawBuffer && s_isFrameExportEnabled) {
+        DjiTest_ExportStereoImage(imageInfo, imageRawBuffer, bufferLen);
+    }
+
+    if (imageRawBuffer && s_isStereoDepthEnabled) {
+        s_stereoDepthPipeline->submitImage(imageInfo, imageRawBuffer, bufferLen);
+    }
+
+    index = DjiTest_GetCameraPositionIndex(imageInfo.dataType);
+    if (imageRawBuffer == nullptr || index < 0) {
+        return;
+    }
+
+    /*! The image is copied into the buffer only the callback writes to, the mutex covers the pointer swap alone. */
+    slot = &s_stereoImagePool.slots[index];
+    buffer = slot->writing;
+    if (bufferLen > buffer->size) {
+        osalHandler->Free(buffer->data);
+        buffer->data = (uint8_t *) osalHandler->Malloc(bufferLen);
+        buffer->size = buffer->data != nullptr ? bufferLen : 0;
+        if (buffer->data == nullptr) {
+            USER_LOG_ERROR("Malloc image buffer failed, size:%d", bufferLen);
+            return;
+        }
+    }
+    memcpy(buffer->data, imageRawBuffer, bufferLen);
+    buffer->info = imageInfo;
+
+    osalHandler->MutexLock(s_stereoImagePool.mutex);
+    slot->writing = slot->latest;
+    slot->latest = buffer;
+    if (slot->isLatestNew) {
+        slot->overwrittenCount++;
     }
+    slot->isLatestNew = true;
+    slot->receivedCount++;
+    osalHandler->MutexUnlock(s_stereoImagePool.mutex);
+
+    osalHandler->SemaphorePost(s_stereoImagePool.semaphore);
+}
+
+static void DjiTest_ExportStereoImage(const T_DjiPerceptionImageInfo &imageInfo, const uint8_t *imageRawBuffer,
+                                      uint32_t bufferLen)
+{
+    T_DjiLiveviewFrameExportFrame frame = {};
+    uint32_t imageSize = imageInfo.rawInfo.width * imageInfo.rawInfo.height;
+    T_DjiReturnCode returnCode;
+
+    if (imageSize == 0 || imageSize > bufferLen) {
+        return;
+    }
+
+    if (s_frameExport == nullptr) {
+        returnCode = DjiLiveviewFrameExport_Create(USER_PERCEPTION_FRAME_EXPORT_NAME,
+                                                   USER_PERCEPTION_FRAME_EXPORT_SLOT_COUNT, imageSize,
+                                                   &s_frameExport);
+        if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("Create frame export failed, return code:0x%08X", returnCode);
+            s_isFrameExportEnabled = false;
+            return;
+        }
+    }
+
+    /*! The camera position tells readers the left and right image of a pair apart. */
+    frame.timestampUs = imageInfo.timeStamp;
+    frame.width = imageInfo.rawInfo.width;
+    frame.height = imageInfo.rawInfo.height;
+    frame.format = DJI_LIVEVIEW_FRAME_EXPORT_FORMAT_GRAY8;
+    frame.sourceId = imageInfo.dataType;
+    frame.dataSize = imageSize;
+    frame.planeCount = 1;
+    frame.planeStride[0] = imageInfo.rawInfo.width;
+    frame.data = imageRawBuffer;
+    DjiLiveviewFrameExport_Publish(s_frameExport, &frame);
 }
 
 static void *DjiTest_StereoImagesDisplayTask(void *arg)
 {
     T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
-    auto *pack = (T_DjiTestStereoImagePacket *) arg;
+    auto *pool = (T_DjiTestStereoImagePool *) arg;
+#ifdef OPEN_CV_INSTALLED
     char nameStr[32] = {0};
     char fpsStr[20] = "FPS: ";
     int fps = 0;
@@ -340,36 +488,28 @@ static void *DjiTest_StereoImagesDisplayTask(void *arg)
     double timeFess[USER_PERCEPTION_DIRECTION_NUM] = {0};
     int count[USER_PERCEPTION_DIRECTION_NUM] = {1};
     char showFpsString[USER_PERCEPTION_DIRECTION_NUM][FPS_STRING_LEN] = {0};
-    int i = 0;
+#else
+    USER_LOG_WARN("Please install opencv to run this stereo image display sample.");
+#endif
 
-    while (true) {
-        osalHandler->TaskSleepMs(1);
-#ifdef OPEN_CV_INSTALLED
-        /*! Get data here */
-        osalHandler->MutexLock(pack->mutex);
-        if (!pack->gotData) {
-            osalHandler->MutexUnlock(pack->mutex);
-            continue;
-        }
-        cv::Mat cv_img_stereo = cv::Mat(pack->info.rawInfo.height, pack->info.rawInfo.width, CV_8U);
-        int copySize = pack->info.rawInfo.height * pack->info.rawInfo.width;
-        if (pack->imageRawBuffer) {
-            memcpy(cv_img_stereo.data, pack->imageRawBuffer, copySize);
-            osalHandler->Free(pack->imageRawBuffer);
-            pack->imageRawBuffer = NULL;
-        }
+    while (!s_isDisplayStopRequested) {
+        /*! Wakes up for every new frame, the timeout only bounds the time to notice a stop request. */
+        osalHandler->SemaphoreTimedWait(pool->semaphore, USER_PERCEPTION_DISPLAY_WAIT_MS);
 
-        for (i = 0; i < sizeof(positionName) / sizeof(T_DjiTestPerceptionCameraPositionName); ++i) {
-            if (positionName[i].cameraPosition == pack->info.dataType) {
-                sprintf(nameStr, "Image position: %s", positionName[i].name);
-                break;
+        for (int i = 0; i < USER_PERCEPTION_DIRECTION_NUM; ++i) {
+            if (!DjiTest_TakeLatestStereoImage(pool, i)) {
+                continue;
             }
-        }
-
-        pack->gotData = false;
-        osalHandler->MutexUnlock(pack->mutex);
+#ifdef OPEN_CV_INSTALLED
+            /*! The reading buffer stays with this task until the next take, so it is shown without a copy. */
+            T_DjiTestStereoImageBuffer *buffer = pool->slots[i].reading;
+            if ((uint32_t) buffer->info.rawInfo.height * buffer->info.rawInfo.width > buffer->size) {
+                continue;
+            }
+            cv::Mat cv_img_stereo = cv::Mat(buffer->info.rawInfo.height, buffer->info.rawInfo.width, CV_8U,
+                                            buffer->data);
+            sprintf(nameStr, "Image position: %s", positionName[i].name);
 
-        if (i < USER_PERCEPTION_DIRECTION_NUM) {
             /*! Calculate frame rate */
             timeNow[i] = (double) cv::getTickCount();
             if (timePrev[i] != 0) {
@@ -386,14 +526,180 @@ static void *DjiTest_StereoImagesDisplayTask(void *arg)
             timePrev[i] = timeNow[i];
             cv::putText(cv_img_stereo, &showFpsString[i][0], cv::Point(5, 20),
                         cv::FONT_HERSHEY_SIMPLEX, 0.5, cv::Scalar(0, 0, 0));
-        }
-        cv::imshow(nameStr, cv_img_stereo);
-        cv::waitKey(1);
-#else
-        osalHandler->TaskSleepMs(1000);
-        USER_LOG_WARN("Please install opencv to run this stereo image display sample.");
+            cv::imshow(nameStr, cv_img_stereo);
+            cv::waitKey(1);
 #endif
+        }
+    }
+
+    return nullptr;
+}
+
+static bool DjiTest_StartStereoDepth(const T_DjiPerceptionCameraParametersPacket &cameraParametersPacket)
+{
+    T_DjiStereoDepthConfig config = {};
+
+    if (s_stereoDepthPipeline != nullptr) {
+        return true;
+    }
+
+    config.output = DJI_STEREO_DEPTH_OUTPUT_DEPTH_IMAGE;
+    config.dropPolicy = DJI_STEREO_DEPTH_DROP_OLDEST;
+    config.uniquenessRatio = DJI_STEREO_DEPTH_UNIQUENESS_RATIO_DEFAULT;
+    for (auto &frameIntervalMs: config.frameIntervalMs) {
+        frameIntervalMs = USER_PERCEPTION_DEPTH_FRAME_INTERVAL_MS;
+    }
+    config.callback = DjiTest_StereoDepthCallback;
+
+    try {
+        s_stereoDepthPipeline = new DJIStereoDepthPipeline(config);
+    } catch (...) {
+        return false;
+    }
+
+    if (!s_stereoDepthPipeline->setCameraParameters(cameraParametersPacket) || !s_stereoDepthPipeline->start()) {
+        delete s_stereoDepthPipeline;
+        s_stereoDepthPipeline = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+static void DjiTest_StopStereoDepth(void)
+{
+    T_DjiStereoDepthStatistics statistics;
+
+    s_isStereoDepthEnabled = false;
+    if (s_stereoDepthPipeline == nullptr) {
+        return;
+    }
+
+    s_stereoDepthPipeline->stop();
+    for (const auto &direction: directionName) {
+        s_stereoDepthPipeline->getStatistics(direction.direction, statistics);
+        if (statistics.receivedCount == 0) {
+            continue;
+        }
+        USER_LOG_INFO("[%-5s] depth pairs received: %u, processed: %u, dropped by budget: %u, dropped busy: %u, "
+                      "unpaired: %u, average %.1f ms, longest %.1f ms", direction.name, statistics.receivedCount,
+                      statistics.processedCount, statistics.droppedBudgetCount, statistics.droppedBusyCount,
+                      statistics.unpairedCount,
+                      statistics.processedCount > 0 ? statistics.totalProcessMs / statistics.processedCount : 0,
+                      statistics.maxProcessMs);
+    }
+
+    delete s_stereoDepthPipeline;
+    s_stereoDepthPipeline = nullptr;
+}
+
+static void DjiTest_StereoDepthCallback(const T_DjiStereoDepthResult *result, void *userData)
+{
+    uint32_t pixelCount = result->width * result->height;
+    uint32_t validCount = 0;
+    float nearest = 0;
+
+    (void) userData;
+    for (uint32_t i = 0; i < pixelCount; i++) {
+        if (result->depth[i] > 0) {
+            nearest = validCount == 0 ? result->depth[i] : std::min(nearest, result->depth[i]);
+            validCount++;
+        }
+    }
+
+    USER_LOG_INFO("[%-5s] depth seq(%d): %u of %u pixels matched, nearest %.2f, %.1f ms",
+                  directionName[result->direction].name, result->sequence, validCount, pixelCount, nearest,
+                  result->processTimeMs);
+}
+
+static T_DjiReturnCode DjiTest_CreateStereoImagePool(T_DjiTestStereoImagePool *pool)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiReturnCode returnCode;
+
+    *pool = {};
+    for (auto &slot: pool->slots) {
+        for (auto &buffer: slot.buffers) {
+            buffer.data = (uint8_t *) osalHandler->Malloc(USER_PERCEPTION_IMAGE_SIZE_DEFAULT);
+            if (buffer.data == nullptr) {
+                DjiTest_DestroyStereoImagePool(pool);
+                return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+            }
+            buffer.size = USER_PERCEPTION_IMAGE_SIZE_DEFAULT;
+        }
+        slot.writing = &slot.buffers[0];
+        slot.latest = &slot.buffers[1];
+        slot.reading = &slot.buffers[2];
+    }
+
+    returnCode = osalHandler->MutexCreate(&pool->mutex);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        DjiTest_DestroyStereoImagePool(pool);
+        return returnCode;
+    }
+
+    returnCode = osalHandler->SemaphoreCreate(0, &pool->semaphore);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        DjiTest_DestroyStereoImagePool(pool);
+        return returnCode;
+    }
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void DjiTest_DestroyStereoImagePool(T_DjiTestStereoImagePool *pool)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+
+    if (pool->semaphore != nullptr) {
+        osalHandler->SemaphoreDestroy(pool->semaphore);
+        pool->semaphore = nullptr;
+    }
+    if (pool->mutex != nullptr) {
+        osalHandler->MutexDestroy(pool->mutex);
+        pool->mutex = nullptr;
+    }
+    for (auto &slot: pool->slots) {
+        for (auto &buffer: slot.buffers) {
+            if (buffer.data != nullptr) {
+                osalHandler->Free(buffer.data);
+                buffer.data = nullptr;
+            }
+            buffer.size = 0;
+        }
+    }
+}
+
+static int DjiTest_GetCameraPositionIndex(uint32_t dataType)
+{
+    for (int i = 0; i < USER_PERCEPTION_DIRECTION_NUM; ++i) {
+        if (positionName[i].cameraPosition == dataType) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static bool DjiTest_TakeLatestStereoImage(T_DjiTestStereoImagePool *pool, int index)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiTestStereoImageSlot *slot = &pool->slots[index];
+    T_DjiTestStereoImageBuffer *buffer;
+
+    osalHandler->MutexLock(pool->mutex);
+    if (!slot->isLatestNew) {
+        osalHandler->MutexUnlock(pool->mutex);
+        return false;
     }
+    buffer = slot->reading;
+    slot->reading = slot->latest;
+    slot->latest = buffer;
+    slot->isLatestNew = false;
+    slot->consumedCount++;
+    osalHandler->MutexUnlock(pool->mutex);
+
+    return true;
 }
 
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,605 @@
+/**
+ ********************************************************************
+ * @file    log_writer.c
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "log_writer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "osal/osal.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define LOG_WRITER_PATH_MAX_SIZE                (256)
+#define LOG_WRITER_PREFIX_MAX_SIZE              (32)
+#define LOG_WRITER_TASK_STACK_SIZE              (2048)
+#define LOG_WRITER_INDEX_FILE_NAME              "index"
+#define LOG_WRITER_LATEST_FILE_NAME             "latest.log"
+// Every message is stored behind a 32 bit header, the header is written last and carries the committed flag
+#define LOG_WRITER_RECORD_HEADER_SIZE           (sizeof(uint32_t))
+#define LOG_WRITER_RECORD_COMMITTED             (0x80000000U)
+#define LOG_WRITER_RECORD_LEN_MASK              (0x0000FFFFU)
+#define LOG_WRITER_RECORD_SIZE(len)             (LOG_WRITER_RECORD_HEADER_SIZE + (((len) + 3U) & ~3U))
+// Wait for another thread draining the queue on exit, unit: ms
+#define LOG_WRITER_EXIT_DRAIN_WAIT_MS           (100)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    // Written by the logging threads, kept away from the consumer side to avoid false sharing
+    uint64_t queueHead __attribute__((aligned(64)));
+    uint32_t activeWriterCount;
+    uint64_t queueTail __attribute__((aligned(64)));
+    uint32_t drainLock;
+    uint8_t *queue;
+    uint32_t queueSize;
+    uint8_t *batch;
+    uint32_t batchLen;
+    int32_t fileFd;
+    uint32_t fileSize;
+    bool isInit;
+    bool isStopRequested;
+    char folderPath[LOG_WRITER_PATH_MAX_SIZE / 2];
+    char filePrefix[LOG_WRITER_PREFIX_MAX_SIZE];
+    uint32_t maxFileCount;
+    uint32_t maxFileSize;
+    uint32_t flushIntervalMs;
+    uint32_t reportedDroppedCount;
+    T_LogWriterStatistics statistics;
+    T_DjiSemaHandle wakeSema;
+    T_DjiTaskHandle writerTask;
+} T_LogWriter;
+
+/* Private values -------------------------------------------------------------*/
+static T_LogWriter s_logWriter = {.fileFd = -1};
+static const int s_fatalSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+static struct sigaction s_oldFatalActions[sizeof(s_fatalSignals) / sizeof(s_fatalSignals[0])];
+static bool s_isExitHandlerRegistered = false;
+
+/* Private functions declaration ---------------------------------------------*/
+static void *LogWriter_Task(void *arg);
+static void LogWriter_DrainQueue(bool isFatal);
+static bool LogWriter_LockDrain(uint32_t waitMs);
+static void LogWriter_UnlockDrain(void);
+static void LogWriter_WriteBatch(bool isFatal);
+static T_DjiReturnCode LogWriter_OpenNextFile(void);
+static T_DjiReturnCode LogWriter_GetNextFileIndex(uint16_t *fileIndex);
+static void LogWriter_RemoveOldFiles(uint16_t fileIndex);
+static void LogWriter_UpdateLatestLink(const char *fileName);
+static void LogWriter_FlushOnExit(bool isFatal);
+static void LogWriter_ExitHandler(void);
+static void LogWriter_FatalSignalHandler(int signalNum);
+
+/* Exported functions definition ---------------------------------------------*/
+T_DjiReturnCode LogWriter_Init(const T_LogWriterConfig *config)
+{
+    T_DjiReturnCode returnCode;
+    struct sigaction fatalAction;
+    uint32_t i;
+
+    if (config == NULL || config->folderPath == NULL || config->filePrefix == NULL || config->maxFileCount == 0 ||
+        strlen(config->folderPath) >= LOG_WRITER_PATH_MAX_SIZE / 2 ||
+        strlen(config->filePrefix) >= LOG_WRITER_PREFIX_MAX_SIZE) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (config->queueSize != 0 &&
+        ((config->queueSize & (config->queueSize - 1)) != 0 || config->queueSize < LOG_WRITER_BATCH_SIZE)) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (__atomic_load_n(&s_logWriter.isInit, __ATOMIC_SEQ_CST) == true || s_logWriter.queue != NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    strcpy(s_logWriter.folderPath, config->folderPath);
+    strcpy(s_logWriter.filePrefix, config->filePrefix);
+    s_logWriter.maxFileCount = config->maxFileCount;
+    s_logWriter.maxFileSize = config->maxFileSize;
+    s_logWriter.queueSize = config->queueSize != 0 ? config->queueSize : LOG_WRITER_QUEUE_SIZE_DEFAULT;
+    s_logWriter.flushIntervalMs =
+        config->flushIntervalMs != 0 ? config->flushIntervalMs : LOG_WRITER_FLUSH_INTERVAL_MS_DEFAULT;
+    s_logWriter.queueHead = 0;
+    s_logWriter.queueTail = 0;
+    s_logWriter.batchLen = 0;
+    s_logWriter.fileSize = 0;
+    s_logWriter.reportedDroppedCount = 0;
+    s_logWriter.isStopRequested = false;
+    memset(&s_logWriter.statistics, 0, sizeof(s_logWriter.statistics));
+
+    if (mkdir(s_logWriter.folderPath, 0755) != 0 && errno != EEXIST) {
+        printf("Create log folder %s error, errno: %d.\r\n", s_logWriter.folderPath, errno);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    // Consumed records are zeroed, so a header that has not been committed yet always reads as zero
+    s_logWriter.queue = calloc(1, s_logWriter.queueSize);
+    s_logWriter.batch = malloc(LOG_WRITER_BATCH_SIZE);
+    if (s_logWriter.queue == NULL || s_logWriter.batch == NULL) {
+        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out;
+    }
+
+    returnCode = LogWriter_OpenNextFile();
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto out;
+    }
+
+    returnCode = Osal_SemaphoreCreate(0, &s_logWriter.wakeSema);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto close_file;
+    }
+
+    returnCode = Osal_TaskCreate("log_writer", LogWriter_Task, LOG_WRITER_TASK_STACK_SIZE, NULL,
+                                 &s_logWriter.writerTask);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto destroy_sema;
+    }
+
+    memset(&fatalAction, 0, sizeof(fatalAction));
+    fatalAction.sa_handler = LogWriter_FatalSignalHandler;
+    sigemptyset(&fatalAction.sa_mask);
+    for (i = 0; i < sizeof(s_fatalSignals) / sizeof(s_fatalSignals[0]); i++) {
+        sigaction(s_fatalSignals[i], &fatalAction, &s_oldFatalActions[i]);
+    }
+
+    if (s_isExitHandlerRegistered == false) {
+        atexit(LogWriter_ExitHandler);
+        s_isExitHandlerRegistered = true;
+    }
+
+    __atomic_store_n(&s_logWriter.isInit, true, __ATOMIC_SEQ_CST);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+destroy_sema:
+    Osal_SemaphoreDestroy(s_logWriter.wakeSema);
+close_file:
+    close(s_logWriter.fileFd);
+    s_logWriter.fileFd = -1;
+out:
+    free(s_logWriter.queue);
+    free(s_logWriter.batch);
+    s_logWriter.queue = NULL;
+    s_logWriter.batch = NULL;
+
+    return returnCode;
+}
+
+T_DjiReturnCode LogWriter_DeInit(void)
+{
+    uint32_t i;
+
+    if (__atomic_load_n(&s_logWriter.isInit, __ATOMIC_SEQ_CST) == false) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    // Refuse new messages, then wait for the threads that are still copying theirs into the queue
+    __atomic_store_n(&s_logWriter.isInit, false, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&s_logWriter.activeWriterCount, __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+
+    for (i = 0; i < sizeof(s_fatalSignals) / sizeof(s_fatalSignals[0]); i++) {
+        sigaction(s_fatalSignals[i], &s_oldFatalActions[i], NULL);
+    }
+
+    // The task writes out the whole queue before it returns
+    __atomic_store_n(&s_logWriter.isStopRequested, true, __ATOMIC_RELEASE);
+    Osal_SemaphorePost(s_logWriter.wakeSema);
+    Osal_TaskDestroy(s_logWriter.writerTask);
+    Osal_SemaphoreDestroy(s_logWriter.wakeSema);
+
+    LogWriter_LockDrain(0);
+    LogWriter_DrainQueue(false);
+    fdatasync(s_logWriter.fileFd);
+    close(__atomic_exchange_n(&s_logWriter.fileFd, -1, __ATOMIC_ACQ_REL));
+    free(s_logWriter.queue);
+    free(s_logWriter.batch);
+    s_logWriter.queue = NULL;
+    s_logWriter.batch = NULL;
+    LogWriter_UnlockDrain();
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode LogWriter_Write(const uint8_t *data, uint16_t dataLen)
+{
+    T_DjiReturnCode returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    uint32_t recordSize = LOG_WRITER_RECORD_SIZE(dataLen);
+    uint32_t queueMask;
+    uint32_t offset;
+    uint32_t firstLen;
+    uint64_t head;
+    uint64_t used;
+
+    if (data == NULL || dataLen == 0) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    __atomic_add_fetch(&s_logWriter.activeWriterCount, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&s_logWriter.isInit, __ATOMIC_SEQ_CST) == false) {
+        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+        goto out;
+    }
+
+    // Reserve room for the record, the messages that do not fit are dropped instead of blocking the caller
+    head = __atomic_load_n(&s_logWriter.queueHead, __ATOMIC_RELAXED);
+    do {
+        used = head - __atomic_load_n(&s_logWriter.queueTail, __ATOMIC_ACQUIRE);
+        if (used + recordSize > s_logWriter.queueSize) {
+            __atomic_add_fetch(&s_logWriter.statistics.droppedCount, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&s_logWriter.statistics.droppedBytes, dataLen, __ATOMIC_RELAXED);
+            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_BUSY;
+            goto out;
+        }
+    } while (__atomic_compare_exchange_n(&s_logWriter.queueHead, &head, head + recordSize, true,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) == false);
+
+    queueMask = s_logWriter.queueSize - 1;
+    offset = (uint32_t) (head + LOG_WRITER_RECORD_HEADER_SIZE) & queueMask;
+    firstLen = s_logWriter.queueSize - offset;
+    if (firstLen >= dataLen) {
+        memcpy(&s_logWriter.queue[offset], data, dataLen);
+    } else {
+        memcpy(&s_logWriter.queue[offset], data, firstLen);
+        memcpy(&s_logWriter.queue[0], data + firstLen, dataLen - firstLen);
+    }
+
+    __atomic_store_n((uint32_t *) &s_logWriter.queue[(uint32_t) head & queueMask],
+                     dataLen | LOG_WRITER_RECORD_COMMITTED, __ATOMIC_RELEASE);
+
+    // The writer task wakes up on its own every flush interval, only hurry it when the queue gets half full
+    if (used < s_logWriter.queueSize / 2 && used + recordSize >= s_logWriter.queueSize / 2) {
+        Osal_SemaphorePost(s_logWriter.wakeSema);
+    }
+
+out:
+    __atomic_sub_fetch(&s_logWriter.activeWriterCount, 1, __ATOMIC_SEQ_CST);
+
+    return returnCode;
+}
+
+T_DjiReturnCode LogWriter_GetStatistics(T_LogWriterStatistics *statistics)
+{
+    if (statistics == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    statistics->writtenBytes = __atomic_load_n(&s_logWriter.statistics.writtenBytes, __ATOMIC_RELAXED);
+    statistics->droppedBytes = __atomic_load_n(&s_logWriter.statistics.droppedBytes, __ATOMIC_RELAXED);
+    statistics->droppedCount = __atomic_load_n(&s_logWriter.statistics.droppedCount, __ATOMIC_RELAXED);
+    statistics->rotatedCount = __atomic_load_n(&s_logWriter.statistics.rotatedCount, __ATOMIC_RELAXED);
+    statistics->writeErrorCount = __atomic_load_n(&s_logWriter.statistics.writeErrorCount, __ATOMIC_RELAXED);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void *LogWriter_Task(void *arg)
+{
+    (void) arg;
+
+    while (__atomic_load_n(&s_logWriter.isStopRequested, __ATOMIC_ACQUIRE) == false &&
+           Osal_TaskShouldStop() == false) {
+        Osal_SemaphoreTimedWait(s_logWriter.wakeSema, s_logWriter.flushIntervalMs);
+
+        LogWriter_LockDrain(0);
+        LogWriter_DrainQueue(false);
+        LogWriter_UnlockDrain();
+    }
+
+    LogWriter_LockDrain(0);
+    LogWriter_DrainQueue(false);
+    LogWriter_UnlockDrain();
+
+    return NULL;
+}
+
+/**
+ * @brief Move the committed records from the queue to the log file, called with the drain lock held.
+ * @note Only async-signal-safe calls are made when isFatal is set.
+ */
+static void LogWriter_DrainQueue(bool isFatal)
+{
+    uint32_t queueMask = s_logWriter.queueSize - 1;
+    uint32_t droppedCount;
+    uint32_t recordSize;
+    uint32_t header;
+    uint32_t offset;
+    uint32_t firstLen;
+    uint32_t len;
+    uint64_t tail;
+    int ret;
+
+    if (s_logWriter.queue == NULL) {
+        return;
+    }
+
+    tail = __atomic_load_n(&s_logWriter.queueTail, __ATOMIC_RELAXED);
+    while (true) {
+        offset = (uint32_t) tail & queueMask;
+        header = __atomic_load_n((uint32_t *) &s_logWriter.queue[offset], __ATOMIC_ACQUIRE);
+        if ((header & LOG_WRITER_RECORD_COMMITTED) == 0) {
+            break;
+        }
+
+        len = header & LOG_WRITER_RECORD_LEN_MASK;
+        recordSize = LOG_WRITER_RECORD_SIZE(len);
+        if (s_logWriter.batchLen + len > LOG_WRITER_BATCH_SIZE) {
+            LogWriter_WriteBatch(isFatal);
+        }
+
+        offset = (uint32_t) (tail + LOG_WRITER_RECORD_HEADER_SIZE) & queueMask;
+        firstLen = s_logWriter.queueSize - offset;
+        if (firstLen >= len) {
+            memcpy(&s_logWriter.batch[s_logWriter.batchLen], &s_logWriter.queue[offset], len);
+        } else {
+            memcpy(&s_logWriter.batch[s_logWriter.batchLen], &s_logWriter.queue[offset], firstLen);
+            memcpy(&s_logWriter.batch[s_logWriter.batchLen + firstLen], &s_logWriter.queue[0], len - firstLen);
+        }
+        s_logWriter.batchLen += len;
+
+        offset = (uint32_t) tail & queueMask;
+        firstLen = s_logWriter.queueSize - offset;
+        if (firstLen >= recordSize) {
+            memset(&s_logWriter.queue[offset], 0, recordSize);
+        } else {
+            memset(&s_logWriter.queue[offset], 0, firstLen);
+            memset(&s_logWriter.queue[0], 0, recordSize - firstLen);
+        }
+
+        tail += recordSize;
+        __atomic_store_n(&s_logWriter.queueTail, tail, __ATOMIC_RELEASE);
+    }
+
+    droppedCount = __atomic_load_n(&s_logWriter.statistics.droppedCount, __ATOMIC_RELAXED);
+    if (isFatal == false && droppedCount != s_logWriter.reportedDroppedCount) {
+        if (s_logWriter.batchLen + 128 > LOG_WRITER_BATCH_SIZE) {
+            LogWriter_WriteBatch(isFatal);
+        }
+
+        ret = snprintf((char *) &s_logWriter.batch[s_logWriter.batchLen], 128,
+                       "[log writer] %u messages dropped because the queue was full.\r\n",
+                       droppedCount - s_logWriter.reportedDroppedCount);
+        if (ret > 0 && ret < 128) {
+            s_logWriter.batchLen += ret;
+        }
+        s_logWriter.reportedDroppedCount = droppedCount;
+    }
+
+    LogWriter_WriteBatch(isFatal);
+}
+
+static bool LogWriter_LockDrain(uint32_t waitMs)
+{
+    struct timespec sleepTime = {.tv_sec = 0, .tv_nsec = 1000000};
+    uint32_t waitedMs = 0;
+
+    while (__atomic_exchange_n(&s_logWriter.drainLock, 1, __ATOMIC_ACQUIRE) != 0) {
+        if (waitMs != 0 && waitedMs++ >= waitMs) {
+            return false;
+        }
+        nanosleep(&sleepTime, NULL);
+    }
+
+    return true;
+}
+
+static void LogWriter_UnlockDrain(void)
+{
+    __atomic_store_n(&s_logWriter.drainLock, 0, __ATOMIC_RELEASE);
+}
+
+static void LogWriter_WriteBatch(bool isFatal)
+{
+    uint32_t writtenLen = 0;
+    ssize_t ret;
+
+    while (writtenLen < s_logWriter.batchLen) {
+        ret = write(s_logWriter.fileFd, &s_logWriter.batch[writtenLen], s_logWriter.batchLen - writtenLen);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            __atomic_add_fetch(&s_logWriter.statistics.writeErrorCount, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        writtenLen += ret;
+    }
+
+    s_logWriter.batchLen = 0;
+    s_logWriter.fileSize += writtenLen;
+    __atomic_add_fetch(&s_logWriter.statistics.writtenBytes, writtenLen, __ATOMIC_RELAXED);
+
+    // Files are switched between batches, so a file can outgrow maxFileSize by up to one batch
+    if (isFatal == false && s_logWriter.maxFileSize != 0 && s_logWriter.fileSize >= s_logWriter.maxFileSize) {
+        if (LogWriter_OpenNextFile() == DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            __atomic_add_fetch(&s_logWriter.statistics.rotatedCount, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static T_DjiReturnCode LogWriter_OpenNextFile(void)
+{
+    T_DjiReturnCode returnCode;
+    char fileName[LOG_WRITER_PATH_MAX_SIZE / 2];
+    char filePath[LOG_WRITER_PATH_MAX_SIZE];
+    time_t currentTime = time(NULL);
+    struct tm localTime;
+    uint16_t fileIndex;
+    int32_t fileFd;
+
+    if (localtime_r(&currentTime, &localTime) == NULL) {
+        printf("Get local time error.\r\n");
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    returnCode = LogWriter_GetNextFileIndex(&fileIndex);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    snprintf(fileName, sizeof(fileName), "%s_%04d_%04d%02d%02d_%02d-%02d-%02d.log", s_logWriter.filePrefix,
+             fileIndex, localTime.tm_year + 1900, localTime.tm_mon + 1, localTime.tm_mday,
+             localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+    snprintf(filePath, sizeof(filePath), "%s/%s", s_logWriter.folderPath, fileName);
+
+    fileFd = open(filePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fileFd < 0) {
+        printf("Open log file %s error, errno: %d.\r\n", filePath, errno);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    fileFd = __atomic_exchange_n(&s_logWriter.fileFd, fileFd, __ATOMIC_ACQ_REL);
+    if (fileFd >= 0) {
+        close(fileFd);
+    }
+    s_logWriter.fileSize = 0;
+
+    LogWriter_RemoveOldFiles(fileIndex);
+    LogWriter_UpdateLatestLink(fileName);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_DjiReturnCode LogWriter_GetNextFileIndex(uint16_t *fileIndex)
+{
+    char indexPath[LOG_WRITER_PATH_MAX_SIZE];
+    uint16_t nextFileIndex;
+    int32_t indexFd;
+
+    snprintf(indexPath, sizeof(indexPath), "%s/" LOG_WRITER_INDEX_FILE_NAME, s_logWriter.folderPath);
+    indexFd = open(indexPath, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (indexFd < 0) {
+        printf("Open log file index %s error, errno: %d.\r\n", indexPath, errno);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (pread(indexFd, fileIndex, sizeof(uint16_t), 0) != sizeof(uint16_t)) {
+        *fileIndex = 0;
+    }
+
+    nextFileIndex = *fileIndex + 1;
+    if (pwrite(indexFd, &nextFileIndex, sizeof(uint16_t), 0) != sizeof(uint16_t)) {
+        printf("Write log file index error, errno: %d.\r\n", errno);
+        close(indexFd);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    close(indexFd);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void LogWriter_RemoveOldFiles(uint16_t fileIndex)
+{
+    char pattern[LOG_WRITER_PATH_MAX_SIZE];
+    glob_t globResult;
+    size_t i;
+
+    if (fileIndex < s_logWriter.maxFileCount) {
+        return;
+    }
+
+    snprintf(pattern, sizeof(pattern), "%s/%s_%04d_*.log", s_logWriter.folderPath, s_logWriter.filePrefix,
+             (uint16_t) (fileIndex - s_logWriter.maxFileCount));
+    if (glob(pattern, GLOB_NOSORT, NULL, &globResult) != 0) {
+        return;
+    }
+
+    for (i = 0; i < globResult.gl_pathc; i++) {
+        if (unlink(globResult.gl_pathv[i]) != 0) {
+            printf("Remove log file %s error, errno: %d.\r\n", globResult.gl_pathv[i], errno);
+        }
+    }
+
+    globfree(&globResult);
+}
+
+static void LogWriter_UpdateLatestLink(const char *fileName)
+{
+    char linkPath[LOG_WRITER_PATH_MAX_SIZE];
+    char tempLinkPath[LOG_WRITER_PATH_MAX_SIZE];
+
+    // Link relative to the folder and swap it in with rename, so readers never miss the link
+    snprintf(linkPath, sizeof(linkPath), "%s/" LOG_WRITER_LATEST_FILE_NAME, s_logWriter.folderPath);
+    snprintf(tempLinkPath, sizeof(tempLinkPath), "%s/." LOG_WRITER_LATEST_FILE_NAME, s_logWriter.folderPath);
+
+    unlink(tempLinkPath);
+    if (symlink(fileName, tempLinkPath) != 0 || rename(tempLinkPath, linkPath) != 0) {
+        printf("Update latest log link error, errno: %d.\r\n", errno);
+        unlink(tempLinkPath);
+    }
+}
+
+static void LogWriter_FlushOnExit(bool isFatal)
+{
+    int32_t fileFd;
+
+    if (__atomic_load_n(&s_logWriter.isInit, __ATOMIC_SEQ_CST) == false) {
+        return;
+    }
+
+    // The writer task may be in the middle of a batch, give it a moment. A crash inside the writer task itself
+    // leaves the lock held, and only the data already handed to the kernel is synced.
+    if (LogWriter_LockDrain(LOG_WRITER_EXIT_DRAIN_WAIT_MS) == true) {
+        LogWriter_DrainQueue(isFatal);
+        LogWriter_UnlockDrain();
+    }
+
+    fileFd = __atomic_load_n(&s_logWriter.fileFd, __ATOMIC_ACQUIRE);
+    if (fileFd >= 0) {
+        fdatasync(fileFd);
+    }
+}
+
+static void LogWriter_ExitHandler(void)
+{
+    LogWriter_FlushOnExit(false);
+}
+
+static void LogWriter_FatalSignalHandler(int signalNum)
+{
+    uint32_t i;
+
+    LogWriter_FlushOnExit(true);
+
+    // Hand the signal back to the previous action once this handler returns
+    for (i = 0; i < sizeof(s_fatalSignals) / sizeof(s_fatalSignals[0]); i++) {
+        if (s_fatalSignals[i] == signalNum) {
+            sigaction(signalNum, &s_oldFatalActions[i], NULL);
+            break;
+        }
+    }
+    raise(signalNum);
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -25,65 +25,231 @@
 /* Includes ------------------------------------------------------------------*/
 #include "osal.h"
 #include "dji_typedef.h"
+#include <errno.h>
+#include <limits.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
 
 /* Private constants ---------------------------------------------------------*/
+#define OSAL_TASK_NAME_MAX_SIZE                 (16)
+#define OSAL_TASK_ATTRIBUTE_MAX_NUM             (32)
+#define OSAL_TASK_ATTRIBUTE_NAME_MAX_SIZE       (48)
+#define OSAL_TASK_ATTRIBUTE_LINE_MAX_SIZE       (256)
+
+/*! sem_clockwait and pthread_clockjoin_np, waiting on CLOCK_MONOTONIC deadlines, come with glibc 2.31 */
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 31))
+#define OSAL_MONOTONIC_WAIT_SUPPORTED           1
+#else
+#define OSAL_MONOTONIC_WAIT_SUPPORTED           0
+#endif
 
 /* Private types -------------------------------------------------------------*/
+typedef struct {
+    pthread_t thread;
+    char name[OSAL_TASK_NAME_MAX_SIZE];
+    void *(*taskFunc)(void *);
+    void *arg;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool isStopRequested;
+    bool isCooperative;
+    bool isDetached;
+    bool isFinished;
+} T_OsalTask;
+
+typedef struct {
+    char name[OSAL_TASK_ATTRIBUTE_NAME_MAX_SIZE];
+    bool isPrefix;
+    int policy;
+    int priority;
+    bool isCpuSetValid;
+    cpu_set_t cpuSet;
+    size_t stackSize;
+} T_OsalTaskAttribute;
 
 /* Private values -------------------------------------------------------------*/
-static uint32_t s_localTimeMsOffset = 0;
-static uint64_t s_localTimeUsOffset = 0;
+static uint64_t s_localTimeBaseNs = 0;
+static __thread T_OsalTask *s_currentTask = NULL;
+static pthread_once_t s_taskAttributeLoadOnce = PTHREAD_ONCE_INIT;
+static T_OsalTaskAttribute s_taskAttributes[OSAL_TASK_ATTRIBUTE_MAX_NUM];
+static uint32_t s_taskAttributeCount = 0;
 
 /* Private functions declaration ---------------------------------------------*/
+static void *Osal_TaskEntry(void *arg);
+static void Osal_TaskExit(void *arg);
+static int Osal_TaskTimedJoin(T_OsalTask *osalTask, uint32_t timeoutMs);
+static void Osal_GetDeadline(clockid_t clockId, uint32_t timeoutMs, struct timespec *deadline);
+static uint64_t Osal_GetLocalTimeNs(void);
+static void Osal_TaskLoadAttributes(void);
+static void Osal_TaskParseCpuList(const char *cpuList, cpu_set_t *cpuSet);
+static const T_OsalTaskAttribute *Osal_TaskFindAttribute(const char *name);
+static void Osal_TaskApplyAttribute(pthread_attr_t *threadAttr, uint32_t stackSize,
+                                    const T_OsalTaskAttribute *taskAttribute, bool isRealTime);
 
 /* Exported functions definition ---------------------------------------------*/
-
-/* Private functions definition-----------------------------------------------*/
-
-/* Private functions declaration ---------------------------------------------*/
-
-/* Exported functions definition ---------------------------------------------*/
-
 T_DjiReturnCode Osal_TaskCreate(const char *name, void *(*taskFunc)(void *), uint32_t stackSize, void *arg,
                                 T_DjiTaskHandle *task)
 {
     int result;
-    char nameDealed[16] = {0};
+    T_OsalTask *osalTask;
+    const T_OsalTaskAttribute *taskAttribute;
+    pthread_attr_t threadAttr;
+    pthread_condattr_t condAttr;
 
-    *task = malloc(sizeof(pthread_t));
-    if (*task == NULL) {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    if (task == NULL || taskFunc == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
-    result = pthread_create(*task, NULL, taskFunc, arg);
-    if (result != 0) {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    pthread_once(&s_taskAttributeLoadOnce, Osal_TaskLoadAttributes);
+
+    osalTask = calloc(1, sizeof(T_OsalTask));
+    if (osalTask == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
     }
 
     if (name != NULL)
-        strncpy(nameDealed, name, sizeof(nameDealed) - 1);
-    result = pthread_setname_np(*(pthread_t *) *task, nameDealed);
+        strncpy(osalTask->name, name, sizeof(osalTask->name) - 1);
+    osalTask->taskFunc = taskFunc;
+    osalTask->arg = arg;
+    pthread_mutex_init(&osalTask->mutex, NULL);
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&osalTask->cond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
+    taskAttribute = Osal_TaskFindAttribute(name);
+
+    pthread_attr_init(&threadAttr);
+    Osal_TaskApplyAttribute(&threadAttr, stackSize, taskAttribute, true);
+    result = pthread_create(&osalTask->thread, &threadAttr, Osal_TaskEntry, osalTask);
+    pthread_attr_destroy(&threadAttr);
+
+    if (result == EPERM && taskAttribute != NULL && taskAttribute->policy != SCHED_OTHER) {
+        fprintf(stderr, "Osal: no permission for real-time scheduling of task %s, "
+                        "it runs with the default policy.\n", osalTask->name);
+        pthread_attr_init(&threadAttr);
+        Osal_TaskApplyAttribute(&threadAttr, stackSize, taskAttribute, false);
+        result = pthread_create(&osalTask->thread, &threadAttr, Osal_TaskEntry, osalTask);
+        pthread_attr_destroy(&threadAttr);
+    }
+
     if (result != 0) {
+        pthread_cond_destroy(&osalTask->cond);
+        pthread_mutex_destroy(&osalTask->mutex);
+        free(osalTask);
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
-    pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    *task = osalTask;
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
+/**
+ * @brief Ask a task to stop and wait for it to end.
+ * @note A task polling Osal_TaskShouldStop is woken from Osal_TaskSleepMs and left to return by itself. Any other
+ * task ends at its next Osal_TaskSleepMs. A task still running after OSAL_TASK_STOP_TIMEOUT_MS is cancelled.
+ * @param task: task handle.
+ * @return an enum that represents a status of PSDK
+ */
 T_DjiReturnCode Osal_TaskDestroy(T_DjiTaskHandle task)
 {
-    pthread_cancel(*(pthread_t *) task);
-    free(task);
+    T_OsalTask *osalTask = (T_OsalTask *) task;
+    bool isFinished;
+
+    if (task == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (pthread_equal(osalTask->thread, pthread_self())) {
+        /*! a task cannot wait for itself, it ends at its next cancellation point and frees its handle on exit */
+        pthread_mutex_lock(&osalTask->mutex);
+        osalTask->isStopRequested = true;
+        osalTask->isDetached = true;
+        pthread_mutex_unlock(&osalTask->mutex);
+        pthread_detach(osalTask->thread);
+        pthread_cancel(osalTask->thread);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    pthread_mutex_lock(&osalTask->mutex);
+    osalTask->isStopRequested = true;
+    pthread_cond_broadcast(&osalTask->cond);
+    pthread_mutex_unlock(&osalTask->mutex);
+
+    if (Osal_TaskTimedJoin(osalTask, OSAL_TASK_STOP_TIMEOUT_MS) != 0) {
+        pthread_cancel(osalTask->thread);
+        if (Osal_TaskTimedJoin(osalTask, OSAL_TASK_STOP_TIMEOUT_MS) != 0) {
+            pthread_mutex_lock(&osalTask->mutex);
+            osalTask->isDetached = true;
+            isFinished = osalTask->isFinished;
+            pthread_mutex_unlock(&osalTask->mutex);
+            pthread_detach(osalTask->thread);
+            if (isFinished == false) {
+                fprintf(stderr, "Osal: task %s did not stop in time and was left detached.\n", osalTask->name);
+                return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            }
+        }
+    }
+
+    pthread_cond_destroy(&osalTask->cond);
+    pthread_mutex_destroy(&osalTask->mutex);
+    free(osalTask);
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
+/**
+ * @brief Tell the calling task whether Osal_TaskDestroy has asked it to stop.
+ * @note A task calling this is expected to return by itself once it reads true, so its sleeps are cut short
+ * instead of ending the task.
+ * @return true when the task should return, always false outside tasks created by Osal_TaskCreate.
+ */
+bool Osal_TaskShouldStop(void)
+{
+    T_OsalTask *osalTask = s_currentTask;
+    bool isStopRequested;
+
+    if (osalTask == NULL) {
+        return false;
+    }
+
+    pthread_mutex_lock(&osalTask->mutex);
+    osalTask->isCooperative = true;
+    isStopRequested = osalTask->isStopRequested;
+    pthread_mutex_unlock(&osalTask->mutex);
+
+    return isStopRequested;
+}
+
 T_DjiReturnCode Osal_TaskSleepMs(uint32_t timeMs)
 {
-    usleep(1000 * timeMs);
+    T_OsalTask *osalTask = s_currentTask;
+    struct timespec deadline;
+    bool isStopRequested;
+    bool isCooperative;
+    int result = 0;
+
+    if (osalTask == NULL) {
+        usleep(1000 * timeMs);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    Osal_GetDeadline(CLOCK_MONOTONIC, timeMs, &deadline);
+
+    pthread_mutex_lock(&osalTask->mutex);
+    while (osalTask->isStopRequested == false && result != ETIMEDOUT) {
+        result = pthread_cond_timedwait(&osalTask->cond, &osalTask->mutex, &deadline);
+    }
+    isStopRequested = osalTask->isStopRequested;
+    isCooperative = osalTask->isCooperative;
+    pthread_mutex_unlock(&osalTask->mutex);
+
+    /*! a task that never asks whether to stop ends here, where usleep used to be its cancellation point */
+    if (isStopRequested == true && isCooperative == false) {
+        pthread_exit(NULL);
+    }
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
@@ -252,20 +418,18 @@ T_DjiReturnCode Osal_SemaphoreTimedWait(T_DjiSemaHandle semaphore, uint32_t wait
 {
     int result;
     struct timespec semaphoreWaitTime;
-    struct timeval systemTime;
-
-    gettimeofday(&systemTime, NULL);
-
-    systemTime.tv_usec += waitTime * 1000;
-    if (systemTime.tv_usec >= 1000000) {
-        systemTime.tv_sec += systemTime.tv_usec / 1000000;
-        systemTime.tv_usec %= 1000000;
-    }
 
-    semaphoreWaitTime.tv_sec = systemTime.tv_sec;
-    semaphoreWaitTime.tv_nsec = systemTime.tv_usec * 1000;
+    /*! a monotonic deadline is not moved by NTP or GPS steps of the wall clock */
+    do {
+#if OSAL_MONOTONIC_WAIT_SUPPORTED
+        Osal_GetDeadline(CLOCK_MONOTONIC, waitTime, &semaphoreWaitTime);
+        result = sem_clockwait(semaphore, CLOCK_MONOTONIC, &semaphoreWaitTime);
+#else
+        Osal_GetDeadline(CLOCK_REALTIME, waitTime, &semaphoreWaitTime);
+        result = sem_timedwait(semaphore, &semaphoreWaitTime);
+#endif
+    } while (result != 0 && errno == EINTR);
 
-    result = sem_timedwait(semaphore, &semaphoreWaitTime);
     if (result != 0) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
@@ -292,36 +456,19 @@ T_DjiReturnCode Osal_SemaphorePost(T_DjiSemaHandle semaphore)
 
 /**
  * @brief Get the system time for ms.
+ * @note Counted on CLOCK_MONOTONIC from the first time query of the process, so wall clock steps never move it.
  * @return an uint32 that the time of system, uint:ms
  */
 T_DjiReturnCode Osal_GetTimeMs(uint32_t *ms)
 {
-    struct timeval time;
-
-    gettimeofday(&time, NULL);
-    *ms = (time.tv_sec * 1000 + time.tv_usec / 1000);
-
-    if (s_localTimeMsOffset == 0) {
-        s_localTimeMsOffset = *ms;
-    } else {
-        *ms = *ms - s_localTimeMsOffset;
-    }
+    *ms = (uint32_t) (Osal_GetLocalTimeNs() / 1000000);
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 T_DjiReturnCode Osal_GetTimeUs(uint64_t *us)
 {
-    struct timeval time;
-
-    gettimeofday(&time, NULL);
-    *us = (time.tv_sec * 1000000 + time.tv_usec);
-
-    if (s_localTimeUsOffset == 0) {
-        s_localTimeUsOffset = *us;
-    } else {
-        *us = *us - s_localTimeUsOffset;
-    }
+    *us = Osal_GetLocalTimeNs() / 1000;
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
@@ -344,4 +491,254 @@ void Osal_Free(void *ptr)
     free(ptr);
 }
 
+/* Private functions definition-----------------------------------------------*/
+static void *Osal_TaskEntry(void *arg)
+{
+    T_OsalTask *osalTask = (T_OsalTask *) arg;
+    void *result;
+
+    s_currentTask = osalTask;
+    pthread_setname_np(pthread_self(), osalTask->name);
+
+    pthread_cleanup_push(Osal_TaskExit, osalTask);
+    result = osalTask->taskFunc(osalTask->arg);
+    pthread_cleanup_pop(1);
+
+    return result;
+}
+
+static void Osal_TaskExit(void *arg)
+{
+    T_OsalTask *osalTask = (T_OsalTask *) arg;
+    bool isDetached;
+
+    pthread_mutex_lock(&osalTask->mutex);
+    osalTask->isFinished = true;
+    isDetached = osalTask->isDetached;
+    pthread_mutex_unlock(&osalTask->mutex);
+
+    /*! nobody joins a detached task, so it frees its own handle */
+    if (isDetached == true) {
+        pthread_cond_destroy(&osalTask->cond);
+        pthread_mutex_destroy(&osalTask->mutex);
+        free(osalTask);
+    }
+}
+
+static int Osal_TaskTimedJoin(T_OsalTask *osalTask, uint32_t timeoutMs)
+{
+    struct timespec deadline;
+
+#if OSAL_MONOTONIC_WAIT_SUPPORTED
+    Osal_GetDeadline(CLOCK_MONOTONIC, timeoutMs, &deadline);
+    return pthread_clockjoin_np(osalTask->thread, NULL, CLOCK_MONOTONIC, &deadline);
+#else
+    Osal_GetDeadline(CLOCK_REALTIME, timeoutMs, &deadline);
+    return pthread_timedjoin_np(osalTask->thread, NULL, &deadline);
+#endif
+}
+
+static void Osal_GetDeadline(clockid_t clockId, uint32_t timeoutMs, struct timespec *deadline)
+{
+    clock_gettime(clockId, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += (long) (timeoutMs % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec += 1;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+static uint64_t Osal_GetLocalTimeNs(void)
+{
+    struct timespec time;
+    uint64_t nowNs;
+    uint64_t baseNs;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    nowNs = (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+
+    /*! the first reading in the process becomes the time base, concurrent first callers settle on one of theirs */
+    baseNs = __atomic_load_n(&s_localTimeBaseNs, __ATOMIC_RELAXED);
+    if (baseNs == 0) {
+        if (__atomic_compare_exchange_n(&s_localTimeBaseNs, &baseNs, nowNs, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            baseNs = nowNs;
+        }
+    }
+
+    return nowNs > baseNs ? nowNs - baseNs : 0;
+}
+
+/**
+ * @brief Load the task attribute file once per process.
+ * @note One task per line: name, policy (other, fifo or rr), priority, cpu list and optional stack size in bytes.
+ * A name ending with '*' matches every task starting with it, "-" leaves the cpu list unset, and '#' starts a
+ * comment, e.g. "dji_recv* fifo 80 2,3" or "user_start_task other 0 0-1 262144".
+ */
+static void Osal_TaskLoadAttributes(void)
+{
+    FILE *fp;
+    char lineBuf[OSAL_TASK_ATTRIBUTE_LINE_MAX_SIZE];
+    char name[OSAL_TASK_ATTRIBUTE_NAME_MAX_SIZE];
+    char policy[8];
+    char cpuList[64];
+    int priority;
+    unsigned long stackSize;
+    int fieldCount;
+    T_OsalTaskAttribute *taskAttribute;
+    cpu_set_t processCpuSet;
+
+    fp = fopen(OSAL_TASK_ATTRIBUTE_FILE_PATH, "r");
+    if (fp == NULL) {
+        return;
+    }
+
+    if (sched_getaffinity(0, sizeof(processCpuSet), &processCpuSet) != 0) {
+        CPU_ZERO(&processCpuSet);
+    }
+
+    while (fgets(lineBuf, sizeof(lineBuf), fp) != NULL &&
+           s_taskAttributeCount < OSAL_TASK_ATTRIBUTE_MAX_NUM) {
+        if (strchr(lineBuf, '#') != NULL) {
+            *strchr(lineBuf, '#') = '\0';
+        }
+
+        stackSize = 0;
+        fieldCount = sscanf(lineBuf, "%47s %7s %d %63s %lu", name, policy, &priority, cpuList, &stackSize);
+        if (fieldCount <= 0) {
+            continue;
+        }
+        if (fieldCount < 4) {
+            fprintf(stderr, "Osal: skip incomplete line in %s: %s", OSAL_TASK_ATTRIBUTE_FILE_PATH, lineBuf);
+            continue;
+        }
+
+        taskAttribute = &s_taskAttributes[s_taskAttributeCount];
+        memset(taskAttribute, 0, sizeof(T_OsalTaskAttribute));
+        strcpy(taskAttribute->name, name);
+        if (name[strlen(name) - 1] == '*') {
+            taskAttribute->name[strlen(name) - 1] = '\0';
+            taskAttribute->isPrefix = true;
+        }
+
+        if (strcmp(policy, "fifo") == 0) {
+            taskAttribute->policy = SCHED_FIFO;
+        } else if (strcmp(policy, "rr") == 0) {
+            taskAttribute->policy = SCHED_RR;
+        } else {
+            taskAttribute->policy = SCHED_OTHER;
+        }
+        if (taskAttribute->policy != SCHED_OTHER &&
+            (priority < sched_get_priority_min(taskAttribute->policy) ||
+             priority > sched_get_priority_max(taskAttribute->policy))) {
+            fprintf(stderr, "Osal: priority %d of task %s out of range, skip the line.\n", priority, name);
+            continue;
+        }
+        taskAttribute->priority = priority;
+
+        if (strcmp(cpuList, "-") != 0) {
+            Osal_TaskParseCpuList(cpuList, &taskAttribute->cpuSet);
+            CPU_AND(&taskAttribute->cpuSet, &taskAttribute->cpuSet, &processCpuSet);
+            if (CPU_COUNT(&taskAttribute->cpuSet) > 0) {
+                taskAttribute->isCpuSetValid = true;
+            } else {
+                fprintf(stderr, "Osal: no usable cpu in \"%s\" for task %s, affinity left unset.\n", cpuList, name);
+            }
+        }
+
+        taskAttribute->stackSize = stackSize;
+        s_taskAttributeCount++;
+    }
+
+    fclose(fp);
+}
+
+static void Osal_TaskParseCpuList(const char *cpuList, cpu_set_t *cpuSet)
+{
+    const char *pos = cpuList;
+    char *end;
+    long first;
+    long last;
+
+    CPU_ZERO(cpuSet);
+    while (*pos != '\0') {
+        first = strtol(pos, &end, 10);
+        if (end == pos) {
+            break;
+        }
+        last = first;
+        if (*end == '-') {
+            pos = end + 1;
+            last = strtol(pos, &end, 10);
+            if (end == pos) {
+                break;
+            }
+        }
+        for (; first <= last && first < CPU_SETSIZE; first++) {
+            if (first >= 0) {
+                CPU_SET(first, cpuSet);
+            }
+        }
+        if (*end != ',') {
+            break;
+        }
+        pos = end + 1;
+    }
+}
+
+static const T_OsalTaskAttribute *Osal_TaskFindAttribute(const char *name)
+{
+    uint32_t i;
+
+    if (name == NULL) {
+        return NULL;
+    }
+
+    for (i = 0; i < s_taskAttributeCount; i++) {
+        if (s_taskAttributes[i].isPrefix == true) {
+            if (strncmp(name, s_taskAttributes[i].name, strlen(s_taskAttributes[i].name)) == 0) {
+                return &s_taskAttributes[i];
+            }
+        } else if (strcmp(name, s_taskAttributes[i].name) == 0) {
+            return &s_taskAttributes[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void Osal_TaskApplyAttribute(pthread_attr_t *threadAttr, uint32_t stackSize,
+                                    const T_OsalTaskAttribute *taskAttribute, bool isRealTime)
+{
+    struct sched_param schedParam = {0};
+    size_t realStackSize = stackSize;
+
+    /*! the stack sizes passed by the PSDK are tuned for RTOS targets, too small for glibc and its stdio */
+    if (taskAttribute != NULL && taskAttribute->stackSize > 0) {
+        realStackSize = taskAttribute->stackSize;
+    } else if (realStackSize < OSAL_TASK_STACK_SIZE_MIN) {
+        realStackSize = OSAL_TASK_STACK_SIZE_MIN;
+    }
+    if (realStackSize < (size_t) PTHREAD_STACK_MIN) {
+        realStackSize = PTHREAD_STACK_MIN;
+    }
+    pthread_attr_setstacksize(threadAttr, realStackSize);
+
+    if (taskAttribute == NULL) {
+        return;
+    }
+
+    if (taskAttribute->isCpuSetValid == true) {
+        pthread_attr_setaffinity_np(threadAttr, sizeof(cpu_set_t), &taskAttribute->cpuSet);
+    }
+
+    if (isRealTime == true && taskAttribute->policy != SCHED_OTHER) {
+        schedParam.sched_priority = taskAttribute->priority;
+        pthread_attr_setinheritsched(threadAttr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(threadAttr, taskAttribute->policy);
+        pthread_attr_setschedparam(threadAttr, &schedParam);
+    }
+}
+
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
\ No newline at end of file
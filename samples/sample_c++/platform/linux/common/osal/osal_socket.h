@@ -35,8 +35,24 @@ extern "C" {
 #endif
 
 /* Exported constants --------------------------------------------------------*/
+//Datagrams moved per recvmmsg/sendmmsg call
+#define OSAL_SOCKET_UDP_BATCH_MAX_NUM          (32)
+//Busy poll time of udp sockets, 0 leaves busy polling off, unit: us
+#define OSAL_SOCKET_UDP_BUSY_POLL_US           (0)
+//Ask the kernel for the receive time of every udp datagram, reported by Osal_UdpRecvBatch
+#define OSAL_SOCKET_UDP_RX_TIMESTAMP_ENABLE    (0)
+//Same as INET_ADDRSTRLEN, the size of a dotted ipv4 address with its terminator
+#define OSAL_SOCKET_IP_ADDR_STR_SIZE           (16)
 
 /* Exported types ------------------------------------------------------------*/
+typedef struct {
+    char ipAddr[OSAL_SOCKET_IP_ADDR_STR_SIZE];
+    uint32_t port;
+    uint8_t *buf;
+    uint32_t len;          /*!< Payload length to send, or buffer size to receive into. */
+    uint32_t realLen;      /*!< Received payload length. */
+    uint64_t timestampNs;  /*!< Kernel receive time in CLOCK_REALTIME, 0 when not available. */
+} T_OsalUdpDatagram;
 
 /* Exported functions --------------------------------------------------------*/
 T_DjiReturnCode Osal_Socket(E_DjiSocketMode mode, T_DjiSocketHandle *socketHandle);
@@ -48,11 +64,46 @@ T_DjiReturnCode Osal_Bind(T_DjiSocketHandle socketHandle, const char *ipAddr, ui
 T_DjiReturnCode Osal_UdpSendData(T_DjiSocketHandle socketHandle, const char *ipAddr, uint32_t port,
                                  const uint8_t *buf, uint32_t len, uint32_t *realLen);
 
+/**
+ * @brief Receive one udp datagram, waiting until one arrives.
+ * @note Datagrams queued behind it are taken with the same system call and returned by the following calls. The
+ * socket lock is not held while waiting, so other receivers on the same socket are not held up.
+ * @param ipAddr: sender address, the buffer must hold at least INET_ADDRSTRLEN (16) bytes.
+ */
 T_DjiReturnCode Osal_UdpRecvData(T_DjiSocketHandle socketHandle, char *ipAddr, uint32_t *port,
                                  uint8_t *buf, uint32_t len, uint32_t *realLen);
 
+/**
+ * @brief Send several udp datagrams with one system call.
+ * @param socketHandle: udp socket.
+ * @param datagrams: destination and payload of each datagram.
+ * @param count: number of datagrams, at most OSAL_SOCKET_UDP_BATCH_MAX_NUM.
+ * @param sentCount: number of datagrams the kernel accepted, counted from the first one.
+ * @return Execution result.
+ */
+T_DjiReturnCode Osal_UdpSendBatch(T_DjiSocketHandle socketHandle, const T_OsalUdpDatagram *datagrams,
+                                  uint32_t count, uint32_t *sentCount);
+
+/**
+ * @brief Receive the udp datagrams queued on a socket with one system call.
+ * @note Waits in epoll until the socket is readable or the timeout expires, then takes what is queued without
+ * blocking again.
+ * @param socketHandle: udp socket.
+ * @param datagrams: buf and len of each entry give the buffer to receive into, the other fields are filled in.
+ * @param count: number of entries, at most OSAL_SOCKET_UDP_BATCH_MAX_NUM.
+ * @param timeoutMs: longest wait for the first datagram, 0 returns at once.
+ * @param recvCount: number of entries filled in, 0 on timeout.
+ * @return Execution result.
+ */
+T_DjiReturnCode Osal_UdpRecvBatch(T_DjiSocketHandle socketHandle, T_OsalUdpDatagram *datagrams,
+                                  uint32_t count, uint32_t timeoutMs, uint32_t *recvCount);
+
 T_DjiReturnCode Osal_TcpListen(T_DjiSocketHandle socketHandle);
 
+/**
+ * @brief Accept a tcp connection.
+ * @param ipAddr: peer address, the buffer must hold at least INET_ADDRSTRLEN (16) bytes.
+ */
 T_DjiReturnCode Osal_TcpAccept(T_DjiSocketHandle socketHandle, char *ipAddr, uint32_t *port,
                                T_DjiSocketHandle *outSocketHandle);
 
@@ -0,0 +1,643 @@
+/**
+ ********************************************************************
+ * @file    hal_usb_bulk_async.c
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "hal_usb_bulk_async.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+#include <linux/aio_abi.h>
+#include "dji_logger.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define HAL_USB_BULK_ASYNC_EVENT_TIMEOUT_MS     (100)
+#define HAL_USB_BULK_ASYNC_CLOSE_TIMEOUT_MS     (1000)
+
+/* Private types -------------------------------------------------------------*/
+typedef enum {
+    HAL_USB_BULK_ASYNC_SLOT_IDLE = 0,
+    HAL_USB_BULK_ASYNC_SLOT_SUBMITTED,
+    HAL_USB_BULK_ASYNC_SLOT_DONE,
+} E_HalUsbBulkAsyncSlotState;
+
+struct _HalUsbBulkAsync;
+
+typedef struct {
+    struct _HalUsbBulkAsync *engine;
+    bool isIn;
+    uint8_t *buf;
+    uint32_t bufSize;
+    uint32_t length;
+    uint32_t offset;
+    int32_t result;
+    E_HalUsbBulkAsyncSlotState state;
+#ifdef LIBUSB_INSTALLED
+    struct libusb_transfer *transfer;
+#endif
+    struct iocb iocb;
+} T_HalUsbBulkAsyncSlot;
+
+typedef struct {
+    T_HalUsbBulkAsyncSlot slots[HAL_USB_BULK_ASYNC_QUEUE_DEPTH_MAX];
+    uint32_t index;
+    pthread_mutex_t mutex;
+} T_HalUsbBulkAsyncQueue;
+
+typedef struct _HalUsbBulkAsync {
+    bool isUsbHost;
+#ifdef LIBUSB_INSTALLED
+    libusb_device_handle *usbHandle;
+#endif
+    uint8_t endPointIn;
+    uint8_t endPointOut;
+    int32_t readFd;
+    int32_t writeFd;
+    aio_context_t aioContext;
+    T_HalUsbBulkAsyncConfig config;
+    pthread_t eventThread;
+    volatile bool isEventThreadRunning;
+    bool isClosing;
+    uint32_t submittedCount;
+    int32_t txResult;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    T_HalUsbBulkAsyncQueue rxQueue;
+    T_HalUsbBulkAsyncQueue txQueue;
+    T_HalUsbBulkAsyncStatistics statistics;
+} T_HalUsbBulkAsync;
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static T_DjiReturnCode HalUsbBulkAsync_Create(bool isUsbHost, const T_HalUsbBulkAsyncConfig *config,
+                                              T_HalUsbBulkAsync **pEngine);
+static T_DjiReturnCode HalUsbBulkAsync_Start(T_HalUsbBulkAsync *engine);
+static void HalUsbBulkAsync_Destroy(T_HalUsbBulkAsync *engine);
+static int32_t HalUsbBulkAsync_SubmitSlot(T_HalUsbBulkAsyncSlot *slot);
+static void HalUsbBulkAsync_ResubmitSlot(T_HalUsbBulkAsyncSlot *slot);
+static void HalUsbBulkAsync_CompleteSlot(T_HalUsbBulkAsyncSlot *slot, int32_t result, uint32_t length);
+static void HalUsbBulkAsync_GetDeadline(struct timespec *deadline, uint32_t timeoutMs);
+static void *HalUsbBulkAsync_EventTask(void *arg);
+#ifdef LIBUSB_INSTALLED
+static void LIBUSB_CALL HalUsbBulkAsync_TransferCallback(struct libusb_transfer *transfer);
+#endif
+
+/* Exported functions definition ---------------------------------------------*/
+#ifdef LIBUSB_INSTALLED
+T_DjiReturnCode HalUsbBulkAsync_OpenHost(libusb_device_handle *handle, uint8_t endPointIn, uint8_t endPointOut,
+                                         const T_HalUsbBulkAsyncConfig *config,
+                                         T_HalUsbBulkAsyncHandle *asyncHandle)
+{
+    T_DjiReturnCode returnCode;
+    T_HalUsbBulkAsync *engine = NULL;
+    uint32_t i;
+
+    if (handle == NULL || asyncHandle == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    returnCode = HalUsbBulkAsync_Create(true, config, &engine);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    engine->usbHandle = handle;
+    engine->endPointIn = endPointIn;
+    engine->endPointOut = endPointOut;
+
+    for (i = 0; i < engine->config.queueDepth; i++) {
+        engine->rxQueue.slots[i].transfer = libusb_alloc_transfer(0);
+        engine->txQueue.slots[i].transfer = libusb_alloc_transfer(0);
+        if (engine->rxQueue.slots[i].transfer == NULL || engine->txQueue.slots[i].transfer == NULL) {
+            HalUsbBulkAsync_Destroy(engine);
+            return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        }
+    }
+
+    returnCode = HalUsbBulkAsync_Start(engine);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        HalUsbBulkAsync_Destroy(engine);
+        return returnCode;
+    }
+
+    *asyncHandle = engine;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+#endif
+
+T_DjiReturnCode HalUsbBulkAsync_OpenDevice(int32_t readFd, int32_t writeFd, const T_HalUsbBulkAsyncConfig *config,
+                                           T_HalUsbBulkAsyncHandle *asyncHandle)
+{
+    T_DjiReturnCode returnCode;
+    T_HalUsbBulkAsync *engine = NULL;
+
+    if (readFd < 0 || writeFd < 0 || asyncHandle == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    returnCode = HalUsbBulkAsync_Create(false, config, &engine);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    engine->readFd = readFd;
+    engine->writeFd = writeFd;
+
+    if (syscall(__NR_io_setup, engine->config.queueDepth * 2, &engine->aioContext) < 0) {
+        USER_LOG_ERROR("usb bulk aio setup failed, errno = %d", errno);
+        engine->aioContext = 0;
+        HalUsbBulkAsync_Destroy(engine);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    returnCode = HalUsbBulkAsync_Start(engine);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        HalUsbBulkAsync_Destroy(engine);
+        return returnCode;
+    }
+
+    *asyncHandle = engine;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode HalUsbBulkAsync_Close(T_HalUsbBulkAsyncHandle asyncHandle)
+{
+    T_HalUsbBulkAsync *engine = asyncHandle;
+    struct timespec deadline;
+    uint32_t i;
+
+    if (engine == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&engine->mutex);
+    engine->isClosing = true;
+    pthread_cond_broadcast(&engine->cond);
+    pthread_mutex_unlock(&engine->mutex);
+
+    // wait for blocked readers and writers to leave before the buffers go away
+    pthread_mutex_lock(&engine->rxQueue.mutex);
+    pthread_mutex_lock(&engine->txQueue.mutex);
+
+#ifdef LIBUSB_INSTALLED
+    if (engine->isUsbHost == true) {
+        pthread_mutex_lock(&engine->mutex);
+        for (i = 0; i < engine->config.queueDepth; i++) {
+            if (engine->rxQueue.slots[i].state == HAL_USB_BULK_ASYNC_SLOT_SUBMITTED) {
+                libusb_cancel_transfer(engine->rxQueue.slots[i].transfer);
+            }
+            if (engine->txQueue.slots[i].state == HAL_USB_BULK_ASYNC_SLOT_SUBMITTED) {
+                libusb_cancel_transfer(engine->txQueue.slots[i].transfer);
+            }
+        }
+
+        // the event thread keeps running until every cancellation has been reported
+        HalUsbBulkAsync_GetDeadline(&deadline, HAL_USB_BULK_ASYNC_CLOSE_TIMEOUT_MS);
+        while (engine->submittedCount > 0) {
+            if (pthread_cond_timedwait(&engine->cond, &engine->mutex, &deadline) == ETIMEDOUT) {
+                USER_LOG_ERROR("usb bulk transfers not cancelled, count = %d", engine->submittedCount);
+                break;
+            }
+        }
+        pthread_mutex_unlock(&engine->mutex);
+    }
+#else
+    (void) i;
+    (void) deadline;
+#endif
+
+    engine->isEventThreadRunning = false;
+    pthread_join(engine->eventThread, NULL);
+
+    USER_LOG_INFO("usb bulk async closed, rx %llu bytes in %d transfers, tx %llu bytes in %d transfers, "
+                  "rx errors %d, tx errors %d, tx queue full %d",
+                  (unsigned long long) engine->statistics.rxBytes, engine->statistics.rxTransferCount,
+                  (unsigned long long) engine->statistics.txBytes, engine->statistics.txTransferCount,
+                  engine->statistics.rxErrorCount, engine->statistics.txErrorCount,
+                  engine->statistics.txQueueFullCount);
+
+    pthread_mutex_unlock(&engine->txQueue.mutex);
+    pthread_mutex_unlock(&engine->rxQueue.mutex);
+
+    HalUsbBulkAsync_Destroy(engine);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode HalUsbBulkAsync_Write(T_HalUsbBulkAsyncHandle asyncHandle, const uint8_t *buf, uint32_t len,
+                                      uint32_t *realLen)
+{
+    T_HalUsbBulkAsync *engine = asyncHandle;
+    T_HalUsbBulkAsyncQueue *queue;
+    T_HalUsbBulkAsyncSlot *slot;
+    struct timespec deadline;
+    uint8_t *newBuf;
+    int32_t result;
+
+    if (engine == NULL || buf == NULL || realLen == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    queue = &engine->txQueue;
+    pthread_mutex_lock(&queue->mutex);
+    slot = &queue->slots[queue->index];
+
+    pthread_mutex_lock(&engine->mutex);
+    // a queued transfer failed after its write call returned, report it to this caller
+    result = engine->txResult;
+    engine->txResult = 0;
+    if (result != 0) {
+        pthread_mutex_unlock(&engine->mutex);
+        pthread_mutex_unlock(&queue->mutex);
+        USER_LOG_ERROR("Write usb bulk data failed, errno = %d", result);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (slot->state == HAL_USB_BULK_ASYNC_SLOT_SUBMITTED) {
+        engine->statistics.txQueueFullCount++;
+        HalUsbBulkAsync_GetDeadline(&deadline, engine->config.txTimeoutMs);
+        while (slot->state == HAL_USB_BULK_ASYNC_SLOT_SUBMITTED && engine->isClosing == false) {
+            if (pthread_cond_timedwait(&engine->cond, &engine->mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+    }
+
+    if (slot->state == HAL_USB_BULK_ASYNC_SLOT_SUBMITTED || engine->isClosing == true) {
+        pthread_mutex_unlock(&engine->mutex);
+        pthread_mutex_unlock(&queue->mutex);
+        USER_LOG_ERROR("Write usb bulk data failed, no free transfer");
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    pthread_mutex_unlock(&engine->mutex);
+
+    // the slot is owned by this writer until it is submitted
+    if (slot->bufSize < len) {
+        newBuf = realloc(slot->buf, len);
+        if (newBuf == NULL) {
+            pthread_mutex_unlock(&queue->mutex);
+            return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        }
+        slot->buf = newBuf;
+        slot->bufSize = len;
+    }
+    memcpy(slot->buf, buf, len);
+    slot->length = len;
+
+    HalUsbBulkAsync_ResubmitSlot(slot);
+    queue->index = (queue->index + 1) % engine->config.queueDepth;
+    pthread_mutex_unlock(&queue->mutex);
+
+    *realLen = len;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode HalUsbBulkAsync_Read(T_HalUsbBulkAsyncHandle asyncHandle, uint8_t *buf, uint32_t len,
+                                     uint32_t *realLen)
+{
+    T_HalUsbBulkAsync *engine = asyncHandle;
+    T_HalUsbBulkAsyncQueue *queue;
+    T_HalUsbBulkAsyncSlot *slot;
+    uint32_t copyLen;
+    int32_t result;
+
+    if (engine == NULL || buf == NULL || realLen == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    queue = &engine->rxQueue;
+    pthread_mutex_lock(&queue->mutex);
+    slot = &queue->slots[queue->index];
+
+    // bulk transfers on one endpoint complete in submission order
+    pthread_mutex_lock(&engine->mutex);
+    while (slot->state == HAL_USB_BULK_ASYNC_SLOT_SUBMITTED && engine->isClosing == false) {
+        pthread_cond_wait(&engine->cond, &engine->mutex);
+    }
+
+    if (engine->isClosing == true) {
+        pthread_mutex_unlock(&engine->mutex);
+        pthread_mutex_unlock(&queue->mutex);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    pthread_mutex_unlock(&engine->mutex);
+
+    result = slot->result;
+    if (result != 0) {
+        slot->length = 0;
+    }
+
+    copyLen = slot->length - slot->offset;
+    if (copyLen > len) {
+        copyLen = len;
+    }
+    memcpy(buf, slot->buf + slot->offset, copyLen);
+    slot->offset += copyLen;
+
+    if (slot->offset >= slot->length) {
+        slot->length = engine->config.rxBufferSize;
+        HalUsbBulkAsync_ResubmitSlot(slot);
+        queue->index = (queue->index + 1) % engine->config.queueDepth;
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    if (result != 0) {
+        USER_LOG_ERROR("Read usb bulk data failed, errno = %d", result);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    *realLen = copyLen;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode HalUsbBulkAsync_GetStatistics(T_HalUsbBulkAsyncHandle asyncHandle,
+                                              T_HalUsbBulkAsyncStatistics *statistics)
+{
+    T_HalUsbBulkAsync *engine = asyncHandle;
+
+    if (engine == NULL || statistics == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&engine->mutex);
+    *statistics = engine->statistics;
+    pthread_mutex_unlock(&engine->mutex);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_DjiReturnCode HalUsbBulkAsync_Create(bool isUsbHost, const T_HalUsbBulkAsyncConfig *config,
+                                              T_HalUsbBulkAsync **pEngine)
+{
+    T_HalUsbBulkAsync *engine;
+    pthread_condattr_t condAttr;
+    uint32_t i;
+
+    if (config == NULL || config->queueDepth == 0 || config->queueDepth > HAL_USB_BULK_ASYNC_QUEUE_DEPTH_MAX ||
+        config->rxBufferSize == 0) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    engine = calloc(1, sizeof(T_HalUsbBulkAsync));
+    if (engine == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    engine->isUsbHost = isUsbHost;
+    engine->config = *config;
+    engine->readFd = -1;
+    engine->writeFd = -1;
+
+    pthread_mutex_init(&engine->mutex, NULL);
+    pthread_mutex_init(&engine->rxQueue.mutex, NULL);
+    pthread_mutex_init(&engine->txQueue.mutex, NULL);
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&engine->cond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
+    for (i = 0; i < config->queueDepth; i++) {
+        engine->rxQueue.slots[i].engine = engine;
+        engine->rxQueue.slots[i].isIn = true;
+        engine->rxQueue.slots[i].bufSize = config->rxBufferSize;
+        engine->rxQueue.slots[i].length = config->rxBufferSize;
+        engine->rxQueue.slots[i].buf = malloc(config->rxBufferSize);
+
+        engine->txQueue.slots[i].engine = engine;
+        engine->txQueue.slots[i].isIn = false;
+        engine->txQueue.slots[i].bufSize = config->txBufferSize;
+        engine->txQueue.slots[i].buf = config->txBufferSize > 0 ? malloc(config->txBufferSize) : NULL;
+
+        if (engine->rxQueue.slots[i].buf == NULL ||
+            (config->txBufferSize > 0 && engine->txQueue.slots[i].buf == NULL)) {
+            HalUsbBulkAsync_Destroy(engine);
+            return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        }
+    }
+
+    *pEngine = engine;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_DjiReturnCode HalUsbBulkAsync_Start(T_HalUsbBulkAsync *engine)
+{
+    uint32_t i;
+
+    engine->isEventThreadRunning = true;
+    if (pthread_create(&engine->eventThread, NULL, HalUsbBulkAsync_EventTask, engine) != 0) {
+        USER_LOG_ERROR("usb bulk event thread create failed");
+        engine->isEventThreadRunning = false;
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    pthread_setname_np(engine->eventThread, "usb_bulk_event");
+
+    for (i = 0; i < engine->config.queueDepth; i++) {
+        HalUsbBulkAsync_ResubmitSlot(&engine->rxQueue.slots[i]);
+    }
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void HalUsbBulkAsync_Destroy(T_HalUsbBulkAsync *engine)
+{
+    uint32_t i;
+
+    if (engine->aioContext != 0) {
+        // cancels and waits for the requests still in flight
+        syscall(__NR_io_destroy, engine->aioContext);
+    }
+
+    for (i = 0; i < engine->config.queueDepth; i++) {
+#ifdef LIBUSB_INSTALLED
+        if (engine->rxQueue.slots[i].transfer != NULL) {
+            libusb_free_transfer(engine->rxQueue.slots[i].transfer);
+        }
+        if (engine->txQueue.slots[i].transfer != NULL) {
+            libusb_free_transfer(engine->txQueue.slots[i].transfer);
+        }
+#endif
+        free(engine->rxQueue.slots[i].buf);
+        free(engine->txQueue.slots[i].buf);
+    }
+
+    pthread_cond_destroy(&engine->cond);
+    pthread_mutex_destroy(&engine->txQueue.mutex);
+    pthread_mutex_destroy(&engine->rxQueue.mutex);
+    pthread_mutex_destroy(&engine->mutex);
+    free(engine);
+}
+
+static int32_t HalUsbBulkAsync_SubmitSlot(T_HalUsbBulkAsyncSlot *slot)
+{
+    T_HalUsbBulkAsync *engine = slot->engine;
+    struct iocb *iocbList[1];
+
+#ifdef LIBUSB_INSTALLED
+    if (engine->isUsbHost == true) {
+        libusb_fill_bulk_transfer(slot->transfer, engine->usbHandle,
+                                  slot->isIn ? engine->endPointIn : engine->endPointOut, slot->buf,
+                                  (int) slot->length, HalUsbBulkAsync_TransferCallback, slot,
+                                  slot->isIn ? 0 : engine->config.txTimeoutMs);
+        return libusb_submit_transfer(slot->transfer);
+    }
+#endif
+
+    memset(&slot->iocb, 0, sizeof(slot->iocb));
+    slot->iocb.aio_data = (uint64_t) (uintptr_t) slot;
+    slot->iocb.aio_lio_opcode = slot->isIn ? IOCB_CMD_PREAD : IOCB_CMD_PWRITE;
+    slot->iocb.aio_fildes = slot->isIn ? engine->readFd : engine->writeFd;
+    slot->iocb.aio_buf = (uint64_t) (uintptr_t) slot->buf;
+    slot->iocb.aio_nbytes = slot->length;
+    iocbList[0] = &slot->iocb;
+
+    if (syscall(__NR_io_submit, engine->aioContext, 1, iocbList) != 1) {
+        return -errno;
+    }
+
+    return 0;
+}
+
+static void HalUsbBulkAsync_ResubmitSlot(T_HalUsbBulkAsyncSlot *slot)
+{
+    T_HalUsbBulkAsync *engine = slot->engine;
+    int32_t ret;
+
+    // mark the slot before submitting, the completion may run before the submit call returns
+    pthread_mutex_lock(&engine->mutex);
+    slot->state = HAL_USB_BULK_ASYNC_SLOT_SUBMITTED;
+    slot->offset = 0;
+    engine->submittedCount++;
+    pthread_mutex_unlock(&engine->mutex);
+
+    ret = HalUsbBulkAsync_SubmitSlot(slot);
+    if (ret != 0) {
+        HalUsbBulkAsync_CompleteSlot(slot, ret, 0);
+    }
+}
+
+static void HalUsbBulkAsync_CompleteSlot(T_HalUsbBulkAsyncSlot *slot, int32_t result, uint32_t length)
+{
+    T_HalUsbBulkAsync *engine = slot->engine;
+
+    pthread_mutex_lock(&engine->mutex);
+    engine->submittedCount--;
+    slot->result = result;
+    slot->length = length;
+    slot->offset = 0;
+
+    if (slot->isIn) {
+        slot->state = HAL_USB_BULK_ASYNC_SLOT_DONE;
+        if (result == 0) {
+            engine->statistics.rxBytes += length;
+            engine->statistics.rxTransferCount++;
+        } else if (engine->isClosing == false) {
+            engine->statistics.rxErrorCount++;
+        }
+    } else {
+        slot->state = HAL_USB_BULK_ASYNC_SLOT_IDLE;
+        if (result == 0) {
+            engine->statistics.txBytes += length;
+            engine->statistics.txTransferCount++;
+        } else if (engine->isClosing == false) {
+            engine->statistics.txErrorCount++;
+            engine->txResult = result;
+        }
+    }
+
+    pthread_cond_broadcast(&engine->cond);
+    pthread_mutex_unlock(&engine->mutex);
+}
+
+static void HalUsbBulkAsync_GetDeadline(struct timespec *deadline, uint32_t timeoutMs)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += (long) (timeoutMs % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+static void *HalUsbBulkAsync_EventTask(void *arg)
+{
+    T_HalUsbBulkAsync *engine = arg;
+    struct io_event events[HAL_USB_BULK_ASYNC_QUEUE_DEPTH_MAX * 2];
+    struct timespec timeout;
+    T_HalUsbBulkAsyncSlot *slot;
+    long eventCount;
+    long i;
+
+    while (engine->isEventThreadRunning) {
+#ifdef LIBUSB_INSTALLED
+        if (engine->isUsbHost == true) {
+            struct timeval eventTimeout = {0, HAL_USB_BULK_ASYNC_EVENT_TIMEOUT_MS * 1000};
+
+            libusb_handle_events_timeout_completed(NULL, &eventTimeout, NULL);
+            continue;
+        }
+#endif
+
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = HAL_USB_BULK_ASYNC_EVENT_TIMEOUT_MS * 1000000L;
+        eventCount = syscall(__NR_io_getevents, engine->aioContext, 1, engine->config.queueDepth * 2, events,
+                             &timeout);
+        for (i = 0; i < eventCount; i++) {
+            slot = (T_HalUsbBulkAsyncSlot *) (uintptr_t) events[i].data;
+            if (events[i].res >= 0) {
+                HalUsbBulkAsync_CompleteSlot(slot, 0, (uint32_t) events[i].res);
+            } else {
+                HalUsbBulkAsync_CompleteSlot(slot, (int32_t) events[i].res, 0);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+#ifdef LIBUSB_INSTALLED
+static void LIBUSB_CALL HalUsbBulkAsync_TransferCallback(struct libusb_transfer *transfer)
+{
+    T_HalUsbBulkAsyncSlot *slot = transfer->user_data;
+
+    if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+        HalUsbBulkAsync_CompleteSlot(slot, 0, (uint32_t) transfer->actual_length);
+    } else {
+        HalUsbBulkAsync_CompleteSlot(slot, -(int32_t) transfer->status, 0);
+    }
+}
+#endif
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -35,18 +35,16 @@
 #include "../common/osal/osal.h"
 #include "../common/osal/osal_fs.h"
 #include "../common/osal/osal_socket.h"
+#include "../common/log_writer/log_writer.h"
 #include "../hal/hal_usb_bulk.h"
 #include "../hal/hal_uart.h"
 #include "../hal/hal_network.h"
 
 /* Private constants ---------------------------------------------------------*/
-#define DJI_LOG_PATH                    "Logs/DJI"
-#define DJI_LOG_INDEX_FILE_NAME         "Logs/latest"
 #define DJI_LOG_FOLDER_NAME             "Logs"
-#define DJI_LOG_PATH_MAX_SIZE           (128)
-#define DJI_LOG_FOLDER_NAME_MAX_SIZE    (32)
-#define DJI_SYSTEM_CMD_STR_MAX_SIZE     (64)
+#define DJI_LOG_FILE_PREFIX             "DJI"
 #define DJI_LOG_MAX_COUNT               (10)
+#define DJI_LOG_MAX_FILE_SIZE           (16 * 1024 * 1024)
 
 #define USER_UTIL_UNUSED(x)                                 ((x) = (x))
 #define USER_UTIL_MIN(a, b)                                 (((a) < (b)) ? (a) : (b))
@@ -55,8 +53,6 @@
 /* Private types -------------------------------------------------------------*/
 
 /* Private values -------------------------------------------------------------*/
-static FILE *s_djiLogFile;
-static FILE *s_djiLogFileCnt;
 
 /* Private functions declaration ---------------------------------------------*/
 static void DjiUser_NormalExitHandler(int signalNum);
@@ -209,7 +205,7 @@ void Application::DjiUser_SetupEnvironment()
         throw std::runtime_error("Register osal filesystem handler error.");
     }
 
-    if (DjiUser_LocalWriteFsInit(DJI_LOG_PATH) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+    if (DjiUser_LocalWriteFsInit(DJI_LOG_FOLDER_NAME) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         throw std::runtime_error("File system init error.");
     }
 
@@ -292,19 +288,7 @@ T_DjiReturnCode Application::DjiUser_PrintConsole(const uint8_t *data, uint16_t
 
 T_DjiReturnCode Application::DjiUser_LocalWrite(const uint8_t *data, uint16_t dataLen)
 {
-    int32_t realLen;
-
-    if (s_djiLogFile == nullptr) {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
-
-    realLen = fwrite(data, 1, dataLen, s_djiLogFile);
-    fflush(s_djiLogFile);
-    if (realLen == dataLen) {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-    } else {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
+    return LogWriter_Write(data, dataLen);
 }
 
 T_DjiReturnCode Application::DjiUser_FillInUserInfo(T_DjiUserInfo *userInfo)
@@ -350,87 +334,14 @@ T_DjiReturnCode Application::DjiUser_FillInUserInfo(T_DjiUserInfo *userInfo)
 
 T_DjiReturnCode Application::DjiUser_LocalWriteFsInit(const char *path)
 {
-    T_DjiReturnCode djiReturnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-    char filePath[DJI_LOG_PATH_MAX_SIZE];
-    char systemCmd[DJI_SYSTEM_CMD_STR_MAX_SIZE];
-    char folderName[DJI_LOG_FOLDER_NAME_MAX_SIZE];
-    time_t currentTime = time(nullptr);
-    struct tm *localTime = localtime(&currentTime);
-    uint16_t logFileIndex = 0;
-    uint16_t currentLogFileIndex;
-    uint8_t ret;
-
-    if (localTime == nullptr) {
-        printf("Get local time error.\r\n");
-        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-    }
-
-    if (access(DJI_LOG_FOLDER_NAME, F_OK) != 0) {
-        sprintf(folderName, "mkdir %s", DJI_LOG_FOLDER_NAME);
-        ret = system(folderName);
-        if (ret != 0) {
-            printf("Create new log folder error, ret:%d.\r\n", ret);
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        }
-    }
-
-    s_djiLogFileCnt = fopen(DJI_LOG_INDEX_FILE_NAME, "rb+");
-    if (s_djiLogFileCnt == nullptr) {
-        s_djiLogFileCnt = fopen(DJI_LOG_INDEX_FILE_NAME, "wb+");
-        if (s_djiLogFileCnt == nullptr) {
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        }
-    } else {
-        ret = fseek(s_djiLogFileCnt, 0, SEEK_SET);
-        if (ret != 0) {
-            printf("Seek log count file error, ret: %d, errno: %d.\r\n", ret, errno);
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        }
-
-        ret = fread((uint16_t * ) & logFileIndex, 1, sizeof(uint16_t), s_djiLogFileCnt);
-        if (ret != sizeof(uint16_t)) {
-            printf("Read log file index error.\r\n");
-        }
-    }
-
-    currentLogFileIndex = logFileIndex;
-    logFileIndex++;
+    T_LogWriterConfig logWriterConfig = {};
 
-    ret = fseek(s_djiLogFileCnt, 0, SEEK_SET);
-    if (ret != 0) {
-        printf("Seek log file error, ret: %d, errno: %d.\r\n", ret, errno);
-        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-    }
-
-    ret = fwrite((uint16_t * ) & logFileIndex, 1, sizeof(uint16_t), s_djiLogFileCnt);
-    if (ret != sizeof(uint16_t)) {
-        printf("Write log file index error.\r\n");
-        fclose(s_djiLogFileCnt);
-        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-    }
-
-    fclose(s_djiLogFileCnt);
-
-    sprintf(filePath, "%s_%04d_%04d%02d%02d_%02d-%02d-%02d.log", path, currentLogFileIndex,
-            localTime->tm_year + 1900, localTime->tm_mon + 1, localTime->tm_mday,
-            localTime->tm_hour, localTime->tm_min, localTime->tm_sec);
-
-    s_djiLogFile = fopen(filePath, "wb+");
-    if (s_djiLogFile == nullptr) {
-        USER_LOG_ERROR("Open filepath time error.");
-        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-    }
-
-    if (logFileIndex >= DJI_LOG_MAX_COUNT) {
-        sprintf(systemCmd, "rm -rf %s_%04d*.log", path, currentLogFileIndex - DJI_LOG_MAX_COUNT);
-        ret = system(systemCmd);
-        if (ret != 0) {
-            printf("Remove file error, ret:%d.\r\n", ret);
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        }
-    }
+    logWriterConfig.folderPath = path;
+    logWriterConfig.filePrefix = DJI_LOG_FILE_PREFIX;
+    logWriterConfig.maxFileCount = DJI_LOG_MAX_COUNT;
+    logWriterConfig.maxFileSize = DJI_LOG_MAX_FILE_SIZE;
 
-    return djiReturnCode;
+    return LogWriter_Init(&logWriterConfig);
 }
 
 static void DjiUser_NormalExitHandler(int signalNum)
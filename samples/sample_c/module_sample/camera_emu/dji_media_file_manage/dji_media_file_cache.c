@@ -0,0 +1,701 @@
+/**
+ ********************************************************************
+ * @file    dji_media_file_cache.c
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_media_file_cache.h"
+#include "dji_media_file_core.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <dji_logger.h>
+#include "dji_platform.h"
+#include "utils/util_time.h"
+#include "utils/util_misc.h"
+
+#ifdef FFMPEG_INSTALLED
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+#endif
+
+/* Private constants ---------------------------------------------------------*/
+#define MEDIA_FILE_CACHE_ENTRY_MAX_COUNT        4096
+#define MEDIA_FILE_CACHE_TEMP_FILE_SUFFIX       ".tmp"
+#define MEDIA_FILE_CACHE_TEMP_FILE_TEMPLATE     "XXXXXX" MEDIA_FILE_CACHE_TEMP_FILE_SUFFIX
+#define MEDIA_FILE_CACHE_PREWARM_PERIOD_MS      1000
+// full rescan even without a folder change, for file systems with coarse timestamps
+#define MEDIA_FILE_CACHE_PREWARM_RESCAN_COUNT   60
+#define MEDIA_FILE_CACHE_PREWARM_STACK_SIZE     2048
+#define MEDIA_FILE_CACHE_JPEG_QSCALE            3
+#define FFMPEG_CMD_BUF_SIZE                     (256 + 256 + 256)
+
+#define FNV1A_64_OFFSET_BASIS                   0xcbf29ce484222325ULL
+#define FNV1A_64_PRIME                          0x100000001b3ULL
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t key;
+    E_DjiMediaFileCacheType type;
+    uint32_t size;
+    time_t lastUsedTime;
+} T_DjiMediaFileCacheEntry;
+
+/* Private values ------------------------------------------------------------*/
+static const char *s_cacheFileSuffix[DJI_MEDIA_FILE_CACHE_TYPE_COUNT] = {".thm", ".scr"};
+static const int s_cachePictureWidth[DJI_MEDIA_FILE_CACHE_TYPE_COUNT] = {
+    DJI_MEDIA_FILE_CACHE_THUMBNAIL_WIDTH,
+    DJI_MEDIA_FILE_CACHE_SCREENNAIL_WIDTH,
+};
+
+static bool s_isCacheInited = false;
+static char s_cacheDirPath[PSDK_MEDIA_DIR_PATH_LEN_MAX] = {0};
+static uint64_t s_cacheCapacity = 0;
+static uint64_t s_cacheTotalSize = 0;
+static T_DjiMutexHandle s_cacheMutex = NULL;
+static T_DjiMediaFileCacheEntry *s_cacheEntries = NULL;
+static uint32_t s_cacheEntryCount = 0;
+
+static bool s_isPrewarmRunning = false;
+static char s_prewarmDirPath[PSDK_MEDIA_DIR_PATH_LEN_MAX] = {0};
+static T_DjiTaskHandle s_prewarmThread = NULL;
+
+/* Private functions declaration ---------------------------------------------*/
+static uint64_t DjiMediaFileCache_Hash(uint64_t hash, const void *data, size_t len);
+static T_DjiReturnCode DjiMediaFileCache_GetKey(const char *srcFilePath, uint64_t *key);
+static void DjiMediaFileCache_GetEntryPath(uint64_t key, E_DjiMediaFileCacheType type, char *path, size_t pathSize);
+static int32_t DjiMediaFileCache_FindEntry(uint64_t key, E_DjiMediaFileCacheType type);
+static void DjiMediaFileCache_AddEntry(uint64_t key, E_DjiMediaFileCacheType type, uint32_t size, time_t usedTime);
+static void DjiMediaFileCache_RemoveEntry(uint32_t index);
+static void DjiMediaFileCache_Evict(void);
+static void DjiMediaFileCache_LoadEntries(void);
+static T_DjiReturnCode DjiMediaFileCache_Prepare(const char *srcFilePath, E_DjiMediaFileCacheType type,
+                                                 bool isUsed, FILE **file);
+static T_DjiReturnCode DjiMediaFileCache_Generate(const char *srcFilePath, int width, const char *dstFilePath);
+static void *DjiMediaFileCache_PrewarmTask(void *arg);
+
+/* Exported functions definition ---------------------------------------------*/
+T_DjiReturnCode DjiMediaFileCache_Init(const char *cacheDirPath, uint32_t capacityBytes)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+
+    if (cacheDirPath == NULL || strlen(cacheDirPath) >= sizeof(s_cacheDirPath) || capacityBytes == 0) {
+        USER_LOG_ERROR("input parameter is invalid");
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isCacheInited == true) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    if (mkdir(cacheDirPath, 0755) != 0 && errno != EEXIST) {
+        USER_LOG_ERROR("create cache directory \"%s\" error: %d", cacheDirPath, errno);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    s_cacheEntries = osalHandler->Malloc(MEDIA_FILE_CACHE_ENTRY_MAX_COUNT * sizeof(T_DjiMediaFileCacheEntry));
+    if (s_cacheEntries == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    if (osalHandler->MutexCreate(&s_cacheMutex) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("mutex create error");
+        osalHandler->Free(s_cacheEntries);
+        s_cacheEntries = NULL;
+        return DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
+    }
+
+    strcpy(s_cacheDirPath, cacheDirPath);
+    s_cacheCapacity = capacityBytes;
+    s_cacheTotalSize = 0;
+    s_cacheEntryCount = 0;
+
+    DjiMediaFileCache_LoadEntries();
+    DjiMediaFileCache_Evict();
+
+    USER_LOG_INFO("Media file cache \"%s\" loaded, %d entries, %llu bytes.", s_cacheDirPath, s_cacheEntryCount,
+                  (unsigned long long) s_cacheTotalSize);
+
+    s_isCacheInited = true;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiMediaFileCache_DeInit(void)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+
+    if (s_isCacheInited == false) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    if (s_isPrewarmRunning == true) {
+        osalHandler->TaskDestroy(s_prewarmThread);
+        s_prewarmThread = NULL;
+        s_isPrewarmRunning = false;
+    }
+
+    s_isCacheInited = false;
+    osalHandler->MutexDestroy(s_cacheMutex);
+    s_cacheMutex = NULL;
+    osalHandler->Free(s_cacheEntries);
+    s_cacheEntries = NULL;
+    s_cacheEntryCount = 0;
+    s_cacheTotalSize = 0;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiMediaFileCache_Open(const char *srcFilePath, E_DjiMediaFileCacheType type, FILE **file)
+{
+    if (s_isCacheInited == false) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (srcFilePath == NULL || file == NULL || type >= DJI_MEDIA_FILE_CACHE_TYPE_COUNT) {
+        USER_LOG_ERROR("input parameter is invalid");
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    return DjiMediaFileCache_Prepare(srcFilePath, type, true, file);
+}
+
+T_DjiReturnCode DjiMediaFileCache_StartPrewarm(const char *mediaDirPath)
+{
+    T_DjiReturnCode returnCode;
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+
+    if (s_isCacheInited == false) {
+        USER_LOG_ERROR("media file cache is not inited");
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (mediaDirPath == NULL || strlen(mediaDirPath) >= sizeof(s_prewarmDirPath)) {
+        USER_LOG_ERROR("input parameter is invalid");
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (s_isPrewarmRunning == true) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    strcpy(s_prewarmDirPath, mediaDirPath);
+    returnCode = osalHandler->TaskCreate("media_cache_task", DjiMediaFileCache_PrewarmTask,
+                                         MEDIA_FILE_CACHE_PREWARM_STACK_SIZE, NULL, &s_prewarmThread);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("media file cache prewarm task create error.");
+        return returnCode;
+    }
+    s_isPrewarmRunning = true;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static uint64_t DjiMediaFileCache_Hash(uint64_t hash, const void *data, size_t len)
+{
+    const uint8_t *bytes = data;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= FNV1A_64_PRIME;
+    }
+
+    return hash;
+}
+
+static T_DjiReturnCode DjiMediaFileCache_GetKey(const char *srcFilePath, uint64_t *key)
+{
+    struct stat srcStat;
+    int64_t mtime;
+    int64_t size;
+    uint64_t hash = FNV1A_64_OFFSET_BASIS;
+
+    if (stat(srcFilePath, &srcStat) != 0) {
+        USER_LOG_ERROR("stat media file \"%s\" error: %d", srcFilePath, errno);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    // nanoseconds, a file rewritten within the same second gets a new key
+    mtime = (int64_t) srcStat.st_mtim.tv_sec * 1000000000 + srcStat.st_mtim.tv_nsec;
+    size = (int64_t) srcStat.st_size;
+    hash = DjiMediaFileCache_Hash(hash, srcFilePath, strlen(srcFilePath));
+    hash = DjiMediaFileCache_Hash(hash, &mtime, sizeof(mtime));
+    hash = DjiMediaFileCache_Hash(hash, &size, sizeof(size));
+    *key = hash;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void DjiMediaFileCache_GetEntryPath(uint64_t key, E_DjiMediaFileCacheType type, char *path, size_t pathSize)
+{
+    snprintf(path, pathSize, "%s/%016llx%s", s_cacheDirPath, (unsigned long long) key, s_cacheFileSuffix[type]);
+}
+
+static int32_t DjiMediaFileCache_FindEntry(uint64_t key, E_DjiMediaFileCacheType type)
+{
+    uint32_t i;
+
+    for (i = 0; i < s_cacheEntryCount; i++) {
+        if (s_cacheEntries[i].key == key && s_cacheEntries[i].type == type) {
+            return (int32_t) i;
+        }
+    }
+
+    return -1;
+}
+
+static void DjiMediaFileCache_AddEntry(uint64_t key, E_DjiMediaFileCacheType type, uint32_t size, time_t usedTime)
+{
+    int32_t index = DjiMediaFileCache_FindEntry(key, type);
+
+    // a prewarmed picture racing a viewed one must not make it look unused
+    if (index >= 0) {
+        if (usedTime > s_cacheEntries[index].lastUsedTime) {
+            s_cacheEntries[index].lastUsedTime = usedTime;
+        }
+        return;
+    }
+
+    // make room by dropping the least recently used entry
+    if (s_cacheEntryCount >= MEDIA_FILE_CACHE_ENTRY_MAX_COUNT) {
+        DjiMediaFileCache_Evict();
+    }
+
+    s_cacheEntries[s_cacheEntryCount].key = key;
+    s_cacheEntries[s_cacheEntryCount].type = type;
+    s_cacheEntries[s_cacheEntryCount].size = size;
+    s_cacheEntries[s_cacheEntryCount].lastUsedTime = usedTime;
+    s_cacheEntryCount++;
+    s_cacheTotalSize += size;
+}
+
+static void DjiMediaFileCache_RemoveEntry(uint32_t index)
+{
+    char path[PSDK_MEDIA_FILE_PATH_LEN_MAX];
+
+    DjiMediaFileCache_GetEntryPath(s_cacheEntries[index].key, s_cacheEntries[index].type, path, sizeof(path));
+    unlink(path);
+
+    s_cacheTotalSize -= s_cacheEntries[index].size;
+    s_cacheEntryCount--;
+    s_cacheEntries[index] = s_cacheEntries[s_cacheEntryCount];
+}
+
+static void DjiMediaFileCache_Evict(void)
+{
+    uint32_t i;
+    uint32_t oldest;
+
+    while (s_cacheEntryCount > 1 &&
+           (s_cacheTotalSize > s_cacheCapacity || s_cacheEntryCount >= MEDIA_FILE_CACHE_ENTRY_MAX_COUNT)) {
+        oldest = 0;
+        for (i = 1; i < s_cacheEntryCount; i++) {
+            if (s_cacheEntries[i].lastUsedTime < s_cacheEntries[oldest].lastUsedTime) {
+                oldest = i;
+            }
+        }
+        DjiMediaFileCache_RemoveEntry(oldest);
+    }
+}
+
+static void DjiMediaFileCache_LoadEntries(void)
+{
+    DIR *dir;
+    struct dirent *dirEntry;
+    struct stat entryStat;
+    char path[PSDK_MEDIA_FILE_PATH_LEN_MAX];
+    unsigned long long key;
+    char suffix[8];
+    uint32_t type;
+
+    dir = opendir(s_cacheDirPath);
+    if (dir == NULL) {
+        USER_LOG_ERROR("open cache directory \"%s\" error: %d", s_cacheDirPath, errno);
+        return;
+    }
+
+    while ((dirEntry = readdir(dir)) != NULL) {
+        snprintf(path, sizeof(path), "%s/%s", s_cacheDirPath, dirEntry->d_name);
+        if (stat(path, &entryStat) != 0 || !S_ISREG(entryStat.st_mode)) {
+            continue;
+        }
+
+        if (sscanf(dirEntry->d_name, "%16llx%7s", &key, suffix) != 2) {
+            continue;
+        }
+
+        for (type = 0; type < DJI_MEDIA_FILE_CACHE_TYPE_COUNT; type++) {
+            if (strcmp(suffix, s_cacheFileSuffix[type]) == 0) {
+                break;
+            }
+        }
+
+        // leftovers of an interrupted generation
+        if (type == DJI_MEDIA_FILE_CACHE_TYPE_COUNT) {
+            if (strcmp(suffix, MEDIA_FILE_CACHE_TEMP_FILE_SUFFIX) == 0) {
+                unlink(path);
+            }
+            continue;
+        }
+
+        if (s_cacheEntryCount >= MEDIA_FILE_CACHE_ENTRY_MAX_COUNT) {
+            unlink(path);
+            continue;
+        }
+
+        DjiMediaFileCache_AddEntry((uint64_t) key, (E_DjiMediaFileCacheType) type, (uint32_t) entryStat.st_size,
+                                   entryStat.st_mtime);
+    }
+
+    closedir(dir);
+}
+
+/*
+ * The picture is opened while the cache mutex is held, an entry can not be evicted between the lookup and the open.
+ * An open file stays readable after its entry is evicted. Pictures generated by prewarming get the oldest possible
+ * use time, so they are evicted before any picture that was actually viewed.
+ */
+static T_DjiReturnCode DjiMediaFileCache_Prepare(const char *srcFilePath, E_DjiMediaFileCacheType type,
+                                                 bool isUsed, FILE **file)
+{
+    T_DjiReturnCode returnCode;
+    uint64_t key;
+    int32_t index;
+    int tempFd;
+    char cachePath[PSDK_MEDIA_FILE_PATH_LEN_MAX];
+    char tempPath[PSDK_MEDIA_FILE_PATH_LEN_MAX];
+    struct stat cacheStat;
+    struct utimbuf unusedTime = {0};
+    time_t usedTime = isUsed == true ? time(NULL) : 0;
+    T_DjiRunTimeStamps tiStart, tiEnd;
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+
+    returnCode = DjiMediaFileCache_GetKey(srcFilePath, &key);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+    DjiMediaFileCache_GetEntryPath(key, type, cachePath, sizeof(cachePath));
+
+    osalHandler->MutexLock(s_cacheMutex);
+    index = DjiMediaFileCache_FindEntry(key, type);
+    if (index >= 0) {
+        if (file != NULL) {
+            *file = fopen(cachePath, "rb");
+        }
+        if (file != NULL ? *file != NULL : access(cachePath, R_OK) == 0) {
+            // the file mtime records the last use, so the order survives a restart
+            if (isUsed == true) {
+                s_cacheEntries[index].lastUsedTime = usedTime;
+                utime(cachePath, NULL);
+            }
+            osalHandler->MutexUnlock(s_cacheMutex);
+            return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+        }
+        DjiMediaFileCache_RemoveEntry((uint32_t) index);
+    }
+
+    // a prewarmed picture would only push out other prewarmed pictures once the cache is full
+    if (isUsed == false && s_cacheTotalSize >= s_cacheCapacity) {
+        osalHandler->MutexUnlock(s_cacheMutex);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+    osalHandler->MutexUnlock(s_cacheMutex);
+
+    tiStart = DjiUtilTime_GetRunTimeStamps();
+
+    snprintf(tempPath, sizeof(tempPath), "%s/%s", s_cacheDirPath, MEDIA_FILE_CACHE_TEMP_FILE_TEMPLATE);
+    tempFd = mkstemps(tempPath, strlen(MEDIA_FILE_CACHE_TEMP_FILE_SUFFIX));
+    if (tempFd < 0) {
+        USER_LOG_ERROR("Create cache temp file error: %d", errno);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    close(tempFd);
+
+    returnCode = DjiMediaFileCache_Generate(srcFilePath, s_cachePictureWidth[type], tempPath);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        unlink(tempPath);
+        return returnCode;
+    }
+
+    if (isUsed == false) {
+        utime(tempPath, &unusedTime);
+    }
+
+    if (stat(tempPath, &cacheStat) != 0 || cacheStat.st_size == 0 || rename(tempPath, cachePath) != 0) {
+        USER_LOG_ERROR("Store cache file \"%s\" error: %d", cachePath, errno);
+        unlink(tempPath);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    tiEnd = DjiUtilTime_GetRunTimeStamps();
+    USER_LOG_DEBUG("Media file cache generate \"%s\" width %d, RealTime = %ld us", srcFilePath,
+                   s_cachePictureWidth[type], tiEnd.realUsec - tiStart.realUsec);
+
+    osalHandler->MutexLock(s_cacheMutex);
+    DjiMediaFileCache_AddEntry(key, type, (uint32_t) cacheStat.st_size, usedTime);
+    if (file != NULL) {
+        *file = fopen(cachePath, "rb");
+        if (*file == NULL) {
+            USER_LOG_ERROR("open cache file \"%s\" error: %d", cachePath, errno);
+            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+    }
+    DjiMediaFileCache_Evict();
+    osalHandler->MutexUnlock(s_cacheMutex);
+
+    return returnCode;
+}
+
+#ifdef FFMPEG_INSTALLED
+static T_DjiReturnCode DjiMediaFileCache_Generate(const char *srcFilePath, int width, const char *dstFilePath)
+{
+    T_DjiReturnCode returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    AVFormatContext *formatCtx = NULL;
+    AVCodec *decoder = NULL;
+    AVCodec *encoder = NULL;
+    AVCodecContext *decoderCtx = NULL;
+    AVCodecContext *encoderCtx = NULL;
+    struct SwsContext *swsCtx = NULL;
+    AVPacket *packet = NULL;
+    AVFrame *srcFrame = NULL;
+    AVFrame *dstFrame = NULL;
+    FILE *dstFile = NULL;
+    int streamIndex;
+    int height;
+    int ret;
+    bool isFrameDecoded = false;
+
+    if (avformat_open_input(&formatCtx, srcFilePath, NULL, NULL) < 0) {
+        USER_LOG_ERROR("open media file \"%s\" error", srcFilePath);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    if (avformat_find_stream_info(formatCtx, NULL) < 0) {
+        USER_LOG_ERROR("find stream info of \"%s\" error", srcFilePath);
+        goto out;
+    }
+
+    streamIndex = av_find_best_stream(formatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+    if (streamIndex < 0 || decoder == NULL) {
+        USER_LOG_ERROR("find picture stream of \"%s\" error", srcFilePath);
+        goto out;
+    }
+
+    decoderCtx = avcodec_alloc_context3(decoder);
+    packet = av_packet_alloc();
+    srcFrame = av_frame_alloc();
+    dstFrame = av_frame_alloc();
+    if (decoderCtx == NULL || packet == NULL || srcFrame == NULL || dstFrame == NULL) {
+        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out;
+    }
+
+    if (avcodec_parameters_to_context(decoderCtx, formatCtx->streams[streamIndex]->codecpar) < 0 ||
+        avcodec_open2(decoderCtx, decoder, NULL) < 0) {
+        USER_LOG_ERROR("open decoder of \"%s\" error", srcFilePath);
+        goto out;
+    }
+
+    // decode the first picture, flushing the decoder at the end of the file
+    while (isFrameDecoded == false) {
+        ret = av_read_frame(formatCtx, packet);
+        if (ret >= 0 && packet->stream_index != streamIndex) {
+            av_packet_unref(packet);
+            continue;
+        }
+
+        ret = avcodec_send_packet(decoderCtx, ret >= 0 ? packet : NULL);
+        av_packet_unref(packet);
+        if (ret < 0 && ret != AVERROR(EAGAIN)) {
+            break;
+        }
+
+        ret = avcodec_receive_frame(decoderCtx, srcFrame);
+        if (ret == 0) {
+            isFrameDecoded = true;
+        } else if (ret != AVERROR(EAGAIN)) {
+            break;
+        }
+    }
+
+    if (isFrameDecoded == false) {
+        USER_LOG_ERROR("decode picture of \"%s\" error", srcFilePath);
+        goto out;
+    }
+
+    // keep the aspect ratio like "scale=<width>:-1"
+    height = (int) ((int64_t) srcFrame->height * width / srcFrame->width);
+    height = height > 1 ? height & ~1 : 2;
+
+    encoder = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+    encoderCtx = encoder != NULL ? avcodec_alloc_context3(encoder) : NULL;
+    if (encoderCtx == NULL) {
+        USER_LOG_ERROR("find jpeg encoder error");
+        goto out;
+    }
+
+    encoderCtx->width = width;
+    encoderCtx->height = height;
+    encoderCtx->pix_fmt = AV_PIX_FMT_YUVJ420P;
+    encoderCtx->time_base = (AVRational) {1, 25};
+    encoderCtx->flags |= AV_CODEC_FLAG_QSCALE;
+    encoderCtx->global_quality = FF_QP2LAMBDA * MEDIA_FILE_CACHE_JPEG_QSCALE;
+    if (avcodec_open2(encoderCtx, encoder, NULL) < 0) {
+        USER_LOG_ERROR("open jpeg encoder error");
+        goto out;
+    }
+
+    dstFrame->width = width;
+    dstFrame->height = height;
+    dstFrame->format = AV_PIX_FMT_YUVJ420P;
+    dstFrame->quality = encoderCtx->global_quality;
+    if (av_frame_get_buffer(dstFrame, 32) < 0) {
+        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto out;
+    }
+
+    swsCtx = sws_getContext(srcFrame->width, srcFrame->height, (enum AVPixelFormat) srcFrame->format,
+                            width, height, AV_PIX_FMT_YUVJ420P, SWS_BICUBIC, NULL, NULL, NULL);
+    if (swsCtx == NULL) {
+        USER_LOG_ERROR("create scale context error");
+        goto out;
+    }
+    sws_scale(swsCtx, (const uint8_t *const *) srcFrame->data, srcFrame->linesize, 0, srcFrame->height,
+              dstFrame->data, dstFrame->linesize);
+
+    if (avcodec_send_frame(encoderCtx, dstFrame) < 0 || avcodec_receive_packet(encoderCtx, packet) < 0) {
+        USER_LOG_ERROR("encode picture of \"%s\" error", srcFilePath);
+        goto out;
+    }
+
+    dstFile = fopen(dstFilePath, "wb");
+    if (dstFile == NULL) {
+        USER_LOG_ERROR("open cache file \"%s\" error: %d", dstFilePath, errno);
+        av_packet_unref(packet);
+        goto out;
+    }
+
+    if (fwrite(packet->data, 1, packet->size, dstFile) == (size_t) packet->size) {
+        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+    av_packet_unref(packet);
+
+    if (fclose(dstFile) != 0) {
+        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+out:
+    sws_freeContext(swsCtx);
+    av_frame_free(&dstFrame);
+    av_frame_free(&srcFrame);
+    av_packet_free(&packet);
+    avcodec_free_context(&encoderCtx);
+    avcodec_free_context(&decoderCtx);
+    avformat_close_input(&formatCtx);
+
+    return returnCode;
+}
+#else
+static T_DjiReturnCode DjiMediaFileCache_Generate(const char *srcFilePath, int width, const char *dstFilePath)
+{
+    char ffmpegCmdStr[FFMPEG_CMD_BUF_SIZE];
+    int cmdRet;
+
+    snprintf(ffmpegCmdStr, FFMPEG_CMD_BUF_SIZE,
+             "ffmpeg -y -i \"%s\" -vf scale=%d:-1 -vframes 1 -f image2 -c:v mjpeg \"%s\" 1>/dev/null 2>&1",
+             srcFilePath, width, dstFilePath);
+
+    cmdRet = system(ffmpegCmdStr);
+    if (cmdRet != 0) {
+        USER_LOG_ERROR("Media file cache ffmpeg cmd call error, ret = %d", cmdRet);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+#endif
+
+static void *DjiMediaFileCache_PrewarmTask(void *arg)
+{
+    DIR *dir;
+    struct dirent *dirEntry;
+    struct stat dirStat;
+    struct timespec lastScanTime = {0};
+    uint32_t idleCount = 0;
+    char srcFilePath[PSDK_MEDIA_FILE_PATH_LEN_MAX];
+    uint32_t type;
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+
+    USER_UTIL_UNUSED(arg);
+
+    while (1) {
+        osalHandler->TaskSleepMs(MEDIA_FILE_CACHE_PREWARM_PERIOD_MS);
+
+        // rescan when files were added, removed or renamed, compared to the nanosecond so a file added in the same
+        // second as the last scan is not missed
+        if (stat(s_prewarmDirPath, &dirStat) != 0) {
+            continue;
+        }
+        if (dirStat.st_mtim.tv_sec == lastScanTime.tv_sec && dirStat.st_mtim.tv_nsec == lastScanTime.tv_nsec &&
+            ++idleCount < MEDIA_FILE_CACHE_PREWARM_RESCAN_COUNT) {
+            continue;
+        }
+        lastScanTime = dirStat.st_mtim;
+        idleCount = 0;
+
+        dir = opendir(s_prewarmDirPath);
+        if (dir == NULL) {
+            continue;
+        }
+
+        while ((dirEntry = readdir(dir)) != NULL) {
+            if (strlen(dirEntry->d_name) < 4) {
+                continue;
+            }
+
+            snprintf(srcFilePath, sizeof(srcFilePath), "%s/%s", s_prewarmDirPath, dirEntry->d_name);
+            if (DjiMediaFile_IsSupported(srcFilePath) == false) {
+                continue;
+            }
+
+            for (type = 0; type < DJI_MEDIA_FILE_CACHE_TYPE_COUNT; type++) {
+                (void) DjiMediaFileCache_Prepare(srcFilePath, (E_DjiMediaFileCacheType) type, false, NULL);
+            }
+        }
+
+        closedir(dir);
+    }
+
+    return NULL;
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -0,0 +1,89 @@
+/**
+ ********************************************************************
+ * @file    dji_media_file_cache.h
+ * @brief   This is the header file for "dji_media_file_cache.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef PSDK_MEDIA_FILE_CACHE_H
+#define PSDK_MEDIA_FILE_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <dji_typedef.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_MEDIA_FILE_CACHE_DEFAULT_CAPACITY       (64 * 1024 * 1024)
+#define DJI_MEDIA_FILE_CACHE_THUMBNAIL_WIDTH        100
+#define DJI_MEDIA_FILE_CACHE_SCREENNAIL_WIDTH       600
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum {
+    DJI_MEDIA_FILE_CACHE_TYPE_THUMBNAIL = 0,
+    DJI_MEDIA_FILE_CACHE_TYPE_SCREENNAIL,
+    DJI_MEDIA_FILE_CACHE_TYPE_COUNT,
+} E_DjiMediaFileCacheType;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Open the cache directory and load the entries left by a previous run.
+ * @note Entries are keyed by path, modification time and size of the source file, so an edited file never hits a
+ * stale picture. The least recently used entries are removed once the cache grows over its capacity.
+ * @param cacheDirPath: directory holding the cached pictures, created when it does not exist.
+ * @param capacityBytes: upper bound of the total size of the cached pictures.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiMediaFileCache_Init(const char *cacheDirPath, uint32_t capacityBytes);
+
+/**
+ * @brief Stop prewarming and release the in-memory index. Cached pictures are kept on disk.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiMediaFileCache_DeInit(void);
+
+/**
+ * @brief Open the cached picture of a media file, generating it first on a miss.
+ * @param srcFilePath: path of the media file.
+ * @param type: thumbnail or screennail.
+ * @param file: opened picture, closed by the caller with fclose.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiMediaFileCache_Open(const char *srcFilePath, E_DjiMediaFileCacheType type, FILE **file);
+
+/**
+ * @brief Start a background task generating the pictures of every media file that appears in a directory.
+ * @param mediaDirPath: directory to watch.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiMediaFileCache_StartPrewarm(const char *mediaDirPath);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PSDK_MEDIA_FILE_CACHE_H
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -27,9 +27,11 @@
 #include <dji_logger.h>
 
 #include "dji_media_file_core.h"
+#include "dji_media_file_cache.h"
 #include "dji_media_file_jpg.h"
 #include "dji_media_file_mp4.h"
 #include "dji_platform.h"
+#include "utils/util_file.h"
 
 /* Private constants ---------------------------------------------------------*/
 
@@ -118,7 +120,9 @@ T_DjiReturnCode DjiMediaFile_CreateHandle(const char *filePath, T_DjiMediaFileHa
 
     (*pMediaFileHandle)->mediaFileOptItem = s_mediaFileOpt[optIndex];
     (*pMediaFileHandle)->mediaFileThm.privThm = NULL;
+    (*pMediaFileHandle)->mediaFileThm.cacheFile = NULL;
     (*pMediaFileHandle)->mediaFileScr.privScr = NULL;
+    (*pMediaFileHandle)->mediaFileScr.cacheFile = NULL;
 
     strcpy((*pMediaFileHandle)->filePath, filePath);
 
@@ -177,6 +181,12 @@ T_DjiReturnCode DjiMediaFile_GetFileSizeOrg(struct _DjiMediaFile *mediaFileHandl
 
 T_DjiReturnCode DjiMediaFile_CreateThm(T_DjiMediaFileHandle mediaFileHandle)
 {
+    if (DjiMediaFileCache_Open(mediaFileHandle->filePath, DJI_MEDIA_FILE_CACHE_TYPE_THUMBNAIL,
+                               &mediaFileHandle->mediaFileThm.cacheFile) == DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+    mediaFileHandle->mediaFileThm.cacheFile = NULL;
+
     if (mediaFileHandle->mediaFileOptItem.createThmFunc == NULL) {
         USER_LOG_ERROR("Media file handle createThmFunc null error");
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -187,6 +197,10 @@ T_DjiReturnCode DjiMediaFile_CreateThm(T_DjiMediaFileHandle mediaFileHandle)
 
 T_DjiReturnCode DjiMediaFile_GetFileSizeThm(T_DjiMediaFileHandle mediaFileHandle, uint32_t *fileSize)
 {
+    if (mediaFileHandle->mediaFileThm.cacheFile != NULL) {
+        return UtilFile_GetFileSize(mediaFileHandle->mediaFileThm.cacheFile, fileSize);
+    }
+
     if (mediaFileHandle->mediaFileOptItem.getFileSizeThmFunc == NULL) {
         USER_LOG_ERROR("Media file handle getFileSizeThmFunc null error");
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -198,6 +212,10 @@ T_DjiReturnCode DjiMediaFile_GetFileSizeThm(T_DjiMediaFileHandle mediaFileHandle
 T_DjiReturnCode DjiMediaFile_GetDataThm(T_DjiMediaFileHandle mediaFileHandle, uint32_t offset, uint16_t len,
                                         uint8_t *data, uint16_t *realLen)
 {
+    if (mediaFileHandle->mediaFileThm.cacheFile != NULL) {
+        return UtilFile_GetFileData(mediaFileHandle->mediaFileThm.cacheFile, offset, len, data, realLen);
+    }
+
     if (mediaFileHandle->mediaFileOptItem.getDataThmFunc == NULL) {
         USER_LOG_ERROR("Media file handle getDataThmFunc null error");
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -208,6 +226,12 @@ T_DjiReturnCode DjiMediaFile_GetDataThm(T_DjiMediaFileHandle mediaFileHandle, ui
 
 T_DjiReturnCode DjiMediaFile_DestoryThm(T_DjiMediaFileHandle mediaFileHandle)
 {
+    if (mediaFileHandle->mediaFileThm.cacheFile != NULL) {
+        fclose(mediaFileHandle->mediaFileThm.cacheFile);
+        mediaFileHandle->mediaFileThm.cacheFile = NULL;
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
     if (mediaFileHandle->mediaFileOptItem.destroyThmFunc == NULL) {
         USER_LOG_ERROR("Media file handle destroyThmFunc null error");
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -218,6 +242,12 @@ T_DjiReturnCode DjiMediaFile_DestoryThm(T_DjiMediaFileHandle mediaFileHandle)
 
 T_DjiReturnCode DjiMediaFile_CreateScr(T_DjiMediaFileHandle mediaFileHandle)
 {
+    if (DjiMediaFileCache_Open(mediaFileHandle->filePath, DJI_MEDIA_FILE_CACHE_TYPE_SCREENNAIL,
+                               &mediaFileHandle->mediaFileScr.cacheFile) == DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+    mediaFileHandle->mediaFileScr.cacheFile = NULL;
+
     if (mediaFileHandle->mediaFileOptItem.creatScrFunc == NULL) {
         USER_LOG_ERROR("Media file handle creatScrFunc null error");
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -228,6 +258,10 @@ T_DjiReturnCode DjiMediaFile_CreateScr(T_DjiMediaFileHandle mediaFileHandle)
 
 T_DjiReturnCode DjiMediaFile_GetFileSizeScr(T_DjiMediaFileHandle mediaFileHandle, uint32_t *fileSize)
 {
+    if (mediaFileHandle->mediaFileScr.cacheFile != NULL) {
+        return UtilFile_GetFileSize(mediaFileHandle->mediaFileScr.cacheFile, fileSize);
+    }
+
     if (mediaFileHandle->mediaFileOptItem.getFileSizeScrFunc == NULL) {
         USER_LOG_ERROR("Media file handle getFileSizeScrFunc null error");
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -239,6 +273,10 @@ T_DjiReturnCode DjiMediaFile_GetFileSizeScr(T_DjiMediaFileHandle mediaFileHandle
 T_DjiReturnCode DjiMediaFile_GetDataScr(T_DjiMediaFileHandle mediaFileHandle, uint32_t offset, uint16_t len,
                                         uint8_t *data, uint16_t *realLen)
 {
+    if (mediaFileHandle->mediaFileScr.cacheFile != NULL) {
+        return UtilFile_GetFileData(mediaFileHandle->mediaFileScr.cacheFile, offset, len, data, realLen);
+    }
+
     if (mediaFileHandle->mediaFileOptItem.getDataScrFunc == NULL) {
         USER_LOG_ERROR("Media file handle getDataScrFunc null error");
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -249,6 +287,12 @@ T_DjiReturnCode DjiMediaFile_GetDataScr(T_DjiMediaFileHandle mediaFileHandle, ui
 
 T_DjiReturnCode DjiMediaFile_DestroyScr(T_DjiMediaFileHandle mediaFileHandle)
 {
+    if (mediaFileHandle->mediaFileScr.cacheFile != NULL) {
+        fclose(mediaFileHandle->mediaFileScr.cacheFile);
+        mediaFileHandle->mediaFileScr.cacheFile = NULL;
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
     if (mediaFileHandle->mediaFileOptItem.destroyScrFunc == NULL) {
         USER_LOG_ERROR("Media file handle destroyScrFunc null error");
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
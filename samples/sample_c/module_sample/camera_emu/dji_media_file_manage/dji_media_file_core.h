@@ -32,6 +32,7 @@ extern "C" {
 #endif
 
 /* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
 #include <dji_typedef.h>
 #include <dji_payload_camera.h>
 
@@ -42,10 +43,12 @@ extern "C" {
 /* Exported types ------------------------------------------------------------*/
 typedef struct {
     void *privThm;
+    FILE *cacheFile;
 } T_DjiMediaFileThm;
 
 typedef struct {
     void *privScr;
+    FILE *cacheFile;
 } T_DjiMediaFileScr;
 
 struct _DjiMediaFile;
@@ -0,0 +1,601 @@
+/**
+ ********************************************************************
+ * @file    dji_media_file_index.c
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_media_file_index.h"
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dji_logger.h>
+#include "dji_platform.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define MEDIA_FILE_INDEX_MAGIC                  (0x58495644) /* "DVIX" */
+#define MEDIA_FILE_INDEX_VERSION                (1)
+#define MEDIA_FILE_INDEX_PATH_MAX_LEN           (512)
+#define MEDIA_FILE_INDEX_DEFAULT_FRAME_RATE     (25.0f) /* same default ffprobe reports for raw streams */
+#define MEDIA_FILE_INDEX_MAX_FRAME_RATE         (240.0f)
+#define MEDIA_FILE_INDEX_SPS_MAX_LEN            (256)
+
+#define H264_NAL_TYPE_SLICE                     (1)
+#define H264_NAL_TYPE_IDR_SLICE                 (5)
+#define H264_NAL_TYPE_SEI                       (6)
+#define H264_NAL_TYPE_SPS                       (7)
+#define H264_NAL_TYPE_PPS                       (8)
+#define H264_NAL_TYPE_AUD                       (9)
+
+#define MP4_BOX_HEADER_LEN                      (8)
+#define MP4_BOX_TYPE(a, b, c, d)                (((uint32_t) (a) << 24) | ((uint32_t) (b) << 16) | \
+                                                ((uint32_t) (c) << 8) | (uint32_t) (d))
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entrySize;
+    uint64_t sourceFileSize;
+    int64_t sourceFileMtime;
+    uint32_t entryCount;
+    float frameRate;
+} T_DjiMediaFileIndexHeader;
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t bitPos;
+} T_DjiMediaFileIndexBitReader;
+
+/* Private functions declaration ---------------------------------------------*/
+static T_DjiReturnCode DjiMediaFileIndex_Load(const char *indexPath, const struct stat *sourceStat,
+                                              T_DjiMediaFileIndexEntry *entries, uint32_t entryBufferCount,
+                                              uint32_t *entryCount, float *frameRate);
+static void DjiMediaFileIndex_Save(const char *indexPath, const struct stat *sourceStat,
+                                   const T_DjiMediaFileIndexEntry *entries, uint32_t entryCount, float frameRate);
+static T_DjiReturnCode DjiMediaFileIndex_ScanH264(const uint8_t *data, uint64_t size,
+                                                  T_DjiMediaFileIndexEntry *entries, uint32_t entryBufferCount,
+                                                  uint32_t *entryCount, float *frameRate);
+static uint64_t DjiMediaFileIndex_FindStartCode(const uint8_t *data, uint64_t from, uint64_t size);
+static bool DjiMediaFileIndex_ParseSpsFrameRate(const uint8_t *nal, uint32_t nalLen, float *frameRate);
+static uint32_t DjiMediaFileIndex_ReadBits(T_DjiMediaFileIndexBitReader *reader, uint32_t count);
+static uint32_t DjiMediaFileIndex_ReadUe(T_DjiMediaFileIndexBitReader *reader);
+static int32_t DjiMediaFileIndex_ReadSe(T_DjiMediaFileIndexBitReader *reader);
+static uint32_t DjiMediaFileIndex_ReadBe32(const uint8_t *buf);
+
+/* Private values ------------------------------------------------------------*/
+
+/* Exported functions definition ---------------------------------------------*/
+T_DjiReturnCode DjiMediaFileIndex_GetH264Index(const char *filePath, T_DjiMediaFileIndexEntry *entries,
+                                               uint32_t entryBufferCount, uint32_t *entryCount, float *frameRate)
+{
+    T_DjiReturnCode returnCode;
+    char indexPath[MEDIA_FILE_INDEX_PATH_MAX_LEN];
+    struct stat sourceStat;
+    uint8_t *data;
+    int fd;
+
+    if (filePath == NULL || entries == NULL || entryBufferCount == 0 || entryCount == NULL || frameRate == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    snprintf(indexPath, sizeof(indexPath), "%s%s", filePath, DJI_MEDIA_FILE_INDEX_FILE_SUFFIX);
+
+    fd = open(filePath, O_RDONLY);
+    if (fd < 0) {
+        USER_LOG_ERROR("open video file \"%s\" fail.", filePath);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (fstat(fd, &sourceStat) != 0 || sourceStat.st_size == 0) {
+        close(fd);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    returnCode = DjiMediaFileIndex_Load(indexPath, &sourceStat, entries, entryBufferCount, entryCount, frameRate);
+    if (returnCode == DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        close(fd);
+        return returnCode;
+    }
+
+    data = mmap(NULL, sourceStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        USER_LOG_ERROR("map video file \"%s\" fail.", filePath);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    madvise(data, sourceStat.st_size, MADV_SEQUENTIAL);
+
+    returnCode = DjiMediaFileIndex_ScanH264(data, sourceStat.st_size, entries, entryBufferCount, entryCount,
+                                            frameRate);
+    munmap(data, sourceStat.st_size);
+
+    if (returnCode == DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        DjiMediaFileIndex_Save(indexPath, &sourceStat, entries, *entryCount, *frameRate);
+    }
+
+    return returnCode;
+}
+
+T_DjiReturnCode DjiMediaFileIndex_GetMp4DurationMs(const char *filePath, uint32_t *durationMs)
+{
+    T_DjiReturnCode returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    uint8_t header[MP4_BOX_HEADER_LEN + 8];
+    uint8_t mvhd[32];
+    uint64_t boxOffset = 0;
+    uint64_t boxSize;
+    uint64_t parentEnd;
+    uint32_t boxType;
+    uint32_t headerLen;
+    uint32_t timeScale;
+    uint64_t duration;
+    struct stat fileStat;
+    FILE *fp;
+
+    if (filePath == NULL || durationMs == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    fp = fopen(filePath, "rb");
+    if (fp == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (fstat(fileno(fp), &fileStat) != 0) {
+        fclose(fp);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    parentEnd = fileStat.st_size;
+
+    /* Walk the top level boxes to "moov", then its children to "mvhd". */
+    while (boxOffset + MP4_BOX_HEADER_LEN <= parentEnd) {
+        if (fseeko(fp, (off_t) boxOffset, SEEK_SET) != 0 || fread(header, 1, MP4_BOX_HEADER_LEN, fp) != MP4_BOX_HEADER_LEN) {
+            break;
+        }
+
+        boxSize = DjiMediaFileIndex_ReadBe32(header);
+        boxType = DjiMediaFileIndex_ReadBe32(&header[4]);
+        headerLen = MP4_BOX_HEADER_LEN;
+        if (boxSize == 1) {
+            if (fread(&header[MP4_BOX_HEADER_LEN], 1, 8, fp) != 8) {
+                break;
+            }
+            boxSize = ((uint64_t) DjiMediaFileIndex_ReadBe32(&header[8]) << 32) |
+                      DjiMediaFileIndex_ReadBe32(&header[12]);
+            headerLen += 8;
+        } else if (boxSize == 0) {
+            boxSize = parentEnd - boxOffset;
+        }
+
+        if (boxSize < headerLen || boxOffset + boxSize > parentEnd) {
+            break;
+        }
+
+        if (boxType == MP4_BOX_TYPE('m', 'o', 'o', 'v')) {
+            parentEnd = boxOffset + boxSize;
+            boxOffset += headerLen;
+            continue;
+        }
+
+        if (boxType == MP4_BOX_TYPE('m', 'v', 'h', 'd')) {
+            if (fread(mvhd, 1, sizeof(mvhd), fp) != sizeof(mvhd)) {
+                break;
+            }
+
+            if (mvhd[0] == 1) {
+                timeScale = DjiMediaFileIndex_ReadBe32(&mvhd[20]);
+                duration = ((uint64_t) DjiMediaFileIndex_ReadBe32(&mvhd[24]) << 32) |
+                           DjiMediaFileIndex_ReadBe32(&mvhd[28]);
+            } else {
+                timeScale = DjiMediaFileIndex_ReadBe32(&mvhd[12]);
+                duration = DjiMediaFileIndex_ReadBe32(&mvhd[16]);
+            }
+
+            if (timeScale != 0) {
+                *durationMs = (uint32_t) (duration * 1000 / timeScale);
+                returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+            }
+            break;
+        }
+
+        boxOffset += boxSize;
+    }
+
+    fclose(fp);
+
+    return returnCode;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static T_DjiReturnCode DjiMediaFileIndex_Load(const char *indexPath, const struct stat *sourceStat,
+                                              T_DjiMediaFileIndexEntry *entries, uint32_t entryBufferCount,
+                                              uint32_t *entryCount, float *frameRate)
+{
+    T_DjiMediaFileIndexHeader header;
+    T_DjiReturnCode returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    FILE *fp;
+
+    fp = fopen(indexPath, "rb");
+    if (fp == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    if (fread(&header, 1, sizeof(header), fp) != sizeof(header)) {
+        goto out;
+    }
+
+    if (header.magic != MEDIA_FILE_INDEX_MAGIC || header.version != MEDIA_FILE_INDEX_VERSION ||
+        header.entrySize != sizeof(T_DjiMediaFileIndexEntry) ||
+        header.sourceFileSize != (uint64_t) sourceStat->st_size ||
+        header.sourceFileMtime != (int64_t) sourceStat->st_mtime ||
+        header.entryCount == 0 || header.entryCount > entryBufferCount) {
+        USER_LOG_DEBUG("index file \"%s\" is stale, rebuild it.", indexPath);
+        goto out;
+    }
+
+    if (fread(entries, sizeof(T_DjiMediaFileIndexEntry), header.entryCount, fp) != header.entryCount) {
+        goto out;
+    }
+
+    *entryCount = header.entryCount;
+    *frameRate = header.frameRate;
+    returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+out:
+    fclose(fp);
+
+    return returnCode;
+}
+
+static void DjiMediaFileIndex_Save(const char *indexPath, const struct stat *sourceStat,
+                                   const T_DjiMediaFileIndexEntry *entries, uint32_t entryCount, float frameRate)
+{
+    T_DjiMediaFileIndexHeader header = {0};
+    char tempPath[MEDIA_FILE_INDEX_PATH_MAX_LEN + 4];
+    FILE *fp;
+
+    header.magic = MEDIA_FILE_INDEX_MAGIC;
+    header.version = MEDIA_FILE_INDEX_VERSION;
+    header.entrySize = sizeof(T_DjiMediaFileIndexEntry);
+    header.sourceFileSize = sourceStat->st_size;
+    header.sourceFileMtime = sourceStat->st_mtime;
+    header.entryCount = entryCount;
+    header.frameRate = frameRate;
+
+    /* Write to a temp file and rename it, so a reader never sees a partly written index. */
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", indexPath);
+    fp = fopen(tempPath, "wb");
+    if (fp == NULL) {
+        USER_LOG_WARN("create index file \"%s\" fail, the index will not be persisted.", tempPath);
+        return;
+    }
+
+    if (fwrite(&header, 1, sizeof(header), fp) != sizeof(header) ||
+        fwrite(entries, sizeof(T_DjiMediaFileIndexEntry), entryCount, fp) != entryCount) {
+        fclose(fp);
+        unlink(tempPath);
+        return;
+    }
+
+    fclose(fp);
+    if (rename(tempPath, indexPath) != 0) {
+        unlink(tempPath);
+    }
+}
+
+static T_DjiReturnCode DjiMediaFileIndex_ScanH264(const uint8_t *data, uint64_t size,
+                                                  T_DjiMediaFileIndexEntry *entries, uint32_t entryBufferCount,
+                                                  uint32_t *entryCount, float *frameRate)
+{
+    uint64_t pos = 0;
+    uint64_t nalStart;
+    uint64_t nextNal;
+    uint64_t auStart = 0;
+    uint64_t nextAuStart;
+    uint32_t count = 0;
+    uint8_t nalType;
+    bool auHasVcl = false;
+    bool auOpened = false;
+    bool isNewAu;
+    bool frameRateFound = false;
+    uint32_t i;
+
+    *frameRate = MEDIA_FILE_INDEX_DEFAULT_FRAME_RATE;
+
+    pos = DjiMediaFileIndex_FindStartCode(data, 0, size);
+
+    while (pos + 3 < size) {
+        nalStart = pos + 3;
+
+        /* Locate the next start code so the NAL length is known. */
+        nextNal = DjiMediaFileIndex_FindStartCode(data, nalStart, size);
+
+        nalType = data[nalStart] & 0x1F;
+        isNewAu = false;
+
+        /* Access unit boundaries follow ITU-T H.264 7.4.1.2.3. */
+        if (nalType == H264_NAL_TYPE_SLICE || nalType == H264_NAL_TYPE_IDR_SLICE) {
+            /* first_mb_in_slice == 0 is coded as a single '1' bit, it marks the first slice of a picture. */
+            if (auHasVcl && nalStart + 1 < nextNal && (data[nalStart + 1] & 0x80) != 0) {
+                isNewAu = true;
+            }
+            auHasVcl = true;
+        } else if (nalType == H264_NAL_TYPE_SEI || nalType == H264_NAL_TYPE_SPS || nalType == H264_NAL_TYPE_PPS ||
+                   nalType == H264_NAL_TYPE_AUD || (nalType >= 14 && nalType <= 18)) {
+            if (auHasVcl) {
+                isNewAu = true;
+                auHasVcl = false;
+            }
+        }
+
+        if (nalType == H264_NAL_TYPE_SPS && !frameRateFound) {
+            frameRateFound = DjiMediaFileIndex_ParseSpsFrameRate(&data[nalStart], nextNal - nalStart, frameRate);
+        }
+
+        if (!auOpened || isNewAu) {
+            /* A four byte start code owns the leading zero byte. */
+            nextAuStart = (pos > 0 && data[pos - 1] == 0) ? pos - 1 : pos;
+            if (auOpened) {
+                if (count >= entryBufferCount) {
+                    USER_LOG_ERROR("frame buffer is full.");
+                    return DJI_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+                }
+                entries[count].positionInFile = (uint32_t) auStart;
+                entries[count].size = (uint32_t) (nextAuStart - auStart);
+                count++;
+            }
+            auOpened = true;
+            auStart = nextAuStart;
+        }
+
+        pos = nextNal;
+    }
+
+    if (auOpened) {
+        if (count >= entryBufferCount) {
+            USER_LOG_ERROR("frame buffer is full.");
+            return DJI_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
+        }
+        entries[count].positionInFile = (uint32_t) auStart;
+        entries[count].size = (uint32_t) (size - auStart);
+        count++;
+    }
+
+    if (count == 0) {
+        USER_LOG_ERROR("no access unit found in video file.");
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
+
+    for (i = 0; i < count; i++) {
+        entries[i].ptsMs = (uint32_t) ((double) i * 1000.0 / *frameRate);
+    }
+    *entryCount = count;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static uint64_t DjiMediaFileIndex_FindStartCode(const uint8_t *data, uint64_t from, uint64_t size)
+{
+    const uint8_t *found;
+    uint64_t pos = from + 2;
+
+    /* Search for the 0x01 byte with memchr and check the two zero bytes before it. */
+    while (pos < size) {
+        found = memchr(&data[pos], 0x01, size - pos);
+        if (found == NULL) {
+            break;
+        }
+        pos = found - data;
+        if (data[pos - 1] == 0 && data[pos - 2] == 0) {
+            return pos - 2;
+        }
+        pos++;
+    }
+
+    return size;
+}
+
+static bool DjiMediaFileIndex_ParseSpsFrameRate(const uint8_t *nal, uint32_t nalLen, float *frameRate)
+{
+    uint8_t rbsp[MEDIA_FILE_INDEX_SPS_MAX_LEN];
+    T_DjiMediaFileIndexBitReader reader;
+    uint32_t rbspLen = 0;
+    uint32_t zeroCount = 0;
+    uint32_t profileIdc;
+    uint32_t chromaFormatIdc = 1;
+    uint32_t pocType;
+    uint32_t numRefFramesInPocCycle;
+    uint32_t scalingListCount;
+    uint32_t scalingListSize;
+    uint32_t lastScale;
+    uint32_t nextScale;
+    uint32_t numUnitsInTick;
+    uint32_t timeScale;
+    uint32_t i;
+    uint32_t j;
+    float rate;
+
+    /* Strip the emulation prevention bytes, skipping the NAL header. */
+    for (i = 1; i < nalLen && rbspLen < sizeof(rbsp); i++) {
+        if (zeroCount >= 2 && nal[i] == 0x03) {
+            zeroCount = 0;
+            continue;
+        }
+        zeroCount = (nal[i] == 0) ? zeroCount + 1 : 0;
+        rbsp[rbspLen++] = nal[i];
+    }
+
+    reader.data = rbsp;
+    reader.size = rbspLen;
+    reader.bitPos = 0;
+
+    profileIdc = DjiMediaFileIndex_ReadBits(&reader, 8);
+    DjiMediaFileIndex_ReadBits(&reader, 16); /* constraint flags and level_idc */
+    DjiMediaFileIndex_ReadUe(&reader); /* seq_parameter_set_id */
+
+    if (profileIdc == 100 || profileIdc == 110 || profileIdc == 122 || profileIdc == 244 || profileIdc == 44 ||
+        profileIdc == 83 || profileIdc == 86 || profileIdc == 118 || profileIdc == 128 || profileIdc == 138 ||
+        profileIdc == 139 || profileIdc == 134 || profileIdc == 135) {
+        chromaFormatIdc = DjiMediaFileIndex_ReadUe(&reader);
+        if (chromaFormatIdc == 3) {
+            DjiMediaFileIndex_ReadBits(&reader, 1); /* separate_colour_plane_flag */
+        }
+        DjiMediaFileIndex_ReadUe(&reader); /* bit_depth_luma_minus8 */
+        DjiMediaFileIndex_ReadUe(&reader); /* bit_depth_chroma_minus8 */
+        DjiMediaFileIndex_ReadBits(&reader, 1); /* qpprime_y_zero_transform_bypass_flag */
+        if (DjiMediaFileIndex_ReadBits(&reader, 1)) {
+            scalingListCount = (chromaFormatIdc != 3) ? 8 : 12;
+            for (i = 0; i < scalingListCount; i++) {
+                if (!DjiMediaFileIndex_ReadBits(&reader, 1)) {
+                    continue;
+                }
+                scalingListSize = (i < 6) ? 16 : 64;
+                lastScale = 8;
+                nextScale = 8;
+                for (j = 0; j < scalingListSize; j++) {
+                    if (nextScale != 0) {
+                        nextScale = (lastScale + DjiMediaFileIndex_ReadSe(&reader) + 256) % 256;
+                    }
+                    lastScale = (nextScale == 0) ? lastScale : nextScale;
+                }
+            }
+        }
+    }
+
+    DjiMediaFileIndex_ReadUe(&reader); /* log2_max_frame_num_minus4 */
+    pocType = DjiMediaFileIndex_ReadUe(&reader);
+    if (pocType == 0) {
+        DjiMediaFileIndex_ReadUe(&reader); /* log2_max_pic_order_cnt_lsb_minus4 */
+    } else if (pocType == 1) {
+        DjiMediaFileIndex_ReadBits(&reader, 1); /* delta_pic_order_always_zero_flag */
+        DjiMediaFileIndex_ReadSe(&reader); /* offset_for_non_ref_pic */
+        DjiMediaFileIndex_ReadSe(&reader); /* offset_for_top_to_bottom_field */
+        numRefFramesInPocCycle = DjiMediaFileIndex_ReadUe(&reader);
+        for (i = 0; i < numRefFramesInPocCycle && reader.bitPos < reader.size * 8; i++) {
+            DjiMediaFileIndex_ReadSe(&reader);
+        }
+    }
+
+    DjiMediaFileIndex_ReadUe(&reader); /* max_num_ref_frames */
+    DjiMediaFileIndex_ReadBits(&reader, 1); /* gaps_in_frame_num_value_allowed_flag */
+    DjiMediaFileIndex_ReadUe(&reader); /* pic_width_in_mbs_minus1 */
+    DjiMediaFileIndex_ReadUe(&reader); /* pic_height_in_map_units_minus1 */
+    if (!DjiMediaFileIndex_ReadBits(&reader, 1)) {
+        DjiMediaFileIndex_ReadBits(&reader, 1); /* mb_adaptive_frame_field_flag */
+    }
+    DjiMediaFileIndex_ReadBits(&reader, 1); /* direct_8x8_inference_flag */
+    if (DjiMediaFileIndex_ReadBits(&reader, 1)) {
+        for (i = 0; i < 4; i++) {
+            DjiMediaFileIndex_ReadUe(&reader); /* frame_crop offsets */
+        }
+    }
+
+    if (!DjiMediaFileIndex_ReadBits(&reader, 1)) {
+        return false; /* vui_parameters_present_flag */
+    }
+
+    if (DjiMediaFileIndex_ReadBits(&reader, 1)) {
+        if (DjiMediaFileIndex_ReadBits(&reader, 8) == 255) {
+            DjiMediaFileIndex_ReadBits(&reader, 32); /* sar_width, sar_height */
+        }
+    }
+    if (DjiMediaFileIndex_ReadBits(&reader, 1)) {
+        DjiMediaFileIndex_ReadBits(&reader, 1); /* overscan_appropriate_flag */
+    }
+    if (DjiMediaFileIndex_ReadBits(&reader, 1)) {
+        DjiMediaFileIndex_ReadBits(&reader, 4); /* video_format, video_full_range_flag */
+        if (DjiMediaFileIndex_ReadBits(&reader, 1)) {
+            DjiMediaFileIndex_ReadBits(&reader, 24); /* colour description */
+        }
+    }
+    if (DjiMediaFileIndex_ReadBits(&reader, 1)) {
+        DjiMediaFileIndex_ReadUe(&reader); /* chroma_sample_loc_type_top_field */
+        DjiMediaFileIndex_ReadUe(&reader); /* chroma_sample_loc_type_bottom_field */
+    }
+    if (!DjiMediaFileIndex_ReadBits(&reader, 1)) {
+        return false; /* timing_info_present_flag */
+    }
+
+    numUnitsInTick = DjiMediaFileIndex_ReadBits(&reader, 32);
+    timeScale = DjiMediaFileIndex_ReadBits(&reader, 32);
+    if (reader.bitPos > reader.size * 8 || numUnitsInTick == 0 || timeScale == 0) {
+        return false;
+    }
+
+    rate = (float) timeScale / (2.0f * (float) numUnitsInTick);
+    if (rate <= 0 || rate > MEDIA_FILE_INDEX_MAX_FRAME_RATE) {
+        return false;
+    }
+
+    *frameRate = rate;
+
+    return true;
+}
+
+static uint32_t DjiMediaFileIndex_ReadBits(T_DjiMediaFileIndexBitReader *reader, uint32_t count)
+{
+    uint32_t value = 0;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        value <<= 1;
+        if (reader->bitPos < reader->size * 8) {
+            value |= (reader->data[reader->bitPos >> 3] >> (7 - (reader->bitPos & 0x07))) & 0x01;
+        }
+        reader->bitPos++;
+    }
+
+    return value;
+}
+
+static uint32_t DjiMediaFileIndex_ReadUe(T_DjiMediaFileIndexBitReader *reader)
+{
+    uint32_t leadingZeroBits = 0;
+
+    while (leadingZeroBits < 32 && reader->bitPos < reader->size * 8 &&
+           DjiMediaFileIndex_ReadBits(reader, 1) == 0) {
+        leadingZeroBits++;
+    }
+
+    if (leadingZeroBits == 0 || leadingZeroBits >= 32) {
+        return 0;
+    }
+
+    return (1U << leadingZeroBits) - 1 + DjiMediaFileIndex_ReadBits(reader, leadingZeroBits);
+}
+
+static int32_t DjiMediaFileIndex_ReadSe(T_DjiMediaFileIndexBitReader *reader)
+{
+    uint32_t codeNum = DjiMediaFileIndex_ReadUe(reader);
+
+    return (codeNum & 0x01) ? (int32_t) ((codeNum + 1) / 2) : -(int32_t) (codeNum / 2);
+}
+
+static uint32_t DjiMediaFileIndex_ReadBe32(const uint8_t *buf)
+{
+    return ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) | (uint32_t) buf[3];
+}
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
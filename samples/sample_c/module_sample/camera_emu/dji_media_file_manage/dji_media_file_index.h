@@ -0,0 +1,76 @@
+/**
+ ********************************************************************
+ * @file    dji_media_file_index.h
+ * @brief   This is the header file for "dji_media_file_index.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef PSDK_MEDIA_FILE_INDEX_H
+#define PSDK_MEDIA_FILE_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include <dji_typedef.h>
+
+/* Exported constants --------------------------------------------------------*/
+#define DJI_MEDIA_FILE_INDEX_FILE_SUFFIX        ".idx"
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    uint32_t positionInFile;
+    uint32_t size;
+    uint32_t ptsMs;
+} T_DjiMediaFileIndexEntry;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Get the access unit index of an H.264 Annex-B elementary stream file.
+ * @note The index is loaded from "<filePath>.idx" when that file matches the size and modification time of the
+ * stream, otherwise the stream is scanned in process and the index is written back for the next call.
+ * @param filePath: path of the Annex-B file.
+ * @param entries: buffer receiving one entry per access unit.
+ * @param entryBufferCount: number of entries the buffer can hold.
+ * @param entryCount: number of entries written.
+ * @param frameRate: frame rate from the SPS VUI timing info, or a default when the stream does not carry it.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiMediaFileIndex_GetH264Index(const char *filePath, T_DjiMediaFileIndexEntry *entries,
+                                               uint32_t entryBufferCount, uint32_t *entryCount, float *frameRate);
+
+/**
+ * @brief Get the duration of an MP4 file from its movie header box.
+ * @param filePath: path of the MP4 file.
+ * @param durationMs: duration of the movie, unit: ms.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiMediaFileIndex_GetMp4DurationMs(const char *filePath, uint32_t *durationMs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PSDK_MEDIA_FILE_INDEX_H
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -26,6 +26,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "dji_media_file_mp4.h"
 #include "dji_media_file_core.h"
+#include "dji_media_file_index.h"
 #include <string.h>
 #include <unistd.h>
 #include <stdio.h>
@@ -76,28 +77,16 @@ bool DjiMediaFile_IsSupported_MP4(const char *filePath)
 T_DjiReturnCode DjiMediaFile_GetAttrFunc_MP4(struct _DjiMediaFile *mediaFileHandle,
                                              T_DjiCameraMediaFileAttr *mediaFileAttr)
 {
-    FILE *fp;
-    char ffmpegCmdStr[FFMPEG_CMD_BUF_SIZE];
-    float hour, minute, second;
-    char tempTailStr[128];
-    int ret;
+    uint32_t durationMs = 0;
     T_DjiReturnCode psdkStat;
 
-    snprintf(ffmpegCmdStr, FFMPEG_CMD_BUF_SIZE, "ffmpeg -i \"%s\" 2>&1 | grep \"Duration\"", mediaFileHandle->filePath);
-    fp = popen(ffmpegCmdStr, "r");
-
-    if (fp == NULL) {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-    }
-
-    ret = fscanf(fp, "  Duration: %f:%f:%f,%127s", &hour, &minute, &second, tempTailStr);
-    if (ret <= 0) {
+    psdkStat = DjiMediaFileIndex_GetMp4DurationMs(mediaFileHandle->filePath, &durationMs);
+    if (psdkStat != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("MP4 File Get Duration Error\n");
-        psdkStat = DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        goto out;
+        return psdkStat;
     }
 
-    mediaFileAttr->attrVideoDuration = (uint32_t) (hour * 3600 + minute * 60 + second + 0.5);
+    mediaFileAttr->attrVideoDuration = (durationMs + 500) / 1000;
 
     /*! The user needs to obtain the frame rate and resolution of the video file by ffmpeg tools.
      * Also the frame rate and resolution of video need convert to enum E_DjiCameraVideoFrameRate or
@@ -106,12 +95,7 @@ T_DjiReturnCode DjiMediaFile_GetAttrFunc_MP4(struct _DjiMediaFile *mediaFileHand
     mediaFileAttr->attrVideoFrameRate = DJI_CAMERA_VIDEO_FRAME_RATE_30_FPS;
     mediaFileAttr->attrVideoResolution = DJI_CAMERA_VIDEO_RESOLUTION_1920x1080;
 
-    psdkStat = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-
-out:
-    pclose(fp);
-
-    return psdkStat;
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 T_DjiReturnCode DjiMediaFile_GetDataOrigin_MP4(struct _DjiMediaFile *mediaFileHandle, uint32_t offset, uint16_t len,
@@ -26,6 +26,10 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "dji_logger.h"
 #include "utils/util_misc.h"
 #include "utils/util_time.h"
@@ -34,6 +38,8 @@
 #include "test_payload_cam_emu_media.h"
 #include "test_payload_cam_emu_base.h"
 #include "camera_emu/dji_media_file_manage/dji_media_file_core.h"
+#include "camera_emu/dji_media_file_manage/dji_media_file_index.h"
+#include "camera_emu/dji_media_file_manage/dji_media_file_cache.h"
 #include "dji_high_speed_data_channel.h"
 #include "dji_aircraft_info.h"
 
@@ -66,12 +72,6 @@ typedef struct {
     char path[DJI_FILE_PATH_SIZE_MAX];
 } T_TestPayloadCameraPlaybackCommand;
 
-typedef struct {
-    float durationS;
-    uint32_t positionInFile;
-    uint32_t size;
-} T_TestPayloadCameraVideoFrameInfo;
-
 /* Private functions declaration ---------------------------------------------*/
 static T_DjiReturnCode DjiPlayback_StopPlay(T_DjiPlaybackInfo *playbackInfo);
 static T_DjiReturnCode DjiPlayback_PausePlay(T_DjiPlaybackInfo *playbackInfo);
@@ -87,11 +87,10 @@ static T_DjiReturnCode DjiPlayback_StopPlayProcess(void);
 static T_DjiReturnCode
 DjiPlayback_VideoFileTranscode(const char *inPath, const char *outFormat, char *outPath, uint16_t outPathBufferSize);
 static T_DjiReturnCode
-DjiPlayback_GetFrameInfoOfVideoFile(const char *path, T_TestPayloadCameraVideoFrameInfo *frameInfo,
-                                    uint32_t frameInfoBufferCount, uint32_t *frameCount);
-static T_DjiReturnCode DjiPlayback_GetFrameRateOfVideoFile(const char *path, float *frameRate);
+DjiPlayback_GetFrameInfoOfVideoFile(const char *path, T_DjiMediaFileIndexEntry *frameInfo,
+                                    uint32_t frameInfoBufferCount, uint32_t *frameCount, float *frameRate);
 static T_DjiReturnCode
-DjiPlayback_GetFrameNumberByTime(T_TestPayloadCameraVideoFrameInfo *frameInfo, uint32_t frameCount,
+DjiPlayback_GetFrameNumberByTime(T_DjiMediaFileIndexEntry *frameInfo, uint32_t frameCount,
                                  uint32_t *frameNumber, uint32_t timeMs);
 static T_DjiReturnCode GetMediaFileDir(char *dirPath);
 static T_DjiReturnCode GetMediaFileOriginData(const char *filePath, uint32_t offset, uint32_t length,
@@ -130,10 +129,6 @@ static T_UtilBuffer s_mediaPlayCommandBufferHandler = {0};
 static T_DjiMutexHandle s_mediaPlayCommandBufferMutex = {0};
 static T_DjiSemaHandle s_mediaPlayWorkSem = NULL;
 static uint8_t s_mediaPlayCommandBuffer[sizeof(T_TestPayloadCameraPlaybackCommand) * 32] = {0};
-static const char *s_frameKeyChar = "[PACKET]";
-static const char *s_frameDurationTimeKeyChar = "duration_time";
-static const char *s_framePositionKeyChar = "pos";
-static const char *s_frameSizeKeyChar = "size";
 static T_DjiMediaFileHandle s_mediaFileThumbNailHandle;
 static T_DjiMediaFileHandle s_mediaFileScreenNailHandle;
 static const uint8_t s_frameAudInfo[VIDEO_FRAME_AUD_LEN] = {0x00, 0x00, 0x00, 0x01, 0x09, 0x10};
@@ -148,6 +143,8 @@ T_DjiReturnCode DjiTest_CameraEmuMediaStartService(void)
     const T_DjiDataChannelBandwidthProportionOfHighspeedChannel bandwidthProportionOfHighspeedChannel =
         {10, 60, 30};
     T_DjiAircraftInfoBaseInfo aircraftInfoBaseInfo = {0};
+    char mediaDirPath[DJI_FILE_PATH_SIZE_MAX];
+    char cacheDirPath[DJI_FILE_PATH_SIZE_MAX + sizeof("_cache")];
 
     if (DjiAircraftInfo_GetBaseInfo(&aircraftInfoBaseInfo) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
         USER_LOG_ERROR("get aircraft information error.");
@@ -193,6 +190,16 @@ T_DjiReturnCode DjiTest_CameraEmuMediaStartService(void)
 
     UtilBuffer_Init(&s_mediaPlayCommandBufferHandler, s_mediaPlayCommandBuffer, sizeof(s_mediaPlayCommandBuffer));
 
+    // thumbnails and screennails are served from a persistent cache, prewarmed when files appear
+    if (GetMediaFileDir(mediaDirPath) == DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        snprintf(cacheDirPath, sizeof(cacheDirPath), "%s_cache", mediaDirPath);
+        if (DjiMediaFileCache_Init(cacheDirPath, DJI_MEDIA_FILE_CACHE_DEFAULT_CAPACITY) !=
+            DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS ||
+            DjiMediaFileCache_StartPrewarm(mediaDirPath) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_WARN("media file cache init error, thumbnails are generated on demand.");
+        }
+    }
+
     if (aircraftInfoBaseInfo.aircraftType == DJI_AIRCRAFT_TYPE_M300_RTK ||
         aircraftInfoBaseInfo.aircraftType == DJI_AIRCRAFT_TYPE_M350_RTK ||
         aircraftInfoBaseInfo.aircraftType == DJI_AIRCRAFT_TYPE_M400) {
@@ -432,34 +439,15 @@ static T_DjiReturnCode DjiPlayback_GetPlaybackStatus(T_DjiPlaybackInfo *playback
 
 static T_DjiReturnCode DjiPlayback_GetVideoLengthMs(const char *filePath, uint32_t *videoLengthMs)
 {
-    FILE *fp;
     T_DjiReturnCode returnCode;
-    char ffmpegCmdStr[FFMPEG_CMD_BUF_SIZE];
-    float hour, minute, second;
-    char tempTailStr[128];
-    int ret;
 
-    snprintf(ffmpegCmdStr, FFMPEG_CMD_BUF_SIZE, "ffmpeg -i \"%s\" 2>&1 | grep \"Duration\"", filePath);
-    fp = popen(ffmpegCmdStr, "r");
-
-    if (fp == NULL) {
-        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-    }
-
-    ret = fscanf(fp, "  Duration: %f:%f:%f,%127s", &hour, &minute, &second, tempTailStr);
-    if (ret <= 0) {
-        USER_LOG_ERROR("MP4 File Get Duration Error\n");
-        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        goto out;
+    returnCode = DjiMediaFileIndex_GetMp4DurationMs(filePath, videoLengthMs);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("MP4 File Get Duration Error, stat = 0x%08llX", returnCode);
+        return returnCode;
     }
 
-    *videoLengthMs = (uint32_t) ((hour * 3600 + minute * 60 + second) * 1000);
-    returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-
-out:
-    pclose(fp);
-
-    return returnCode;
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 static T_DjiReturnCode DjiPlayback_StartPlayProcess(const char *filePath, uint32_t playPosMs)
@@ -530,233 +518,94 @@ static T_DjiReturnCode DjiPlayback_StopPlayProcess(void)
 static T_DjiReturnCode DjiPlayback_VideoFileTranscode(const char *inPath, const char *outFormat, char *outPath,
                                                       uint16_t outPathBufferSize)
 {
-    T_DjiReturnCode returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-    T_DjiReturnCode djiStatus = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
     FILE *fpCommand = NULL;
     char ffmpegCmdStr[FFMPEG_CMD_BUF_SIZE];
-    char *directory = NULL;
-    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    const char *inSuffix = NULL;
+    struct stat inStat;
+    struct stat outStat;
+
+    // a file already in the output format is played in place
+    inSuffix = strrchr(inPath, '.');
+    if (inSuffix != NULL && strcasecmp(inSuffix + 1, outFormat) == 0) {
+        snprintf(outPath, outPathBufferSize, "%s", inPath);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
 
-    directory = osalHandler->Malloc(DJI_FILE_PATH_SIZE_MAX);
-    if (directory == NULL) {
-        USER_LOG_ERROR("malloc memory for directory fail.");
-        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    // the transcoded stream is kept next to its source and reused until the source changes
+    snprintf(outPath, outPathBufferSize, "%s.%s", inPath, outFormat);
+    if (stat(inPath, &inStat) != 0) {
+        USER_LOG_ERROR("stat video file:\"%s\" fail:%d.", inPath, errno);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
     }
 
-    djiStatus = DjiUserUtil_GetCurrentFileDirPath(inPath, DJI_FILE_PATH_SIZE_MAX, directory);
-    if (djiStatus != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-        USER_LOG_ERROR("get directory of file error: 0x%08llX.", djiStatus);
-        returnCode = djiStatus;
-        goto out;
+    if (stat(outPath, &outStat) == 0 && outStat.st_size > 0 && outStat.st_mtime >= inStat.st_mtime) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
     }
 
-    snprintf(outPath, outPathBufferSize, "%sout.%s", directory, outFormat);
     snprintf(ffmpegCmdStr, FFMPEG_CMD_BUF_SIZE,
              "echo \"y\" | ffmpeg -i \"%s\" -codec copy -f \"%s\" \"%s\" 1>/dev/null 2>&1", inPath,
              outFormat, outPath);
     fpCommand = popen(ffmpegCmdStr, "r");
     if (fpCommand == NULL) {
         USER_LOG_ERROR("execute transcode command fail.");
-        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-        goto out;
+        return DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
-    pclose(fpCommand);
-
-out:
-    osalHandler->Free(directory);
+    if (pclose(fpCommand) != 0) {
+        USER_LOG_ERROR("transcode video file:\"%s\" fail.", inPath);
+        unlink(outPath);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
 
-    return returnCode;
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 static T_DjiReturnCode
-DjiPlayback_GetFrameInfoOfVideoFile(const char *path, T_TestPayloadCameraVideoFrameInfo *frameInfo,
-                                    uint32_t frameInfoBufferCount, uint32_t *frameCount)
+DjiPlayback_GetFrameInfoOfVideoFile(const char *path, T_DjiMediaFileIndexEntry *frameInfo,
+                                    uint32_t frameInfoBufferCount, uint32_t *frameCount, float *frameRate)
 {
-    long ret;
-    T_DjiReturnCode returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-    FILE *fpCommand = NULL;
-    char ffmpegCmdStr[FFMPEG_CMD_BUF_SIZE];
-    char *frameInfoString = NULL;
-    char *frameLocation = NULL;
-    char frameParameterFormat[50] = {0};
-    char *frameDurationTimeLocation = NULL;
-    float frameDurationTimeS = 0;
-    uint32_t frameNumber = 0;
-    char *framePositionLocation = NULL;
-    uint32_t framePosition = 0;
-    char *frameSizeLocation = NULL;
-    uint32_t frameSize = 0;
+    T_DjiReturnCode returnCode;
+    uint32_t startTimeMs = 0;
+    uint32_t endTimeMs = 0;
     T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
 
-    frameInfoString = osalHandler->Malloc(VIDEO_FRAME_MAX_COUNT * 1024);
-    if (frameInfoString == NULL) {
-        USER_LOG_ERROR("malloc memory for frame info fail.");
-        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
-    }
-    memset(frameInfoString, 0, VIDEO_FRAME_MAX_COUNT * 1024);
-
-    snprintf(ffmpegCmdStr, FFMPEG_CMD_BUF_SIZE, "ffprobe -show_packets \"%s\" 2>/dev/null", path);
-    fpCommand = popen(ffmpegCmdStr, "r");
-    if (fpCommand == NULL) {
-        USER_LOG_ERROR("execute show frames commands fail.");
-        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-        goto out2;
-    }
-
-    ret = (long) fread(frameInfoString, 1, VIDEO_FRAME_MAX_COUNT * 1024, fpCommand);
-    if (ret < 0) {
-        USER_LOG_ERROR("read show frames commands result error.");
-        goto out1;
-    }
-    frameInfoString[ret] = '\0';
-
-    frameLocation = frameInfoString;
-    *frameCount = 0;
-    while (1) {
-        // find frame
-        frameLocation = strstr(frameLocation, s_frameKeyChar);
-        if (frameLocation == NULL) {
-            USER_LOG_DEBUG("reach file tail.");
-            break;
-        }
-
-        // find frame duration
-        frameDurationTimeLocation = strstr(frameLocation, s_frameDurationTimeKeyChar);
-        if (frameDurationTimeLocation == NULL) {
-            USER_LOG_ERROR("can not find pkt_duration_time.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-            goto out1;
-        }
-
-        ret = snprintf(frameParameterFormat, sizeof(frameParameterFormat), "%s=%%f", s_frameDurationTimeKeyChar);
-        if (ret < 0) {
-            USER_LOG_ERROR("snprintf frameParameterFormat fail.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-            goto out1;
-        }
-
-        ret = sscanf(frameDurationTimeLocation, frameParameterFormat, &frameDurationTimeS);
-        if (ret <= 0) {
-            USER_LOG_ERROR("can not find pkt_duration_time.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-            goto out1;
-        }
-        frameInfo[frameNumber].durationS = frameDurationTimeS;
-
-        // find frame position
-        framePositionLocation = strstr(frameLocation, s_framePositionKeyChar);
-        if (framePositionLocation == NULL) {
-            USER_LOG_ERROR("can not found pkt_pos.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-            goto out1;
-        }
-
-        ret = snprintf(frameParameterFormat, sizeof(frameParameterFormat), "%s=%%d", s_framePositionKeyChar);
-        if (ret < 0) {
-            USER_LOG_ERROR("snprintf frameParameterFormat fail.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-            goto out1;
-        }
-
-        ret = sscanf(framePositionLocation, frameParameterFormat, &framePosition);
-        if (ret <= 0) {
-            USER_LOG_ERROR("can not found pkt_pos.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-            goto out1;
-        }
-        frameInfo[frameNumber].positionInFile = framePosition;
-
-        // find frame size
-        frameSizeLocation = strstr(frameLocation, s_frameSizeKeyChar);
-        if (frameSizeLocation == NULL) {
-            USER_LOG_ERROR("can not found pkt_size.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-            goto out1;
-        }
-
-        ret = snprintf(frameParameterFormat, sizeof(frameParameterFormat), "%s=%%d", s_frameSizeKeyChar);
-        if (ret < 0) {
-            USER_LOG_ERROR("snprintf frameParameterFormat fail.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-            goto out1;
-        }
-
-        ret = sscanf(frameSizeLocation, frameParameterFormat, &frameSize);
-        if (ret <= 0) {
-            USER_LOG_ERROR("can not find pkt_size.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-            goto out1;
-        }
-        frameInfo[frameNumber].size = frameSize;
-
-        frameLocation += strlen(s_frameKeyChar);
-        frameNumber++;
-        (*frameCount)++;
-
-        if (frameNumber >= frameInfoBufferCount) {
-            USER_LOG_ERROR("frame buffer is full.");
-            returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_OUT_OF_RANGE;
-            goto out1;
-        }
-    }
-
-out1:
-    pclose(fpCommand);
-
-out2:
-    osalHandler->Free(frameInfoString);
-
-    return returnCode;
-}
-
-static T_DjiReturnCode DjiPlayback_GetFrameRateOfVideoFile(const char *path, float *frameRate)
-{
-    int ret;
-    T_DjiReturnCode returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
-    FILE *fpCommand = NULL;
-    char ffmpegCmdStr[FFMPEG_CMD_BUF_SIZE] = {0};
-    int frameRateMolecule = 0;
-    int frameRateDenominator = 0;
-
-    snprintf(ffmpegCmdStr, FFMPEG_CMD_BUF_SIZE, "ffprobe -show_streams \"%s\" 2>/dev/null | grep r_frame_rate", path);
-    fpCommand = popen(ffmpegCmdStr, "r");
-    if (fpCommand == NULL) {
-        USER_LOG_ERROR("execute show frame rate command fail.");
-        return DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
-    }
-
-    ret = fscanf(fpCommand, "r_frame_rate=%d/%d", &frameRateMolecule, &frameRateDenominator);
-    if (ret <= 0) {
-        USER_LOG_ERROR("can not find frame rate form \"%s\".", path);
-        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
-        goto out;
+    (void) osalHandler->GetTimeMs(&startTimeMs);
+    returnCode = DjiMediaFileIndex_GetH264Index(path, frameInfo, frameInfoBufferCount, frameCount, frameRate);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("get frame index of \"%s\" error: 0x%08llX.", path, returnCode);
+        return returnCode;
     }
-    *frameRate = (float) frameRateMolecule / (float) frameRateDenominator;
+    (void) osalHandler->GetTimeMs(&endTimeMs);
 
-out:
-    pclose(fpCommand);
+    USER_LOG_INFO("index %d frames of \"%s\" at %.2f fps in %d ms.", *frameCount, path, *frameRate,
+                  endTimeMs - startTimeMs);
 
-    return returnCode;
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
-static T_DjiReturnCode DjiPlayback_GetFrameNumberByTime(T_TestPayloadCameraVideoFrameInfo *frameInfo,
+static T_DjiReturnCode DjiPlayback_GetFrameNumberByTime(T_DjiMediaFileIndexEntry *frameInfo,
                                                         uint32_t frameCount, uint32_t *frameNumber, uint32_t timeMs)
 {
-    uint32_t i = 0;
-    double camulativeTimeS = 0;
-    double timeS = (double) timeMs / 1000.0;
+    uint32_t low = 0;
+    uint32_t high = frameCount;
+    uint32_t middle = 0;
 
-    for (i = 0; i < frameCount; ++i) {
-        camulativeTimeS += frameInfo[i].durationS;
+    if (frameCount == 0 || frameInfo[frameCount - 1].ptsMs < timeMs) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    }
 
-        if (camulativeTimeS >= timeS) {
-            *frameNumber = i;
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    // first frame whose presentation time is not earlier than the requested time
+    while (low < high) {
+        middle = low + (high - low) / 2;
+        if (frameInfo[middle].ptsMs < timeMs) {
+            low = middle + 1;
+        } else {
+            high = middle;
         }
     }
+    *frameNumber = low;
 
-    return DJI_ERROR_SYSTEM_MODULE_CODE_NOT_FOUND;
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
 static T_DjiReturnCode GetMediaFileDir(char *dirPath)
@@ -1176,7 +1025,7 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
     uint32_t waitDuration = 1000 / SEND_VIDEO_TASK_FREQ;
     uint32_t rightNow = 0;
     uint32_t sendExpect = 0;
-    T_TestPayloadCameraVideoFrameInfo *frameInfo = NULL;
+    T_DjiMediaFileIndexEntry *frameInfo = NULL;
     uint32_t frameNumber = 0;
     uint32_t frameCount = 0;
     uint32_t startTimeMs = 0;
@@ -1215,12 +1064,12 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
         exit(1);
     }
 
-    frameInfo = osalHandler->Malloc(VIDEO_FRAME_MAX_COUNT * sizeof(T_TestPayloadCameraVideoFrameInfo));
+    frameInfo = osalHandler->Malloc(VIDEO_FRAME_MAX_COUNT * sizeof(T_DjiMediaFileIndexEntry));
     if (frameInfo == NULL) {
         USER_LOG_ERROR("malloc memory for frame info fail.");
         exit(1);
     }
-    memset(frameInfo, 0, VIDEO_FRAME_MAX_COUNT * sizeof(T_TestPayloadCameraVideoFrameInfo));
+    memset(frameInfo, 0, VIDEO_FRAME_MAX_COUNT * sizeof(T_DjiMediaFileIndexEntry));
 
     returnCode = DjiPlayback_StopPlayProcess();
     if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
@@ -1286,14 +1135,8 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
             continue;
         }
 
-        returnCode = DjiPlayback_GetFrameRateOfVideoFile(transcodedFilePath, &frameRate);
-        if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
-            USER_LOG_ERROR("get frame rate of video error: 0x%08llX.", returnCode);
-            continue;
-        }
-
         returnCode = DjiPlayback_GetFrameInfoOfVideoFile(transcodedFilePath, frameInfo, VIDEO_FRAME_MAX_COUNT,
-                                                         &frameCount);
+                                                         &frameCount, &frameRate);
         if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
             USER_LOG_ERROR("get frame info of video error: 0x%08llX.", returnCode);
             continue;
@@ -1309,7 +1152,7 @@ static void *UserCameraMedia_SendVideoTask(void *arg)
         if (fpFile != NULL)
             fclose(fpFile);
 
-        fpFile = fopen(transcodedFilePath, "rb+");
+        fpFile = fopen(transcodedFilePath, "rb");
         if (fpFile == NULL) {
             USER_LOG_ERROR("open video file:\"%s\" fail:%d.", transcodedFilePath, errno);
             continue;
@@ -0,0 +1,389 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_recorder_benchmark.c
+ * @brief   Sustained recording of a synthetic 4K H264 stream with DjiLiveviewRecorder, optionally on a throttled disk.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* The benchmark has its own main, it is only compiled by the benchmark target of the platform CMakeLists,
+ * which also links it with -Wl,--wrap=write so a slow card can be simulated on any disk.
+ */
+#if defined(DJI_SAMPLE_BENCHMARK) && defined(SYSTEM_ARCH_LINUX)
+
+/* Includes ------------------------------------------------------------------*/
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "dji_logger.h"
+#include "dji_platform.h"
+#include "osal/osal.h"
+#include "liveview/dji_liveview_recorder.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define RECORDER_BENCHMARK_BIT_RATE_MBPS_DEFAULT    (100)
+#define RECORDER_BENCHMARK_DURATION_S_DEFAULT       (12)
+#define RECORDER_BENCHMARK_FRAME_RATE               (30)
+#define RECORDER_BENCHMARK_SEGMENT_DURATION_MS      (10000)
+// Largest chunk handed to a single push, frames above it arrive in several chunks like from the stream callback
+#define RECORDER_BENCHMARK_CHUNK_SIZE_MAX           (64 * 1024)
+// Size of a key frame relative to the other frames of its group of pictures
+#define RECORDER_BENCHMARK_KEY_FRAME_WEIGHT         (4)
+#define RECORDER_BENCHMARK_FILE_PREFIX              "benchmark"
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint64_t pushCount;
+    uint64_t pushTotalUs;
+    uint64_t pushMaxUs;
+    uint64_t busyCount;
+} T_RecorderBenchmarkPushStatistics;
+
+/* Private values -------------------------------------------------------------*/
+static uint64_t s_throttleBytesPerSecond = 0;
+static uint64_t s_throttleStallMs = 0;
+static uint64_t s_throttleStallIntervalMs = 0;
+static uint64_t s_throttleStartUs = 0;
+static uint64_t s_throttleLastStallUs = 0;
+static uint64_t s_throttleWrittenBytes = 0;
+
+/* Private functions declaration ---------------------------------------------*/
+static uint64_t RecorderBenchmark_GetTimeUs(void);
+static T_DjiReturnCode RecorderBenchmark_PrintConsole(const uint8_t *data, uint16_t dataLen);
+static T_DjiReturnCode RecorderBenchmark_PrepareEnvironment(void);
+static void RecorderBenchmark_FillFrame(uint8_t *frame, uint32_t len, bool isKeyFrame);
+static void RecorderBenchmark_Push(T_DjiLiveviewRecorderHandle recorder, const uint8_t *frame, uint32_t len,
+                                   T_RecorderBenchmarkPushStatistics *pushStatistics);
+static void RecorderBenchmark_CheckSegments(const char *folderPath, uint32_t *segmentCount,
+                                            uint32_t *badSegmentCount, uint64_t *totalBytes);
+ssize_t __real_write(int fd, const void *buf, size_t count);
+ssize_t __wrap_write(int fd, const void *buf, size_t count);
+
+/* Exported functions definition ---------------------------------------------*/
+int main(int argc, char **argv)
+{
+    T_DjiLiveviewRecorderConfig config = {0};
+    T_DjiLiveviewRecorderStatistics statistics = {0};
+    T_RecorderBenchmarkPushStatistics pushStatistics = {0};
+    T_DjiLiveviewRecorderHandle recorder = NULL;
+    uint32_t bitRateMbps = RECORDER_BENCHMARK_BIT_RATE_MBPS_DEFAULT;
+    uint32_t durationS = RECORDER_BENCHMARK_DURATION_S_DEFAULT;
+    uint32_t frameUnit;
+    uint32_t frameCount;
+    uint32_t segmentCount = 0;
+    uint32_t badSegmentCount = 0;
+    uint64_t diskBytes = 0;
+    uint64_t startUs;
+    uint64_t elapsedUs;
+    uint8_t *keyFrame;
+    uint8_t *frame;
+
+    if (argc < 2 || argc > 7 || argc == 3 || argc == 5 || argc == 6) {
+        printf("usage: %s <record folder> [bitRateMbps durationS [throttleMBps stallMs stallIntervalS]]\n", argv[0]);
+        printf("  throttleMBps: limit write() to this rate to simulate a slow card, stalling it for stallMs every "
+               "stallIntervalS\n");
+        printf("  the record folder should be empty, every segment found in it is checked\n");
+        return -1;
+    }
+    if (argc >= 4) {
+        bitRateMbps = (uint32_t) strtoul(argv[2], NULL, 0);
+        durationS = (uint32_t) strtoul(argv[3], NULL, 0);
+    }
+    if (argc == 7) {
+        s_throttleBytesPerSecond = strtoull(argv[4], NULL, 0) * 1000 * 1000;
+        s_throttleStallMs = strtoull(argv[5], NULL, 0);
+        s_throttleStallIntervalMs = strtoull(argv[6], NULL, 0) * 1000;
+    }
+    if (bitRateMbps == 0 || durationS == 0) {
+        printf("bit rate and duration must not be 0\n");
+        return -1;
+    }
+
+    if (RecorderBenchmark_PrepareEnvironment() != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        printf("register osal handler error\n");
+        return -1;
+    }
+
+    // A group of pictures per second, the key frame counts as RECORDER_BENCHMARK_KEY_FRAME_WEIGHT frames
+    frameUnit = (uint32_t) ((uint64_t) bitRateMbps * 1000 * 1000 / 8 /
+                            (RECORDER_BENCHMARK_FRAME_RATE - 1 + RECORDER_BENCHMARK_KEY_FRAME_WEIGHT));
+    keyFrame = malloc(frameUnit * RECORDER_BENCHMARK_KEY_FRAME_WEIGHT);
+    frame = malloc(frameUnit);
+    if (keyFrame == NULL || frame == NULL) {
+        printf("malloc frames error\n");
+        goto free_frames;
+    }
+    RecorderBenchmark_FillFrame(keyFrame, frameUnit * RECORDER_BENCHMARK_KEY_FRAME_WEIGHT, true);
+    RecorderBenchmark_FillFrame(frame, frameUnit, false);
+
+    config.folderPath = argv[1];
+    config.filePrefix = RECORDER_BENCHMARK_FILE_PREFIX;
+    config.segmentDurationMs = RECORDER_BENCHMARK_SEGMENT_DURATION_MS;
+    if (DjiLiveviewRecorder_Create(&config, &recorder) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        printf("create recorder in %s error\n", argv[1]);
+        goto free_frames;
+    }
+
+    // The main thread plays the stream callback, handing over one frame per frame interval
+    frameCount = durationS * RECORDER_BENCHMARK_FRAME_RATE;
+    startUs = RecorderBenchmark_GetTimeUs();
+    for (uint32_t i = 0; i < frameCount; i++) {
+        uint64_t nextFrameUs = startUs + (uint64_t) (i + 1) * 1000000 / RECORDER_BENCHMARK_FRAME_RATE;
+        uint64_t nowUs;
+
+        if (i % RECORDER_BENCHMARK_FRAME_RATE == 0) {
+            RecorderBenchmark_Push(recorder, keyFrame, frameUnit * RECORDER_BENCHMARK_KEY_FRAME_WEIGHT,
+                                   &pushStatistics);
+        } else {
+            RecorderBenchmark_Push(recorder, frame, frameUnit, &pushStatistics);
+        }
+
+        nowUs = RecorderBenchmark_GetTimeUs();
+        if (nextFrameUs > nowUs) {
+            usleep(nextFrameUs - nowUs);
+        }
+    }
+
+    DjiLiveviewRecorder_GetStatistics(recorder, &statistics);
+    DjiLiveviewRecorder_Destroy(recorder);
+    elapsedUs = RecorderBenchmark_GetTimeUs() - startUs;
+
+    RecorderBenchmark_CheckSegments(argv[1], &segmentCount, &badSegmentCount, &diskBytes);
+
+    printf("stream: %u Mbps, %u fps, %u s", bitRateMbps, RECORDER_BENCHMARK_FRAME_RATE, durationS);
+    if (s_throttleBytesPerSecond != 0) {
+        printf(", write() throttled to %llu MB/s with a %llu ms stall every %llu s",
+               (unsigned long long) (s_throttleBytesPerSecond / 1000 / 1000), (unsigned long long) s_throttleStallMs,
+               (unsigned long long) (s_throttleStallIntervalMs / 1000));
+    }
+    printf("\n");
+    printf("push: %llu chunks, avg %llu us, max %llu us, %llu busy\n", (unsigned long long) pushStatistics.pushCount,
+           (unsigned long long) (pushStatistics.pushCount ? pushStatistics.pushTotalUs / pushStatistics.pushCount : 0),
+           (unsigned long long) pushStatistics.pushMaxUs, (unsigned long long) pushStatistics.busyCount);
+    printf("queue: peak %.1f MB, dropped %llu bytes in %u chunks\n", statistics.queueHighWater / 1e6,
+           (unsigned long long) statistics.droppedBytes, statistics.droppedChunkCount);
+    printf("writer: max write %u ms, max sync %u ms, %u write errors, %.1f MB/s over the run\n",
+           statistics.maxWriteTimeMs, statistics.maxSyncTimeMs, statistics.writeErrorCount,
+           elapsedUs ? (double) diskBytes / elapsedUs : 0.0);
+    printf("segments: %u, %u not starting with SPS, %llu bytes on disk, received - dropped = %llu\n", segmentCount,
+           badSegmentCount, (unsigned long long) diskBytes,
+           (unsigned long long) (statistics.receivedBytes - statistics.droppedBytes));
+
+    free(keyFrame);
+    free(frame);
+
+    return badSegmentCount == 0 && diskBytes == statistics.receivedBytes - statistics.droppedBytes ? 0 : -1;
+
+free_frames:
+    free(keyFrame);
+    free(frame);
+
+    return -1;
+}
+
+ssize_t __wrap_write(int fd, const void *buf, size_t count)
+{
+    uint64_t nowUs;
+    uint64_t dueUs;
+
+    if (s_throttleBytesPerSecond == 0) {
+        return __real_write(fd, buf, count);
+    }
+
+    nowUs = RecorderBenchmark_GetTimeUs();
+    if (s_throttleStartUs == 0) {
+        s_throttleStartUs = nowUs;
+        s_throttleLastStallUs = nowUs;
+    }
+
+    // Like the garbage collection of a card, the write blocks now and then far longer than its size explains
+    if (s_throttleStallIntervalMs != 0 && nowUs - s_throttleLastStallUs >= s_throttleStallIntervalMs * 1000) {
+        usleep(s_throttleStallMs * 1000);
+        s_throttleLastStallUs = RecorderBenchmark_GetTimeUs();
+        s_throttleStartUs += s_throttleStallMs * 1000;
+    }
+
+    s_throttleWrittenBytes += count;
+    dueUs = s_throttleStartUs + s_throttleWrittenBytes * 1000000 / s_throttleBytesPerSecond;
+    nowUs = RecorderBenchmark_GetTimeUs();
+    if (dueUs > nowUs) {
+        usleep(dueUs - nowUs);
+    }
+
+    return __real_write(fd, buf, count);
+}
+
+/* Private functions definition-----------------------------------------------*/
+static uint64_t RecorderBenchmark_GetTimeUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static T_DjiReturnCode RecorderBenchmark_PrintConsole(const uint8_t *data, uint16_t dataLen)
+{
+    (void) dataLen;
+
+    printf("%s", data);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static T_DjiReturnCode RecorderBenchmark_PrepareEnvironment(void)
+{
+    T_DjiReturnCode returnCode;
+    T_DjiOsalHandler osalHandler = {
+        .TaskCreate = Osal_TaskCreate,
+        .TaskDestroy = Osal_TaskDestroy,
+        .TaskSleepMs = Osal_TaskSleepMs,
+        .MutexCreate = Osal_MutexCreate,
+        .MutexDestroy = Osal_MutexDestroy,
+        .MutexLock = Osal_MutexLock,
+        .MutexUnlock = Osal_MutexUnlock,
+        .SemaphoreCreate = Osal_SemaphoreCreate,
+        .SemaphoreDestroy = Osal_SemaphoreDestroy,
+        .SemaphoreWait = Osal_SemaphoreWait,
+        .SemaphoreTimedWait = Osal_SemaphoreTimedWait,
+        .SemaphorePost = Osal_SemaphorePost,
+        .Malloc = Osal_Malloc,
+        .Free = Osal_Free,
+        .GetTimeMs = Osal_GetTimeMs,
+        .GetTimeUs = Osal_GetTimeUs,
+        .GetRandomNum = Osal_GetRandomNum,
+    };
+    static T_DjiLoggerConsole printConsole = {
+        .func = RecorderBenchmark_PrintConsole,
+        .consoleLevel = DJI_LOGGER_CONSOLE_LOG_LEVEL_WARN,
+        .isSupportColor = false,
+    };
+
+    returnCode = DjiPlatform_RegOsalHandler(&osalHandler);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        return returnCode;
+    }
+
+    return DjiLogger_AddConsole(&printConsole);
+}
+
+static void RecorderBenchmark_FillFrame(uint8_t *frame, uint32_t len, bool isKeyFrame)
+{
+    static const uint8_t spsPps[] = {
+        0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x33, 0xAC, 0x34, 0xE4,
+        0x00, 0x00, 0x00, 0x01, 0x68, 0xEE, 0x3C, 0xB0,
+    };
+    static const uint8_t idrHeader[] = {0x00, 0x00, 0x00, 0x01, 0x65};
+    static const uint8_t sliceHeader[] = {0x00, 0x00, 0x00, 0x01, 0x41};
+    uint32_t seed = len;
+    uint32_t offset = 0;
+
+    if (isKeyFrame) {
+        memcpy(frame, spsPps, sizeof(spsPps));
+        offset += sizeof(spsPps);
+        memcpy(frame + offset, idrHeader, sizeof(idrHeader));
+        offset += sizeof(idrHeader);
+    } else {
+        memcpy(frame, sliceHeader, sizeof(sliceHeader));
+        offset += sizeof(sliceHeader);
+    }
+
+    // Slice data never holds a zero byte here, so the only start codes are the ones written above
+    for (; offset < len; offset++) {
+        seed = seed * 1103515245 + 12345;
+        frame[offset] = (uint8_t) ((seed >> 16) | 0x01);
+    }
+}
+
+static void RecorderBenchmark_Push(T_DjiLiveviewRecorderHandle recorder, const uint8_t *frame, uint32_t len,
+                                   T_RecorderBenchmarkPushStatistics *pushStatistics)
+{
+    uint32_t offset;
+
+    for (offset = 0; offset < len; offset += RECORDER_BENCHMARK_CHUNK_SIZE_MAX) {
+        uint32_t chunkLen = len - offset < RECORDER_BENCHMARK_CHUNK_SIZE_MAX ? len - offset
+                                                                               : RECORDER_BENCHMARK_CHUNK_SIZE_MAX;
+        uint64_t startUs = RecorderBenchmark_GetTimeUs();
+        uint64_t costUs;
+
+        if (DjiLiveviewRecorder_Push(recorder, frame + offset, chunkLen) == DJI_ERROR_SYSTEM_MODULE_CODE_BUSY) {
+            pushStatistics->busyCount++;
+        }
+
+        costUs = RecorderBenchmark_GetTimeUs() - startUs;
+        pushStatistics->pushCount++;
+        pushStatistics->pushTotalUs += costUs;
+        if (costUs > pushStatistics->pushMaxUs) {
+            pushStatistics->pushMaxUs = costUs;
+        }
+    }
+}
+
+static void RecorderBenchmark_CheckSegments(const char *folderPath, uint32_t *segmentCount,
+                                            uint32_t *badSegmentCount, uint64_t *totalBytes)
+{
+    char filePath[256];
+    struct dirent *entry;
+    DIR *dir;
+
+    dir = opendir(folderPath);
+    if (dir == NULL) {
+        return;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        uint8_t head[5] = {0};
+        FILE *file;
+        long size;
+
+        if (strncmp(entry->d_name, RECORDER_BENCHMARK_FILE_PREFIX "_", sizeof(RECORDER_BENCHMARK_FILE_PREFIX)) != 0) {
+            continue;
+        }
+
+        if (snprintf(filePath, sizeof(filePath), "%s/%s", folderPath, entry->d_name) >= (int) sizeof(filePath)) {
+            continue;
+        }
+        file = fopen(filePath, "rb");
+        if (file == NULL) {
+            continue;
+        }
+
+        (*segmentCount)++;
+        if (fread(head, 1, sizeof(head), file) != sizeof(head) || head[0] != 0 || head[1] != 0 || head[2] != 0 ||
+            head[3] != 1 || (head[4] & 0x1F) != 7) {
+            (*badSegmentCount)++;
+        }
+        fseek(file, 0, SEEK_END);
+        size = ftell(file);
+        if (size > 0) {
+            *totalBytes += (uint64_t) size;
+        }
+        fclose(file);
+    }
+
+    closedir(dir);
+}
+
+#endif
+
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
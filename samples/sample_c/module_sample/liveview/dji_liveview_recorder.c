@@ -0,0 +1,590 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_recorder.c
+ * @brief
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_liveview_recorder.h"
+
+#ifdef SYSTEM_ARCH_LINUX
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "dji_logger.h"
+#include "dji_platform.h"
+
+/* Private constants ---------------------------------------------------------*/
+#define DJI_LIVEVIEW_RECORDER_PATH_MAX_SIZE             (256)
+#define DJI_LIVEVIEW_RECORDER_PREFIX_MAX_SIZE           (32)
+#define DJI_LIVEVIEW_RECORDER_TASK_STACK_SIZE           (2048)
+// Longest time stream data waits in the queue before the writer task picks it up, unit: ms
+#define DJI_LIVEVIEW_RECORDER_WAKE_INTERVAL_MS          (100)
+// Every chunk is stored behind a 32 bit header carrying its length and whether it starts a key frame
+#define DJI_LIVEVIEW_RECORDER_RECORD_HEADER_SIZE        (sizeof(uint32_t))
+#define DJI_LIVEVIEW_RECORDER_RECORD_KEY_FRAME          (0x80000000U)
+#define DJI_LIVEVIEW_RECORDER_RECORD_LEN_MASK           (0x7FFFFFFFU)
+#define DJI_LIVEVIEW_RECORDER_RECORD_SIZE(len)          (DJI_LIVEVIEW_RECORDER_RECORD_HEADER_SIZE + (((len) + 3U) & ~3U))
+#define DJI_LIVEVIEW_RECORDER_NAL_TYPE_SLICE            (1)
+#define DJI_LIVEVIEW_RECORDER_NAL_TYPE_IDR              (5)
+#define DJI_LIVEVIEW_RECORDER_NAL_TYPE_SPS              (7)
+
+/* Private types -------------------------------------------------------------*/
+typedef struct {
+    // Written by the stream callback, kept away from the writer side to avoid false sharing
+    uint64_t queueHead __attribute__((aligned(64)));
+    bool isWaitingKeyFrame;
+    bool isNalHeaderPending;
+    uint8_t trailingZeroCount;
+    uint64_t queueTail __attribute__((aligned(64)));
+    uint8_t *queue;
+    uint32_t queueSize;
+    uint8_t *batch;
+    uint32_t batchLen;
+    int32_t fileFd;
+    uint64_t fileSize;
+    uint32_t fileIndex;
+    uint32_t fileStartMs;
+    uint32_t lastSyncMs;
+    bool isStopRequested;
+    char folderPath[DJI_LIVEVIEW_RECORDER_PATH_MAX_SIZE / 2];
+    char filePrefix[DJI_LIVEVIEW_RECORDER_PREFIX_MAX_SIZE];
+    uint32_t segmentDurationMs;
+    uint32_t segmentSize;
+    uint32_t syncIntervalMs;
+    T_DjiLiveviewRecorderStatistics statistics;
+    T_DjiSemaHandle wakeSema;
+    T_DjiSemaHandle doneSema;
+    T_DjiTaskHandle writerTask;
+} T_DjiLiveviewRecorder;
+
+/* Private values -------------------------------------------------------------*/
+
+/* Private functions declaration ---------------------------------------------*/
+static void *DjiLiveviewRecorder_Task(void *arg);
+static bool DjiLiveviewRecorder_IsKeyFrame(T_DjiLiveviewRecorder *recorder, const uint8_t *buf, uint32_t len);
+static bool DjiLiveviewRecorder_CheckNalType(uint8_t nalHeader, bool *isKeyFrame);
+static void DjiLiveviewRecorder_DrainQueue(T_DjiLiveviewRecorder *recorder);
+static bool DjiLiveviewRecorder_IsSegmentDue(T_DjiLiveviewRecorder *recorder);
+static void DjiLiveviewRecorder_WriteBatch(T_DjiLiveviewRecorder *recorder);
+static void DjiLiveviewRecorder_SyncSegment(T_DjiLiveviewRecorder *recorder);
+static T_DjiReturnCode DjiLiveviewRecorder_OpenNextSegment(T_DjiLiveviewRecorder *recorder);
+static void DjiLiveviewRecorder_CloseSegment(T_DjiLiveviewRecorder *recorder);
+static uint32_t DjiLiveviewRecorder_GetTimeMs(void);
+
+/* Exported functions definition ---------------------------------------------*/
+T_DjiReturnCode DjiLiveviewRecorder_Create(const T_DjiLiveviewRecorderConfig *config,
+                                           T_DjiLiveviewRecorderHandle *recorderHandle)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiLiveviewRecorder *recorder;
+    T_DjiReturnCode returnCode;
+
+    if (config == NULL || recorderHandle == NULL || config->folderPath == NULL || config->filePrefix == NULL ||
+        strlen(config->folderPath) >= DJI_LIVEVIEW_RECORDER_PATH_MAX_SIZE / 2 ||
+        strlen(config->filePrefix) >= DJI_LIVEVIEW_RECORDER_PREFIX_MAX_SIZE) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (config->queueSize != 0 &&
+        ((config->queueSize & (config->queueSize - 1)) != 0 || config->queueSize < DJI_LIVEVIEW_RECORDER_WRITE_SIZE)) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    if (mkdir(config->folderPath, 0755) != 0 && errno != EEXIST) {
+        USER_LOG_ERROR("Create record folder %s error, errno: %d.", config->folderPath, errno);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    recorder = osalHandler->Malloc(sizeof(T_DjiLiveviewRecorder));
+    if (recorder == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    memset(recorder, 0, sizeof(T_DjiLiveviewRecorder));
+    strcpy(recorder->folderPath, config->folderPath);
+    strcpy(recorder->filePrefix, config->filePrefix);
+    recorder->segmentDurationMs = config->segmentDurationMs;
+    recorder->segmentSize = config->segmentSize;
+    recorder->queueSize = config->queueSize != 0 ? config->queueSize : DJI_LIVEVIEW_RECORDER_QUEUE_SIZE_DEFAULT;
+    recorder->syncIntervalMs =
+        config->syncIntervalMs != 0 ? config->syncIntervalMs : DJI_LIVEVIEW_RECORDER_SYNC_INTERVAL_MS_DEFAULT;
+    recorder->isWaitingKeyFrame = true;
+    recorder->fileFd = -1;
+
+    recorder->queue = osalHandler->Malloc(recorder->queueSize);
+    recorder->batch = osalHandler->Malloc(DJI_LIVEVIEW_RECORDER_WRITE_SIZE);
+    if (recorder->queue == NULL || recorder->batch == NULL) {
+        returnCode = DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        goto free_recorder;
+    }
+
+    // Touch the whole queue now, so the stream callback does not take the page faults of its first round
+    memset(recorder->queue, 0, recorder->queueSize);
+
+    returnCode = osalHandler->SemaphoreCreate(0, &recorder->wakeSema);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto free_recorder;
+    }
+
+    returnCode = osalHandler->SemaphoreCreate(0, &recorder->doneSema);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto destroy_wake_sema;
+    }
+
+    returnCode = osalHandler->TaskCreate("liveview_recorder", DjiLiveviewRecorder_Task,
+                                         DJI_LIVEVIEW_RECORDER_TASK_STACK_SIZE, recorder, &recorder->writerTask);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Create liveview recorder task error, error code: 0x%08X.", returnCode);
+        goto destroy_done_sema;
+    }
+
+    *recorderHandle = recorder;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+destroy_done_sema:
+    osalHandler->SemaphoreDestroy(recorder->doneSema);
+destroy_wake_sema:
+    osalHandler->SemaphoreDestroy(recorder->wakeSema);
+free_recorder:
+    if (recorder->queue != NULL) {
+        osalHandler->Free(recorder->queue);
+    }
+    if (recorder->batch != NULL) {
+        osalHandler->Free(recorder->batch);
+    }
+    osalHandler->Free(recorder);
+
+    return returnCode;
+}
+
+T_DjiReturnCode DjiLiveviewRecorder_Destroy(T_DjiLiveviewRecorderHandle recorderHandle)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiLiveviewRecorder *recorder = (T_DjiLiveviewRecorder *) recorderHandle;
+
+    if (recorder == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    // Writing out a full queue to a slow card can outlast the task stop timeout, so wait for the task to say it is done
+    __atomic_store_n(&recorder->isStopRequested, true, __ATOMIC_RELEASE);
+    osalHandler->SemaphorePost(recorder->wakeSema);
+    osalHandler->SemaphoreWait(recorder->doneSema);
+    osalHandler->TaskDestroy(recorder->writerTask);
+
+    osalHandler->SemaphoreDestroy(recorder->doneSema);
+    osalHandler->SemaphoreDestroy(recorder->wakeSema);
+    osalHandler->Free(recorder->queue);
+    osalHandler->Free(recorder->batch);
+    osalHandler->Free(recorder);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewRecorder_Push(T_DjiLiveviewRecorderHandle recorderHandle, const uint8_t *buf, uint32_t len)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiLiveviewRecorder *recorder = (T_DjiLiveviewRecorder *) recorderHandle;
+    uint32_t recordSize = DJI_LIVEVIEW_RECORDER_RECORD_SIZE(len);
+    uint32_t queueMask;
+    uint32_t offset;
+    uint32_t firstLen;
+    uint64_t head;
+    uint64_t used;
+    bool isKeyFrame;
+
+    if (recorder == NULL || buf == NULL || len == 0 || len > DJI_LIVEVIEW_RECORDER_RECORD_LEN_MASK) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    __atomic_add_fetch(&recorder->statistics.receivedBytes, len, __ATOMIC_RELAXED);
+    isKeyFrame = DjiLiveviewRecorder_IsKeyFrame(recorder, buf, len);
+
+    head = recorder->queueHead;
+    used = head - __atomic_load_n(&recorder->queueTail, __ATOMIC_ACQUIRE);
+    if (used + recordSize > recorder->queueSize) {
+        // The frames up to the next key frame reference the dropped one, writing them would only give broken pictures
+        recorder->isWaitingKeyFrame = true;
+    } else if (isKeyFrame == true) {
+        recorder->isWaitingKeyFrame = false;
+    }
+
+    if (recorder->isWaitingKeyFrame == true) {
+        __atomic_add_fetch(&recorder->statistics.droppedBytes, len, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&recorder->statistics.droppedChunkCount, 1, __ATOMIC_RELAXED);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_BUSY;
+    }
+
+    // Records are 4 byte aligned and the queue size is a power of two, so a header never wraps around
+    queueMask = recorder->queueSize - 1;
+    *(uint32_t *) &recorder->queue[(uint32_t) head & queueMask] =
+        len | (isKeyFrame == true ? DJI_LIVEVIEW_RECORDER_RECORD_KEY_FRAME : 0);
+
+    offset = (uint32_t) (head + DJI_LIVEVIEW_RECORDER_RECORD_HEADER_SIZE) & queueMask;
+    firstLen = recorder->queueSize - offset;
+    if (firstLen >= len) {
+        memcpy(&recorder->queue[offset], buf, len);
+    } else {
+        memcpy(&recorder->queue[offset], buf, firstLen);
+        memcpy(&recorder->queue[0], buf + firstLen, len - firstLen);
+    }
+
+    __atomic_store_n(&recorder->queueHead, head + recordSize, __ATOMIC_RELEASE);
+
+    if (used + recordSize > __atomic_load_n(&recorder->statistics.queueHighWater, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&recorder->statistics.queueHighWater, (uint32_t) (used + recordSize), __ATOMIC_RELAXED);
+    }
+
+    // The writer task wakes up on its own every wake interval, only hurry it once a full write is queued
+    if (used < DJI_LIVEVIEW_RECORDER_WRITE_SIZE && used + recordSize >= DJI_LIVEVIEW_RECORDER_WRITE_SIZE) {
+        osalHandler->SemaphorePost(recorder->wakeSema);
+    }
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode DjiLiveviewRecorder_GetStatistics(T_DjiLiveviewRecorderHandle recorderHandle,
+                                                  T_DjiLiveviewRecorderStatistics *statistics)
+{
+    T_DjiLiveviewRecorder *recorder = (T_DjiLiveviewRecorder *) recorderHandle;
+
+    if (recorder == NULL || statistics == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    statistics->receivedBytes = __atomic_load_n(&recorder->statistics.receivedBytes, __ATOMIC_RELAXED);
+    statistics->writtenBytes = __atomic_load_n(&recorder->statistics.writtenBytes, __ATOMIC_RELAXED);
+    statistics->droppedBytes = __atomic_load_n(&recorder->statistics.droppedBytes, __ATOMIC_RELAXED);
+    statistics->droppedChunkCount = __atomic_load_n(&recorder->statistics.droppedChunkCount, __ATOMIC_RELAXED);
+    statistics->segmentCount = __atomic_load_n(&recorder->statistics.segmentCount, __ATOMIC_RELAXED);
+    statistics->writeErrorCount = __atomic_load_n(&recorder->statistics.writeErrorCount, __ATOMIC_RELAXED);
+    statistics->queueHighWater = __atomic_load_n(&recorder->statistics.queueHighWater, __ATOMIC_RELAXED);
+    statistics->maxWriteTimeMs = __atomic_load_n(&recorder->statistics.maxWriteTimeMs, __ATOMIC_RELAXED);
+    statistics->maxSyncTimeMs = __atomic_load_n(&recorder->statistics.maxSyncTimeMs, __ATOMIC_RELAXED);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+/* Private functions definition-----------------------------------------------*/
+static void *DjiLiveviewRecorder_Task(void *arg)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    T_DjiLiveviewRecorder *recorder = (T_DjiLiveviewRecorder *) arg;
+
+    while (__atomic_load_n(&recorder->isStopRequested, __ATOMIC_ACQUIRE) == false) {
+        osalHandler->SemaphoreTimedWait(recorder->wakeSema, DJI_LIVEVIEW_RECORDER_WAKE_INTERVAL_MS);
+        DjiLiveviewRecorder_DrainQueue(recorder);
+    }
+
+    DjiLiveviewRecorder_DrainQueue(recorder);
+    DjiLiveviewRecorder_CloseSegment(recorder);
+    osalHandler->SemaphorePost(recorder->doneSema);
+
+    return NULL;
+}
+
+/**
+ * @brief Tell whether a chunk of stream data starts a key frame, by the NAL units in front of its first slice.
+ * @note Scanning stops at the first slice, so only the few bytes of parameter sets and slice headers are looked at.
+ * Start codes split over two chunks are followed through the trailing zeros of the previous chunk.
+ */
+static bool DjiLiveviewRecorder_IsKeyFrame(T_DjiLiveviewRecorder *recorder, const uint8_t *buf, uint32_t len)
+{
+    const uint8_t *end = buf + len;
+    const uint8_t *pos = buf;
+    const uint8_t *nalHeader = NULL;
+    uint8_t zeroCount = recorder->trailingZeroCount;
+    bool isKeyFrame = false;
+
+    if (recorder->isNalHeaderPending == true) {
+        nalHeader = buf;
+    } else if (zeroCount == 2 && buf[0] == 1) {
+        nalHeader = buf + 1;
+    } else if (zeroCount >= 1 && len >= 2 && buf[0] == 0 && buf[1] == 1) {
+        nalHeader = buf + 2;
+    }
+
+    recorder->isNalHeaderPending = false;
+    recorder->trailingZeroCount = 0;
+    while (recorder->trailingZeroCount < 2 && recorder->trailingZeroCount < len &&
+           buf[len - 1 - recorder->trailingZeroCount] == 0) {
+        recorder->trailingZeroCount++;
+    }
+    if (recorder->trailingZeroCount == len && zeroCount + len >= 2) {
+        recorder->trailingZeroCount = 2;
+    }
+
+    while (true) {
+        if (nalHeader != NULL) {
+            if (nalHeader == end) {
+                recorder->isNalHeaderPending = true;
+                break;
+            }
+            if (DjiLiveviewRecorder_CheckNalType(*nalHeader, &isKeyFrame) == true) {
+                break;
+            }
+            nalHeader = NULL;
+        }
+
+        pos = pos < end ? memchr(pos, 1, end - pos) : NULL;
+        if (pos == NULL) {
+            break;
+        }
+
+        pos++;
+        if (pos - buf >= 3 && pos[-2] == 0 && pos[-3] == 0) {
+            nalHeader = pos;
+        }
+    }
+
+    return isKeyFrame;
+}
+
+/**
+ * @brief Sort a NAL unit out by its header.
+ * @return true once the NAL unit decides whether the frame is a key frame.
+ */
+static bool DjiLiveviewRecorder_CheckNalType(uint8_t nalHeader, bool *isKeyFrame)
+{
+    switch (nalHeader & 0x1F) {
+        case DJI_LIVEVIEW_RECORDER_NAL_TYPE_SPS:
+        case DJI_LIVEVIEW_RECORDER_NAL_TYPE_IDR:
+            *isKeyFrame = true;
+            return true;
+        case DJI_LIVEVIEW_RECORDER_NAL_TYPE_SLICE:
+            *isKeyFrame = false;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Move the queued chunks to the current segment, starting the next segment at a key frame once it is due.
+ */
+static void DjiLiveviewRecorder_DrainQueue(T_DjiLiveviewRecorder *recorder)
+{
+    uint32_t queueMask = recorder->queueSize - 1;
+    uint32_t header;
+    uint32_t offset;
+    uint32_t copyLen;
+    uint32_t len;
+    uint64_t tail = recorder->queueTail;
+    uint64_t head = __atomic_load_n(&recorder->queueHead, __ATOMIC_ACQUIRE);
+
+    while (tail != head) {
+        header = *(uint32_t *) &recorder->queue[(uint32_t) tail & queueMask];
+        len = header & DJI_LIVEVIEW_RECORDER_RECORD_LEN_MASK;
+
+        if ((header & DJI_LIVEVIEW_RECORDER_RECORD_KEY_FRAME) != 0 &&
+            DjiLiveviewRecorder_IsSegmentDue(recorder) == true) {
+            DjiLiveviewRecorder_CloseSegment(recorder);
+            DjiLiveviewRecorder_OpenNextSegment(recorder);
+        }
+
+        if (recorder->fileFd < 0) {
+            __atomic_add_fetch(&recorder->statistics.droppedBytes, len, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&recorder->statistics.droppedChunkCount, 1, __ATOMIC_RELAXED);
+        } else {
+            offset = (uint32_t) (tail + DJI_LIVEVIEW_RECORDER_RECORD_HEADER_SIZE) & queueMask;
+            while (len > 0) {
+                copyLen = DJI_LIVEVIEW_RECORDER_WRITE_SIZE - recorder->batchLen;
+                copyLen = copyLen < len ? copyLen : len;
+                copyLen = copyLen < recorder->queueSize - offset ? copyLen : recorder->queueSize - offset;
+
+                memcpy(&recorder->batch[recorder->batchLen], &recorder->queue[offset], copyLen);
+                recorder->batchLen += copyLen;
+                offset = (offset + copyLen) & queueMask;
+                len -= copyLen;
+
+                if (recorder->batchLen == DJI_LIVEVIEW_RECORDER_WRITE_SIZE) {
+                    DjiLiveviewRecorder_WriteBatch(recorder);
+                }
+            }
+        }
+
+        tail += DJI_LIVEVIEW_RECORDER_RECORD_SIZE(header & DJI_LIVEVIEW_RECORDER_RECORD_LEN_MASK);
+        __atomic_store_n(&recorder->queueTail, tail, __ATOMIC_RELEASE);
+
+        if (tail == head) {
+            head = __atomic_load_n(&recorder->queueHead, __ATOMIC_ACQUIRE);
+        }
+    }
+
+    if (recorder->fileFd >= 0) {
+        DjiLiveviewRecorder_WriteBatch(recorder);
+        if (DjiLiveviewRecorder_GetTimeMs() - recorder->lastSyncMs >= recorder->syncIntervalMs) {
+            DjiLiveviewRecorder_SyncSegment(recorder);
+        }
+    }
+}
+
+static bool DjiLiveviewRecorder_IsSegmentDue(T_DjiLiveviewRecorder *recorder)
+{
+    if (recorder->fileFd < 0) {
+        return true;
+    }
+
+    if (recorder->segmentDurationMs != 0 &&
+        DjiLiveviewRecorder_GetTimeMs() - recorder->fileStartMs >= recorder->segmentDurationMs) {
+        return true;
+    }
+
+    if (recorder->segmentSize != 0 && recorder->fileSize + recorder->batchLen >= recorder->segmentSize) {
+        return true;
+    }
+
+    return false;
+}
+
+static void DjiLiveviewRecorder_WriteBatch(T_DjiLiveviewRecorder *recorder)
+{
+    uint32_t writtenLen = 0;
+    uint32_t startMs;
+    uint32_t costMs;
+    ssize_t ret;
+
+    if (recorder->batchLen == 0) {
+        return;
+    }
+
+    startMs = DjiLiveviewRecorder_GetTimeMs();
+    while (writtenLen < recorder->batchLen) {
+        ret = write(recorder->fileFd, &recorder->batch[writtenLen], recorder->batchLen - writtenLen);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            __atomic_add_fetch(&recorder->statistics.writeErrorCount, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        writtenLen += ret;
+    }
+
+    costMs = DjiLiveviewRecorder_GetTimeMs() - startMs;
+    if (costMs > __atomic_load_n(&recorder->statistics.maxWriteTimeMs, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&recorder->statistics.maxWriteTimeMs, costMs, __ATOMIC_RELAXED);
+    }
+
+    recorder->batchLen = 0;
+    recorder->fileSize += writtenLen;
+    __atomic_add_fetch(&recorder->statistics.writtenBytes, writtenLen, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Flush the segment to the card and drop its pages from the page cache.
+ * @note Left alone, the kernel collects seconds of dirty pages and then flushes them in one go, stalling the writes
+ * of the next seconds. Syncing often keeps every flush short, and dropping the synced pages keeps the recording from
+ * pushing other data out of memory.
+ */
+static void DjiLiveviewRecorder_SyncSegment(T_DjiLiveviewRecorder *recorder)
+{
+    uint32_t startMs = DjiLiveviewRecorder_GetTimeMs();
+    uint32_t costMs;
+
+    if (fdatasync(recorder->fileFd) != 0) {
+        __atomic_add_fetch(&recorder->statistics.writeErrorCount, 1, __ATOMIC_RELAXED);
+    }
+    posix_fadvise(recorder->fileFd, 0, 0, POSIX_FADV_DONTNEED);
+
+    recorder->lastSyncMs = DjiLiveviewRecorder_GetTimeMs();
+    costMs = recorder->lastSyncMs - startMs;
+    if (costMs > __atomic_load_n(&recorder->statistics.maxSyncTimeMs, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&recorder->statistics.maxSyncTimeMs, costMs, __ATOMIC_RELAXED);
+    }
+}
+
+static T_DjiReturnCode DjiLiveviewRecorder_OpenNextSegment(T_DjiLiveviewRecorder *recorder)
+{
+    char filePath[DJI_LIVEVIEW_RECORDER_PATH_MAX_SIZE];
+    time_t currentTime = time(NULL);
+    struct tm localTime;
+    off_t preallocateSize;
+
+    if (localtime_r(&currentTime, &localTime) == NULL) {
+        USER_LOG_ERROR("Get local time error.");
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    snprintf(filePath, sizeof(filePath), "%s/%s_%04u_%04d%02d%02d_%02d-%02d-%02d.h264", recorder->folderPath,
+             recorder->filePrefix, recorder->fileIndex, localTime.tm_year + 1900, localTime.tm_mon + 1,
+             localTime.tm_mday, localTime.tm_hour, localTime.tm_min, localTime.tm_sec);
+
+    recorder->fileFd = open(filePath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (recorder->fileFd < 0) {
+        USER_LOG_ERROR("Open record file %s error, errno: %d.", filePath, errno);
+        __atomic_add_fetch(&recorder->statistics.writeErrorCount, 1, __ATOMIC_RELAXED);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    // Reserving the segment up front keeps the file in few extents and saves the allocation work on every write,
+    // file systems without fallocate support simply allocate on write as before
+    preallocateSize = recorder->segmentSize != 0 ? recorder->segmentSize : DJI_LIVEVIEW_RECORDER_PREALLOCATE_SIZE_DEFAULT;
+    fallocate(recorder->fileFd, FALLOC_FL_KEEP_SIZE, 0, preallocateSize);
+
+    recorder->fileIndex++;
+    recorder->fileSize = 0;
+    recorder->fileStartMs = DjiLiveviewRecorder_GetTimeMs();
+    recorder->lastSyncMs = recorder->fileStartMs;
+    __atomic_add_fetch(&recorder->statistics.segmentCount, 1, __ATOMIC_RELAXED);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void DjiLiveviewRecorder_CloseSegment(T_DjiLiveviewRecorder *recorder)
+{
+    if (recorder->fileFd < 0) {
+        return;
+    }
+
+    DjiLiveviewRecorder_WriteBatch(recorder);
+    DjiLiveviewRecorder_SyncSegment(recorder);
+
+    // Give back the reserved space the segment did not use
+    if (ftruncate(recorder->fileFd, (off_t) recorder->fileSize) != 0) {
+        __atomic_add_fetch(&recorder->statistics.writeErrorCount, 1, __ATOMIC_RELAXED);
+    }
+
+    close(recorder->fileFd);
+    recorder->fileFd = -1;
+}
+
+static uint32_t DjiLiveviewRecorder_GetTimeMs(void)
+{
+    T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
+    uint32_t timeMs = 0;
+
+    osalHandler->GetTimeMs(&timeMs);
+
+    return timeMs;
+}
+
+#endif
+
+/****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
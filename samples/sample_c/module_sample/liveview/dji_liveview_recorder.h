@@ -0,0 +1,112 @@
+/**
+ ********************************************************************
+ * @file    dji_liveview_recorder.h
+ * @brief   This is the header file for "dji_liveview_recorder.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef DJI_LIVEVIEW_RECORDER_H
+#define DJI_LIVEVIEW_RECORDER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef SYSTEM_ARCH_LINUX
+
+/* Exported constants --------------------------------------------------------*/
+//Size of the queue between the stream callback and the writer task, a power of two, unit: byte
+#define DJI_LIVEVIEW_RECORDER_QUEUE_SIZE_DEFAULT        (32 * 1024 * 1024)
+//Size of the blocks handed to a single write call, unit: byte
+#define DJI_LIVEVIEW_RECORDER_WRITE_SIZE                (1024 * 1024)
+//Interval between two fdatasync calls on the current segment, unit: ms
+#define DJI_LIVEVIEW_RECORDER_SYNC_INTERVAL_MS_DEFAULT  (1000)
+//Space reserved for a segment split by time only, unit: byte
+#define DJI_LIVEVIEW_RECORDER_PREALLOCATE_SIZE_DEFAULT  (64 * 1024 * 1024)
+
+/* Exported types ------------------------------------------------------------*/
+typedef void *T_DjiLiveviewRecorderHandle;
+
+typedef struct {
+    const char *folderPath;     /*!< Folder holding the segments, created when it does not exist. */
+    const char *filePrefix;     /*!< Segments are named <prefix>_<index>_<date>_<time>.h264 inside the folder. */
+    uint32_t segmentDurationMs; /*!< Length of a segment, 0 to not split by time. */
+    uint32_t segmentSize;       /*!< Size of a segment, 0 to not split by size, unit: byte. */
+    uint32_t queueSize;         /*!< 0 selects DJI_LIVEVIEW_RECORDER_QUEUE_SIZE_DEFAULT. */
+    uint32_t syncIntervalMs;    /*!< 0 selects DJI_LIVEVIEW_RECORDER_SYNC_INTERVAL_MS_DEFAULT. */
+} T_DjiLiveviewRecorderConfig;
+
+typedef struct {
+    uint64_t receivedBytes;
+    uint64_t writtenBytes;
+    uint64_t droppedBytes;      /*!< Dropped on a full queue, and after that until the next key frame. */
+    uint32_t droppedChunkCount;
+    uint32_t segmentCount;
+    uint32_t writeErrorCount;
+    uint32_t queueHighWater;    /*!< Highest fill level of the queue, unit: byte. */
+    uint32_t maxWriteTimeMs;
+    uint32_t maxSyncTimeMs;
+} T_DjiLiveviewRecorderStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Create a recorder writing a raw H264 stream into Annex-B segments from a writer task of its own.
+ * @note A segment only ends at a key frame, so every segment starts with SPS and IDR and plays on its own. A segment
+ * that reaches its time or size limit continues up to the next key frame.
+ * @param config: segment naming, split and queue settings.
+ * @param recorderHandle: created recorder.
+ * @return Execution result.
+ */
+T_DjiReturnCode DjiLiveviewRecorder_Create(const T_DjiLiveviewRecorderConfig *config,
+                                           T_DjiLiveviewRecorderHandle *recorderHandle);
+
+/**
+ * @brief Write out the queued stream data, close the current segment and free the recorder.
+ * @note Push must not be called any more once destroy has started.
+ */
+T_DjiReturnCode DjiLiveviewRecorder_Destroy(T_DjiLiveviewRecorderHandle recorderHandle);
+
+/**
+ * @brief Queue stream data from the liveview H264 callback.
+ * @note Never blocks and never touches the file. The data is dropped when the queue is full, and so is the data
+ * following it up to the next key frame, so a segment never holds a frame that misses its references. Only one
+ * thread may push to a recorder.
+ * @param buf: H264 stream data as received from DjiLiveview_StartH264Stream.
+ * @param len: length of the data.
+ * @return Execution result, DJI_ERROR_SYSTEM_MODULE_CODE_BUSY when the data was dropped.
+ */
+T_DjiReturnCode DjiLiveviewRecorder_Push(T_DjiLiveviewRecorderHandle recorderHandle, const uint8_t *buf, uint32_t len);
+
+T_DjiReturnCode DjiLiveviewRecorder_GetStatistics(T_DjiLiveviewRecorderHandle recorderHandle,
+                                                  T_DjiLiveviewRecorderStatistics *statistics);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DJI_LIVEVIEW_RECORDER_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
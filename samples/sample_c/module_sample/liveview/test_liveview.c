@@ -31,6 +31,7 @@
 #include "dji_platform.h"
 #include "dji_aircraft_info.h"
 #include "time.h"
+#include "dji_liveview_recorder.h"
 
 /* Private constants ---------------------------------------------------------*/
 #define TEST_LIVEVIEW_STREAM_FILE_PATH_STR_MAX_SIZE             256
@@ -39,25 +40,36 @@
 #define TEST_LIVEVIEW_STREAM_REQUEST_I_FRAME_ON                 1
 #define TEST_LIVEVIEW_STREAM_REQUEST_I_FRAME_TICK_IN_SECONDS    5
 
+#define TEST_LIVEVIEW_STREAM_RECORD_FOLDER                      "liveview_record"
+#define TEST_LIVEVIEW_STREAM_RECORD_SEGMENT_IN_SECONDS          10
+
 /* Private types -------------------------------------------------------------*/
+typedef struct {
+#ifdef SYSTEM_ARCH_LINUX
+    T_DjiLiveviewRecorderHandle recorder;
+#endif
+    char filePath[TEST_LIVEVIEW_STREAM_FILE_PATH_STR_MAX_SIZE];
+} T_DjiTestStreamRecord;
 
 /* Private values -------------------------------------------------------------*/
-static char s_fpvCameraStreamFilePath[TEST_LIVEVIEW_STREAM_FILE_PATH_STR_MAX_SIZE];
-static char s_payloadCameraStreamFilePath[TEST_LIVEVIEW_STREAM_FILE_PATH_STR_MAX_SIZE];
+static T_DjiTestStreamRecord s_fpvCameraStreamRecord;
+static T_DjiTestStreamRecord s_payloadCameraStreamRecord;
 
 /* Private functions declaration ---------------------------------------------*/
 static void DjiTest_FpvCameraStreamCallback(E_DjiLiveViewCameraPosition position, const uint8_t *buf,
                                             uint32_t bufLen);
 static void DjiTest_PayloadCameraStreamCallback(E_DjiLiveViewCameraPosition position, const uint8_t *buf,
                                                 uint32_t bufLen);
+static T_DjiReturnCode DjiTest_StartStreamRecord(T_DjiTestStreamRecord *record, const char *name);
+static void DjiTest_StopStreamRecord(T_DjiTestStreamRecord *record);
+static void DjiTest_WriteStreamRecord(T_DjiTestStreamRecord *record, const uint8_t *buf, uint32_t bufLen);
 
 /* Exported functions definition ---------------------------------------------*/
 T_DjiReturnCode DjiTest_LiveviewRunSample(E_DjiMountPosition mountPosition)
 {
     T_DjiReturnCode returnCode;
     T_DjiOsalHandler *osalHandler = DjiPlatform_GetOsalHandler();
-    time_t currentTime = time(NULL);
-    struct tm *localTime = NULL;
+    char streamName[TEST_LIVEVIEW_STREAM_FILE_PATH_STR_MAX_SIZE];
     T_DjiAircraftInfoBaseInfo aircraftInfoBaseInfo = {0};
 
     USER_LOG_INFO("Liveview sample start");
@@ -85,10 +97,10 @@ T_DjiReturnCode DjiTest_LiveviewRunSample(E_DjiMountPosition mountPosition)
         aircraftInfoBaseInfo.aircraftSeries == DJI_AIRCRAFT_SERIES_M30 ||
         aircraftInfoBaseInfo.aircraftSeries == DJI_AIRCRAFT_SERIES_M400) {
 
-        localTime = localtime(&currentTime);
-        sprintf(s_fpvCameraStreamFilePath, "fpv_stream_%04d%02d%02d_%02d-%02d-%02d.h264",
-                localTime->tm_year + 1900, localTime->tm_mon + 1, localTime->tm_mday,
-                localTime->tm_hour, localTime->tm_min, localTime->tm_sec);
+        returnCode = DjiTest_StartStreamRecord(&s_fpvCameraStreamRecord, "fpv_stream");
+        if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("Start record of fpv stream failed, error code: 0x%08X", returnCode);
+        }
 
         returnCode = DjiLiveview_StartH264Stream(DJI_LIVEVIEW_CAMERA_POSITION_FPV, DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT,
                                                  DjiTest_FpvCameraStreamCallback);
@@ -111,12 +123,14 @@ T_DjiReturnCode DjiTest_LiveviewRunSample(E_DjiMountPosition mountPosition)
             USER_LOG_ERROR("Request to stop h264 of fpv failed, error code: 0x%08X", returnCode);
             goto out;
         }
+        DjiTest_StopStreamRecord(&s_fpvCameraStreamRecord);
     }
 
-    localTime = localtime(&currentTime);
-    sprintf(s_payloadCameraStreamFilePath, "payload%d_default_stream_%04d%02d%02d_%02d-%02d-%02d.h264",
-            mountPosition, localTime->tm_year + 1900, localTime->tm_mon + 1, localTime->tm_mday,
-            localTime->tm_hour, localTime->tm_min, localTime->tm_sec);
+    snprintf(streamName, sizeof(streamName), "payload%d_default_stream", mountPosition);
+    returnCode = DjiTest_StartStreamRecord(&s_payloadCameraStreamRecord, streamName);
+    if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        USER_LOG_ERROR("Start record of payload %d stream failed, error code: 0x%08X", mountPosition, returnCode);
+    }
 
     returnCode = DjiLiveview_StartH264Stream((E_DjiLiveViewCameraPosition) mountPosition,
                                              DJI_LIVEVIEW_CAMERA_SOURCE_DEFAULT,
@@ -157,6 +171,7 @@ T_DjiReturnCode DjiTest_LiveviewRunSample(E_DjiMountPosition mountPosition)
             USER_LOG_ERROR("Request to stop h264 of fpv failed, error code: 0x%08X", returnCode);
             goto out;
         }
+        DjiTest_StopStreamRecord(&s_fpvCameraStreamRecord);
     }
 
     returnCode = DjiLiveview_StopH264Stream((E_DjiLiveViewCameraPosition) mountPosition,
@@ -165,6 +180,7 @@ T_DjiReturnCode DjiTest_LiveviewRunSample(E_DjiMountPosition mountPosition)
         USER_LOG_ERROR("Request to stop h264 of payload %d failed, error code: 0x%08X", mountPosition, returnCode);
         goto out;
     }
+    DjiTest_StopStreamRecord(&s_payloadCameraStreamRecord);
 
     if (DJI_AIRCRAFT_TYPE_M3T == aircraftInfoBaseInfo.aircraftType
         || DJI_AIRCRAFT_TYPE_M3TA == aircraftInfoBaseInfo.aircraftType
@@ -174,10 +190,12 @@ T_DjiReturnCode DjiTest_LiveviewRunSample(E_DjiMountPosition mountPosition)
     ) {
         USER_LOG_INFO("--> Start h264 stream of the fpv and selected payload\r\n");
 
-        localTime = localtime(&currentTime);
-        sprintf(s_payloadCameraStreamFilePath, "payload%d_ir_stream_%04d%02d%02d_%02d-%02d-%02d.h264",
-                mountPosition, localTime->tm_year + 1900, localTime->tm_mon + 1, localTime->tm_mday,
-                localTime->tm_hour, localTime->tm_min, localTime->tm_sec);
+        snprintf(streamName, sizeof(streamName), "payload%d_ir_stream", mountPosition);
+        returnCode = DjiTest_StartStreamRecord(&s_payloadCameraStreamRecord, streamName);
+        if (returnCode != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("Start record of payload %d stream failed, error code: 0x%08X", mountPosition,
+                           returnCode);
+        }
 
         returnCode = DjiLiveview_StartH264Stream((E_DjiLiveViewCameraPosition) mountPosition,
                                                  DJI_LIVEVIEW_CAMERA_SOURCE_M3T_IR,
@@ -197,10 +215,11 @@ T_DjiReturnCode DjiTest_LiveviewRunSample(E_DjiMountPosition mountPosition)
             USER_LOG_ERROR("Request to stop h264 of payload %d failed, error code: 0x%08X", mountPosition, returnCode);
             goto out;
         }
+        DjiTest_StopStreamRecord(&s_payloadCameraStreamRecord);
     }
 
-    USER_LOG_INFO("Fpv stream is saved to file: %s", s_fpvCameraStreamFilePath);
-    USER_LOG_INFO("Payload%d stream is saved to file: %s\r\n", mountPosition, s_payloadCameraStreamFilePath);
+    USER_LOG_INFO("Fpv stream is saved to file: %s", s_fpvCameraStreamRecord.filePath);
+    USER_LOG_INFO("Payload%d stream is saved to file: %s\r\n", mountPosition, s_payloadCameraStreamRecord.filePath);
 
     USER_LOG_INFO("--> Step 4: Deinit liveview module");
     DjiTest_WidgetLogAppend("--> Step 4: Deinit liveview module");
@@ -211,6 +230,9 @@ T_DjiReturnCode DjiTest_LiveviewRunSample(E_DjiMountPosition mountPosition)
     }
 
 out:
+    // records already stopped on the way here are skipped
+    DjiTest_StopStreamRecord(&s_fpvCameraStreamRecord);
+    DjiTest_StopStreamRecord(&s_payloadCameraStreamRecord);
     USER_LOG_INFO("Liveview sample end");
 
     return returnCode;
@@ -220,32 +242,77 @@ out:
 static void DjiTest_FpvCameraStreamCallback(E_DjiLiveViewCameraPosition position, const uint8_t *buf,
                                             uint32_t bufLen)
 {
-    FILE *fp = NULL;
-    size_t size;
+    DjiTest_WriteStreamRecord(&s_fpvCameraStreamRecord, buf, bufLen);
+}
 
-    fp = fopen(s_fpvCameraStreamFilePath, "ab+");
-    if (fp == NULL) {
-        printf("fopen failed!\n");
-        return;
-    }
+static void DjiTest_PayloadCameraStreamCallback(E_DjiLiveViewCameraPosition position, const uint8_t *buf,
+                                                uint32_t bufLen)
+{
+    DjiTest_WriteStreamRecord(&s_payloadCameraStreamRecord, buf, bufLen);
+}
 
-    size = fwrite(buf, 1, bufLen, fp);
-    if (size != bufLen) {
-        fclose(fp);
+#ifdef SYSTEM_ARCH_LINUX
+/**
+ * @brief Record a stream into segments written by a task of their own, so the stream callback never waits on the
+ * card.
+ */
+static T_DjiReturnCode DjiTest_StartStreamRecord(T_DjiTestStreamRecord *record, const char *name)
+{
+    T_DjiLiveviewRecorderConfig recorderConfig = {
+        .folderPath = TEST_LIVEVIEW_STREAM_RECORD_FOLDER,
+        .filePrefix = name,
+        .segmentDurationMs = TEST_LIVEVIEW_STREAM_RECORD_SEGMENT_IN_SECONDS * 1000,
+    };
+
+    snprintf(record->filePath, sizeof(record->filePath), "%s/%s_*.h264", TEST_LIVEVIEW_STREAM_RECORD_FOLDER, name);
+
+    return DjiLiveviewRecorder_Create(&recorderConfig, &record->recorder);
+}
+
+static void DjiTest_StopStreamRecord(T_DjiTestStreamRecord *record)
+{
+    T_DjiLiveviewRecorderStatistics statistics = {0};
+
+    if (record->recorder == NULL) {
         return;
     }
 
-    fflush(fp);
-    fclose(fp);
+    DjiLiveviewRecorder_GetStatistics(record->recorder, &statistics);
+    USER_LOG_INFO("Stream record %s: received %llu bytes, dropped %llu bytes, max write %u ms, max sync %u ms.",
+                  record->filePath, statistics.receivedBytes, statistics.droppedBytes, statistics.maxWriteTimeMs,
+                  statistics.maxSyncTimeMs);
+
+    DjiLiveviewRecorder_Destroy(record->recorder);
+    record->recorder = NULL;
 }
 
-static void DjiTest_PayloadCameraStreamCallback(E_DjiLiveViewCameraPosition position, const uint8_t *buf,
-                                                uint32_t bufLen)
+static void DjiTest_WriteStreamRecord(T_DjiTestStreamRecord *record, const uint8_t *buf, uint32_t bufLen)
+{
+    DjiLiveviewRecorder_Push(record->recorder, buf, bufLen);
+}
+#else
+static T_DjiReturnCode DjiTest_StartStreamRecord(T_DjiTestStreamRecord *record, const char *name)
+{
+    time_t currentTime = time(NULL);
+    struct tm *localTime = localtime(&currentTime);
+
+    sprintf(record->filePath, "%s_%04d%02d%02d_%02d-%02d-%02d.h264", name,
+            localTime->tm_year + 1900, localTime->tm_mon + 1, localTime->tm_mday,
+            localTime->tm_hour, localTime->tm_min, localTime->tm_sec);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+static void DjiTest_StopStreamRecord(T_DjiTestStreamRecord *record)
+{
+}
+
+static void DjiTest_WriteStreamRecord(T_DjiTestStreamRecord *record, const uint8_t *buf, uint32_t bufLen)
 {
     FILE *fp = NULL;
     size_t size;
 
-    fp = fopen(s_payloadCameraStreamFilePath, "ab+");
+    fp = fopen(record->filePath, "ab+");
     if (fp == NULL) {
         printf("fopen failed!\n");
         return;
@@ -260,5 +327,6 @@ static void DjiTest_PayloadCameraStreamCallback(E_DjiLiveViewCameraPosition posi
     fflush(fp);
     fclose(fp);
 }
+#endif
 
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
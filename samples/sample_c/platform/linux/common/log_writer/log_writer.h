@@ -0,0 +1,96 @@
+/**
+ ********************************************************************
+ * @file    log_writer.h
+ * @brief   This is the header file for "log_writer.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "dji_typedef.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+//Size of the queue feeding the writer task, a power of two not below the batch size, unit: byte
+#define LOG_WRITER_QUEUE_SIZE_DEFAULT           (1024 * 1024)
+//Size of the batch handed to a single write call, unit: byte
+#define LOG_WRITER_BATCH_SIZE                   (64 * 1024)
+//Longest time a message waits in the queue before it is written, unit: ms
+#define LOG_WRITER_FLUSH_INTERVAL_MS_DEFAULT    (100)
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct {
+    const char *folderPath;     /*!< Folder holding the log files, created when it does not exist. */
+    const char *filePrefix;     /*!< Files are named <prefix>_<index>_<date>_<time>.log inside the folder. */
+    uint32_t maxFileCount;      /*!< Number of log files kept, older files are removed. */
+    uint32_t maxFileSize;       /*!< Size at which the writer moves on to a new file, 0 to never rotate, unit: byte. */
+    uint32_t queueSize;         /*!< 0 selects LOG_WRITER_QUEUE_SIZE_DEFAULT. */
+    uint32_t flushIntervalMs;   /*!< 0 selects LOG_WRITER_FLUSH_INTERVAL_MS_DEFAULT. */
+} T_LogWriterConfig;
+
+typedef struct {
+    uint64_t writtenBytes;
+    uint64_t droppedBytes;
+    uint32_t droppedCount;      /*!< Messages dropped because the queue was full. */
+    uint32_t rotatedCount;
+    uint32_t writeErrorCount;
+} T_LogWriterStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+/**
+ * @brief Open the first log file and start the task writing queued messages to it.
+ * @note The writer also installs handlers for fatal signals that write out whatever is still queued before the
+ * default action runs, and an exit handler doing the same on a normal exit.
+ * @param config: log file naming, rotation and queue settings.
+ * @return Execution result.
+ */
+T_DjiReturnCode LogWriter_Init(const T_LogWriterConfig *config);
+
+/**
+ * @brief Write out the queued messages, stop the writer task and close the log file.
+ * @return Execution result.
+ */
+T_DjiReturnCode LogWriter_DeInit(void);
+
+/**
+ * @brief Queue a message for the writer task, matching the func of T_DjiLoggerConsole.
+ * @note Never blocks and can be called from any number of threads at once. The message is dropped and counted when
+ * the queue is full.
+ * @param data: message to write.
+ * @param dataLen: length of the message.
+ * @return Execution result.
+ */
+T_DjiReturnCode LogWriter_Write(const uint8_t *data, uint16_t dataLen);
+
+T_DjiReturnCode LogWriter_GetStatistics(T_LogWriterStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_WRITER_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
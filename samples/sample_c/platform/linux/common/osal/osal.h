@@ -41,6 +41,12 @@ extern "C" {
 #endif
 
 /* Exported constants --------------------------------------------------------*/
+//Scheduling policy, priority, cpu affinity and stack size per task name, see Osal_TaskLoadAttributes in osal.c
+#define OSAL_TASK_ATTRIBUTE_FILE_PATH       "osal_task_attribute.conf"
+//Smallest stack given to a task unless the attribute file sets one
+#define OSAL_TASK_STACK_SIZE_MIN            (1024 * 1024)
+//Time a task gets to end after Osal_TaskDestroy before it is cancelled, unit: ms
+#define OSAL_TASK_STOP_TIMEOUT_MS           (200)
 
 /* Exported types ------------------------------------------------------------*/
 
@@ -49,6 +55,7 @@ T_DjiReturnCode Osal_TaskCreate(const char *name, void *(*taskFunc)(void *),
                                 uint32_t stackSize, void *arg, T_DjiTaskHandle *task);
 T_DjiReturnCode Osal_TaskDestroy(T_DjiTaskHandle task);
 T_DjiReturnCode Osal_TaskSleepMs(uint32_t timeMs);
+bool Osal_TaskShouldStop(void);
 
 T_DjiReturnCode Osal_MutexCreate(T_DjiMutexHandle *mutex);
 T_DjiReturnCode Osal_MutexDestroy(T_DjiMutexHandle mutex);
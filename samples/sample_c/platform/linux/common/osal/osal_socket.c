@@ -25,22 +25,54 @@
 /* Includes ------------------------------------------------------------------*/
 #include "osal_socket.h"
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
 #include "stdlib.h"
 
 /* Private constants ---------------------------------------------------------*/
-#define SOCKET_RECV_BUF_MAX_SIZE    (1000 * 1000 * 10)
+#define SOCKET_RECV_BUF_MAX_SIZE            (1000 * 1000 * 10)
+#define SOCKET_NET_CORE_RMEM_DEFAULT        (20000000)
+#define SOCKET_NET_CORE_RMEM_MAX            (50000000)
+#define SOCKET_UDP_DATAGRAM_MAX_SIZE        (65536)
+#define SOCKET_UDP_RECV_CACHE_NUM           (8)
+#define SOCKET_UDP_CONTROL_BUF_SIZE         (CMSG_SPACE(sizeof(struct timespec)))
 
 /* Private types -------------------------------------------------------------*/
+typedef struct {
+    uint8_t *buf;
+    struct mmsghdr msgs[SOCKET_UDP_RECV_CACHE_NUM];
+    struct iovec iovs[SOCKET_UDP_RECV_CACHE_NUM];
+    struct sockaddr_in addrs[SOCKET_UDP_RECV_CACHE_NUM];
+    uint32_t count;
+    uint32_t index;
+} T_SocketUdpRecvCache;
+
 typedef struct {
     int socketFd;
+    int epollFd;
+    pthread_mutex_t recvMutex;
+    T_SocketUdpRecvCache *recvCache;
 } T_SocketHandleStruct;
 
 /* Private values -------------------------------------------------------------*/
+static pthread_once_t s_socketKernelBufTuneOnce = PTHREAD_ONCE_INIT;
 
 /* Private functions declaration ---------------------------------------------*/
+static void Osal_SocketTuneKernelBuf(void);
+static void Osal_SocketRaiseSysctl(const char *path, long value);
+static void Osal_SocketSetUdpOptions(int socketFd);
+static void Osal_SocketParseAddr(const struct sockaddr_in *addr, char *ipAddr, uint32_t ipAddrSize,
+                                 uint32_t *port);
+static uint32_t Osal_SocketTakeCachedDatagrams(T_SocketUdpRecvCache *recvCache, T_OsalUdpDatagram *datagrams,
+                                               uint32_t count);
+static uint64_t Osal_SocketGetTimestampNs(struct msghdr *msg);
 
 /* Exported functions definition ---------------------------------------------*/
 T_DjiReturnCode Osal_Socket(E_DjiSocketMode mode, T_DjiSocketHandle *socketHandle)
@@ -49,22 +81,24 @@ T_DjiReturnCode Osal_Socket(E_DjiSocketMode mode, T_DjiSocketHandle *socketHandl
     socklen_t optlen = sizeof (int);
     int rcvBufSize = SOCKET_RECV_BUF_MAX_SIZE;
     int opt = 1;
-
-    /*! set the socket default read buffer to 20MByte */
-    system("echo 20000000 > /proc/sys/net/core/rmem_default");
-
-    /*! set the socket max read buffer to 50MByte */
-    system("echo 50000000 > /proc/sys/net/core/rmem_max");
+    struct epoll_event event = {0};
 
     if (socketHandle == NULL) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
+    /*! raise the socket default and max read buffer once per process, before SO_RCVBUF below */
+    pthread_once(&s_socketKernelBufTuneOnce, Osal_SocketTuneKernelBuf);
+
     socketHandleStruct = malloc(sizeof(T_SocketHandleStruct));
     if (socketHandleStruct == NULL) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
     }
 
+    socketHandleStruct->epollFd = -1;
+    socketHandleStruct->recvCache = NULL;
+    pthread_mutex_init(&socketHandleStruct->recvMutex, NULL);
+
     if (mode == DJI_SOCKET_MODE_UDP) {
         socketHandleStruct->socketFd = socket(PF_INET, SOCK_DGRAM, 0);
 
@@ -76,6 +110,19 @@ T_DjiReturnCode Osal_Socket(E_DjiSocketMode mode, T_DjiSocketHandle *socketHandl
         {
             goto out;
         }
+
+        Osal_SocketSetUdpOptions(socketHandleStruct->socketFd);
+
+        socketHandleStruct->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (socketHandleStruct->epollFd < 0) {
+            goto out;
+        }
+
+        event.events = EPOLLIN;
+        event.data.fd = socketHandleStruct->socketFd;
+        if (epoll_ctl(socketHandleStruct->epollFd, EPOLL_CTL_ADD, socketHandleStruct->socketFd, &event) < 0) {
+            goto out;
+        }
     } else if (mode == DJI_SOCKET_MODE_TCP) {
         socketHandleStruct->socketFd = socket(PF_INET, SOCK_STREAM, 0);
     } else {
@@ -87,7 +134,11 @@ T_DjiReturnCode Osal_Socket(E_DjiSocketMode mode, T_DjiSocketHandle *socketHandl
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 
 out:
+    if (socketHandleStruct->epollFd >= 0) {
+        close(socketHandleStruct->epollFd);
+    }
     close(socketHandleStruct->socketFd);
+    pthread_mutex_destroy(&socketHandleStruct->recvMutex);
     free(socketHandleStruct);
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
@@ -107,6 +158,14 @@ T_DjiReturnCode Osal_Close(T_DjiSocketHandle socketHandle)
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    if (socketHandleStruct->epollFd >= 0) {
+        close(socketHandleStruct->epollFd);
+    }
+    if (socketHandleStruct->recvCache != NULL) {
+        free(socketHandleStruct->recvCache->buf);
+        free(socketHandleStruct->recvCache);
+    }
+    pthread_mutex_destroy(&socketHandleStruct->recvMutex);
     free(socketHandle);
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
@@ -164,22 +223,208 @@ T_DjiReturnCode Osal_UdpSendData(T_DjiSocketHandle socketHandle, const char *ipA
 T_DjiReturnCode Osal_UdpRecvData(T_DjiSocketHandle socketHandle, char *ipAddr, uint32_t *port,
                                  uint8_t *buf, uint32_t len, uint32_t *realLen)
 {
-    struct sockaddr_in addr;
     T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
-    uint32_t addrLen = 0;
+    T_SocketUdpRecvCache *recvCache;
+    uint32_t i;
     int32_t ret;
 
-    if (socketHandle == NULL || ipAddr == NULL || port == 0 || buf == NULL || len == 0 || realLen == NULL) {
+    struct epoll_event event;
+
+    if (socketHandle == NULL || ipAddr == NULL || port == 0 || buf == NULL || len == 0 || realLen == NULL ||
+        socketHandleStruct->epollFd < 0) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
-    ret = recvfrom(socketHandleStruct->socketFd, buf, len, 0, (struct sockaddr *) &addr, &addrLen);
-    if (ret >= 0) {
-        *realLen = ret;
-    } else {
+    pthread_mutex_lock(&socketHandleStruct->recvMutex);
+
+    if (socketHandleStruct->recvCache == NULL) {
+        recvCache = calloc(1, sizeof(T_SocketUdpRecvCache));
+        if (recvCache == NULL) {
+            pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+            return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        }
+        recvCache->buf = malloc((SOCKET_UDP_RECV_CACHE_NUM - 1) * SOCKET_UDP_DATAGRAM_MAX_SIZE);
+        if (recvCache->buf == NULL) {
+            free(recvCache);
+            pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+            return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+        }
+        socketHandleStruct->recvCache = recvCache;
+    }
+    recvCache = socketHandleStruct->recvCache;
+
+    /*! the lock is only held while taking datagrams, never while waiting for the socket to become readable */
+    for (;;) {
+        if (recvCache->index < recvCache->count) {
+            i = recvCache->index++;
+            *realLen = recvCache->msgs[i].msg_len < len ? recvCache->msgs[i].msg_len : len;
+            memcpy(buf, recvCache->iovs[i].iov_base, *realLen);
+            Osal_SocketParseAddr(&recvCache->addrs[i], ipAddr, INET_ADDRSTRLEN, port);
+            pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+            return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+        }
+
+        /*! the first datagram lands in the caller buffer, the ones queued behind it are kept for the next calls */
+        for (i = 0; i < SOCKET_UDP_RECV_CACHE_NUM; i++) {
+            recvCache->iovs[i].iov_base = i == 0 ? buf : recvCache->buf + (i - 1) * SOCKET_UDP_DATAGRAM_MAX_SIZE;
+            recvCache->iovs[i].iov_len = i == 0 ? len : SOCKET_UDP_DATAGRAM_MAX_SIZE;
+            memset(&recvCache->msgs[i], 0, sizeof(struct mmsghdr));
+            recvCache->msgs[i].msg_hdr.msg_name = &recvCache->addrs[i];
+            recvCache->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+            recvCache->msgs[i].msg_hdr.msg_iov = &recvCache->iovs[i];
+            recvCache->msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        ret = recvmmsg(socketHandleStruct->socketFd, recvCache->msgs, SOCKET_UDP_RECV_CACHE_NUM, MSG_DONTWAIT,
+                       NULL);
+        if (ret >= 0) {
+            break;
+        }
+
+        recvCache->count = 0;
+        recvCache->index = 0;
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+
+        pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+        ret = epoll_wait(socketHandleStruct->epollFd, &event, 1, -1);
+        if (ret < 0 && errno != EINTR) {
+            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+        pthread_mutex_lock(&socketHandleStruct->recvMutex);
+    }
+
+    recvCache->count = ret;
+    recvCache->index = 1;
+    *realLen = recvCache->msgs[0].msg_len;
+    Osal_SocketParseAddr(&recvCache->addrs[0], ipAddr, INET_ADDRSTRLEN, port);
+
+    pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode Osal_UdpSendBatch(T_DjiSocketHandle socketHandle, const T_OsalUdpDatagram *datagrams,
+                                  uint32_t count, uint32_t *sentCount)
+{
+    T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
+    struct mmsghdr msgs[OSAL_SOCKET_UDP_BATCH_MAX_NUM];
+    struct iovec iovs[OSAL_SOCKET_UDP_BATCH_MAX_NUM];
+    struct sockaddr_in addrs[OSAL_SOCKET_UDP_BATCH_MAX_NUM];
+    uint32_t sent = 0;
+    uint32_t i;
+    int32_t ret;
+
+    if (socketHandle == NULL || datagrams == NULL || count == 0 || count > OSAL_SOCKET_UDP_BATCH_MAX_NUM ||
+        sentCount == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    memset(msgs, 0, sizeof(struct mmsghdr) * count);
+    for (i = 0; i < count; i++) {
+        bzero(&addrs[i], sizeof(struct sockaddr_in));
+        addrs[i].sin_family = AF_INET;
+        addrs[i].sin_port = htons(datagrams[i].port);
+        addrs[i].sin_addr.s_addr = inet_addr(datagrams[i].ipAddr);
+
+        iovs[i].iov_base = datagrams[i].buf;
+        iovs[i].iov_len = datagrams[i].len;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (sent < count) {
+        ret = sendmmsg(socketHandleStruct->socketFd, &msgs[sent], count - sent, 0);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        sent += ret;
+    }
+
+    *sentCount = sent;
+    if (sent != count) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+}
+
+T_DjiReturnCode Osal_UdpRecvBatch(T_DjiSocketHandle socketHandle, T_OsalUdpDatagram *datagrams,
+                                  uint32_t count, uint32_t timeoutMs, uint32_t *recvCount)
+{
+    T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
+    struct mmsghdr msgs[OSAL_SOCKET_UDP_BATCH_MAX_NUM];
+    struct iovec iovs[OSAL_SOCKET_UDP_BATCH_MAX_NUM];
+    struct sockaddr_in addrs[OSAL_SOCKET_UDP_BATCH_MAX_NUM];
+    uint8_t controls[OSAL_SOCKET_UDP_BATCH_MAX_NUM][SOCKET_UDP_CONTROL_BUF_SIZE];
+    struct epoll_event event;
+    uint32_t i;
+    int32_t ret;
+
+    if (socketHandle == NULL || datagrams == NULL || count == 0 || count > OSAL_SOCKET_UDP_BATCH_MAX_NUM ||
+        recvCount == NULL || socketHandleStruct->epollFd < 0) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
+    }
+
+    /*! datagrams already taken from the kernel by Osal_UdpRecvData are handed out first */
+    pthread_mutex_lock(&socketHandleStruct->recvMutex);
+    *recvCount = Osal_SocketTakeCachedDatagrams(socketHandleStruct->recvCache, datagrams, count);
+    pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+    if (*recvCount > 0) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    /*! wait without the lock, so a receiver waiting here never holds up the others */
+    ret = epoll_wait(socketHandleStruct->epollFd, &event, 1, (int) timeoutMs);
+    if (ret <= 0) {
+        if (ret < 0 && errno != EINTR) {
+            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+        }
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    pthread_mutex_lock(&socketHandleStruct->recvMutex);
+    *recvCount = Osal_SocketTakeCachedDatagrams(socketHandleStruct->recvCache, datagrams, count);
+    if (*recvCount > 0) {
+        pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    memset(msgs, 0, sizeof(struct mmsghdr) * count);
+    for (i = 0; i < count; i++) {
+        iovs[i].iov_base = datagrams[i].buf;
+        iovs[i].iov_len = datagrams[i].len;
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = controls[i];
+        msgs[i].msg_hdr.msg_controllen = SOCKET_UDP_CONTROL_BUF_SIZE;
+    }
+
+    ret = recvmmsg(socketHandleStruct->socketFd, msgs, count, MSG_DONTWAIT, NULL);
+    pthread_mutex_unlock(&socketHandleStruct->recvMutex);
+    if (ret < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+        }
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
+    for (i = 0; i < (uint32_t) ret; i++) {
+        datagrams[i].realLen = msgs[i].msg_len;
+        Osal_SocketParseAddr(&addrs[i], datagrams[i].ipAddr, sizeof(datagrams[i].ipAddr), &datagrams[i].port);
+        datagrams[i].timestampNs = Osal_SocketGetTimestampNs(&msgs[i].msg_hdr);
+    }
+    *recvCount = ret;
+
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
 }
 
@@ -206,7 +451,7 @@ T_DjiReturnCode Osal_TcpAccept(T_DjiSocketHandle socketHandle, char *ipAddr, uin
     T_SocketHandleStruct *socketHandleStruct = (T_SocketHandleStruct *) socketHandle;
     T_SocketHandleStruct *outSocketHandleStruct;
     struct sockaddr_in addr;
-    uint32_t addrLen = 0;
+    socklen_t addrLen = sizeof(addr);
 
     if (socketHandle == NULL || ipAddr == NULL) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
@@ -223,7 +468,11 @@ T_DjiReturnCode Osal_TcpAccept(T_DjiSocketHandle socketHandle, char *ipAddr, uin
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
-    *port = ntohs(addr.sin_port);
+    outSocketHandleStruct->epollFd = -1;
+    outSocketHandleStruct->recvCache = NULL;
+    pthread_mutex_init(&outSocketHandleStruct->recvMutex, NULL);
+
+    Osal_SocketParseAddr(&addr, ipAddr, INET_ADDRSTRLEN, port);
     *outSocketHandle = outSocketHandleStruct;
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
@@ -293,5 +542,100 @@ T_DjiReturnCode Osal_TcpRecvData(T_DjiSocketHandle socketHandle,
 }
 
 /* Private functions definition-----------------------------------------------*/
+static void Osal_SocketTuneKernelBuf(void)
+{
+    Osal_SocketRaiseSysctl("/proc/sys/net/core/rmem_default", SOCKET_NET_CORE_RMEM_DEFAULT);
+    Osal_SocketRaiseSysctl("/proc/sys/net/core/rmem_max", SOCKET_NET_CORE_RMEM_MAX);
+}
+
+static void Osal_SocketRaiseSysctl(const char *path, long value)
+{
+    FILE *fp;
+    long currentValue = 0;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        return;
+    }
+    if (fscanf(fp, "%ld", &currentValue) != 1) {
+        currentValue = 0;
+    }
+    fclose(fp);
+
+    /*! never lower a limit the system has already set higher */
+    if (currentValue >= value) {
+        return;
+    }
+
+    /*! writing needs root, without it the sockets keep the system limits */
+    fp = fopen(path, "w");
+    if (fp == NULL) {
+        return;
+    }
+    fprintf(fp, "%ld\n", value);
+    fclose(fp);
+}
+
+static void Osal_SocketSetUdpOptions(int socketFd)
+{
+    int busyPollUs = OSAL_SOCKET_UDP_BUSY_POLL_US;
+    int isTimestampEnable = OSAL_SOCKET_UDP_RX_TIMESTAMP_ENABLE;
+
+    /*! both options are optional, the socket works the same when the kernel refuses them */
+    if (busyPollUs > 0) {
+        (void) setsockopt(socketFd, SOL_SOCKET, SO_BUSY_POLL, &busyPollUs, sizeof(busyPollUs));
+    }
+
+    if (isTimestampEnable != 0) {
+        (void) setsockopt(socketFd, SOL_SOCKET, SO_TIMESTAMPNS, &isTimestampEnable, sizeof(isTimestampEnable));
+    }
+}
+
+static void Osal_SocketParseAddr(const struct sockaddr_in *addr, char *ipAddr, uint32_t ipAddrSize,
+                                 uint32_t *port)
+{
+    if (ipAddr != NULL && inet_ntop(AF_INET, &addr->sin_addr, ipAddr, ipAddrSize) == NULL) {
+        ipAddr[0] = '\0';
+    }
+
+    if (port != NULL) {
+        *port = ntohs(addr->sin_port);
+    }
+}
+
+static uint32_t Osal_SocketTakeCachedDatagrams(T_SocketUdpRecvCache *recvCache, T_OsalUdpDatagram *datagrams,
+                                               uint32_t count)
+{
+    uint32_t takenCount = 0;
+    uint32_t i;
+
+    while (recvCache != NULL && recvCache->index < recvCache->count && takenCount < count) {
+        i = recvCache->index++;
+        datagrams[takenCount].realLen = recvCache->msgs[i].msg_len < datagrams[takenCount].len ?
+                                        recvCache->msgs[i].msg_len : datagrams[takenCount].len;
+        memcpy(datagrams[takenCount].buf, recvCache->iovs[i].iov_base, datagrams[takenCount].realLen);
+        Osal_SocketParseAddr(&recvCache->addrs[i], datagrams[takenCount].ipAddr,
+                             sizeof(datagrams[takenCount].ipAddr), &datagrams[takenCount].port);
+        datagrams[takenCount].timestampNs = 0;
+        takenCount++;
+    }
+
+    return takenCount;
+}
+
+static uint64_t Osal_SocketGetTimestampNs(struct msghdr *msg)
+{
+    struct cmsghdr *cmsg;
+    struct timespec timestamp;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(&timestamp, CMSG_DATA(cmsg), sizeof(timestamp));
+            return (uint64_t) timestamp.tv_sec * 1000000000ULL + (uint64_t) timestamp.tv_nsec;
+        }
+    }
+
+    return 0;
+}
 
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
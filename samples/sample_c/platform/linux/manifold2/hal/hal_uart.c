@@ -24,21 +24,45 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <dji_logger.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
 #include "hal_uart.h"
 
 /* Private constants ---------------------------------------------------------*/
 #define UART_DEV_NAME_STR_SIZE             (128)
 #define DJI_SYSTEM_CMD_STR_MAX_SIZE        (64)
 #define DJI_SYSTEM_RESULT_STR_MAX_SIZE     (128)
+#define UART_RX_EPOLL_EVENT_MAX_NUM        (2)
+#define UART_RX_RING_FULL_WAIT_MS          (1)
 
 /* Private types -------------------------------------------------------------*/
 typedef struct {
     int32_t uartFd;
+    int32_t epollFd;
+    int32_t stopEventFd;
+    int32_t rxEventFd;
+    pthread_t rxThread;
+    bool isRxTaskFailed;
+    uint8_t *rxRing;
+    uint32_t rxRingHead;
+    uint32_t rxRingTail;
+    uint32_t rxRingFullCount;
 } T_UartHandleStruct;
 
 /* Private values -------------------------------------------------------------*/
 
 /* Private functions declaration ---------------------------------------------*/
+static void HalUart_SetLowLatency(int32_t uartFd);
+static T_DjiReturnCode HalUart_StartRxTask(T_UartHandleStruct *uartHandleStruct);
+static void HalUart_StopRxTask(T_UartHandleStruct *uartHandleStruct);
+static void *HalUart_RxTask(void *arg);
+static int32_t HalUart_DrainToRxRing(T_UartHandleStruct *uartHandleStruct);
+static uint32_t HalUart_PopRxRing(T_UartHandleStruct *uartHandleStruct, uint8_t *buf, uint32_t len);
 
 /* Exported functions definition ---------------------------------------------*/
 T_DjiReturnCode HalUart_Init(E_DjiHalUartNum uartNum, uint32_t baudRate, T_DjiUartHandle *uartHandle)
@@ -144,6 +168,34 @@ T_DjiReturnCode HalUart_Init(E_DjiHalUartNum uartNum, uint32_t baudRate, T_DjiUa
             cfsetispeed(&options, B1000000);
             cfsetospeed(&options, B1000000);
             break;
+        case 1152000:
+            cfsetispeed(&options, B1152000);
+            cfsetospeed(&options, B1152000);
+            break;
+        case 1500000:
+            cfsetispeed(&options, B1500000);
+            cfsetospeed(&options, B1500000);
+            break;
+        case 2000000:
+            cfsetispeed(&options, B2000000);
+            cfsetospeed(&options, B2000000);
+            break;
+        case 2500000:
+            cfsetispeed(&options, B2500000);
+            cfsetospeed(&options, B2500000);
+            break;
+        case 3000000:
+            cfsetispeed(&options, B3000000);
+            cfsetospeed(&options, B3000000);
+            break;
+        case 3500000:
+            cfsetispeed(&options, B3500000);
+            cfsetospeed(&options, B3500000);
+            break;
+        case 4000000:
+            cfsetispeed(&options, B4000000);
+            cfsetospeed(&options, B4000000);
+            break;
         default:
             goto close_uart_fd;
     }
@@ -168,6 +220,12 @@ T_DjiReturnCode HalUart_Init(E_DjiHalUartNum uartNum, uint32_t baudRate, T_DjiUa
         goto close_uart_fd;
     }
 
+    HalUart_SetLowLatency(uartHandleStruct->uartFd);
+
+    if (HalUart_StartRxTask(uartHandleStruct) != DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+        goto close_uart_fd;
+    }
+
     *uartHandle = uartHandleStruct;
     pclose(fp);
 
@@ -194,6 +252,8 @@ T_DjiReturnCode HalUart_DeInit(T_DjiUartHandle uartHandle)
         return DJI_ERROR_SYSTEM_MODULE_CODE_UNKNOWN;
     }
 
+    HalUart_StopRxTask(uartHandleStruct);
+
     ret = close(uartHandleStruct->uartFd);
     if (ret < 0) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
@@ -226,16 +286,34 @@ T_DjiReturnCode HalUart_WriteData(T_DjiUartHandle uartHandle, const uint8_t *buf
 T_DjiReturnCode HalUart_ReadData(T_DjiUartHandle uartHandle, uint8_t *buf, uint32_t len, uint32_t *realLen)
 {
     int32_t ret;
+    uint64_t eventCount;
+    struct pollfd pollFd;
     T_UartHandleStruct *uartHandleStruct = (T_UartHandleStruct *) uartHandle;
 
     if (uartHandle == NULL || buf == NULL || len == 0 || realLen == NULL) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_INVALID_PARAMETER;
     }
 
-    ret = read(uartHandleStruct->uartFd, buf, len);
-    if (ret >= 0) {
-        *realLen = ret;
-    } else {
+    *realLen = HalUart_PopRxRing(uartHandleStruct, buf, len);
+    if (*realLen > 0) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    }
+
+    // The receive task raises the event after every push, so data arriving after the ring was found empty
+    // still ends the wait below.
+    pollFd.fd = uartHandleStruct->rxEventFd;
+    pollFd.events = POLLIN;
+    pollFd.revents = 0;
+    ret = poll(&pollFd, 1, LINUX_UART_READ_TIMEOUT_MS);
+    if (ret < 0 && errno != EINTR) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+    }
+    if (ret > 0) {
+        ret = read(uartHandleStruct->rxEventFd, &eventCount, sizeof(eventCount));
+    }
+
+    *realLen = HalUart_PopRxRing(uartHandleStruct, buf, len);
+    if (*realLen == 0 && __atomic_load_n(&uartHandleStruct->isRxTaskFailed, __ATOMIC_ACQUIRE) == true) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
@@ -256,5 +334,247 @@ T_DjiReturnCode HalUart_GetStatus(E_DjiHalUartNum uartNum, T_DjiUartStatus *stat
 }
 
 /* Private functions definition-----------------------------------------------*/
+static void HalUart_SetLowLatency(int32_t uartFd)
+{
+    struct serial_struct serial;
+
+    // Drivers supporting the flag push received bytes to the tty right away instead of batching them on a timer.
+    if (ioctl(uartFd, TIOCGSERIAL, &serial) < 0) {
+        USER_LOG_DEBUG("Uart driver does not support low latency mode, errno = %d", errno);
+        return;
+    }
+
+    serial.flags |= ASYNC_LOW_LATENCY;
+    if (ioctl(uartFd, TIOCSSERIAL, &serial) < 0) {
+        USER_LOG_WARN("Set uart low latency mode failed, errno = %d", errno);
+    }
+}
+
+static T_DjiReturnCode HalUart_StartRxTask(T_UartHandleStruct *uartHandleStruct)
+{
+    struct epoll_event event = {0};
+
+    uartHandleStruct->isRxTaskFailed = false;
+    uartHandleStruct->rxRingHead = 0;
+    uartHandleStruct->rxRingTail = 0;
+    uartHandleStruct->rxRingFullCount = 0;
+    uartHandleStruct->epollFd = -1;
+    uartHandleStruct->stopEventFd = -1;
+    uartHandleStruct->rxEventFd = -1;
+
+    uartHandleStruct->rxRing = malloc(LINUX_UART_RX_RING_SIZE);
+    if (uartHandleStruct->rxRing == NULL) {
+        return DJI_ERROR_SYSTEM_MODULE_CODE_MEMORY_ALLOC_FAILED;
+    }
+
+    uartHandleStruct->epollFd = epoll_create1(EPOLL_CLOEXEC);
+    uartHandleStruct->stopEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    uartHandleStruct->rxEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (uartHandleStruct->epollFd < 0 || uartHandleStruct->stopEventFd < 0 || uartHandleStruct->rxEventFd < 0) {
+        USER_LOG_ERROR("Create uart event descriptors failed, errno = %d", errno);
+        goto close_fds;
+    }
+
+    event.events = EPOLLIN;
+    event.data.fd = uartHandleStruct->uartFd;
+    if (epoll_ctl(uartHandleStruct->epollFd, EPOLL_CTL_ADD, uartHandleStruct->uartFd, &event) < 0) {
+        USER_LOG_ERROR("Add uart to epoll failed, errno = %d", errno);
+        goto close_fds;
+    }
+
+    event.events = EPOLLIN;
+    event.data.fd = uartHandleStruct->stopEventFd;
+    if (epoll_ctl(uartHandleStruct->epollFd, EPOLL_CTL_ADD, uartHandleStruct->stopEventFd, &event) < 0) {
+        USER_LOG_ERROR("Add uart stop event to epoll failed, errno = %d", errno);
+        goto close_fds;
+    }
+
+    if (pthread_create(&uartHandleStruct->rxThread, NULL, HalUart_RxTask, uartHandleStruct) != 0) {
+        USER_LOG_ERROR("Create uart receive task failed.");
+        goto close_fds;
+    }
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+close_fds:
+    if (uartHandleStruct->epollFd >= 0) {
+        close(uartHandleStruct->epollFd);
+    }
+    if (uartHandleStruct->stopEventFd >= 0) {
+        close(uartHandleStruct->stopEventFd);
+    }
+    if (uartHandleStruct->rxEventFd >= 0) {
+        close(uartHandleStruct->rxEventFd);
+    }
+    free(uartHandleStruct->rxRing);
+    uartHandleStruct->rxRing = NULL;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+}
+
+static void HalUart_StopRxTask(T_UartHandleStruct *uartHandleStruct)
+{
+    uint64_t eventCount = 1;
+
+    if (write(uartHandleStruct->stopEventFd, &eventCount, sizeof(eventCount)) != sizeof(eventCount)) {
+        USER_LOG_WARN("Notify uart receive task to stop failed, errno = %d", errno);
+    }
+    pthread_join(uartHandleStruct->rxThread, NULL);
+
+    if (uartHandleStruct->rxRingFullCount > 0) {
+        USER_LOG_WARN("Uart receive ring was full %d times.", uartHandleStruct->rxRingFullCount);
+    }
+
+    close(uartHandleStruct->epollFd);
+    close(uartHandleStruct->stopEventFd);
+    close(uartHandleStruct->rxEventFd);
+    free(uartHandleStruct->rxRing);
+    uartHandleStruct->rxRing = NULL;
+}
+
+static void *HalUart_RxTask(void *arg)
+{
+    T_UartHandleStruct *uartHandleStruct = (T_UartHandleStruct *) arg;
+    struct epoll_event events[UART_RX_EPOLL_EVENT_MAX_NUM];
+    struct epoll_event uartEvent = {0};
+    uint64_t eventCount = 1;
+    bool isRxRingFull = false;
+    bool isHangUp = false;
+    int32_t count;
+    int32_t ret;
+    int32_t i;
+
+    uartEvent.data.fd = uartHandleStruct->uartFd;
+
+    while (1) {
+        count = epoll_wait(uartHandleStruct->epollFd, events, UART_RX_EPOLL_EVENT_MAX_NUM,
+                           isRxRingFull ? UART_RX_RING_FULL_WAIT_MS : -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            USER_LOG_ERROR("Wait uart event failed, errno = %d", errno);
+            break;
+        }
+
+        isHangUp = false;
+        for (i = 0; i < count; i++) {
+            if (events[i].data.fd == uartHandleStruct->stopEventFd) {
+                return NULL;
+            }
+            if ((events[i].events & (EPOLLHUP | EPOLLERR)) != 0) {
+                isHangUp = true;
+            }
+        }
+
+        // While the ring is full the uart is left out of the wait, which then only times out to retry once the
+        // reader has made room, instead of reporting the still readable tty over and over.
+        ret = HalUart_DrainToRxRing(uartHandleStruct);
+        if (ret < 0 || (ret == 0 && isHangUp == true)) {
+            USER_LOG_ERROR("Uart receive stopped.");
+            break;
+        }
+        if (isRxRingFull != (ret > 0)) {
+            isRxRingFull = ret > 0;
+            uartEvent.events = isRxRingFull ? 0 : EPOLLIN;
+            if (epoll_ctl(uartHandleStruct->epollFd, EPOLL_CTL_MOD, uartHandleStruct->uartFd, &uartEvent) < 0) {
+                USER_LOG_ERROR("Modify uart epoll event failed, errno = %d", errno);
+                break;
+            }
+        }
+
+        if (write(uartHandleStruct->rxEventFd, &eventCount, sizeof(eventCount)) != sizeof(eventCount)) {
+            USER_LOG_WARN("Notify uart data ready failed, errno = %d", errno);
+        }
+    }
+
+    __atomic_store_n(&uartHandleStruct->isRxTaskFailed, true, __ATOMIC_RELEASE);
+    if (write(uartHandleStruct->rxEventFd, &eventCount, sizeof(eventCount)) != sizeof(eventCount)) {
+        USER_LOG_WARN("Notify uart data ready failed, errno = %d", errno);
+    }
+
+    // Keep the task joinable until deinit asks it to stop.
+    epoll_ctl(uartHandleStruct->epollFd, EPOLL_CTL_DEL, uartHandleStruct->uartFd, NULL);
+    while (1) {
+        count = epoll_wait(uartHandleStruct->epollFd, events, UART_RX_EPOLL_EVENT_MAX_NUM, -1);
+        for (i = 0; i < count; i++) {
+            if (events[i].data.fd == uartHandleStruct->stopEventFd) {
+                return NULL;
+            }
+        }
+        if (count < 0 && errno != EINTR) {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Read everything the tty holds into the receive ring.
+ * @return 0 when the tty was drained, 1 when the ring filled up first, -1 on a read error.
+ */
+static int32_t HalUart_DrainToRxRing(T_UartHandleStruct *uartHandleStruct)
+{
+    uint32_t head = uartHandleStruct->rxRingHead;
+    uint32_t tail;
+    uint32_t offset;
+    uint32_t freeLen;
+    ssize_t readLen;
+
+    while (1) {
+        tail = __atomic_load_n(&uartHandleStruct->rxRingTail, __ATOMIC_ACQUIRE);
+        freeLen = LINUX_UART_RX_RING_SIZE - (head - tail);
+        if (freeLen == 0) {
+            uartHandleStruct->rxRingFullCount++;
+            return 1;
+        }
+
+        offset = head & (LINUX_UART_RX_RING_SIZE - 1);
+        if (freeLen > LINUX_UART_RX_RING_SIZE - offset) {
+            freeLen = LINUX_UART_RX_RING_SIZE - offset;
+        }
+
+        readLen = read(uartHandleStruct->uartFd, uartHandleStruct->rxRing + offset, freeLen);
+        if (readLen > 0) {
+            head += (uint32_t) readLen;
+            __atomic_store_n(&uartHandleStruct->rxRingHead, head, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        if (readLen == 0 || errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+
+        USER_LOG_ERROR("Read uart failed, errno = %d", errno);
+        return -1;
+    }
+}
+
+static uint32_t HalUart_PopRxRing(T_UartHandleStruct *uartHandleStruct, uint8_t *buf, uint32_t len)
+{
+    uint32_t tail = uartHandleStruct->rxRingTail;
+    uint32_t head = __atomic_load_n(&uartHandleStruct->rxRingHead, __ATOMIC_ACQUIRE);
+    uint32_t offset = tail & (LINUX_UART_RX_RING_SIZE - 1);
+    uint32_t copyLen = head - tail;
+    uint32_t firstLen;
+
+    if (copyLen > len) {
+        copyLen = len;
+    }
+
+    firstLen = LINUX_UART_RX_RING_SIZE - offset;
+    if (firstLen > copyLen) {
+        firstLen = copyLen;
+    }
+    memcpy(buf, uartHandleStruct->rxRing + offset, firstLen);
+    memcpy(buf + firstLen, uartHandleStruct->rxRing, copyLen - firstLen);
+
+    __atomic_store_n(&uartHandleStruct->rxRingTail, tail + copyLen, __ATOMIC_RELEASE);
+
+    return copyLen;
+}
+
 
 /****************** (C) COPYRIGHT DJI Innovations *****END OF FILE****/
@@ -24,11 +24,11 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "hal_usb_bulk.h"
+#include "hal_usb_bulk_async.h"
 #include "dji_logger.h"
 
 /* Private constants ---------------------------------------------------------*/
 #define LINUX_USB_BULK_TRANSFER_TIMEOUT_MS    (50)
-#define LINUX_USB_BULK_TRANSFER_WAIT_FOREVER  (-1)
 
 /* Private types -------------------------------------------------------------*/
 typedef struct {
@@ -41,9 +41,16 @@ typedef struct {
     int32_t ep2;
     uint32_t interfaceNum;
     T_DjiHalUsbBulkInfo usbBulkInfo;
+    T_HalUsbBulkAsyncHandle asyncHandle;
 } T_HalUsbBulkObj;
 
 /* Private values -------------------------------------------------------------*/
+static const T_HalUsbBulkAsyncConfig s_usbBulkAsyncConfig = {
+    .queueDepth = LINUX_USB_BULK_ASYNC_QUEUE_DEPTH,
+    .rxBufferSize = LINUX_USB_BULK_ASYNC_RX_BUFFER_SIZE,
+    .txBufferSize = LINUX_USB_BULK_ASYNC_TX_BUFFER_SIZE,
+    .txTimeoutMs = LINUX_USB_BULK_TRANSFER_TIMEOUT_MS,
+};
 
 /* Private functions declaration ---------------------------------------------*/
 
@@ -57,30 +64,41 @@ T_DjiReturnCode HalUsbBulk_Init(T_DjiHalUsbBulkInfo usbBulkInfo, T_DjiUsbBulkHan
     if (*usbBulkHandle == NULL) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
+    ((T_HalUsbBulkObj *) *usbBulkHandle)->ep1 = -1;
+    ((T_HalUsbBulkObj *) *usbBulkHandle)->ep2 = -1;
 
     if (usbBulkInfo.isUsbHost == true) {
 #ifdef LIBUSB_INSTALLED
         ret = libusb_init(NULL);
         if (ret < 0) {
             USER_LOG_ERROR("init usb bulk failed, errno = %d", ret);
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            goto init_failed;
         }
 
         handle = libusb_open_device_with_vid_pid(NULL, usbBulkInfo.vid, usbBulkInfo.pid);
         if (handle == NULL) {
             USER_LOG_ERROR("open usb device failed");
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            goto init_failed;
         }
 
         ret = libusb_claim_interface(handle, usbBulkInfo.channelInfo.interfaceNum);
         if (ret != LIBUSB_SUCCESS) {
             USER_LOG_ERROR("libusb claim interface failed, errno = %d", ret);
             libusb_close(handle);
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+            goto init_failed;
         }
 
         ((T_HalUsbBulkObj *) *usbBulkHandle)->handle = handle;
         memcpy(&((T_HalUsbBulkObj *) *usbBulkHandle)->usbBulkInfo, &usbBulkInfo, sizeof(usbBulkInfo));
+
+        if (HalUsbBulkAsync_OpenHost(handle, usbBulkInfo.channelInfo.endPointIn, usbBulkInfo.channelInfo.endPointOut,
+                                     &s_usbBulkAsyncConfig, &((T_HalUsbBulkObj *) *usbBulkHandle)->asyncHandle) !=
+            DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("start usb bulk async transfer failed");
+            libusb_release_interface(handle, usbBulkInfo.channelInfo.interfaceNum);
+            libusb_close(handle);
+            goto init_failed;
+        }
 #endif
     } else {
         ((T_HalUsbBulkObj *) *usbBulkHandle)->handle = handle;
@@ -90,27 +108,47 @@ T_DjiReturnCode HalUsbBulk_Init(T_DjiHalUsbBulkInfo usbBulkInfo, T_DjiUsbBulkHan
         if (usbBulkInfo.channelInfo.interfaceNum == LINUX_USB_BULK1_INTERFACE_NUM) {
             ((T_HalUsbBulkObj *) *usbBulkHandle)->ep1 = open(LINUX_USB_BULK1_EP_OUT_FD, O_RDWR);
             if (((T_HalUsbBulkObj *) *usbBulkHandle)->ep1 < 0) {
-                return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+                goto init_failed;
             }
 
             ((T_HalUsbBulkObj *) *usbBulkHandle)->ep2 = open(LINUX_USB_BULK1_EP_IN_FD, O_RDWR);
             if (((T_HalUsbBulkObj *) *usbBulkHandle)->ep2 < 0) {
-                return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+                goto init_failed;
             }
         } else if (usbBulkInfo.channelInfo.interfaceNum == LINUX_USB_BULK2_INTERFACE_NUM) {
             ((T_HalUsbBulkObj *) *usbBulkHandle)->ep1 = open(LINUX_USB_BULK2_EP_OUT_FD, O_RDWR);
             if (((T_HalUsbBulkObj *) *usbBulkHandle)->ep1 < 0) {
-                return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+                goto init_failed;
             }
 
             ((T_HalUsbBulkObj *) *usbBulkHandle)->ep2 = open(LINUX_USB_BULK2_EP_IN_FD, O_RDWR);
             if (((T_HalUsbBulkObj *) *usbBulkHandle)->ep2 < 0) {
-                return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
+                goto init_failed;
             }
         }
+
+        if (HalUsbBulkAsync_OpenDevice(((T_HalUsbBulkObj *) *usbBulkHandle)->ep2,
+                                       ((T_HalUsbBulkObj *) *usbBulkHandle)->ep1, &s_usbBulkAsyncConfig,
+                                       &((T_HalUsbBulkObj *) *usbBulkHandle)->asyncHandle) !=
+            DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS) {
+            USER_LOG_ERROR("start usb bulk aio transfer failed");
+            goto init_failed;
+        }
     }
 
     return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+
+init_failed:
+    if (((T_HalUsbBulkObj *) *usbBulkHandle)->ep1 >= 0) {
+        close(((T_HalUsbBulkObj *) *usbBulkHandle)->ep1);
+    }
+    if (((T_HalUsbBulkObj *) *usbBulkHandle)->ep2 >= 0) {
+        close(((T_HalUsbBulkObj *) *usbBulkHandle)->ep2);
+    }
+    free(*usbBulkHandle);
+    *usbBulkHandle = NULL;
+
+    return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
 }
 
 T_DjiReturnCode HalUsbBulk_DeInit(T_DjiUsbBulkHandle usbBulkHandle)
@@ -127,6 +165,7 @@ T_DjiReturnCode HalUsbBulk_DeInit(T_DjiUsbBulkHandle usbBulkHandle)
 
     if (((T_HalUsbBulkObj *) usbBulkHandle)->usbBulkInfo.isUsbHost == true) {
 #ifdef LIBUSB_INSTALLED
+        HalUsbBulkAsync_Close(((T_HalUsbBulkObj *) usbBulkHandle)->asyncHandle);
         ret = libusb_release_interface(handle, ((T_HalUsbBulkObj *) usbBulkHandle)->usbBulkInfo.channelInfo.interfaceNum);
         if(ret != 0) {
             USER_LOG_ERROR("release usb bulk interface failed, errno = %d", ret);
@@ -136,6 +175,7 @@ T_DjiReturnCode HalUsbBulk_DeInit(T_DjiUsbBulkHandle usbBulkHandle)
         libusb_exit(NULL);
 #endif
     } else {
+        HalUsbBulkAsync_Close(((T_HalUsbBulkObj *) usbBulkHandle)->asyncHandle);
         close(((T_HalUsbBulkObj *) usbBulkHandle)->ep1);
         close(((T_HalUsbBulkObj *) usbBulkHandle)->ep2);
     }
@@ -148,63 +188,21 @@ T_DjiReturnCode HalUsbBulk_DeInit(T_DjiUsbBulkHandle usbBulkHandle)
 T_DjiReturnCode HalUsbBulk_WriteData(T_DjiUsbBulkHandle usbBulkHandle, const uint8_t *buf, uint32_t len,
                                      uint32_t *realLen)
 {
-    int32_t ret;
-    int32_t actualLen;
-    struct libusb_device_handle *handle = NULL;
-
     if (usbBulkHandle == NULL) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
-    handle = ((T_HalUsbBulkObj *) usbBulkHandle)->handle;
-
-    if (((T_HalUsbBulkObj *) usbBulkHandle)->usbBulkInfo.isUsbHost == true) {
-#ifdef LIBUSB_INSTALLED
-        ret = libusb_bulk_transfer(handle, ((T_HalUsbBulkObj *) usbBulkHandle)->usbBulkInfo.channelInfo.endPointOut,
-                                   (uint8_t *) buf, len, &actualLen, LINUX_USB_BULK_TRANSFER_TIMEOUT_MS);
-        if (ret < 0) {
-            USER_LOG_ERROR("Write usb bulk data failed, errno = %d", ret);
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        }
-
-        *realLen = actualLen;
-#endif
-    } else {
-        *realLen = write(((T_HalUsbBulkObj *) usbBulkHandle)->ep1, buf, len);
-    }
-
-    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return HalUsbBulkAsync_Write(((T_HalUsbBulkObj *) usbBulkHandle)->asyncHandle, buf, len, realLen);
 }
 
 T_DjiReturnCode HalUsbBulk_ReadData(T_DjiUsbBulkHandle usbBulkHandle, uint8_t *buf, uint32_t len,
                                     uint32_t *realLen)
 {
-    int32_t ret;
-    struct libusb_device_handle *handle = NULL;
-    int32_t actualLen;
-
     if (usbBulkHandle == NULL) {
         return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
     }
 
-    handle = ((T_HalUsbBulkObj *) usbBulkHandle)->handle;
-
-    if (((T_HalUsbBulkObj *) usbBulkHandle)->usbBulkInfo.isUsbHost == true) {
-#ifdef LIBUSB_INSTALLED
-        ret = libusb_bulk_transfer(handle, ((T_HalUsbBulkObj *) usbBulkHandle)->usbBulkInfo.channelInfo.endPointIn,
-                                   buf, len, &actualLen, LINUX_USB_BULK_TRANSFER_WAIT_FOREVER);
-        if (ret < 0) {
-            USER_LOG_ERROR("Read usb bulk data failed, errno = %d", ret);
-            return DJI_ERROR_SYSTEM_MODULE_CODE_SYSTEM_ERROR;
-        }
-
-        *realLen = actualLen;
-#endif
-    } else {
-        *realLen = read(((T_HalUsbBulkObj *) usbBulkHandle)->ep2, buf, len);
-    }
-
-    return DJI_ERROR_SYSTEM_MODULE_CODE_SUCCESS;
+    return HalUsbBulkAsync_Read(((T_HalUsbBulkObj *) usbBulkHandle)->asyncHandle, buf, len, realLen);
 }
 
 T_DjiReturnCode HalUsbBulk_GetDeviceInfo(T_DjiHalUsbBulkDeviceInfo *deviceInfo)
@@ -73,13 +73,20 @@ extern "C" {
 #define LINUX_USB_PID                         (0x7020)
 #endif
 
+/* Transfers kept in flight per endpoint, raise it for higher throughput on fast links. */
+#define LINUX_USB_BULK_ASYNC_QUEUE_DEPTH        (8)
+#define LINUX_USB_BULK_ASYNC_RX_BUFFER_SIZE     (128 * 1024)
+#define LINUX_USB_BULK_ASYNC_TX_BUFFER_SIZE     (64 * 1024)
+
 /* Exported types ------------------------------------------------------------*/
 
 /* Exported functions --------------------------------------------------------*/
 T_DjiReturnCode HalUsbBulk_Init(T_DjiHalUsbBulkInfo usbBulkInfo, T_DjiUsbBulkHandle *usbBulkHandle);
 T_DjiReturnCode HalUsbBulk_DeInit(T_DjiUsbBulkHandle usbBulkHandle);
+// returns once the data is queued, a transfer failing after that is reported by the next call
 T_DjiReturnCode HalUsbBulk_WriteData(T_DjiUsbBulkHandle usbBulkHandle, const uint8_t *buf, uint32_t len,
                                      uint32_t *realLen);
+// returns data from one transfer per call, the part of a transfer longer than len is kept for the next call
 T_DjiReturnCode HalUsbBulk_ReadData(T_DjiUsbBulkHandle usbBulkHandle, uint8_t *buf, uint32_t len, uint32_t *realLen);
 T_DjiReturnCode HalUsbBulk_GetDeviceInfo(T_DjiHalUsbBulkDeviceInfo *deviceInfo);
 
@@ -0,0 +1,125 @@
+/**
+ ********************************************************************
+ * @file    hal_usb_bulk_async.h
+ * @brief   This is the header file for "hal_usb_bulk_async.c", defining the structure and
+ * (exported) function prototypes.
+ *
+ * @copyright (c) 2021 DJI. All rights reserved.
+ *
+ * All information contained herein is, and remains, the property of DJI.
+ * The intellectual and technical concepts contained herein are proprietary
+ * to DJI and may be covered by U.S. and foreign patents, patents in process,
+ * and protected by trade secret or copyright law.  Dissemination of this
+ * information, including but not limited to data and other proprietary
+ * material(s) incorporated within the information, in any form, is strictly
+ * prohibited without the express written consent of DJI.
+ *
+ * If you receive this source code without DJI’s authorization, you may not
+ * further disseminate the information, and you must immediately remove the
+ * source code and notify DJI of its removal. DJI reserves the right to pursue
+ * legal actions against you for any loss(es) or damage(s) caused by your
+ * failure to do so.
+ *
+ *********************************************************************
+ */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef HAL_USB_BULK_ASYNC_H
+#define HAL_USB_BULK_ASYNC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+#ifdef LIBUSB_INSTALLED
+
+#include <libusb-1.0/libusb.h>
+
+#endif
+
+#include "dji_platform.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported constants --------------------------------------------------------*/
+#define HAL_USB_BULK_ASYNC_QUEUE_DEPTH_MAX      (32)
+
+/* Exported types ------------------------------------------------------------*/
+typedef void *T_HalUsbBulkAsyncHandle;
+
+typedef struct {
+    uint32_t queueDepth;     /*!< Transfers kept in flight per endpoint. */
+    uint32_t rxBufferSize;   /*!< Size of each receive buffer, unit: byte. */
+    uint32_t txBufferSize;   /*!< Initial size of each transmit buffer, grows on demand, unit: byte. */
+    uint32_t txTimeoutMs;    /*!< Time to wait for a free transmit buffer and for a transfer to finish. */
+} T_HalUsbBulkAsyncConfig;
+
+typedef struct {
+    uint64_t rxBytes;
+    uint64_t txBytes;
+    uint32_t rxTransferCount;
+    uint32_t txTransferCount;
+    uint32_t rxErrorCount;
+    uint32_t txErrorCount;
+    uint32_t txQueueFullCount;
+} T_HalUsbBulkAsyncStatistics;
+
+/* Exported functions --------------------------------------------------------*/
+#ifdef LIBUSB_INSTALLED
+/**
+ * @brief Start asynchronous transfers on the bulk endpoints of a claimed libusb interface.
+ * @param handle: opened device with the interface already claimed.
+ * @param endPointIn: address of the bulk IN endpoint.
+ * @param endPointOut: address of the bulk OUT endpoint.
+ * @param config: queue configuration.
+ * @param asyncHandle: created transfer engine.
+ * @return Execution result.
+ */
+T_DjiReturnCode HalUsbBulkAsync_OpenHost(libusb_device_handle *handle, uint8_t endPointIn, uint8_t endPointOut,
+                                         const T_HalUsbBulkAsyncConfig *config,
+                                         T_HalUsbBulkAsyncHandle *asyncHandle);
+#endif
+
+/**
+ * @brief Start asynchronous transfers with Linux AIO on the endpoint files of a FunctionFS gadget.
+ * @param readFd: endpoint file receiving data from the host.
+ * @param writeFd: endpoint file sending data to the host.
+ * @param config: queue configuration.
+ * @param asyncHandle: created transfer engine.
+ * @return Execution result.
+ */
+T_DjiReturnCode HalUsbBulkAsync_OpenDevice(int32_t readFd, int32_t writeFd, const T_HalUsbBulkAsyncConfig *config,
+                                           T_HalUsbBulkAsyncHandle *asyncHandle);
+
+/**
+ * @brief Cancel the transfers in flight, stop the event thread and free the engine.
+ * @note The libusb handle and the endpoint files are left open for the caller.
+ */
+T_DjiReturnCode HalUsbBulkAsync_Close(T_HalUsbBulkAsyncHandle asyncHandle);
+
+/**
+ * @brief Queue data for sending. Returns as soon as the data is copied into a free transmit buffer.
+ * @note A transfer that fails after this call has returned is reported by the next call, which then returns an
+ * error without queueing its data.
+ */
+T_DjiReturnCode HalUsbBulkAsync_Write(T_HalUsbBulkAsyncHandle asyncHandle, const uint8_t *buf, uint32_t len,
+                                      uint32_t *realLen);
+
+/**
+ * @brief Take data from the oldest completed receive buffer, waiting until one completes.
+ * @note Each call returns data from a single transfer, as a blocking bulk read does. Unlike a blocking read, a
+ * transfer carrying more than len bytes is not truncated: the rest is returned by the following calls, and the
+ * buffer is resubmitted only once it has been consumed completely.
+ */
+T_DjiReturnCode HalUsbBulkAsync_Read(T_HalUsbBulkAsyncHandle asyncHandle, uint8_t *buf, uint32_t len,
+                                     uint32_t *realLen);
+
+T_DjiReturnCode HalUsbBulkAsync_GetStatistics(T_HalUsbBulkAsyncHandle asyncHandle,
+                                              T_HalUsbBulkAsyncStatistics *statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HAL_USB_BULK_ASYNC_H
+/************************ (C) COPYRIGHT DJI Innovations *******END OF FILE******/
@@ -48,6 +48,11 @@ extern "C" {
 #define LINUX_UART_DEV1    "/dev/ttyAMA1"
 #define LINUX_UART_DEV2    "/dev/ttyAMA2"
 
+//Bytes buffered between the receive task and HalUart_ReadData, must be a power of two
+#define LINUX_UART_RX_RING_SIZE         (64 * 1024)
+//Time HalUart_ReadData waits for data before returning with zero length
+#define LINUX_UART_READ_TIMEOUT_MS      (10)
+
 /**
  * Use for Eport 2.0, specify the VID and PID of the USB serial port closest to the aircraft.
  * FT232    0x0403:0x6001